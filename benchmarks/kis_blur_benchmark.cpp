@@ -36,6 +36,9 @@
 
 #include "kis_selection.h"
 #include <kis_iterator_ng.h>
+#include <kis_convolution_painter.h>
+#include <kis_convolution_kernel.h>
+#include <kis_gaussian_kernel.h>
 #include <KisGlobalResourcesInterface.h>
 
 void KisBlurBenchmark::initTestCase()
@@ -88,6 +91,56 @@ void KisBlurBenchmark::benchmarkFilter()
     }
 }
 
+void KisBlurBenchmark::benchmarkGaussian_data()
+{
+    QTest::addColumn<qreal>("radius");
+    QTest::addColumn<bool>("useBoxGaussian");
+
+    const QVector<qreal> radii({1, 3, 10, 30, 100, 300, 1000});
+
+    Q_FOREACH (qreal radius, radii) {
+        QTest::newRow(QString("box-%1").arg(radius).toLatin1()) << radius << true;
+
+        // the spatial kernels are too slow to be benchmarked with huge radii
+        if (radius <= 100) {
+            QTest::newRow(QString("kernel-%1").arg(radius).toLatin1()) << radius << false;
+        }
+    }
+}
+
+void KisBlurBenchmark::benchmarkGaussian()
+{
+    QFETCH(qreal, radius);
+    QFETCH(bool, useBoxGaussian);
 
+    // the device has no image, so it has no bounds to repeat the border pixels of
+    const QRect rect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+    KisPaintDeviceSP dst = new KisPaintDevice(m_colorSpace);
+
+    if (useBoxGaussian) {
+        QBENCHMARK_ONCE {
+            KisConvolutionPainter painter(dst, KisConvolutionPainter::BOX_GAUSSIAN);
+            painter.applyGaussian(m_device, rect.topLeft(), rect.topLeft(), rect.size(), radius, radius, BORDER_IGNORE);
+        }
+    } else {
+        KisConvolutionKernelSP kernelHoriz = KisGaussianKernel::createHorizontalKernel(radius);
+        KisConvolutionKernelSP kernelVertical = KisGaussianKernel::createVerticalKernel(radius);
+        const int verticalCenter = kernelVertical->height() / 2;
+
+        QBENCHMARK_ONCE {
+            KisPaintDeviceSP interm = new KisPaintDevice(m_colorSpace);
+
+            KisConvolutionPainter horizPainter(interm, KisConvolutionPainter::SPATIAL);
+            horizPainter.applyMatrix(kernelHoriz, m_device,
+                                     rect.topLeft() - QPoint(0, verticalCenter),
+                                     rect.topLeft() - QPoint(0, verticalCenter),
+                                     rect.size() + QSize(0, 2 * verticalCenter),
+                                     BORDER_IGNORE);
+
+            KisConvolutionPainter verticalPainter(dst, KisConvolutionPainter::SPATIAL);
+            verticalPainter.applyMatrix(kernelVertical, interm, rect.topLeft(), rect.topLeft(), rect.size(), BORDER_IGNORE);
+        }
+    }
+}
 
 QTEST_MAIN(KisBlurBenchmark)
@@ -24,6 +24,7 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColor.h>
+#include <KoColorModelStandardIds.h>
 
 #include <kis_image.h>
 
@@ -65,11 +66,8 @@ void KisLevelFilterBenchmark::cleanupTestCase()
 {
 }
 
-void KisLevelFilterBenchmark::benchmarkFilter()
+KisFilterConfigurationSP KisLevelFilterBenchmark::createLevelsConfiguration(KisFilterSP filter)
 {
-    KisFilterSP filter = KisFilterRegistry::instance()->value("levels");
-    //KisFilterConfigurationSP  kfc = filter->defaultConfiguration(m_device);
-
     KisColorTransformationConfiguration * kfc= new KisColorTransformationConfiguration("levels", 1, KisGlobalResourcesInterface::instance());
 
     kfc->setProperty("blackvalue", 75);
@@ -92,12 +90,92 @@ void KisLevelFilterBenchmark::benchmarkFilter()
         kfc->fromXML(s);
     }
 
+    return kfc;
+}
+
+void KisLevelFilterBenchmark::benchmarkFilter_data()
+{
+    QTest::addColumn<QString>("filterId");
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<QString>("configuration");
+
+    /**
+     * The curves of the RGB virtual channels: all colors, red, green,
+     * blue, alpha, hue, saturation and lightness
+     */
+    const QString perChannelConfig =
+        "<!DOCTYPE params>"
+        "<params version=\"1\">"
+        "<param name=\"nTransfers\">8</param>"
+        "<param name=\"curve0\">0,0.1;1,0.9;</param>"
+        "<param name=\"curve1\">0,0;0.5,0.7;1,1;</param>"
+        "<param name=\"curve2\">0,0;1,1;</param>"
+        "<param name=\"curve3\">0,0;0.5,0.3;1,1;</param>"
+        "<param name=\"curve4\">0,0;1,1;</param>"
+        "<param name=\"curve5\">0,0;1,1;</param>"
+        "<param name=\"curve6\">0,0;1,1;</param>"
+        "<param name=\"curve7\">0,0;1,1;</param>"
+        "</params>";
+
+    // the red channel is driven by the green one
+    const QString crossChannelConfig =
+        "<!DOCTYPE params>"
+        "<params version=\"1\">"
+        "<param name=\"nTransfers\">8</param>"
+        "<param name=\"curve0\">0,0.5;1,0.5;</param>"
+        "<param name=\"curve1\">0,0.4;1,0.7;</param>"
+        "<param name=\"curve2\">0,0.5;1,0.5;</param>"
+        "<param name=\"curve3\">0,0.5;1,0.5;</param>"
+        "<param name=\"curve4\">0,0.5;1,0.5;</param>"
+        "<param name=\"curve5\">0,0.5;1,0.5;</param>"
+        "<param name=\"curve6\">0,0.5;1,0.5;</param>"
+        "<param name=\"curve7\">0,0.5;1,0.5;</param>"
+        "<param name=\"driver1\">2</param>"
+        "</params>";
+
+    QList<KoID> depths;
+    depths << Integer8BitsColorDepthID << Integer16BitsColorDepthID << Float32BitsColorDepthID;
+
+    Q_FOREACH (const KoID &depth, depths) {
+        QTest::newRow(QString("levels-%1").arg(depth.id()).toLatin1())
+            << "levels" << depth.id() << QString();
+        QTest::newRow(QString("perchannel-%1").arg(depth.id()).toLatin1())
+            << "perchannel" << depth.id() << perChannelConfig;
+        QTest::newRow(QString("crosschannel-%1").arg(depth.id()).toLatin1())
+            << "crosschannel" << depth.id() << crossChannelConfig;
+    }
+}
+
+void KisLevelFilterBenchmark::benchmarkFilter()
+{
+    QFETCH(QString, filterId);
+    QFETCH(QString, colorDepthId);
+    QFETCH(QString, configuration);
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value(filterId);
+    QVERIFY(filter);
+
+    KisFilterConfigurationSP kfc;
+
+    if (configuration.isEmpty()) {
+        kfc = createLevelsConfiguration(filter);
+    } else {
+        kfc = filter->defaultConfiguration(KisGlobalResourcesInterface::instance());
+        kfc->fromXML(configuration);
+    }
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepthId, 0);
+    QVERIFY(cs);
+
+    KisPaintDeviceSP device = new KisPaintDevice(*m_device);
+    device->convertTo(cs);
+
     QSize size = KritaUtils::optimalPatchSize();
     QVector<QRect> rects = KritaUtils::splitRectIntoPatches(QRect(0, 0, GMP_IMAGE_WIDTH,GMP_IMAGE_HEIGHT), size);
 
     QBENCHMARK{
         Q_FOREACH (const QRect &rc, rects) {
-            filter->process(m_device, rc, kfc);
+            filter->process(device, rc, kfc);
         }
     }
 }
@@ -35,10 +35,13 @@ private:
     KisPaintDeviceSP m_device;
     KoColor m_color;
 
+    KisFilterConfigurationSP createLevelsConfiguration(KisFilterSP filter);
+
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
 
+    void benchmarkFilter_data();
     void benchmarkFilter();
 };
 
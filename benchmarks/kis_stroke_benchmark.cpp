@@ -28,6 +28,7 @@ inline double drand48()
 
 #include <QPainterPath>
 #include <QTest>
+#include <QtConcurrent>
 
 #include "kis_stroke_benchmark.h"
 #include "kis_benchmark_values.h"
@@ -44,6 +45,8 @@ inline double drand48()
 
 #include <brushengine/kis_paint_information.h>
 #include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop.h>
+#include <brushengine/kis_paintop_utils.h>
 
 #define GMP_IMAGE_WIDTH 3274
 #define GMP_IMAGE_HEIGHT 2067
@@ -51,9 +54,51 @@ inline double drand48()
 #include <brushengine/kis_paintop_registry.h>
 
 #include <KisGlobalResourcesInterface.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
 
 //#define SAVE_OUTPUT
 
+/**
+ * Runs the concurrent jobs of the paintop in the global thread pool, the
+ * same way the strokes queue does, so that the pipelined paintops could be
+ * measured in the real multithreaded conditions.
+ */
+class ThreadedStrokeJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+public:
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobDataBase*> &list) override {
+        QVector<KisRunnableStrokeJobDataBase*> concurrentJobs;
+
+        Q_FOREACH (KisRunnableStrokeJobDataBase *data, list) {
+            if (data->sequentiality() == KisStrokeJobData::CONCURRENT) {
+                concurrentJobs.append(data);
+            } else {
+                runConcurrently(concurrentJobs);
+                data->run();
+            }
+        }
+
+        runConcurrently(concurrentJobs);
+        qDeleteAll(list);
+    }
+
+private:
+    static void runConcurrently(QVector<KisRunnableStrokeJobDataBase*> &jobs) {
+        QVector<QFuture<void>> futures;
+
+        Q_FOREACH (KisRunnableStrokeJobDataBase *data, jobs) {
+            futures.append(QtConcurrent::run([data] () { data->run(); }));
+        }
+
+        Q_FOREACH (QFuture<void> future, futures) {
+            future.waitForFinished();
+        }
+
+        jobs.clear();
+    }
+};
+
 static const int LINES = 20;
 static const int RECTANGLES = 20;
 const QString OUTPUT_FORMAT = ".png";
@@ -359,6 +404,24 @@ void KisStrokeBenchmark::colorsmudgeRL()
     benchmarkStroke(presetFileName);
 }
 
+void KisStrokeBenchmark::colorsmudgeThreaded()
+{
+    QString presetFileName = "colorsmudge.kpp";
+    benchmarkThreadedStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::sprayTextureThreaded()
+{
+    QString presetFileName = "spray_21_textures1.kpp";
+    benchmarkThreadedStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::hairy30pxDefaultThreaded()
+{
+    QString presetFileName = "hairybrush_thesis30px1.kpp";
+    benchmarkThreadedStroke(presetFileName);
+}
+
 
 void KisStrokeBenchmark::roundMarker()
 {
@@ -503,6 +566,7 @@ QBENCHMARK{
         }
         m_painter->paintLine(prev, first, &currentDistance);
     }
+    KisPaintOpUtils::flushAsynchronousUpdates(m_painter);
 }
 
 #ifdef SAVE_OUTPUT
@@ -533,6 +597,7 @@ void KisStrokeBenchmark::benchmarkRandomLines(QString presetFileName)
             KisPaintInformation pi2(m_endPoints[i], 1.0);
             m_painter->paintLine(pi1, pi2, &currentDistance);
         }
+        KisPaintOpUtils::flushAsynchronousUpdates(m_painter);
     }
 
 #ifdef SAVE_OUTPUT
@@ -564,6 +629,7 @@ void KisStrokeBenchmark::benchmarkRectangle(QString presetFileName)
             path.addRect(rect);
             m_painter->paintPainterPath(path);
         }
+        KisPaintOpUtils::flushAsynchronousUpdates(m_painter);
     }
 
 #ifdef SAVE_OUTPUT
@@ -588,6 +654,7 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
         KisDistanceInformation currentDistance;
         m_painter->paintBezierCurve(m_pi1, m_c1, m_c1, m_pi2, &currentDistance);
         m_painter->paintBezierCurve(m_pi2, m_c2, m_c2, m_pi3, &currentDistance);
+        KisPaintOpUtils::flushAsynchronousUpdates(m_painter);
     }
 
 #ifdef SAVE_OUTPUT
@@ -596,6 +663,16 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
 #endif
 }
 
+void KisStrokeBenchmark::benchmarkThreadedStroke(QString presetFileName)
+{
+    ThreadedStrokeJobsExecutor executor;
+    m_painter->setRunnableStrokeJobsInterface(&executor);
+
+    benchmarkStroke(presetFileName);
+
+    m_painter->setRunnableStrokeJobsInterface(0);
+}
+
 static const int COUNT = 1000000;
 void KisStrokeBenchmark::benchmarkRand48()
 {
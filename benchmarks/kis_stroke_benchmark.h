@@ -68,6 +68,7 @@ private:
         inline void benchmarkLine(QString presetFileName);
         inline void benchmarkCircle(QString presetFileName);
         inline void benchmarkRectangle(QString presetFileName);
+        inline void benchmarkThreadedStroke(QString presetFileName);
 
 private Q_SLOTS:
     void initTestCase();
@@ -102,6 +103,8 @@ private Q_SLOTS:
     void hairy30InkDepletion();
     void hairy30InkDepletionRL();
 
+    void hairy30pxDefaultThreaded();
+
     // Spray brush benchmark1
     void spray30px21particles();
     void spray30px21particlesRL();
@@ -114,6 +117,7 @@ private Q_SLOTS:
 
     void sprayTexture();
     void sprayTextureRL();
+    void sprayTextureThreaded();
 
     void dynabrush();
     void dynabrushRL();
@@ -126,6 +130,7 @@ private Q_SLOTS:
 
     void colorsmudge();
     void colorsmudgeRL();
+    void colorsmudgeThreaded();
 
     void roundMarker();
     void roundMarkerRandomLines();
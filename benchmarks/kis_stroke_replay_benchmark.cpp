@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_stroke_replay_benchmark.h"
+
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTest>
+
+#include "kis_benchmark_values.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <kis_distance_information.h>
+
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_settings.h>
+#include <brushengine/kis_paintop.h>
+#include <brushengine/kis_paintop_utils.h>
+#include <brushengine/KisStrokeRecording.h>
+#include <brushengine/kis_random_source.h>
+#include <brushengine/KisPerStrokeRandomSource.h>
+
+#include <KisGlobalResourcesInterface.h>
+
+namespace {
+
+const QString DEFAULT_RECORDING_FILE_NAME = "stroke_replay_sample.kstroke";
+const QString FALLBACK_PRESET_FILE_NAME = "softbrush_30px.kpp";
+
+// the same values as used by KisToolFreehandHelper
+const qreal SPACING_UPDATE_INTERVAL = 50.0;
+const qreal TIMING_UPDATE_INTERVAL = 50.0;
+
+const int RANDOM_SEED = 12345678;
+
+qreal percentile(const QVector<qreal> &sortedValues, qreal portion)
+{
+    if (sortedValues.isEmpty()) return 0.0;
+
+    const int index = qBound(0, qRound(portion * (sortedValues.size() - 1)), sortedValues.size() - 1);
+    return sortedValues[index];
+}
+
+}
+
+void KisStrokeReplayBenchmark::initTestCase()
+{
+    m_dataPath = QString(FILES_DATA_DIR) + '/';
+
+    m_recordingFileName = qEnvironmentVariableIsEmpty("KRITA_STROKE_REPLAY_FILE") ?
+        m_dataPath + DEFAULT_RECORDING_FILE_NAME :
+        QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_FILE"));
+}
+
+KisPaintOpPresetSP KisStrokeReplayBenchmark::loadPreset(const KisStrokeRecording &recording)
+{
+    QString presetFileName;
+
+    if (!qEnvironmentVariableIsEmpty("KRITA_STROKE_REPLAY_PRESET")) {
+        presetFileName = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_PRESET"));
+
+        if (QFileInfo(presetFileName).isRelative() && !QFileInfo(presetFileName).exists()) {
+            presetFileName = m_dataPath + presetFileName;
+        }
+    } else if (recording.preset()) {
+        return recording.preset();
+    } else {
+        presetFileName = m_dataPath + FALLBACK_PRESET_FILE_NAME;
+    }
+
+    KisPaintOpPresetSP preset(new KisPaintOpPreset(presetFileName));
+    if (!preset->load(KisGlobalResourcesInterface::instance())) {
+        qWarning() << "Couldn't load the preset" << presetFileName;
+        return KisPaintOpPresetSP();
+    }
+
+    return preset;
+}
+
+void KisStrokeReplayBenchmark::benchmarkReplay()
+{
+    KisStrokeRecording recording;
+    QVERIFY(recording.load(m_recordingFileName, KisGlobalResourcesInterface::instance()));
+
+    KisPaintOpPresetSP preset = loadPreset(recording);
+    QVERIFY(preset);
+    QVERIFY(preset->settings());
+
+    const KoColorSpace *cs = recording.colorSpace();
+
+    QRect bounds = recording.imageBounds();
+    if (bounds.isEmpty()) {
+        bounds = QRect(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    }
+
+    KisImageSP image = new KisImage(0, bounds.width(), bounds.height(), cs, "stroke replay image");
+    image->setResolution(recording.xRes(), recording.yRes());
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "stroke replay layer", OPACITY_OPAQUE_U8, cs);
+
+    const QVector<KisStrokeRecording::Segment> segments = recording.segments();
+
+    QVector<qreal> segmentLatencies;
+    int numDabs = 0;
+    qint64 totalTime = 0;
+
+    QBENCHMARK_ONCE {
+        KisPainter painter(layer->paintDevice());
+        painter.setPaintColor(recording.paintColor().convertedTo(cs));
+        painter.setCompositeOp(recording.compositeOpId());
+        painter.setOpacity(recording.opacity());
+        painter.setPaintOpPreset(preset, layer, image);
+
+        const bool airbrushing = preset->settings()->isAirbrushing();
+        const bool useSpacingUpdates = preset->settings()->useSpacingUpdates();
+
+        KisDistanceInformation distance(useSpacingUpdates ? SPACING_UPDATE_INTERVAL : LONG_TIME,
+                                        airbrushing ? TIMING_UPDATE_INTERVAL : LONG_TIME);
+
+        // make the randomized brushes produce the same image in every run
+        qsrand(RANDOM_SEED);
+        KisRandomSourceSP randomSource(new KisRandomSource(RANDOM_SEED));
+        KisPerStrokeRandomSourceSP strokeRandomSource(new KisPerStrokeRandomSource());
+
+        QElapsedTimer timer;
+
+        Q_FOREACH (KisStrokeRecording::Segment segment, segments) {
+            segment.pi1.setRandomSource(randomSource);
+            segment.pi1.setPerStrokeRandomSource(strokeRandomSource);
+            segment.pi2.setRandomSource(randomSource);
+            segment.pi2.setPerStrokeRandomSource(strokeRandomSource);
+
+            const int dabsBefore = distance.currentDabSeqNo();
+            timer.start();
+
+            switch (segment.type) {
+            case KisStrokeRecording::Point:
+                painter.paintAt(segment.pi1, &distance);
+                break;
+            case KisStrokeRecording::Line:
+                painter.paintLine(segment.pi1, segment.pi2, &distance);
+                break;
+            case KisStrokeRecording::BezierCurve:
+                painter.paintBezierCurve(segment.pi1,
+                                         segment.control1, segment.control2,
+                                         segment.pi2, &distance);
+                break;
+            }
+
+            KisPaintOpUtils::flushAsynchronousUpdates(&painter);
+
+            const qint64 elapsed = timer.nsecsElapsed();
+
+            totalTime += elapsed;
+            numDabs += distance.currentDabSeqNo() - dabsBefore;
+
+            /**
+             * The dabs of a segment are painted in one call and some
+             * paintops render them in batches, so the latency can only
+             * be measured per segment, that is per input event
+             */
+            segmentLatencies.append(elapsed / 1000.0);
+        }
+    }
+
+    std::sort(segmentLatencies.begin(), segmentLatencies.end());
+
+    KisPaintDeviceSP dev = layer->paintDevice();
+    QByteArray pixels(bounds.width() * bounds.height() * cs->pixelSize(), 0);
+    dev->readBytes(reinterpret_cast<quint8*>(pixels.data()), QRect(QPoint(), bounds.size()));
+    const QByteArray hash = QCryptographicHash::hash(pixels, QCryptographicHash::Md5).toHex();
+
+    const qreal totalSeconds = totalTime / 1e9;
+
+    qDebug().noquote() << "Stroke replay:" << QFileInfo(m_recordingFileName).fileName();
+    qDebug().noquote() << "  Preset:" << preset->name();
+    qDebug().noquote() << "  Segments:" << segments.size();
+    qDebug().noquote() << "  Dabs:" << numDabs;
+    qDebug().noquote() << "  Time (ms):" << totalTime / 1000000.0;
+    qDebug().noquote() << "  Dabs/s:" << (totalSeconds > 0 ? numDabs / totalSeconds : 0.0);
+    qDebug().noquote() << "  Segment latency p50 (us):" << percentile(segmentLatencies, 0.5);
+    qDebug().noquote() << "  Segment latency p90 (us):" << percentile(segmentLatencies, 0.9);
+    qDebug().noquote() << "  Segment latency p99 (us):" << percentile(segmentLatencies, 0.99);
+    qDebug().noquote() << "  Segment latency max (us):" << (segmentLatencies.isEmpty() ? 0.0 : segmentLatencies.last());
+    qDebug().noquote() << "  Image hash (md5):" << QString::fromLatin1(hash);
+}
+
+QTEST_MAIN(KisStrokeReplayBenchmark)
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_STROKE_REPLAY_BENCHMARK_H
+#define KIS_STROKE_REPLAY_BENCHMARK_H
+
+#include <QtTest>
+
+#include <kis_types.h>
+
+class KisStrokeRecording;
+
+/**
+ * Replays a stroke recorded by the freehand tool (see KisStrokeRecording)
+ * and reports the number of dabs painted per second, the percentiles of
+ * the latency of painting one recorded segment (one input event) and the
+ * hash of the resulting image.
+ *
+ * The benchmark is configured with the environment variables:
+ *
+ * KRITA_STROKE_REPLAY_FILE -- the *.kstroke file to replay, the sample
+ *                             recording from the data folder is used
+ *                             by default
+ *
+ * KRITA_STROKE_REPLAY_PRESET -- the *.kpp preset to replay the stroke
+ *                               with. By default, the preset saved in
+ *                               the recording is used.
+ */
+class KisStrokeReplayBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    KisPaintOpPresetSP loadPreset(const KisStrokeRecording &recording);
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchmarkReplay();
+
+private:
+    QString m_dataPath;
+    QString m_recordingFileName;
+};
+
+#endif // KIS_STROKE_REPLAY_BENCHMARK_H
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISQIMAGESAMPLERBASE_H
+#define KISQIMAGESAMPLERBASE_H
+
+#include "kritabrush_export.h"
+
+class QImage;
+class QTransform;
+
+/**
+ * Resamples the levels of KisQImagePyramid into the brush dabs.
+ *
+ * The implementations are created per-arch with KisQImageSamplerFactoryImpl.
+ * The sampling is bilinear and follows the rules of QPainter with
+ * SmoothPixmapTransform hint: the value of every destination pixel is
+ * taken at its center, the pixels outside the source image are
+ * considered to be transparent.
+ */
+class BRUSH_EXPORT KisQImageSamplerBase
+{
+public:
+    virtual ~KisQImageSamplerBase();
+
+    /**
+     * Fills \p dst with \p src transformed by \p transform
+     *
+     * \p src must be in QImage::Format_ARGB32_Premultiplied, \p dst must be
+     * preallocated in QImage::Format_ARGB32. \p transform maps the pixel
+     * coordinates of \p src into the ones of \p dst and must be affine.
+     */
+    virtual void transform(const QImage &src, const QTransform &transform, QImage *dst) const = 0;
+};
+
+#endif // KISQIMAGESAMPLERBASE_H
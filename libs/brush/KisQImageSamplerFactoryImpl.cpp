@@ -0,0 +1,289 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisQImageSamplerFactoryImpl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#include <QImage>
+#include <QTransform>
+
+#include <kis_assert.h>
+
+#include "KisQImageSamplerBase.h"
+
+/**
+ * NOTE: this file is compiled once per every supported instruction set,
+ *       so everything except the factory method should have internal
+ *       linkage, otherwise the linker may pick the AVX version of an
+ *       inline function for the SSE2 kernel.
+ */
+
+namespace {
+
+struct SourceImage
+{
+    SourceImage(const QImage &image)
+        : bits(reinterpret_cast<const quint32*>(image.constBits())),
+          width(image.width()),
+          height(image.height()),
+          stride(image.bytesPerLine() / 4)
+    {
+    }
+
+    const quint32 *bits;
+    int width;
+    int height;
+    int stride; // in pixels
+};
+
+inline quint32 fetchPixel(const SourceImage &src, int x, int y)
+{
+    return x >= 0 && x < src.width && y >= 0 && y < src.height ?
+        src.bits[y * src.stride + x] : 0;
+}
+
+/**
+ * Converts an interpolated premultiplied pixel into
+ * QImage::Format_ARGB32. The channels are in BGRA order.
+ */
+inline quint32 packUnpremultiplied(const float *c)
+{
+    const float alpha = c[3];
+    if (alpha < 0.5f) return 0;
+
+    const float k = 255.0f / alpha;
+
+    return
+        (quint32(qMin(alpha + 0.5f, 255.0f)) << 24) |
+        (quint32(qMin(c[2] * k + 0.5f, 255.0f)) << 16) |
+        (quint32(qMin(c[1] * k + 0.5f, 255.0f)) << 8) |
+        quint32(qMin(c[0] * k + 0.5f, 255.0f));
+}
+
+inline quint32 samplePixel(const SourceImage &src, float sx, float sy)
+{
+    const float x0 = std::floor(sx);
+    const float y0 = std::floor(sy);
+    const float fx = sx - x0;
+    const float fy = sy - y0;
+
+    const int ix = int(x0);
+    const int iy = int(y0);
+
+    const quint32 p00 = fetchPixel(src, ix, iy);
+    const quint32 p01 = fetchPixel(src, ix + 1, iy);
+    const quint32 p10 = fetchPixel(src, ix, iy + 1);
+    const quint32 p11 = fetchPixel(src, ix + 1, iy + 1);
+
+    if (!(p00 | p01 | p10 | p11)) return 0;
+
+    float c[4];
+
+    for (int ch = 0; ch < 4; ch++) {
+        const int shift = 8 * ch;
+
+        const float top =
+            ((p00 >> shift) & 0xff) * (1.0f - fx) +
+            ((p01 >> shift) & 0xff) * fx;
+
+        const float bottom =
+            ((p10 >> shift) & 0xff) * (1.0f - fx) +
+            ((p11 >> shift) & 0xff) * fx;
+
+        c[ch] = top * (1.0f - fy) + bottom * fy;
+    }
+
+    return packUnpremultiplied(c);
+}
+
+/**
+ * The source coordinate of the destination pixel \p x is
+ * (m11 * x + baseX, m12 * x + baseY), the half-pixel offsets
+ * are already accounted in baseX and baseY.
+ */
+inline void processRowScalar(const SourceImage &src, quint32 *dst,
+                             int begin, int end,
+                             float m11, float m12, float baseX, float baseY)
+{
+    for (int x = begin; x < end; x++) {
+        dst[x] = samplePixel(src, m11 * x + baseX, m12 * x + baseY);
+    }
+}
+
+template<Vc::Implementation _impl, typename EnableDummyType = void>
+struct RowProcessor
+{
+    static void process(const SourceImage &src, quint32 *dst, int width,
+                        float m11, float m12, float baseX, float baseY)
+    {
+        processRowScalar(src, dst, 0, width, m11, m12, baseX, baseY);
+    }
+};
+
+#ifdef HAVE_VC
+
+template<Vc::Implementation _impl>
+struct RowProcessor<_impl, typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    using int_v = Vc::SimdArray<int, Vc::float_v::size()>;
+    using uint_v = Vc::SimdArray<unsigned int, Vc::float_v::size()>;
+
+    static inline Vc::float_v channel(const uint_v &pixel, int shift)
+    {
+        return Vc::simd_cast<Vc::float_v>(int_v((pixel >> shift) & uint_v(0xffu)));
+    }
+
+    static void process(const SourceImage &src, quint32 *dst, int width,
+                        float m11, float m12, float baseX, float baseY)
+    {
+        const int vectorSize = Vc::float_v::size();
+        const int vectorEnd = width - width % vectorSize;
+
+        const Vc::float_v vM11(m11);
+        const Vc::float_v vM12(m12);
+        const Vc::float_v vBaseX(baseX);
+        const Vc::float_v vBaseY(baseY);
+
+        const Vc::float_v vZero(Vc::Zero);
+        const Vc::float_v vOne(Vc::One);
+        const Vc::float_v vHalf(0.5f);
+        const Vc::float_v v255(255.0f);
+        const Vc::float_v vMaxX(float(src.width - 1));
+        const Vc::float_v vMaxY(float(src.height - 1));
+        const int_v vStride(src.stride);
+
+        Vc::float_v vx = Vc::float_v::IndexesFromZero();
+        const Vc::float_v vStep(float(vectorSize));
+
+        for (int x = 0; x < vectorEnd; x += vectorSize) {
+            const Vc::float_v sx = vM11 * vx + vBaseX;
+            const Vc::float_v sy = vM12 * vx + vBaseY;
+            vx += vStep;
+
+            const Vc::float_v x0 = Vc::floor(sx);
+            const Vc::float_v y0 = Vc::floor(sy);
+            const Vc::float_v x1 = x0 + vOne;
+            const Vc::float_v y1 = y0 + vOne;
+
+            Vc::float_v wx1 = sx - x0;
+            Vc::float_v wy1 = sy - y0;
+            Vc::float_v wx0 = vOne - wx1;
+            Vc::float_v wy0 = vOne - wy1;
+
+            // the pixels outside the image are transparent
+            wx0.setZero(x0 < vZero || x0 > vMaxX);
+            wx1.setZero(x1 < vZero || x1 > vMaxX);
+            wy0.setZero(y0 < vZero || y0 > vMaxY);
+            wy1.setZero(y1 < vZero || y1 > vMaxY);
+
+            if ((wx0 + wx1 == vZero || wy0 + wy1 == vZero).isFull()) {
+                std::fill(dst + x, dst + x + vectorSize, 0);
+                continue;
+            }
+
+            // the clamped pixels have zero weight, we clamp them only
+            // to keep the gather inside the image
+            const int_v ix0(Vc::min(Vc::max(x0, vZero), vMaxX));
+            const int_v ix1(Vc::min(Vc::max(x1, vZero), vMaxX));
+            const int_v row0 = int_v(Vc::min(Vc::max(y0, vZero), vMaxY)) * vStride;
+            const int_v row1 = int_v(Vc::min(Vc::max(y1, vZero), vMaxY)) * vStride;
+
+            const uint_v p00(src.bits, row0 + ix0);
+            const uint_v p01(src.bits, row0 + ix1);
+            const uint_v p10(src.bits, row1 + ix0);
+            const uint_v p11(src.bits, row1 + ix1);
+
+            Vc::float_v c[4];
+
+            for (int ch = 0; ch < 4; ch++) {
+                const int shift = 8 * ch;
+
+                const Vc::float_v top = channel(p00, shift) * wx0 + channel(p01, shift) * wx1;
+                const Vc::float_v bottom = channel(p10, shift) * wx0 + channel(p11, shift) * wx1;
+
+                c[ch] = top * wy0 + bottom * wy1;
+            }
+
+            Vc::float_v k = v255 / c[3];
+            k.setZero(c[3] < vHalf);
+
+            const uint_v a_i(int_v(Vc::min(c[3] + vHalf, v255)));
+            const uint_v r_i(int_v(Vc::min(c[2] * k + vHalf, v255)));
+            const uint_v g_i(int_v(Vc::min(c[1] * k + vHalf, v255)));
+            const uint_v b_i(int_v(Vc::min(c[0] * k + vHalf, v255)));
+
+            // the transparent pixels have zero k and alpha below 1.0,
+            // so they are packed into zero automatically
+            const uint_v result = (a_i << 24) | (r_i << 16) | (g_i << 8) | b_i;
+            result.store(dst + x, Vc::Unaligned);
+        }
+
+        processRowScalar(src, dst, vectorEnd, width, m11, m12, baseX, baseY);
+    }
+};
+
+#endif /* HAVE_VC */
+
+template<Vc::Implementation _impl>
+class KisQImageSampler : public KisQImageSamplerBase
+{
+public:
+    void transform(const QImage &src, const QTransform &transform, QImage *dst) const override
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(src.format() == QImage::Format_ARGB32_Premultiplied);
+        KIS_SAFE_ASSERT_RECOVER_RETURN(dst->format() == QImage::Format_ARGB32);
+        KIS_SAFE_ASSERT_RECOVER_NOOP(transform.isAffine());
+
+        bool isInvertible = false;
+        const QTransform t = transform.inverted(&isInvertible);
+
+        if (!isInvertible) {
+            dst->fill(0);
+            return;
+        }
+
+        const SourceImage source(src);
+        const int width = dst->width();
+
+        for (int y = 0; y < dst->height(); y++) {
+            const qreal centerY = y + 0.5;
+
+            const float baseX = 0.5 * t.m11() + centerY * t.m21() + t.dx() - 0.5;
+            const float baseY = 0.5 * t.m12() + centerY * t.m22() + t.dy() - 0.5;
+
+            RowProcessor<_impl>::process(source,
+                                         reinterpret_cast<quint32*>(dst->scanLine(y)),
+                                         width,
+                                         t.m11(), t.m12(),
+                                         baseX, baseY);
+        }
+    }
+};
+
+}
+
+template<Vc::Implementation _impl>
+KisQImageSamplerBase* KisQImageSamplerFactoryImpl::create(int)
+{
+    return new KisQImageSampler<_impl>();
+}
+
+template KisQImageSamplerBase* KisQImageSamplerFactoryImpl::create<Vc::CurrentImplementation::current()>(int);
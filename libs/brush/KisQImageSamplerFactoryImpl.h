@@ -0,0 +1,39 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISQIMAGESAMPLERFACTORYIMPL_H
+#define KISQIMAGESAMPLERFACTORYIMPL_H
+
+#include <compositeops/KoVcMultiArchBuildSupport.h>
+
+class KisQImageSamplerBase;
+
+struct KisQImageSamplerFactoryImpl
+{
+    typedef int ParamType;
+    typedef KisQImageSamplerBase* ReturnType;
+
+    static const char* kernelName() {
+        return "Brush tip samplers";
+    }
+
+    template<Vc::Implementation _impl>
+    static KisQImageSamplerBase* create(int);
+};
+
+#endif // KISQIMAGESAMPLERFACTORYIMPL_H
@@ -20,13 +20,31 @@
 
 #include <limits>
 #include <QPainter>
+#include <QGlobalStatic>
+#include <QScopedPointer>
 #include <kis_debug.h>
 
+#include "KisQImageSamplerBase.h"
+#include "KisQImageSamplerFactoryImpl.h"
+
 #define MIPMAP_SIZE_THRESHOLD 512
 #define MAX_MIPMAP_SCALE 8.0
 
 #define QPAINTER_WORKAROUND_BORDER 1
 
+namespace {
+struct SamplerHolder
+{
+    SamplerHolder()
+        : sampler(createOptimizedClass<KisQImageSamplerFactoryImpl>(0))
+    {
+    }
+
+    QScopedPointer<KisQImageSamplerBase> sampler;
+};
+
+Q_GLOBAL_STATIC(SamplerHolder, s_samplerHolder)
+}
 
 KisQImagePyramid::KisQImagePyramid(const QImage &baseImage)
 {
@@ -56,7 +74,7 @@ KisQImagePyramid::KisQImagePyramid(const QImage &baseImage)
     if (m_levels.isEmpty()) {
         m_baseScale = 1.0;
     }
-    appendPyramidLevel(baseImage);
+    appendPyramidLevel(baseImage, true);
 
     scale = 0.5;
     while (true) {
@@ -241,7 +259,7 @@ QSizeF KisQImagePyramid::characteristicSize(const QSize &originalSize,
     return transform.mapRect(originalRect).size();
 }
 
-void KisQImagePyramid::appendPyramidLevel(const QImage &image)
+void KisQImagePyramid::appendPyramidLevel(const QImage &image, bool isOriginalLevel)
 {
     /**
      * QPainter has a bug: when doing a transformation it decides that
@@ -252,15 +270,51 @@ void KisQImagePyramid::appendPyramidLevel(const QImage &image)
      * wide border to the image, so that it transforms smoothly.
      *
      * See a unittest in: KisGbrBrushTest::testQPainterTransformationBorder
+     *
+     * The levels are stored premultiplied, because both, the sampler
+     * and QPainter, interpolate premultiplied values. The original level
+     * is also kept unpremultiplied for the identity transform.
      */
-    
-QSize levelSize = image.size();
-    QImage tmp = image.convertToFormat(QImage::Format_ARGB32);
+
+    QSize levelSize = image.size();
+    QImage tmp = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
     tmp = tmp.copy(-QPAINTER_WORKAROUND_BORDER,
                    -QPAINTER_WORKAROUND_BORDER,
                    image.width() + 2 * QPAINTER_WORKAROUND_BORDER,
                    image.height() + 2 * QPAINTER_WORKAROUND_BORDER);
-    m_levels.append(PyramidLevel(tmp, levelSize));
+    m_levels.append(PyramidLevel(tmp, levelSize,
+                                 isOriginalLevel ?
+                                     image.convertToFormat(QImage::Format_ARGB32) : QImage()));
+}
+
+const KisQImagePyramid::PyramidLevel&
+KisQImagePyramid::prepareLevel(KisDabShape const& shape,
+                               qreal subPixelX, qreal subPixelY,
+                               QTransform *transform, QSize *dstSize) const
+{
+    qreal baseScale = -1.0;
+    int level = findNearestLevel(shape.scale(), &baseScale);
+
+    calculateParams(shape, subPixelX, subPixelY,
+                    m_originalSize, baseScale, m_levels[level].size,
+                    transform, dstSize);
+
+    return m_levels[level];
+}
+
+namespace {
+QImage identityImage(const QImage &premultipliedImage, const QImage &unpremultipliedImage)
+{
+    if (!unpremultipliedImage.isNull()) {
+        return unpremultipliedImage;
+    }
+
+    return premultipliedImage.copy(QPAINTER_WORKAROUND_BORDER,
+                                   QPAINTER_WORKAROUND_BORDER,
+                                   premultipliedImage.width() - 2 * QPAINTER_WORKAROUND_BORDER,
+                                   premultipliedImage.height() - 2 * QPAINTER_WORKAROUND_BORDER)
+        .convertToFormat(QImage::Format_ARGB32);
+}
 }
 
 QImage KisQImagePyramid::createImage(KisDabShape const& shape,
@@ -268,25 +322,46 @@ QImage KisQImagePyramid::createImage(KisDabShape const& shape,
 {
     if (m_levels.isEmpty()) return QImage();
 
-    qreal baseScale = -1.0;
-    int level = findNearestLevel(shape.scale(), &baseScale);
+    QTransform transform;
+    QSize dstSize;
+
+    const PyramidLevel &level = prepareLevel(shape, subPixelX, subPixelY, &transform, &dstSize);
+    const QImage &srcImage = level.image;
+
+    if (transform.isIdentity()) {
+        return identityImage(srcImage, level.unpremultipliedImage);
+    }
+
+    /**
+     * The sampler treats the pixels outside the level as transparent,
+     * so it doesn't need the border, but we still have to skip it.
+     * It also doesn't have QPainter's problem with TxTranslate
+     * transforms, so no fake scale is needed.
+     */
+    QImage dstImage(dstSize, QImage::Format_ARGB32);
 
-    const QImage &srcImage = m_levels[level].image;
+    s_samplerHolder->sampler->transform(
+        srcImage,
+        QTransform::fromTranslate(-QPAINTER_WORKAROUND_BORDER,
+                                  -QPAINTER_WORKAROUND_BORDER) * transform,
+        &dstImage);
+
+    return dstImage;
+}
+
+QImage KisQImagePyramid::createImageQPainter(KisDabShape const& shape,
+                                             qreal subPixelX, qreal subPixelY) const
+{
+    if (m_levels.isEmpty()) return QImage();
 
     QTransform transform;
     QSize dstSize;
 
-    calculateParams(shape, subPixelX, subPixelY,
-                    m_originalSize, baseScale, m_levels[level].size,
-                    &transform, &dstSize);
-
-    if (transform.isIdentity() &&
-            srcImage.format() == QImage::Format_ARGB32) {
+    const PyramidLevel &level = prepareLevel(shape, subPixelX, subPixelY, &transform, &dstSize);
+    const QImage &srcImage = level.image;
 
-        return srcImage.copy(QPAINTER_WORKAROUND_BORDER,
-                             QPAINTER_WORKAROUND_BORDER,
-                             srcImage.width() - 2 * QPAINTER_WORKAROUND_BORDER,
-                             srcImage.height() - 2 * QPAINTER_WORKAROUND_BORDER);
+    if (transform.isIdentity()) {
+        return identityImage(srcImage, level.unpremultipliedImage);
     }
 
     QImage dstImage(dstSize, QImage::Format_ARGB32);
@@ -41,12 +41,42 @@ public:
     QImage createImage(KisDabShape const&,
                        qreal subPixelX, qreal subPixelY) const;
 
+    /**
+     * The same as createImage(), but the transformation is done with
+     * QPainter instead of the per-arch sampler. Used as a reference for
+     * the sampler in the unittests and benchmarks.
+     */
+    QImage createImageQPainter(KisDabShape const&,
+                               qreal subPixelX, qreal subPixelY) const;
+
     QImage getClosest(QTransform transform, qreal *scale) const;
 
+private:
+    struct PyramidLevel {
+        PyramidLevel() {}
+        PyramidLevel(QImage _image, QSize _size, QImage _unpremultipliedImage)
+            : image(_image), size(_size), unpremultipliedImage(_unpremultipliedImage) {}
+
+        QImage image;
+        QSize size;
+
+        /**
+         * The level in QImage::Format_ARGB32 without the border. It is
+         * set for the original level only and returned as it is for the
+         * identity transform, because unpremultiplying \p image back
+         * would lose the precision of the semi-transparent pixels.
+         */
+        QImage unpremultipliedImage;
+    };
+
 private:
     friend class KisGbrBrushTest;
     int findNearestLevel(qreal scale, qreal *baseScale) const;
-    void appendPyramidLevel(const QImage &image);
+    void appendPyramidLevel(const QImage &image, bool isOriginalLevel = false);
+
+    const PyramidLevel& prepareLevel(KisDabShape const& shape,
+                                     qreal subPixelX, qreal subPixelY,
+                                     QTransform *transform, QSize *dstSize) const;
 
     static void calculateParams(KisDabShape const& shape,
                                 qreal subPixelX, qreal subPixelY,
@@ -63,14 +93,6 @@ private:
     QSize m_originalSize;
     qreal m_baseScale;
 
-    struct PyramidLevel {
-        PyramidLevel() {}
-        PyramidLevel(QImage _image, QSize _size) : image(_image), size(_size) {}
-
-        QImage image;
-        QSize size;
-    };
-
     QVector<PyramidLevel> m_levels;
 };
 
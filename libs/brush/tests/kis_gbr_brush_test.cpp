@@ -32,6 +32,7 @@
 #include <kis_fixed_paint_device.h>
 #include "kis_qimage_pyramid.h"
 #include <KisGlobalResourcesInterface.h>
+#include <kis_debug.h>
 
 void KisGbrBrushTest::testMaskGenerationSingleColor()
 {
@@ -299,4 +300,144 @@ void KisGbrBrushTest::testQPainterTransformationBorder()
     }
 }
 
+namespace {
+struct SamplerParams {
+    KisDabShape shape;
+    qreal subPixelX;
+    qreal subPixelY;
+};
+
+SamplerParams randomSamplerParams()
+{
+    const qreal scale = 0.05 + qreal(qrand()) / RAND_MAX * 1.45;
+    const qreal ratio = 0.2 + qreal(qrand()) / RAND_MAX * 0.8;
+    const qreal rotation = qreal(qrand()) / RAND_MAX * 2 * M_PI;
+    const qreal subPixelX = qreal(qrand()) / RAND_MAX;
+    const qreal subPixelY = qreal(qrand()) / RAND_MAX;
+
+    return {KisDabShape(scale, ratio, rotation), subPixelX, subPixelY};
+}
+}
+
+void KisGbrBrushTest::testSamplerAccuracy()
+{
+    QScopedPointer<KisGbrBrush> brush(new KisGbrBrush(QString(FILES_DATA_DIR) + '/' + "testing_brush_512_bars.gbr"));
+    brush->load(KisGlobalResourcesInterface::instance());
+    QVERIFY(!brush->brushTipImage().isNull());
+
+    KisQImagePyramid pyramid(brush->brushTipImage());
+    qsrand(1);
+
+    /**
+     * QPainter quantizes the interpolation weights (down to 4 bits
+     * in some of its SSE2 paths), so on the sharp edges of the bars
+     * the results may differ noticeably. Though on average they
+     * should be almost the same.
+     */
+    const int maxAllowedDifference = 16;
+    const qreal maxAllowedMeanDifference = 0.5;
+
+    for (int i = 0; i < 50; i++) {
+        const SamplerParams params = randomSamplerParams();
+
+        const QImage sampled =
+            pyramid.createImage(params.shape, params.subPixelX, params.subPixelY)
+                .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        const QImage reference =
+            pyramid.createImageQPainter(params.shape, params.subPixelX, params.subPixelY)
+                .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+        QCOMPARE(sampled.size(), reference.size());
+
+        int maxDifference = 0;
+        qint64 totalDifference = 0;
+
+        for (int y = 0; y < sampled.height(); y++) {
+            const QRgb *sampledPtr = reinterpret_cast<const QRgb*>(sampled.constScanLine(y));
+            const QRgb *referencePtr = reinterpret_cast<const QRgb*>(reference.constScanLine(y));
+
+            for (int x = 0; x < sampled.width(); x++) {
+                const int diff = qMax(qMax(qAbs(qRed(sampledPtr[x]) - qRed(referencePtr[x])),
+                                           qAbs(qGreen(sampledPtr[x]) - qGreen(referencePtr[x]))),
+                                      qMax(qAbs(qBlue(sampledPtr[x]) - qBlue(referencePtr[x])),
+                                           qAbs(qAlpha(sampledPtr[x]) - qAlpha(referencePtr[x]))));
+
+                maxDifference = qMax(maxDifference, diff);
+                totalDifference += diff;
+            }
+        }
+
+        const qreal meanDifference = qreal(totalDifference) / (sampled.width() * sampled.height());
+
+        if (maxDifference > maxAllowedDifference ||
+            meanDifference > maxAllowedMeanDifference) {
+
+            qDebug() << ppVar(i) << ppVar(params.shape.scale()) << ppVar(params.shape.ratio())
+                     << ppVar(params.shape.rotation())
+                     << ppVar(params.subPixelX) << ppVar(params.subPixelY)
+                     << ppVar(maxDifference) << ppVar(meanDifference);
+
+            sampled.save(QString("sampler_%1_sampled.png").arg(i));
+            reference.save(QString("sampler_%1_qpainter.png").arg(i));
+
+            QFAIL("The sampler differs from QPainter too much");
+        }
+    }
+}
+
+void KisGbrBrushTest::testIdentityTransformIsExact()
+{
+    /**
+     * The pyramid levels are stored premultiplied, so a tip with a lot
+     * of semi-transparent pixels would not survive a round trip through
+     * them. The identity transform must return the tip as it is.
+     */
+    QImage image(67, 45, QImage::Format_ARGB32);
+    qsrand(1);
+
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *ptr = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            ptr[x] = qRgba(qrand() % 256, qrand() % 256, qrand() % 256, qrand() % 16);
+        }
+    }
+
+    KisQImagePyramid pyramid(image);
+
+    QCOMPARE(pyramid.createImage(KisDabShape(1.0, 1.0, 0.0), 0.0, 0.0), image);
+    QCOMPARE(pyramid.createImageQPainter(KisDabShape(1.0, 1.0, 0.0), 0.0, 0.0), image);
+}
+
+void KisGbrBrushTest::benchmarkSamplerTransform()
+{
+    QScopedPointer<KisGbrBrush> brush(new KisGbrBrush(QString(FILES_DATA_DIR) + '/' + "testing_brush_512_bars.gbr"));
+    brush->load(KisGlobalResourcesInterface::instance());
+    QVERIFY(!brush->brushTipImage().isNull());
+
+    KisQImagePyramid pyramid(brush->brushTipImage());
+    qsrand(1);
+
+    QBENCHMARK {
+        const SamplerParams params = randomSamplerParams();
+        QImage image = pyramid.createImage(params.shape, params.subPixelX, params.subPixelY);
+        QVERIFY(!image.isNull()); // avoid compiler elimination of unused code!
+    }
+}
+
+void KisGbrBrushTest::benchmarkQPainterTransform()
+{
+    QScopedPointer<KisGbrBrush> brush(new KisGbrBrush(QString(FILES_DATA_DIR) + '/' + "testing_brush_512_bars.gbr"));
+    brush->load(KisGlobalResourcesInterface::instance());
+    QVERIFY(!brush->brushTipImage().isNull());
+
+    KisQImagePyramid pyramid(brush->brushTipImage());
+    qsrand(1);
+
+    QBENCHMARK {
+        const SamplerParams params = randomSamplerParams();
+        QImage image = pyramid.createImageQPainter(params.shape, params.subPixelX, params.subPixelY);
+        QVERIFY(!image.isNull()); // avoid compiler elimination of unused code!
+    }
+}
+
 QTEST_MAIN(KisGbrBrushTest)
@@ -42,6 +42,11 @@ private Q_SLOTS:
     void testPyramidDabTransform();
 
     void testQPainterTransformationBorder();
+
+    void testSamplerAccuracy();
+    void testIdentityTransformIsExact();
+    void benchmarkSamplerTransform();
+    void benchmarkQPainterTransform();
 };
 
 #endif
@@ -0,0 +1,381 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisFilterTileCache.h"
+
+#include <algorithm>
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QRegion>
+#include <QVector>
+
+#include "KisThreadLimitedMap.h"
+#include "kis_algebra_2d.h"
+#include "kis_default_bounds_base.h"
+#include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "krita_utils.h"
+#include "filter/kis_filter.h"
+#include "filter/kis_filter_configuration.h"
+
+/**
+ * The size of the cached tiles, the same as the size of the tiles
+ * of the paint devices. The grid of the cached tiles starts at the
+ * offset of the destination device, so they match its tiles.
+ */
+#define FILTER_CACHE_TILE_SIZE 64
+
+/**
+ * The missing parts of the output are filtered in the patches of this
+ * size in parallel. The patches should be much bigger than the tiles,
+ * because every patch reads the needed rect of the filter around it.
+ */
+#define FILTER_CACHE_PATCH_SIZE 256
+
+/**
+ * 16 MiB for RGBA8 and 64 MiB for RGBA32F, shared by all the levels
+ * of detail
+ */
+#define FILTER_CACHE_MAX_TILES 1024
+
+namespace {
+
+typedef QPair<int, int> TileIndex;
+
+struct Entry
+{
+    quint64 sourceHash = 0;
+    QRegion validRegion;
+    quint64 lastAccess = 0;
+};
+
+inline QRect tileRect(const TileIndex &index, const QPoint &origin)
+{
+    return QRect(origin.x() + index.first * FILTER_CACHE_TILE_SIZE,
+                 origin.y() + index.second * FILTER_CACHE_TILE_SIZE,
+                 FILTER_CACHE_TILE_SIZE,
+                 FILTER_CACHE_TILE_SIZE);
+}
+
+QVector<TileIndex> tilesInRect(const QRect &rc, const QPoint &origin)
+{
+    using KisAlgebra2D::divideFloor;
+
+    QVector<TileIndex> tiles;
+
+    const int firstCol = divideFloor(rc.left() - origin.x(), FILTER_CACHE_TILE_SIZE);
+    const int lastCol = divideFloor(rc.right() - origin.x(), FILTER_CACHE_TILE_SIZE);
+    const int firstRow = divideFloor(rc.top() - origin.y(), FILTER_CACHE_TILE_SIZE);
+    const int lastRow = divideFloor(rc.bottom() - origin.y(), FILTER_CACHE_TILE_SIZE);
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            tiles << TileIndex(col, row);
+        }
+    }
+
+    return tiles;
+}
+
+quint64 hashSourceTile(KisPaintDeviceSP src, const QRect &rc, QVector<quint8> *buffer)
+{
+    buffer->resize(rc.width() * rc.height() * src->pixelSize());
+    src->readBytes(buffer->data(), rc);
+
+    // two 32-bit hashes with different seeds make the collisions negligible
+    const uint lowHash = qHashBits(buffer->constData(), buffer->size(), 0);
+    const uint highHash = qHashBits(buffer->constData(), buffer->size(), 0x9e3779b9);
+
+    return (quint64(highHash) << 32) | lowHash;
+}
+
+}
+
+/**
+ * The tiles cached for one level of detail
+ */
+struct Level
+{
+    QHash<TileIndex, Entry> entries;
+
+    /**
+     * The cached pixels, only the valid regions of the entries
+     * are meaningful
+     */
+    KisPaintDeviceSP output;
+};
+
+struct KisFilterTileCache::Private
+{
+    QMutex mutex;
+
+    /**
+     * The LoD previews and the final rendering update the same node in
+     * turns, so every level of detail keeps its own tiles instead of
+     * dropping the other level on every switch
+     */
+    QHash<int, Level> levels;
+    quint64 accessCounter = 0;
+    qint64 hitCount = 0;
+
+    const KoColorSpace *colorSpace = 0;
+    const KisFilterConfiguration *config = 0;
+    QPoint tileGridOrigin;
+
+    bool isCompatible(const KoColorSpace *cs, const KisFilterConfiguration *cfg, const QPoint &origin) const {
+        return colorSpace && colorSpace == cs && config == cfg && tileGridOrigin == origin;
+    }
+
+    Level& levelFor(int lod);
+    int numCachedTiles() const;
+
+    void reset(const KoColorSpace *cs, const KisFilterConfiguration *cfg, const QPoint &origin);
+    void evictExcessTiles();
+};
+
+KisFilterTileCache::KisFilterTileCache()
+    : m_d(new Private)
+{
+}
+
+KisFilterTileCache::~KisFilterTileCache()
+{
+}
+
+Level& KisFilterTileCache::Private::levelFor(int lod)
+{
+    Level &result = levels[lod];
+
+    if (!result.output) {
+        result.output = new KisPaintDevice(colorSpace);
+    }
+
+    return result;
+}
+
+int KisFilterTileCache::Private::numCachedTiles() const
+{
+    int result = 0;
+
+    Q_FOREACH (const Level &level, levels) {
+        result += level.entries.size();
+    }
+
+    return result;
+}
+
+void KisFilterTileCache::Private::reset(const KoColorSpace *cs, const KisFilterConfiguration *cfg, const QPoint &origin)
+{
+    levels.clear();
+    colorSpace = cs;
+    config = cfg;
+    tileGridOrigin = origin;
+}
+
+void KisFilterTileCache::Private::evictExcessTiles()
+{
+    const int numTiles = numCachedTiles();
+    if (numTiles <= FILTER_CACHE_MAX_TILES) return;
+
+    typedef QPair<int, TileIndex> LevelTile;
+
+    QVector<QPair<quint64, LevelTile>> tiles;
+    tiles.reserve(numTiles);
+
+    for (auto level = levels.constBegin(); level != levels.constEnd(); ++level) {
+        for (auto it = level->entries.constBegin(); it != level->entries.constEnd(); ++it) {
+            tiles << qMakePair(it.value().lastAccess, LevelTile(level.key(), it.key()));
+        }
+    }
+
+    std::sort(tiles.begin(), tiles.end());
+
+    // evict a quarter of the cache at once to not sort it on every update
+    const int numEvicted = numTiles - 3 * FILTER_CACHE_MAX_TILES / 4;
+
+    for (int i = 0; i < numEvicted; i++) {
+        Level &level = levels[tiles[i].second.first];
+        const TileIndex &index = tiles[i].second.second;
+
+        level.entries.remove(index);
+        level.output->clear(tileRect(index, tileGridOrigin));
+    }
+}
+
+void KisFilterTileCache::process(KisFilterSP filter, KisFilterConfigurationSP config,
+                                 KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                                 const QRect &rect, bool sourceChanged)
+{
+    if (rect.isEmpty()) return;
+
+    const int lod = dst->defaultBounds()->currentLevelOfDetail();
+
+    const bool isPointWise =
+        filter->neededRect(rect, config, lod) == rect &&
+        filter->changedRect(rect, config, lod) == rect;
+
+    /**
+     * The filters that don't support threading give different results
+     * when the rect is split, so the output of such a filter cannot be
+     * assembled from the separately filtered tiles
+     */
+    if (sourceChanged || isPointWise || !filter->supportsThreading() ||
+        src->colorSpace() != dst->colorSpace()) {
+
+        filter->process(src, dst, 0, rect, config, 0);
+        return;
+    }
+
+    const QPoint origin(dst->x(), dst->y());
+    const QVector<TileIndex> tiles = tilesInRect(rect, origin);
+    QVector<quint64> sourceHashes(tiles.size());
+
+    /**
+     * The needed rects of the neighbouring tiles overlap, so every
+     * source tile is hashed only once and the hash of the output tile
+     * is combined from the hashes of the source tiles
+     */
+    {
+        QHash<TileIndex, quint64> sourceTileHashes;
+        QVector<quint8> buffer;
+
+        for (int i = 0; i < tiles.size(); i++) {
+            const QRect needRect = filter->neededRect(tileRect(tiles[i], origin), config, lod);
+
+            quint64 hash = 14695981039346656037ULL;
+
+            Q_FOREACH (const TileIndex &srcTile, tilesInRect(needRect, origin)) {
+                auto it = sourceTileHashes.find(srcTile);
+                if (it == sourceTileHashes.end()) {
+                    it = sourceTileHashes.insert(srcTile, hashSourceTile(src, tileRect(srcTile, origin), &buffer));
+                }
+
+                hash = (hash ^ it.value()) * 1099511628211ULL;
+            }
+
+            sourceHashes[i] = hash;
+        }
+    }
+
+    QRegion missingRegion;
+
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        if (!m_d->isCompatible(src->colorSpace(), config.data(), origin)) {
+            m_d->reset(src->colorSpace(), config.data(), origin);
+        }
+
+        Level &level = m_d->levelFor(lod);
+
+        for (int i = 0; i < tiles.size(); i++) {
+            const QRect requiredRect = tileRect(tiles[i], origin) & rect;
+
+            Entry &entry = level.entries[tiles[i]];
+
+            if (entry.sourceHash != sourceHashes[i]) {
+                entry.sourceHash = sourceHashes[i];
+                entry.validRegion = QRegion();
+            }
+
+            entry.lastAccess = ++m_d->accessCounter;
+
+            const QRegion cachedRegion = entry.validRegion & requiredRect;
+
+            if (!cachedRegion.isEmpty()) {
+                m_d->hitCount++;
+            }
+
+            Q_FOREACH (const QRect &rc, cachedRegion.rects()) {
+                KisPainter::copyAreaOptimized(rc.topLeft(), level.output, dst, rc);
+            }
+
+            missingRegion += QRegion(requiredRect) - cachedRegion;
+        }
+    }
+
+    if (missingRegion.isEmpty()) return;
+
+    /**
+     * The patches are aligned to the tiles of the destination, so that
+     * no two threads write into the same tile
+     */
+    QVector<QRect> patches;
+    Q_FOREACH (const QRect &rc, missingRegion.rects()) {
+        Q_FOREACH (const QRect &patch,
+                   KritaUtils::splitRectIntoPatches(rc.translated(-origin),
+                                                    QSize(FILTER_CACHE_PATCH_SIZE,
+                                                          FILTER_CACHE_PATCH_SIZE))) {
+            patches << patch.translated(origin);
+        }
+    }
+
+    if (patches.size() > 1) {
+        KisThreadLimitedMap::blockingMap(patches,
+            [filter, config, src, dst] (const QRect &patch) {
+                filter->process(src, dst, 0, patch, config, 0);
+            });
+    } else {
+        filter->process(src, dst, 0, patches.first(), config, 0);
+    }
+
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        // the cache could have been reset while we were filtering
+        if (!m_d->isCompatible(src->colorSpace(), config.data(), origin)) return;
+
+        Level &level = m_d->levelFor(lod);
+
+        for (int i = 0; i < tiles.size(); i++) {
+            auto it = level.entries.find(tiles[i]);
+            if (it == level.entries.end() || it->sourceHash != sourceHashes[i]) continue;
+
+            const QRegion computedRegion = missingRegion & tileRect(tiles[i], origin);
+
+            Q_FOREACH (const QRect &rc, computedRegion.rects()) {
+                KisPainter::copyAreaOptimized(rc.topLeft(), dst, level.output, rc);
+            }
+
+            it->validRegion += computedRegion;
+        }
+
+        m_d->evictExcessTiles();
+    }
+}
+
+void KisFilterTileCache::clear()
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->reset(0, 0, QPoint());
+}
+
+int KisFilterTileCache::numCachedTiles() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->numCachedTiles();
+}
+
+qint64 KisFilterTileCache::hitCount() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->hitCount;
+}
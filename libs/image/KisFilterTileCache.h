@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FILTER_TILE_CACHE_H
+#define __KIS_FILTER_TILE_CACHE_H
+
+#include <QRect>
+#include <QScopedPointer>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+/**
+ * Caches the output of the filter of a filter mask or an adjustment
+ * layer tile by tile.
+ *
+ * Every cached tile is keyed by a hash of the source pixels its
+ * neededRect() covers, so the filter is rerun only for the tiles
+ * whose source has actually changed. That happens, for example, when
+ * the user paints on the selection of an adjustment layer or changes
+ * a mask that stays above a blur mask: the layer is updated, but the
+ * input of the filter stays the same.
+ *
+ * The filter is run for the missing parts in parallel patches aligned
+ * to the tiles of the destination device. The point-wise filters are
+ * processed directly, because hashing their source costs as much as
+ * filtering it, and so are the filters that don't support threading,
+ * because their output depends on the processed rect.
+ *
+ * Every level of detail has its own set of tiles, so switching
+ * between the LoD preview and the final rendering keeps both.
+ *
+ * The cache is thread-safe, so the update jobs of the same node may
+ * use it concurrently.
+ */
+class KRITAIMAGE_EXPORT KisFilterTileCache
+{
+public:
+    KisFilterTileCache();
+    ~KisFilterTileCache();
+
+    /**
+     * Processes \p rect of \p src with \p filter and \p config and
+     * writes the result into \p dst, the same way as
+     * KisFilter::process() does without a selection and a progress
+     *
+     * When \p sourceChanged is true, e.g. the update comes from the
+     * layers below the node, none of the cached tiles can match, so
+     * the source is filtered directly without hashing it.
+     */
+    void process(KisFilterSP filter, KisFilterConfigurationSP config,
+                 KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                 const QRect &rect, bool sourceChanged);
+
+    /**
+     * Drops all the cached tiles. Should be called whenever the
+     * filter configuration is changed in place.
+     */
+    void clear();
+
+    /**
+     * @return the number of tiles currently stored in the cache
+     */
+    int numCachedTiles() const;
+
+    /**
+     * @return the number of tiles that have been taken from the cache,
+     *         fully or partially, since the creation of the cache
+     */
+    qint64 hitCount() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_FILTER_TILE_CACHE_H */
@@ -0,0 +1,223 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisMipmapSampler.h"
+
+#include <cmath>
+
+#include <QtMath>
+
+#include <KoColorSpace.h>
+#include <KoMixColorsOp.h>
+
+#include "KisThreadLimitedMap.h"
+#include "kis_algebra_2d.h"
+#include "kis_paint_device.h"
+#include "kis_random_sub_accessor.h"
+
+/**
+ * The levels are built in bands of rows aligned to the tiles of the
+ * destination level, so that the bands can be written in parallel
+ */
+#define MIPMAP_BAND_HEIGHT 64
+
+/**
+ * Every level halves the size of the source, so there is no use in
+ * having more levels than the source can be halved
+ */
+#define MIPMAP_MAX_LEVELS 16
+
+/**
+ * Bilinear sampling still covers a footprint of up to about one and a
+ * half source pixels without visible aliasing, so mild downscales are
+ * sampled from level 0 and keep their sharpness
+ */
+#define MIPMAP_MINIFICATION_THRESHOLD 1.5
+
+
+KisMipmapSampler::KisMipmapSampler(KisPaintDeviceSP device, const QRect &bounds, int numLevels)
+{
+    m_levels << device;
+
+    QRect levelBounds = bounds;
+
+    for (int i = 1; i < numLevels && !levelBounds.isEmpty(); i++) {
+        levelBounds = buildNextLevel(levelBounds);
+    }
+}
+
+KisMipmapSampler::~KisMipmapSampler()
+{
+}
+
+int KisMipmapSampler::numLevels() const
+{
+    return m_levels.size();
+}
+
+int KisMipmapSampler::levelsForFootprint(qreal maxFootprint, const QRect &bounds)
+{
+    if (!needsMipmaps(maxFootprint) || bounds.isEmpty()) return 1;
+
+    const int size = qMax(bounds.width(), bounds.height());
+
+    int levels = qCeil(std::log2(maxFootprint)) + 1;
+    levels = qMin(levels, MIPMAP_MAX_LEVELS);
+
+    while (levels > 1 && (1 << (levels - 2)) >= size) {
+        levels--;
+    }
+
+    return levels;
+}
+
+qreal KisMipmapSampler::lodForFootprint(qreal footprint)
+{
+    return needsMipmaps(footprint) ? std::log2(footprint) : 0.0;
+}
+
+bool KisMipmapSampler::needsMipmaps(qreal footprint)
+{
+    return footprint > MIPMAP_MINIFICATION_THRESHOLD;
+}
+
+QRect KisMipmapSampler::buildNextLevel(const QRect &srcBounds)
+{
+    using KisAlgebra2D::divideFloor;
+
+    KisPaintDeviceSP src = m_levels.last();
+
+    KisPaintDeviceSP dst = new KisPaintDevice(src->colorSpace());
+    dst->setDefaultPixel(src->defaultPixel());
+
+    const QRect dstBounds(QPoint(divideFloor(srcBounds.left(), 2),
+                                 divideFloor(srcBounds.top(), 2)),
+                          QPoint(divideFloor(srcBounds.right(), 2),
+                                 divideFloor(srcBounds.bottom(), 2)));
+
+    QVector<QRect> bands;
+
+    for (int y = dstBounds.top(); y <= dstBounds.bottom();) {
+        const int nextY = qMin((divideFloor(y, MIPMAP_BAND_HEIGHT) + 1) * MIPMAP_BAND_HEIGHT,
+                               dstBounds.bottom() + 1);
+
+        bands << QRect(dstBounds.left(), y, dstBounds.width(), nextY - y);
+        y = nextY;
+    }
+
+    const int pixelSize = src->pixelSize();
+    const KoMixColorsOp *mixOp = src->colorSpace()->mixColorsOp();
+
+    KisThreadLimitedMap::blockingMap(bands,
+        [src, dst, pixelSize, mixOp] (const QRect &dstRect) {
+            const QRect srcRect(2 * dstRect.x(), 2 * dstRect.y(),
+                                2 * dstRect.width(), 2 * dstRect.height());
+
+            QVector<quint8> srcBuffer(srcRect.width() * srcRect.height() * pixelSize);
+            QVector<quint8> dstBuffer(dstRect.width() * dstRect.height() * pixelSize);
+
+            src->readBytes(srcBuffer.data(), srcRect);
+
+            const int srcRowStride = srcRect.width() * pixelSize;
+            quint8 *dstPtr = dstBuffer.data();
+            const quint8 *colors[4];
+
+            for (int row = 0; row < dstRect.height(); row++) {
+                const quint8 *srcRowPtr = srcBuffer.constData() + 2 * row * srcRowStride;
+
+                for (int col = 0; col < dstRect.width(); col++) {
+                    colors[0] = srcRowPtr + 2 * col * pixelSize;
+                    colors[1] = colors[0] + pixelSize;
+                    colors[2] = colors[0] + srcRowStride;
+                    colors[3] = colors[2] + pixelSize;
+
+                    mixOp->mixColors(colors, 4, dstPtr);
+                    dstPtr += pixelSize;
+                }
+            }
+
+            dst->writeBytes(dstBuffer.constData(), dstRect);
+        });
+
+    m_levels << dst;
+
+    return dstBounds;
+}
+
+KisMipmapSampler::Accessor::Accessor(const KisMipmapSampler *sampler)
+    : m_sampler(sampler)
+{
+    Q_FOREACH (KisPaintDeviceSP level, sampler->m_levels) {
+        m_accessors << level->createRandomSubAccessor();
+    }
+
+    const KoColorSpace *cs = sampler->m_levels.first()->colorSpace();
+
+    m_mixOp = cs->mixColorsOp();
+    m_pixelSize = cs->pixelSize();
+    m_buffer.resize(2 * m_pixelSize);
+}
+
+KisMipmapSampler::Accessor::~Accessor()
+{
+}
+
+void KisMipmapSampler::Accessor::sample(const QPointF &pt, qreal lod, quint8 *dst)
+{
+    const int maxLevel = m_accessors.size() - 1;
+
+    lod = qBound(0.0, lod, qreal(maxLevel));
+
+    const int level = qFloor(lod);
+    const qint16 upperWeight = qRound((lod - level) * 255);
+
+    if (!upperWeight || level == maxLevel) {
+        sampleLevel(level, pt, dst);
+        return;
+    }
+
+    quint8 *lower = m_buffer.data();
+    quint8 *upper = lower + m_pixelSize;
+
+    sampleLevel(level, pt, lower);
+    sampleLevel(level + 1, pt, upper);
+
+    const quint8 *colors[2] = {lower, upper};
+    const qint16 weights[2] = {qint16(255 - upperWeight), upperWeight};
+
+    m_mixOp->mixColors(colors, weights, 2, dst);
+}
+
+void KisMipmapSampler::Accessor::sampleLevel(int level, const QPointF &pt, quint8 *dst)
+{
+    KisRandomSubAccessorSP accessor = m_accessors[level];
+
+    if (!level) {
+        accessor->moveTo(pt.x(), pt.y());
+    } else {
+        /**
+         * The centers of the pixels of the levels are at integer
+         * positions, so the level coordinates are not just scaled
+         */
+        const qreal scale = 1.0 / (1 << level);
+        accessor->moveTo((pt.x() + 0.5) * scale - 0.5,
+                         (pt.y() + 0.5) * scale - 0.5);
+    }
+
+    accessor->sampledOldRawData(dst);
+}
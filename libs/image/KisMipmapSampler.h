@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_MIPMAP_SAMPLER_H
+#define __KIS_MIPMAP_SAMPLER_H
+
+#include <QPointF>
+#include <QRect>
+#include <QVector>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+class KoMixColorsOp;
+
+/**
+ * A pyramid of copies of a paint device, every next level being
+ * downscaled twice, for sampling the device under strong minification
+ * (e.g. in perspective or warp transformations) without aliasing.
+ *
+ * Level 0 is the device itself. A pixel (i, j) of level (k + 1) is an
+ * average of pixels (2i, 2j), (2i + 1, 2j), (2i, 2j + 1) and (2i + 1,
+ * 2j + 1) of level k.
+ *
+ * The sampler itself is read-only after construction, so it may be
+ * shared between threads. Every thread should sample it through its
+ * own Accessor.
+ */
+class KRITAIMAGE_EXPORT KisMipmapSampler
+{
+public:
+    /**
+     * Builds \p numLevels levels (including the level 0) from \p bounds
+     * of \p device
+     */
+    KisMipmapSampler(KisPaintDeviceSP device, const QRect &bounds, int numLevels);
+    ~KisMipmapSampler();
+
+    int numLevels() const;
+
+    /**
+     * The number of levels needed to sample a device without aliasing
+     * when a pixel of the destination covers up to \p maxFootprint
+     * pixels of the source (measured along one axis). The number is
+     * limited by the size of \p bounds of the source.
+     */
+    static int levelsForFootprint(qreal maxFootprint, const QRect &bounds);
+
+    /**
+     * The level of detail at which a destination pixel should be
+     * sampled when it covers \p footprint pixels of the source. It is
+     * zero unless needsMipmaps(\p footprint) is true.
+     */
+    static qreal lodForFootprint(qreal footprint);
+
+    /**
+     * Whether a destination pixel covering \p footprint pixels of the
+     * source is minified strongly enough to alias when sampled from
+     * level 0 with bilinear filtering
+     */
+    static bool needsMipmaps(qreal footprint);
+
+    class KRITAIMAGE_EXPORT Accessor
+    {
+    public:
+        Accessor(const KisMipmapSampler *sampler);
+        ~Accessor();
+
+        /**
+         * Samples the source at \p pt (in the coordinates of the level 0,
+         * the centers of the pixels being at integer positions) with
+         * trilinear filtering at level of detail \p lod. Level 0 is
+         * sampled exactly as KisRandomSubAccessor::sampledOldRawData()
+         * does.
+         */
+        void sample(const QPointF &pt, qreal lod, quint8 *dst);
+
+    private:
+        void sampleLevel(int level, const QPointF &pt, quint8 *dst);
+
+    private:
+        const KisMipmapSampler *m_sampler;
+        QVector<KisRandomSubAccessorSP> m_accessors;
+        const KoMixColorsOp *m_mixOp;
+        QVector<quint8> m_buffer;
+        int m_pixelSize;
+    };
+
+private:
+    QRect buildNextLevel(const QRect &srcBounds);
+
+private:
+    QVector<KisPaintDeviceSP> m_levels;
+};
+
+#endif /* __KIS_MIPMAP_SAMPLER_H */
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisThreadLimitedMap.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "kis_image_config.h"
+
+namespace {
+
+struct ThreadPoolHolder
+{
+    ThreadPoolHolder() {
+        setThreadsLimit(KisImageConfig(true).maxNumberOfThreads());
+    }
+
+    void setThreadsLimit(int value) {
+        /**
+         * The caller of run() is one of the threads, so the pool gets
+         * one thread less. QThreadPool always starts at least one thread,
+         * so the limit of one thread is handled by maxHelpers.
+         */
+        maxHelpers.store(qMax(0, value - 1));
+        pool.setMaxThreadCount(qMax(1, value - 1));
+    }
+
+    QThreadPool pool;
+    QAtomicInt maxHelpers;
+};
+
+Q_GLOBAL_STATIC(ThreadPoolHolder, s_threadPool)
+
+struct SharedState
+{
+    SharedState(int _numJobs, std::function<void(int)> _func)
+        : numJobs(_numJobs),
+          func(_func)
+    {
+    }
+
+    void processJobs() {
+        int job;
+        while ((job = nextJob.fetchAndAddOrdered(1)) < numJobs) {
+            func(job);
+
+            if (completedJobs.fetchAndAddOrdered(1) + 1 == numJobs) {
+                QMutexLocker l(&mutex);
+                allJobsCompleted.wakeAll();
+            }
+        }
+    }
+
+    void waitForAllJobs() {
+        QMutexLocker l(&mutex);
+        while (completedJobs.loadAcquire() < numJobs) {
+            allJobsCompleted.wait(&mutex);
+        }
+    }
+
+    const int numJobs;
+    const std::function<void(int)> func;
+    QAtomicInt nextJob;
+    QAtomicInt completedJobs;
+    QMutex mutex;
+    QWaitCondition allJobsCompleted;
+};
+
+/**
+ * The state is shared with the helpers, because a helper may be still
+ * starting when the caller has already completed all the jobs and
+ * returned from run()
+ */
+class HelperRunnable : public QRunnable
+{
+public:
+    HelperRunnable(QSharedPointer<SharedState> state)
+        : m_state(state)
+    {
+    }
+
+    void run() override {
+        m_state->processJobs();
+    }
+
+private:
+    QSharedPointer<SharedState> m_state;
+};
+
+}
+
+void KisThreadLimitedMap::run(int numJobs, std::function<void(int)> func)
+{
+    if (numJobs <= 0) return;
+
+    if (numJobs == 1) {
+        func(0);
+        return;
+    }
+
+    QSharedPointer<SharedState> state(new SharedState(numJobs, func));
+
+    const int numHelpers = qMin(numJobs - 1, s_threadPool->maxHelpers.loadAcquire());
+    for (int i = 0; i < numHelpers; i++) {
+        HelperRunnable *helper = new HelperRunnable(state);
+
+        /**
+         * We never queue the helpers: when all the threads of the pool
+         * are busy (e.g. by the other updater threads or by the outer
+         * level of a nested map) the caller just does more jobs itself.
+         */
+        if (!s_threadPool->pool.tryStart(helper)) {
+            delete helper;
+            break;
+        }
+    }
+
+    state->processJobs();
+    state->waitForAllJobs();
+}
+
+void KisThreadLimitedMap::setThreadsLimit(int value)
+{
+    s_threadPool->setThreadsLimit(value);
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTHREADLIMITEDMAP_H
+#define KISTHREADLIMITEDMAP_H
+
+#include "kritaimage_export.h"
+#include <functional>
+
+/**
+ * A replacement for QtConcurrent::blockingMap() for the data-parallel
+ * loops that run inside the update and stroke jobs of the image.
+ *
+ * The helper threads are taken from a dedicated pool that is limited by
+ * KisImageConfig::maxNumberOfThreads(), so the loops never load the
+ * global thread pool and never use more threads than the user allowed,
+ * however many updater threads run them concurrently. The calling
+ * thread processes the jobs as well and helpers are started only when
+ * a thread of the pool is free, so the call never waits for the pool
+ * and can be safely nested.
+ */
+class KRITAIMAGE_EXPORT KisThreadLimitedMap
+{
+public:
+    /**
+     * Calls \p func for every index in [0, numJobs) and returns when all
+     * the calls have completed.
+     */
+    static void run(int numJobs, std::function<void(int)> func);
+
+    /**
+     * Calls \p func for every item of \p sequence and returns when all
+     * the calls have completed.
+     */
+    template <typename Sequence, typename MapFunctor>
+    static void blockingMap(Sequence &sequence, MapFunctor func) {
+        run(sequence.size(), [&sequence, &func] (int index) { func(sequence[index]); });
+    }
+
+    /**
+     * Updates the number of threads of the pool. The caller of run() is
+     * counted as one of the threads.
+     */
+    static void setThreadsLimit(int value);
+};
+
+#endif // KISTHREADLIMITEDMAP_H
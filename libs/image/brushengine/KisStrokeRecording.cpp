@@ -0,0 +1,365 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecording.h"
+
+#include <QDomDocument>
+#include <QDomElement>
+#include <QFile>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorProfile.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_dom_utils.h>
+#include "kis_image.h"
+#include "brushengine/kis_paintop_preset.h"
+
+namespace {
+
+const int currentVersion = 1;
+
+QString segmentTypeToString(KisStrokeRecording::SegmentType type)
+{
+    switch (type) {
+    case KisStrokeRecording::Point:
+        return "point";
+    case KisStrokeRecording::Line:
+        return "line";
+    case KisStrokeRecording::BezierCurve:
+        return "bezier";
+    }
+
+    return "point";
+}
+
+bool segmentTypeFromString(const QString &str, KisStrokeRecording::SegmentType *type)
+{
+    if (str == "point") {
+        *type = KisStrokeRecording::Point;
+    } else if (str == "line") {
+        *type = KisStrokeRecording::Line;
+    } else if (str == "bezier") {
+        *type = KisStrokeRecording::BezierCurve;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void savePaintInformation(QDomDocument &doc, QDomElement &parent, const QString &tag, const KisPaintInformation &pi)
+{
+    QDomElement e = doc.createElement(tag);
+    pi.toXML(doc, e);
+    parent.appendChild(e);
+}
+
+bool loadPaintInformation(const QDomElement &parent, const QString &tag, KisPaintInformation *pi)
+{
+    QDomElement e;
+    if (!KisDomUtils::findOnlyElement(parent, tag, &e)) return false;
+
+    *pi = KisPaintInformation::fromXML(e);
+    return true;
+}
+
+}
+
+KisStrokeRecording::KisStrokeRecording()
+    : m_colorSpace(KoColorSpaceRegistry::instance()->rgb8()),
+      m_xRes(1.0),
+      m_yRes(1.0),
+      m_paintColor(Qt::black, m_colorSpace),
+      m_compositeOpId(COMPOSITE_OVER),
+      m_opacity(OPACITY_OPAQUE_U8)
+{
+}
+
+KisStrokeRecording::~KisStrokeRecording()
+{
+}
+
+void KisStrokeRecording::addPoint(const KisPaintInformation &pi)
+{
+    Segment segment;
+    segment.type = Point;
+    segment.pi1 = pi;
+    m_segments.append(segment);
+}
+
+void KisStrokeRecording::addLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2)
+{
+    Segment segment;
+    segment.type = Line;
+    segment.pi1 = pi1;
+    segment.pi2 = pi2;
+    m_segments.append(segment);
+}
+
+void KisStrokeRecording::addBezierCurve(const KisPaintInformation &pi1, const QPointF &control1, const QPointF &control2, const KisPaintInformation &pi2)
+{
+    Segment segment;
+    segment.type = BezierCurve;
+    segment.pi1 = pi1;
+    segment.control1 = control1;
+    segment.control2 = control2;
+    segment.pi2 = pi2;
+    m_segments.append(segment);
+}
+
+QVector<KisStrokeRecording::Segment> KisStrokeRecording::segments() const
+{
+    return m_segments;
+}
+
+void KisStrokeRecording::setImageState(KisImageSP image)
+{
+    m_imageBounds = image->bounds();
+    m_colorSpace = image->colorSpace();
+    m_xRes = image->xRes();
+    m_yRes = image->yRes();
+}
+
+QRect KisStrokeRecording::imageBounds() const
+{
+    return m_imageBounds;
+}
+
+const KoColorSpace *KisStrokeRecording::colorSpace() const
+{
+    return m_colorSpace;
+}
+
+qreal KisStrokeRecording::xRes() const
+{
+    return m_xRes;
+}
+
+qreal KisStrokeRecording::yRes() const
+{
+    return m_yRes;
+}
+
+void KisStrokeRecording::setPainterState(const KoColor &paintColor, const QString &compositeOpId, quint8 opacity, KisPaintOpPresetSP preset)
+{
+    m_paintColor = paintColor;
+    m_compositeOpId = compositeOpId;
+    m_opacity = opacity;
+    m_preset = preset;
+}
+
+KoColor KisStrokeRecording::paintColor() const
+{
+    return m_paintColor;
+}
+
+QString KisStrokeRecording::compositeOpId() const
+{
+    return m_compositeOpId;
+}
+
+quint8 KisStrokeRecording::opacity() const
+{
+    return m_opacity;
+}
+
+KisPaintOpPresetSP KisStrokeRecording::preset() const
+{
+    return m_preset;
+}
+
+bool KisStrokeRecording::save(QIODevice *device) const
+{
+    QDomDocument doc("strokeRecording");
+    QDomElement root = doc.createElement("strokeRecording");
+    root.setAttribute("version", currentVersion);
+    doc.appendChild(root);
+
+    QDomElement canvasElt = doc.createElement("canvas");
+    canvasElt.setAttribute("colorModelId", m_colorSpace->colorModelId().id());
+    canvasElt.setAttribute("colorDepthId", m_colorSpace->colorDepthId().id());
+    canvasElt.setAttribute("profile", m_colorSpace->profile() ? m_colorSpace->profile()->name() : QString());
+    KisDomUtils::saveValue(&canvasElt, "bounds", m_imageBounds);
+    KisDomUtils::saveValue(&canvasElt, "xRes", m_xRes);
+    KisDomUtils::saveValue(&canvasElt, "yRes", m_yRes);
+    root.appendChild(canvasElt);
+
+    QDomElement painterElt = doc.createElement("painter");
+    KisDomUtils::saveValue(&painterElt, "compositeOp", m_compositeOpId);
+    KisDomUtils::saveValue(&painterElt, "opacity", int(m_opacity));
+
+    QDomElement colorElt = doc.createElement("paintColor");
+    colorElt.setAttribute("channeldepth", m_paintColor.colorSpace()->colorDepthId().id());
+    m_paintColor.toXML(doc, colorElt);
+    painterElt.appendChild(colorElt);
+
+    if (m_preset) {
+        QDomElement presetElt = doc.createElement("preset");
+        m_preset->toXML(doc, presetElt);
+        painterElt.appendChild(presetElt);
+    }
+
+    root.appendChild(painterElt);
+
+    QDomElement strokeElt = doc.createElement("stroke");
+
+    Q_FOREACH (const Segment &segment, m_segments) {
+        QDomElement segmentElt = doc.createElement(segmentTypeToString(segment.type));
+
+        savePaintInformation(doc, segmentElt, "pi1", segment.pi1);
+
+        if (segment.type != Point) {
+            savePaintInformation(doc, segmentElt, "pi2", segment.pi2);
+        }
+
+        if (segment.type == BezierCurve) {
+            KisDomUtils::saveValue(&segmentElt, "control1", segment.control1);
+            KisDomUtils::saveValue(&segmentElt, "control2", segment.control2);
+        }
+
+        strokeElt.appendChild(segmentElt);
+    }
+
+    root.appendChild(strokeElt);
+
+    return device->write(doc.toByteArray()) >= 0;
+}
+
+bool KisStrokeRecording::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnKrita << "WARNING: couldn't open the stroke recording file for writing" << fileName;
+        return false;
+    }
+
+    return save(&file);
+}
+
+bool KisStrokeRecording::load(QIODevice *device, KisResourcesInterfaceSP resourcesInterface)
+{
+    QDomDocument doc;
+    QString errorMessage;
+
+    if (!doc.setContent(device, &errorMessage)) {
+        warnKrita << "WARNING: couldn't parse the stroke recording:" << errorMessage;
+        return false;
+    }
+
+    QDomElement root = doc.documentElement();
+    if (root.tagName() != "strokeRecording" ||
+        root.attribute("version").toInt() > currentVersion) {
+
+        warnKrita << "WARNING: unsupported stroke recording format" << root.tagName() << root.attribute("version");
+        return false;
+    }
+
+    QDomElement canvasElt;
+    QDomElement painterElt;
+    QDomElement strokeElt;
+
+    if (!KisDomUtils::findOnlyElement(root, "canvas", &canvasElt) ||
+        !KisDomUtils::findOnlyElement(root, "painter", &painterElt) ||
+        !KisDomUtils::findOnlyElement(root, "stroke", &strokeElt)) {
+
+        return false;
+    }
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(canvasElt.attribute("colorModelId"),
+                                                     canvasElt.attribute("colorDepthId"),
+                                                     canvasElt.attribute("profile"));
+    if (!cs) {
+        warnKrita << "WARNING: the color space of the stroke recording is not available, falling back to sRGB";
+        cs = KoColorSpaceRegistry::instance()->rgb8();
+    }
+
+    m_colorSpace = cs;
+
+    bool result = true;
+
+    result &= KisDomUtils::loadValue(canvasElt, "bounds", &m_imageBounds);
+    result &= KisDomUtils::loadValue(canvasElt, "xRes", &m_xRes);
+    result &= KisDomUtils::loadValue(canvasElt, "yRes", &m_yRes);
+
+    int opacity = OPACITY_OPAQUE_U8;
+    result &= KisDomUtils::loadValue(painterElt, "compositeOp", &m_compositeOpId);
+    result &= KisDomUtils::loadValue(painterElt, "opacity", &opacity);
+    m_opacity = quint8(qBound(0, opacity, 255));
+
+    QDomElement colorElt;
+    if (KisDomUtils::findOnlyElement(painterElt, "paintColor", &colorElt)) {
+        m_paintColor = KoColor::fromXML(colorElt.firstChildElement(),
+                                        colorElt.attribute("channeldepth"));
+    }
+
+    m_preset.clear();
+
+    QDomElement presetElt;
+    if (KisDomUtils::findOnlyElement(painterElt, "preset", &presetElt)) {
+        KisPaintOpPresetSP preset(new KisPaintOpPreset());
+        preset->fromXML(presetElt, resourcesInterface);
+
+        if (preset->valid()) {
+            m_preset = preset;
+        } else {
+            warnKrita << "WARNING: couldn't load the preset of the stroke recording" << presetElt.attribute("name");
+        }
+    }
+
+    m_segments.clear();
+
+    QDomElement segmentElt = strokeElt.firstChildElement();
+    while (!segmentElt.isNull()) {
+        Segment segment;
+
+        if (!segmentTypeFromString(segmentElt.tagName(), &segment.type)) {
+            warnKrita << "WARNING: unknown stroke recording segment" << segmentElt.tagName();
+            return false;
+        }
+
+        result &= loadPaintInformation(segmentElt, "pi1", &segment.pi1);
+
+        if (segment.type != Point) {
+            result &= loadPaintInformation(segmentElt, "pi2", &segment.pi2);
+        }
+
+        if (segment.type == BezierCurve) {
+            result &= KisDomUtils::loadValue(segmentElt, "control1", &segment.control1);
+            result &= KisDomUtils::loadValue(segmentElt, "control2", &segment.control2);
+        }
+
+        m_segments.append(segment);
+        segmentElt = segmentElt.nextSiblingElement();
+    }
+
+    return result;
+}
+
+bool KisStrokeRecording::load(const QString &fileName, KisResourcesInterfaceSP resourcesInterface)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        warnKrita << "WARNING: couldn't open the stroke recording file" << fileName;
+        return false;
+    }
+
+    return load(&file, resourcesInterface);
+}
@@ -0,0 +1,132 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKERECORDING_H
+#define KISSTROKERECORDING_H
+
+#include "kritaimage_export.h"
+
+#include <QRect>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include <KoColor.h>
+
+#include "kis_types.h"
+#include "brushengine/kis_paint_information.h"
+
+class KoColorSpace;
+class QIODevice;
+
+class KisResourcesInterface;
+typedef QSharedPointer<KisResourcesInterface> KisResourcesInterfaceSP;
+
+/**
+ * A recording of a single freehand stroke: the paint information
+ * stream exactly as it was passed to the painter, and the state of the
+ * canvas and of the painter at the moment the stroke was started.
+ *
+ * The recording is used for reproducing the slow paths of the brush
+ * engines with the real pressure, tilt and timing patterns of the user
+ * (see KisStrokeReplayBenchmark). The stream is stored in the form of
+ * the painter's primitives (dabs, lines and bezier curves), so that the
+ * replay would not depend on the smoothing options of the freehand tool.
+ *
+ * To record the strokes, set KRITA_STROKE_RECORDING_DIR environment
+ * variable to an existing directory. Every freehand stroke will be
+ * saved into a separate *.kstroke file in that directory.
+ */
+class KRITAIMAGE_EXPORT KisStrokeRecording
+{
+public:
+    enum SegmentType {
+        Point,
+        Line,
+        BezierCurve
+    };
+
+    struct Segment {
+        SegmentType type = Point;
+        KisPaintInformation pi1;
+        KisPaintInformation pi2;
+        QPointF control1;
+        QPointF control2;
+    };
+
+public:
+    KisStrokeRecording();
+    ~KisStrokeRecording();
+
+    void addPoint(const KisPaintInformation &pi);
+    void addLine(const KisPaintInformation &pi1,
+                 const KisPaintInformation &pi2);
+    void addBezierCurve(const KisPaintInformation &pi1,
+                        const QPointF &control1,
+                        const QPointF &control2,
+                        const KisPaintInformation &pi2);
+
+    QVector<Segment> segments() const;
+
+    /**
+     * Saves the state of the image the stroke is painted on
+     */
+    void setImageState(KisImageSP image);
+
+    QRect imageBounds() const;
+    const KoColorSpace* colorSpace() const;
+    qreal xRes() const;
+    qreal yRes() const;
+
+    void setPainterState(const KoColor &paintColor,
+                         const QString &compositeOpId,
+                         quint8 opacity,
+                         KisPaintOpPresetSP preset);
+
+    KoColor paintColor() const;
+    QString compositeOpId() const;
+    quint8 opacity() const;
+
+    /**
+     * The preset the stroke has been painted with. Might be null if
+     * the preset couldn't be loaded, e.g. if its paintop is not present
+     * in the registry.
+     */
+    KisPaintOpPresetSP preset() const;
+
+    bool save(QIODevice *device) const;
+    bool save(const QString &fileName) const;
+
+    bool load(QIODevice *device, KisResourcesInterfaceSP resourcesInterface);
+    bool load(const QString &fileName, KisResourcesInterfaceSP resourcesInterface);
+
+private:
+    QVector<Segment> m_segments;
+
+    QRect m_imageBounds;
+    const KoColorSpace *m_colorSpace;
+    qreal m_xRes;
+    qreal m_yRes;
+
+    KoColor m_paintColor;
+    QString m_compositeOpId;
+    quint8 m_opacity;
+    KisPaintOpPresetSP m_preset;
+};
+
+#endif // KISSTROKERECORDING_H
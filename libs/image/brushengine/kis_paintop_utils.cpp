@@ -21,8 +21,13 @@
 #include "krita_utils.h"
 #include "krita_container_utils.h"
 #include <KisRenderedDab.h>
+#include "kis_painter.h"
+#include "kis_paintop.h"
+#include "KisRunnableStrokeJobData.h"
+#include "KisRunnableStrokeJobsInterface.h"
 
 #include <functional>
+#include <tuple>
 
 namespace KisPaintOpUtils {
 
@@ -110,6 +115,21 @@ QVector<QRect> splitDabsIntoRects(const QVector<QRect> &dabRects, int idealNumRe
     return rects;
 }
 
+void flushAsynchronousUpdates(KisPainter *painter)
+{
+    KisPaintOp *paintOp = painter->paintOp();
+    if (!paintOp) return;
+
+    bool needsMoreUpdates = false;
+
+    do {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        std::tie(std::ignore, needsMoreUpdates) = paintOp->doAsyncronousUpdate(jobs);
 
+        if (!jobs.isEmpty()) {
+            painter->runnableStrokeJobsInterface()->addRunnableJobs(jobs);
+        }
+    } while (needsMoreUpdates);
+}
 
 }
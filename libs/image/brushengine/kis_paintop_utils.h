@@ -27,6 +27,7 @@
 
 #include "kritaimage_export.h"
 
+class KisPainter;
 struct KisRenderedDab;
 
 namespace KisPaintOpUtils {
@@ -202,6 +203,15 @@ QVector<QRect> splitAndFilterDabRect(const QRect &totalRect, const QVector<QRect
 KRITAIMAGE_EXPORT
 QVector<QRect> splitDabsIntoRects(const QVector<QRect> &dabRects, int idealNumRects, int diameter, qreal spacing);
 
+/**
+ * Runs all the asynchronous updates of the paintop of \p painter, the
+ * same way FreehandStrokeStrategy does, until the paintop has no more
+ * queued dabs. The jobs are executed by the runnable jobs interface of
+ * the painter, which by default runs them in the calling thread.
+ */
+KRITAIMAGE_EXPORT
+void flushAsynchronousUpdates(KisPainter *painter);
+
 }
 
 #endif /* __KIS_PAINTOP_UTILS_H */
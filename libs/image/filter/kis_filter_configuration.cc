@@ -38,6 +38,7 @@ struct Q_DECL_HIDDEN KisFilterConfiguration::Private {
     QString name;
     qint32 version;
     QBitArray channelFlags;
+    bool isDialogPreview = false;
     KisCubicCurve curve;
     QList< KisCubicCurve > curves;
     KisResourcesInterfaceSP resourcesInterface = 0;
@@ -53,6 +54,7 @@ struct Q_DECL_HIDDEN KisFilterConfiguration::Private {
         : name(rhs.name),
           version(rhs.version),
           channelFlags(rhs.channelFlags),
+          isDialogPreview(rhs.isDialogPreview),
           curve(rhs.curve),
           curves(rhs.curves),
           resourcesInterface(rhs.resourcesInterface)
@@ -234,6 +236,16 @@ void KisFilterConfiguration::setChannelFlags(QBitArray channelFlags)
     d->channelFlags = channelFlags;
 }
 
+bool KisFilterConfiguration::isDialogPreview() const
+{
+    return d->isDialogPreview;
+}
+
+void KisFilterConfiguration::setDialogPreview(bool value)
+{
+    d->isDialogPreview = value;
+}
+
 #ifdef SANITY_CHECK_FILTER_CONFIGURATION_OWNER
 
 int KisFilterConfiguration::sanityRefUsageCounter()
@@ -119,6 +119,20 @@ public:
      */
     void setChannelFlags(QBitArray channelFlags);
 
+    /**
+     * @return true if the configuration is applied as the live preview
+     * of the filter dialog, which is regenerated on every change of the
+     * parameters. Filters may keep caches for such configurations, the
+     * dialog drops them when it is closed.
+     */
+    bool isDialogPreview() const;
+
+    /**
+     * Marks the configuration as applied by the filter dialog. The flag
+     * is not saved.
+     */
+    void setDialogPreview(bool value);
+
     /**
      * These functions exist solely to allow plugins to reimplement them as
      * needed, while allowing consumers to implement support for them without
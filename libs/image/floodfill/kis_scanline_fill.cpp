@@ -154,6 +154,20 @@ public:
         }
     }
 
+    ALWAYS_INLINE void calculateDifferences(quint8* pixelPtr, quint8 *differences, int numPixels) {
+        if (m_threshold == 1) {
+            const int pixelSize = m_colorSpace->pixelSize();
+
+            for (int i = 0; i < numPixels; i++) {
+                differences[i] = memcmp(m_srcPixelPtr, pixelPtr, pixelSize) == 0 ? 0 : quint8_MAX;
+                pixelPtr += pixelSize;
+            }
+        }
+        else {
+            m_colorSpace->differenceSpan(m_srcPixelPtr, pixelPtr, differences, numPixels);
+        }
+    }
+
 private:
     const KoColorSpace *m_colorSpace;
     KoColor m_srcPixel;
@@ -202,9 +216,54 @@ public:
         return result;
     }
 
+    ALWAYS_INLINE void calculateDifferences(quint8* pixelPtr, quint8 *differences, int numPixels) {
+        const HashKeyType *pixels = reinterpret_cast<const HashKeyType*>(pixelPtr);
+
+        m_missedPixels.clear();
+        m_missedIndexes.clear();
+
+        for (int i = 0; i < numPixels; i++) {
+            typename HashType::const_iterator it = m_differences.constFind(pixels[i]);
+
+            if (it != m_differences.constEnd()) {
+                differences[i] = *it;
+            } else {
+                m_missedPixels.append(pixels[i]);
+                m_missedIndexes.append(i);
+            }
+        }
+
+        if (m_missedPixels.isEmpty()) return;
+
+        const int numMissedPixels = m_missedPixels.size();
+        m_missedDifferences.resize(numMissedPixels);
+
+        if (m_threshold == 1) {
+            for (int i = 0; i < numMissedPixels; i++) {
+                m_missedDifferences[i] =
+                    memcmp(m_srcPixelPtr, &m_missedPixels[i], sizeof(HashKeyType)) == 0 ? 0 : quint8_MAX;
+            }
+        }
+        else {
+            m_colorSpace->differenceSpan(m_srcPixelPtr,
+                                         reinterpret_cast<const quint8*>(m_missedPixels.constData()),
+                                         m_missedDifferences.data(),
+                                         numMissedPixels);
+        }
+
+        for (int i = 0; i < numMissedPixels; i++) {
+            differences[m_missedIndexes[i]] = m_missedDifferences[i];
+            m_differences.insert(m_missedPixels[i], m_missedDifferences[i]);
+        }
+    }
+
 private:
     HashType m_differences;
 
+    QVector<HashKeyType> m_missedPixels;
+    QVector<int> m_missedIndexes;
+    QVector<quint8> m_missedDifferences;
+
     const KoColorSpace *m_colorSpace;
     KoColor m_srcPixel;
     const quint8 *m_srcPixelPtr;
@@ -228,8 +287,19 @@ public:
     }
 
     ALWAYS_INLINE quint8 calculateOpacity(quint8* pixelPtr) {
-        quint8 diff = this->calculateDifference(pixelPtr);
+        return opacityFromDifference(this->calculateDifference(pixelPtr));
+    }
+
+    ALWAYS_INLINE void calculateOpacities(quint8* pixelPtr, quint8 *opacities, int numPixels) {
+        this->calculateDifferences(pixelPtr, opacities, numPixels);
+
+        for (int i = 0; i < numPixels; i++) {
+            opacities[i] = opacityFromDifference(opacities[i]);
+        }
+    }
 
+private:
+    ALWAYS_INLINE quint8 opacityFromDifference(quint8 diff) const {
         if (!useSmoothSelection) {
             return diff <= m_threshold ? MAX_SELECTED : MIN_SELECTED;
         } else {
@@ -267,6 +337,13 @@ public:
         return quint8_MAX;
     }
 
+    ALWAYS_INLINE void calculateDifferences(quint8* pixelPtr, quint8 *differences, int numPixels) {
+        for (int i = 0; i < numPixels; i++) {
+            differences[i] = calculateDifference(pixelPtr);
+            pixelPtr += m_pixelSize;
+        }
+    }
+
 private:
     int m_pixelSize {0};
     QByteArray m_testPixel;
@@ -285,6 +362,14 @@ public:
         SrcPixelType *pixel = reinterpret_cast<SrcPixelType*>(pixelPtr);
         return *pixel == 0;
     }
+
+    ALWAYS_INLINE void calculateDifferences(quint8* pixelPtr, quint8 *differences, int numPixels) {
+        const SrcPixelType *pixels = reinterpret_cast<const SrcPixelType*>(pixelPtr);
+
+        for (int i = 0; i < numPixels; i++) {
+            differences[i] = pixels[i] == 0;
+        }
+    }
 };
 
 class GroupSplitPolicy
@@ -317,6 +402,13 @@ public:
         return diff <= m_threshold ? MAX_SELECTED : MIN_SELECTED;
     }
 
+    ALWAYS_INLINE void calculateOpacities(quint8* pixelPtr, quint8 *opacities, int numPixels) {
+        // the scribble device is always 8-bit, see fillContiguousGroup()
+        for (int i = 0; i < numPixels; i++) {
+            opacities[i] = calculateOpacity(pixelPtr + i);
+        }
+    }
+
     ALWAYS_INLINE void fillPixel(quint8 *dstPtr, quint8 opacity, int x, int y) {
         Q_UNUSED(opacity);
 
@@ -356,6 +448,8 @@ struct Q_DECL_HIDDEN KisScanlineFill::Private
     KisFillIntervalMap backwardMap;
     QStack<KisFillInterval> forwardStack;
 
+    QVector<quint8> opacitiesBuffer;
+
 
     inline void swapDirection() {
         rowIncrement *= -1;
@@ -458,6 +552,7 @@ void KisScanlineFill::processLine(KisFillInterval interval, const int rowIncreme
 
     int numPixelsLeft = 0;
     quint8 *dataPtr = 0;
+    const quint8 *opacityPtr = 0;
     const int pixelSize = m_d->device->pixelSize();
 
     while(x <= lastX) {
@@ -465,15 +560,32 @@ void KisScanlineFill::processLine(KisFillInterval interval, const int rowIncreme
         // methods too often
         if (numPixelsLeft <= 0) {
             pixelPolicy.m_srcIt->moveTo(x, row);
-            numPixelsLeft = pixelPolicy.m_srcIt->numContiguousColumns(x) - 1;
+            const int numChunkPixels =
+                qMin(pixelPolicy.m_srcIt->numContiguousColumns(x), lastX - x + 1);
+
+            numPixelsLeft = numChunkPixels - 1;
             dataPtr = const_cast<quint8*>(pixelPolicy.m_srcIt->rawDataConst());
+
+            /**
+             * Calculate opacities of the whole chunk in one go, so that
+             * the color space could use its bulk differenceSpan()
+             * implementation instead of converting pixels one-by-one.
+             * Filling a pixel never changes any other pixel of the chunk,
+             * so the precalculated values stay valid.
+             */
+            if (m_d->opacitiesBuffer.size() < numChunkPixels) {
+                m_d->opacitiesBuffer.resize(numChunkPixels);
+            }
+            pixelPolicy.calculateOpacities(dataPtr, m_d->opacitiesBuffer.data(), numChunkPixels);
+            opacityPtr = m_d->opacitiesBuffer.constData();
         } else {
             numPixelsLeft--;
             dataPtr += pixelSize;
+            opacityPtr++;
         }
 
         quint8 *pixelPtr = dataPtr;
-        quint8 opacity = pixelPolicy.calculateOpacity(pixelPtr);
+        quint8 opacity = *opacityPtr;
 
         if (opacity) {
             if (!currentForwardInterval.isValid()) {
@@ -33,6 +33,7 @@
 #include "filter/kis_filter.h"
 #include "kis_node_visitor.h"
 #include "kis_processing_visitor.h"
+#include "KisFilterTileCache.h"
 
 
 KisAdjustmentLayer::KisAdjustmentLayer(KisImageWSP image,
@@ -144,6 +145,7 @@ void KisAdjustmentLayer::setChannelFlags(const QBitArray & channelFlags)
 
     if (filterConfig) {
         filterConfig->setChannelFlags(channelFlags);
+        filterTileCache()->clear();
     }
     KisLayer::setChannelFlags(channelFlags);
 }
@@ -40,6 +40,7 @@
 #include "kis_clone_layer.h"
 #include "kis_processing_information.h"
 #include "kis_busy_progress_indicator.h"
+#include "KisFilterTileCache.h"
 
 
 #include "kis_merge_walker.h"
@@ -61,10 +62,12 @@
 class KisUpdateOriginalVisitor : public KisNodeVisitor
 {
 public:
-    KisUpdateOriginalVisitor(const QRect &updateRect, KisPaintDeviceSP projection, const QRect &cropRect)
+    KisUpdateOriginalVisitor(const QRect &updateRect, KisPaintDeviceSP projection, const QRect &cropRect,
+                             bool projectionChanged)
         : m_updateRect(updateRect),
           m_cropRect(cropRect),
-          m_projection(projection)
+          m_projection(projection),
+          m_projectionChanged(projectionChanged)
         {
         }
 
@@ -124,7 +127,8 @@ public:
             layer->busyProgressIndicator()->update();
 
             // We do not create a transaction here, as srcDevice != dstDevice
-            filter->process(m_projection, dstDevice, 0, filterRect, filterConfig.data(), 0);
+            layer->filterTileCache()->process(filter, filterConfig, m_projection, dstDevice, filterRect,
+                                              m_projectionChanged);
         }
 
         if (selection) {
@@ -209,6 +213,7 @@ private:
     QRect m_updateRect;
     QRect m_cropRect;
     KisPaintDeviceSP m_projection;
+    bool m_projectionChanged;
 };
 
 
@@ -249,7 +254,8 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
             DEBUG_NODE_ACTION("Updating", "N_EXTRA", currentLeaf, applyRect);
             KisUpdateOriginalVisitor originalVisitor(applyRect,
                                                      m_currentProjection,
-                                                     walker.cropRect());
+                                                     walker.cropRect(),
+                                                     false);
             currentLeaf->accept(originalVisitor);
             currentLeaf->projectionPlane()->recalculate(applyRect, currentLeaf->node());
 
@@ -261,9 +267,14 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
             setupProjection(currentLeaf, applyRect, useTempProjections);
         }
 
+        /**
+         * The nodes above the filthy one are updated because the
+         * projection below them has changed
+         */
         KisUpdateOriginalVisitor originalVisitor(applyRect,
                                                  m_currentProjection,
-                                                 walker.cropRect());
+                                                 walker.cropRect(),
+                                                 item.m_position & KisMergeWalker::N_ABOVE_FILTHY);
 
         if(item.m_position & KisMergeWalker::N_FILTHY) {
             DEBUG_NODE_ACTION("Updating", "N_FILTHY", currentLeaf, applyRect);
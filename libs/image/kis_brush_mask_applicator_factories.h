@@ -44,6 +44,10 @@ struct MaskApplicatorFactory
     typedef MaskGenerator* ParamType;
     typedef KisBrushMaskApplicatorBase* ReturnType;
 
+    static const char* kernelName() {
+        return "Brush mask applicators";
+    }
+
     template<Vc::Implementation _impl>
     static ReturnType create(ParamType maskGenerator);
 };
@@ -37,8 +37,10 @@
 #include <klocalizedstring.h>
 
 #include "kis_convolution_kernel.h"
+#include "kis_gaussian_kernel.h"
 #include "kis_global.h"
 #include "kis_image.h"
+#include "kis_image_config.h"
 #include "kis_layer.h"
 #include "kis_paint_device.h"
 #include "kis_painter.h"
@@ -50,11 +52,18 @@
 
 #include "kis_convolution_worker.h"
 #include "kis_convolution_worker_spatial.h"
+#include "kis_convolution_worker_box_gaussian.h"
 
 #include "config_convolution.h"
 
 #ifdef HAVE_FFTW3
 #include "kis_convolution_worker_fft.h"
+
+KisConvolutionWorkerFFTSpectraCache::Cache& KisConvolutionWorkerFFTSpectraCache::instance()
+{
+    static Cache s_cache;
+    return s_cache;
+}
 #endif
 
 
@@ -77,6 +86,32 @@ bool KisConvolutionPainter::useFFTImplementation(const KisConvolutionKernelSP ke
     return result;
 }
 
+bool KisConvolutionPainter::useBoxGaussian(qreal xRadius, qreal yRadius) const
+{
+    /**
+     * Small kernels are cheap enough, and they give the exact result
+     */
+    #define BOX_GAUSSIAN_THRESHOLD_SIZE 61
+
+    if (m_enginePreference == BOX_GAUSSIAN) return true;
+    if (m_enginePreference != NONE) return false;
+
+    if (KisGaussianKernel::kernelSizeFromRadius(qMax(xRadius, yRadius)) <= BOX_GAUSSIAN_THRESHOLD_SIZE) {
+        return false;
+    }
+
+    /**
+     * The box cascade differs from the exact Gaussian by about 1%, so
+     * it is chosen automatically only for the LoD previews, which are
+     * regenerated with the exact blur at the end of the stroke anyway.
+     * The final rendering uses it only when the user opted in for it.
+     */
+    const bool isLodPreview =
+        device() && device()->defaultBounds()->currentLevelOfDetail() > 0;
+
+    return isLodPreview || m_boxGaussianBlurEnabled;
+}
+
 template<class factory>
 KisConvolutionWorker<factory>* KisConvolutionPainter::createWorker(const KisConvolutionKernelSP kernel,
                                                                    KisPainter *painter,
@@ -86,7 +121,7 @@ KisConvolutionWorker<factory>* KisConvolutionPainter::createWorker(const KisConv
 
 #ifdef HAVE_FFTW3
     if (useFFTImplementation(kernel)) {
-        worker = new KisConvolutionWorkerFFT<factory>(painter, progress);
+        worker = new KisConvolutionWorkerFFT<factory>(painter, progress, m_cacheSourceSpectra);
     } else {
         worker = new KisConvolutionWorkerSpatial<factory>(painter, progress);
     }
@@ -109,27 +144,47 @@ bool KisConvolutionPainter::supportsFFTW()
 }
 
 
+void KisConvolutionPainter::setCacheSourceSpectra(bool value)
+{
+    m_cacheSourceSpectra = value;
+}
+
+void KisConvolutionPainter::clearSourceSpectraCache()
+{
+#ifdef HAVE_FFTW3
+    KisConvolutionWorkerFFTSpectraCache::clear();
+#endif
+}
+
 KisConvolutionPainter::KisConvolutionPainter()
     : KisPainter(),
-      m_enginePreference(NONE)
+      m_enginePreference(NONE),
+      m_cacheSourceSpectra(false),
+      m_boxGaussianBlurEnabled(KisImageConfig(true).boxGaussianBlur())
 {
 }
 
 KisConvolutionPainter::KisConvolutionPainter(KisPaintDeviceSP device)
     : KisPainter(device),
-      m_enginePreference(NONE)
+      m_enginePreference(NONE),
+      m_cacheSourceSpectra(false),
+      m_boxGaussianBlurEnabled(KisImageConfig(true).boxGaussianBlur())
 {
 }
 
 KisConvolutionPainter::KisConvolutionPainter(KisPaintDeviceSP device, KisSelectionSP selection)
     : KisPainter(device, selection),
-      m_enginePreference(NONE)
+      m_enginePreference(NONE),
+      m_cacheSourceSpectra(false),
+      m_boxGaussianBlurEnabled(KisImageConfig(true).boxGaussianBlur())
 {
 }
 
 KisConvolutionPainter::KisConvolutionPainter(KisPaintDeviceSP device, TestingEnginePreference enginePreference)
     : KisPainter(device),
-      m_enginePreference(enginePreference)
+      m_enginePreference(enginePreference),
+      m_cacheSourceSpectra(false),
+      m_boxGaussianBlurEnabled(KisImageConfig(true).boxGaussianBlur())
 {
 }
 
@@ -147,13 +202,7 @@ void KisConvolutionPainter::applyMatrix(const KisConvolutionKernelSP kernel, con
     // Determine whether we convolve border pixels, or not.
     switch (borderOp) {
     case BORDER_REPEAT: {
-        const QRect boundsRect = src->defaultBounds()->bounds();
-        const QRect requestedRect = QRect(srcPos, areaSize);
-        QRect dataRect = requestedRect | boundsRect;
-
-        KIS_SAFE_ASSERT_RECOVER(boundsRect != KisDefaultBounds().bounds()) {
-            dataRect = requestedRect | src->exactBounds();
-        }
+        const QRect dataRect = repeatDataRect(src, srcPos, areaSize);
 
         /**
          * FIXME: Implementation can return empty destination device
@@ -183,7 +232,49 @@ void KisConvolutionPainter::applyMatrix(const KisConvolutionKernelSP kernel, con
     }
 }
 
+void KisConvolutionPainter::applyGaussian(const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
+                                          qreal xRadius, qreal yRadius,
+                                          KisConvolutionBorderOp borderOp)
+{
+    const qreal xSigma = xRadius > 0.0 ? KisGaussianKernel::sigmaFromRadius(xRadius) : 0.0;
+    const qreal ySigma = yRadius > 0.0 ? KisGaussianKernel::sigmaFromRadius(yRadius) : 0.0;
+
+    if (src->defaultBounds()->wrapAroundMode()) {
+        borderOp = BORDER_IGNORE;
+    }
+
+    switch (borderOp) {
+    case BORDER_REPEAT: {
+        const QRect dataRect = repeatDataRect(src, srcPos, areaSize);
+
+        if (dataRect.isValid()) {
+            KisConvolutionWorkerBoxGaussian<RepeatIteratorFactory> worker(this, progressUpdater());
+            worker.execute(xSigma, ySigma, src, srcPos, dstPos, areaSize, dataRect);
+        }
+        break;
+    }
+    case BORDER_IGNORE:
+    default: {
+        KisConvolutionWorkerBoxGaussian<StandardIteratorFactory> worker(this, progressUpdater());
+        worker.execute(xSigma, ySigma, src, srcPos, dstPos, areaSize, QRect());
+    }
+    }
+}
+
 bool KisConvolutionPainter::needsTransaction(const KisConvolutionKernelSP kernel) const
 {
     return !useFFTImplementation(kernel);
 }
+
+QRect KisConvolutionPainter::repeatDataRect(const KisPaintDeviceSP src, QPoint srcPos, QSize areaSize)
+{
+    const QRect boundsRect = src->defaultBounds()->bounds();
+    const QRect requestedRect = QRect(srcPos, areaSize);
+    QRect dataRect = requestedRect | boundsRect;
+
+    KIS_SAFE_ASSERT_RECOVER(boundsRect != KisDefaultBounds().bounds()) {
+        dataRect = requestedRect | src->exactBounds();
+    }
+
+    return dataRect;
+}
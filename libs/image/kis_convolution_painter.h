@@ -50,7 +50,8 @@ public:
     enum TestingEnginePreference {
         NONE,
         SPATIAL,
-        FFTW
+        FFTW,
+        BOX_GAUSSIAN
     };
 
 
@@ -83,8 +84,48 @@ public:
      */
     bool needsTransaction(const KisConvolutionKernelSP kernel) const;
 
+    /**
+     * Blur the area with a Gaussian of the given radii (the radii are
+     * converted into sigma with KisGaussianKernel::sigmaFromRadius()).
+     *
+     * Unlike applyMatrix() with a Gaussian kernel, the blur is approximated
+     * with a cascade of box filters, so its cost doesn't depend on the
+     * radius. The result differs from the exact Gaussian by about 1% on
+     * sharp edges.
+     *
+     * The blur caches the source data before writing anything, so it doesn't
+     * need an explicit transaction when the source and destination coincide.
+     */
+    void applyGaussian(const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
+                       qreal xRadius, qreal yRadius,
+                       KisConvolutionBorderOp borderOp = BORDER_REPEAT);
+
+    /**
+     * Returns true if a Gaussian blur with the given radii should better
+     * be done with applyGaussian() than with applyMatrix(). Without an
+     * explicit BOX_GAUSSIAN preference the approximation is used for
+     * large radii only, and only in the LoD previews or when it is
+     * enabled with KisImageConfig::setBoxGaussianBlur().
+     */
+    bool useBoxGaussian(qreal xRadius, qreal yRadius) const;
+
     static bool supportsFFTW();
 
+    /**
+     * Makes the FFT convolution cache the spectra of the source, so
+     * that convolving the same area of the same data again with
+     * another kernel of a similar size skips the forward transforms.
+     * It is useful for the filters whose previews are regenerated on
+     * every change of the parameters (e.g. lens or motion blur).
+     */
+    void setCacheSourceSpectra(bool value);
+
+    /**
+     * Drops the spectra cached by the painters with
+     * setCacheSourceSpectra() enabled
+     */
+    static void clearSourceSpectraCache();
+
 protected:
     friend class KisConvolutionPainterTest;
 
@@ -98,7 +139,11 @@ private:
 
      bool useFFTImplementation(const KisConvolutionKernelSP kernel) const;
 
+     static QRect repeatDataRect(const KisPaintDeviceSP src, QPoint srcPos, QSize areaSize);
+
 private:
     TestingEnginePreference m_enginePreference;
+    bool m_cacheSourceSpectra;
+    bool m_boxGaussianBlurEnabled;
 };
 #endif //KIS_CONVOLUTION_PAINTER_H_
@@ -0,0 +1,464 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_CONVOLUTION_WORKER_BOX_GAUSSIAN_H
+#define KIS_CONVOLUTION_WORKER_BOX_GAUSSIAN_H
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <QtMath>
+#include <QVector>
+
+#include <KoChannelInfo.h>
+
+#include "KisThreadLimitedMap.h"
+#include "kis_convolution_worker.h"
+#include "kis_global.h"
+#include "kis_math_toolbox.h"
+#include "kis_paint_device.h"
+#include "kis_selection.h"
+
+/**
+ * Blurs the paint device with a cascade of three box filters, which
+ * approximates a Gaussian blur. Every box is implemented as a running
+ * sum, so the cost of the blur doesn't depend on its radius.
+ *
+ * To match the requested sigma exactly, the boxes are "extended" ones
+ * (Gwosdek et al., "Theoretical Foundations of Gaussian Convolution
+ * by Extended Box Filtering"): a box of integer radius has two
+ * additional taps with a fractional weight at its ends.
+ *
+ * The area is first copied into a floating point cache with
+ * premultiplied channels, then blurred horizontally (rows are split
+ * into strips processed in parallel) and vertically (the same for
+ * columns). The inner loops of the filter run over contiguous floats:
+ * all the channels of a pixel in the horizontal pass and all the
+ * channels of a strip of pixels in the vertical one.
+ */
+template<class _IteratorFactory_>
+class KisConvolutionWorkerBoxGaussian
+{
+public:
+    KisConvolutionWorkerBoxGaussian(KisPainter *painter, KoUpdater *progress)
+        : m_painter(painter),
+          m_progress(progress)
+    {
+    }
+
+    /**
+     * The number of pixels around the blurred area that affect
+     * the result of the blur with \p sigma
+     */
+    static int margin(qreal sigma)
+    {
+        return sigma > 0.0 ? numPasses * (BoxParams(sigma).radius + 1) : 0;
+    }
+
+    void execute(qreal xSigma, qreal ySigma, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect)
+    {
+        // Make the area we cover as small as possible
+        if (m_painter->selection()) {
+            QRect r = m_painter->selection()->selectedRect().intersected(QRect(srcPos, areaSize));
+            dstPos += r.topLeft() - srcPos;
+            srcPos = r.topLeft();
+            areaSize = r.size();
+        }
+
+        if (areaSize.isEmpty()) return;
+
+        setProgress(0);
+        if (isInterrupted()) return;
+
+        const QRect areaRect(srcPos, areaSize);
+        const int xMargin = margin(xSigma);
+        const int yMargin = margin(ySigma);
+
+        /**
+         * The passes repeat the border pixels of the cache, so there is
+         * no need to cache the repeated pixels outside the data rect
+         */
+        QRect cacheRect = areaRect.adjusted(-xMargin, -yMargin, xMargin, yMargin);
+        if (dataRect.isValid()) {
+            cacheRect &= dataRect | areaRect;
+        }
+
+        ChannelInfo info(convolvableChannelList(src));
+
+        m_cacheRect = cacheRect;
+        m_pixelStride = info.numChannels();
+        m_rowStride = cacheRect.width() * m_pixelStride;
+        m_cache.resize(size_t(m_rowStride) * cacheRect.height());
+
+        QVector<QRect> rowStrips = splitIntoRowStrips(cacheRect);
+        KisThreadLimitedMap::blockingMap(rowStrips, [&] (const QRect &rc) {
+            fillCacheFromDevice(src, rc, info, dataRect);
+        });
+
+        setProgress(20);
+        if (isInterrupted()) return;
+
+        if (xSigma > 0.0) {
+            const BoxParams box(xSigma);
+
+            KisThreadLimitedMap::blockingMap(rowStrips, [&] (const QRect &rc) {
+                std::vector<float> line;
+                std::vector<double> acc;
+
+                for (int y = rc.top(); y <= rc.bottom(); y++) {
+                    float *rowPtr = cachePtr(cacheRect.left(), y);
+
+                    for (int i = 0; i < numPasses; i++) {
+                        boxPass(rowPtr, cacheRect.width(), m_pixelStride, m_pixelStride, box, line, acc);
+                    }
+                }
+            });
+        }
+
+        setProgress(50);
+        if (isInterrupted()) return;
+
+        if (ySigma > 0.0) {
+            const BoxParams box(ySigma);
+
+            // only the columns of the blurred area are needed now
+            const QRect columnsRect(areaRect.left(), cacheRect.top(), areaRect.width(), cacheRect.height());
+
+            QVector<QRect> columnStrips = splitIntoColumnStrips(columnsRect);
+            KisThreadLimitedMap::blockingMap(columnStrips, [&] (const QRect &rc) {
+                std::vector<float> line;
+                std::vector<double> acc;
+
+                float *stripPtr = cachePtr(rc.left(), cacheRect.top());
+
+                for (int i = 0; i < numPasses; i++) {
+                    boxPass(stripPtr, cacheRect.height(), m_rowStride, rc.width() * m_pixelStride, box, line, acc);
+                }
+            });
+        }
+
+        setProgress(80);
+        if (isInterrupted()) return;
+
+        const QPoint offset = srcPos - dstPos;
+        QVector<QRect> dstStrips = splitIntoRowStrips(QRect(dstPos, areaSize), m_painter->device()->y());
+        KisThreadLimitedMap::blockingMap(dstStrips, [&] (const QRect &rc) {
+            writeResultToDevice(rc, offset, info, dataRect);
+        });
+
+        setProgress(100);
+        m_cache.clear();
+    }
+
+private:
+    static const int numPasses = 3;
+    static const int stripSize = 64;
+
+    struct BoxParams {
+        BoxParams(qreal sigma) {
+            const qreal variance = pow2(sigma) / numPasses;
+
+            radius = qMax(0, qFloor(0.5 * std::sqrt(12.0 * variance + 1.0) - 0.5));
+
+            /**
+             * The weight of the end taps is chosen so that the variance
+             * of the box is exactly the requested one
+             */
+            const qreal r = radius;
+            endWeight = (2.0 * r + 1.0) * (r * (r + 1.0) / 3.0 - variance) /
+                (2.0 * (variance - pow2(r + 1.0)));
+
+            normalizationFactor = 1.0 / (2.0 * r + 1.0 + 2.0 * endWeight);
+        }
+
+        int radius;
+        double endWeight;
+        double normalizationFactor;
+    };
+
+    struct ChannelInfo {
+        ChannelInfo(const QList<KoChannelInfo*> &_convChannelList)
+            : convChannelList(_convChannelList),
+              alphaCachePos(-1),
+              alphaRealPos(-1)
+        {
+            KisMathToolbox mathToolbox;
+
+            for (int i = 0; i < convChannelList.count(); ++i) {
+                minClamp.append(mathToolbox.minChannelValue(convChannelList[i]));
+                maxClamp.append(mathToolbox.maxChannelValue(convChannelList[i]));
+
+                if (convChannelList[i]->channelType() == KoChannelInfo::ALPHA) {
+                    alphaCachePos = i;
+                    alphaRealPos = convChannelList[i]->pos();
+                }
+            }
+
+            toDoubleFuncPtr.resize(convChannelList.count());
+            fromDoubleFuncPtr.resize(convChannelList.count());
+
+            bool result = mathToolbox.getToDoubleChannelPtr(convChannelList, toDoubleFuncPtr);
+            result &= mathToolbox.getFromDoubleChannelPtr(convChannelList, fromDoubleFuncPtr);
+
+            KIS_ASSERT(result);
+        }
+
+        inline int numChannels() const {
+            return convChannelList.size();
+        }
+
+        QList<KoChannelInfo*> convChannelList;
+
+        QVector<qreal> minClamp;
+        QVector<qreal> maxClamp;
+
+        QVector<PtrToDouble> toDoubleFuncPtr;
+        QVector<PtrFromDouble> fromDoubleFuncPtr;
+
+        int alphaCachePos;
+        int alphaRealPos;
+    };
+
+    /**
+     * Applies one box to \p count elements placed \p step floats apart.
+     * Every element is a vector of \p size contiguous floats. The elements
+     * outside the line repeat the border ones.
+     */
+    static void boxPass(float *data, int count, int step, int size,
+                        const BoxParams &box,
+                        std::vector<float> &line, std::vector<double> &acc)
+    {
+        line.resize(size_t(count) * size);
+        for (int i = 0; i < count; i++) {
+            std::copy(data + i * step, data + i * step + size, line.begin() + i * size);
+        }
+
+        auto element = [&line, count, size] (int i) {
+            return line.data() + qBound(0, i, count - 1) * size;
+        };
+
+        acc.assign(size, 0.0);
+        for (int i = -box.radius; i <= box.radius; i++) {
+            const float *ptr = element(i);
+            for (int k = 0; k < size; k++) {
+                acc[k] += ptr[k];
+            }
+        }
+
+        const double endWeight = box.endWeight;
+        const double normalizationFactor = box.normalizationFactor;
+
+        for (int i = 0; i < count; i++) {
+            const float *prevPtr = element(i - box.radius - 1);
+            const float *firstPtr = element(i - box.radius);
+            const float *nextPtr = element(i + box.radius + 1);
+            float *dstPtr = data + i * step;
+
+            for (int k = 0; k < size; k++) {
+                dstPtr[k] = (acc[k] + endWeight * (prevPtr[k] + nextPtr[k])) * normalizationFactor;
+                acc[k] += nextPtr[k] - firstPtr[k];
+            }
+        }
+    }
+
+    /**
+     * Splits the rect into strips aligned to the tiles of a device
+     * with vertical offset \p originY, so that different threads
+     * never write into the same tile of that device
+     */
+    static QVector<QRect> splitIntoRowStrips(const QRect &rc, int originY = 0)
+    {
+        QVector<QRect> strips;
+
+        for (int y = rc.top(); y <= rc.bottom();) {
+            const int nextY = qMin(rc.bottom() + 1,
+                                   originY + (qFloor(qreal(y - originY) / stripSize) + 1) * stripSize);
+            strips.append(QRect(rc.left(), y, rc.width(), nextY - y));
+            y = nextY;
+        }
+
+        return strips;
+    }
+
+    static QVector<QRect> splitIntoColumnStrips(const QRect &rc)
+    {
+        QVector<QRect> strips;
+
+        for (int x = rc.left(); x <= rc.right(); x += stripSize) {
+            const int width = rc.right() + 1 - x;
+            strips.append(QRect(x, rc.top(), width < stripSize ? width : stripSize, rc.height()));
+        }
+
+        return strips;
+    }
+
+    inline float* cachePtr(int x, int y) {
+        return m_cache.data() +
+            size_t(y - m_cacheRect.top()) * m_rowStride +
+            (x - m_cacheRect.left()) * m_pixelStride;
+    }
+
+    void fillCacheFromDevice(KisPaintDeviceSP src,
+                             const QRect &rect,
+                             const ChannelInfo &info,
+                             const QRect &dataRect) {
+
+        typename _IteratorFactory_::HLineConstIterator hitSrc =
+            _IteratorFactory_::createHLineConstIterator(src,
+                                                        rect.x(), rect.y(), rect.width(),
+                                                        dataRect);
+
+        const int channelCount = info.numChannels();
+
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            float *cacheDataPtr = cachePtr(rect.left(), y);
+
+            for (int x = 0; x < rect.width(); ++x) {
+                const quint8 *data = hitSrc->oldRawData();
+
+                // no alpha is a rare case, so just multiply by 1.0 in that case
+                double alphaValue = info.alphaRealPos >= 0 ?
+                    info.toDoubleFuncPtr[info.alphaCachePos](data, info.alphaRealPos) : 1.0;
+
+                for (int k = 0; k < channelCount; ++k) {
+                    if (k != info.alphaCachePos) {
+                        const quint32 channelPos = info.convChannelList[k]->pos();
+                        cacheDataPtr[k] = info.toDoubleFuncPtr[k](data, channelPos) * alphaValue;
+                    } else {
+                        cacheDataPtr[k] = alphaValue;
+                    }
+                }
+
+                cacheDataPtr += m_pixelStride;
+                hitSrc->nextPixel();
+            }
+
+            hitSrc->nextRow();
+        }
+    }
+
+    inline qreal writeOneChannelFromCache(quint8* dstPtr,
+                                          const int channel,
+                                          const ChannelInfo &info,
+                                          qreal channelPixelValue) {
+
+        if (channelPixelValue > info.maxClamp[channel]) {
+            channelPixelValue = info.maxClamp[channel];
+        } else if (!(channelPixelValue >= info.minClamp[channel])) {
+            // IEEE compliant comparisons with NaN are always false
+            channelPixelValue = info.minClamp[channel];
+        }
+
+        info.fromDoubleFuncPtr[channel](dstPtr, info.convChannelList[channel]->pos(), channelPixelValue);
+
+        return channelPixelValue;
+    }
+
+    void writeResultToDevice(const QRect &rect,
+                             const QPoint &srcOffset,
+                             const ChannelInfo &info,
+                             const QRect &dataRect) {
+
+        typename _IteratorFactory_::HLineIterator hitDst =
+            _IteratorFactory_::createHLineIterator(m_painter->device(),
+                                                   rect.x(), rect.y(), rect.width(),
+                                                   dataRect);
+
+        const int channelCount = info.numChannels();
+
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            const float *cacheDataPtr = cachePtr(rect.left() + srcOffset.x(), y + srcOffset.y());
+
+            for (int x = 0; x < rect.width(); ++x) {
+                quint8 *dstPtr = hitDst->rawData();
+
+                if (info.alphaCachePos >= 0) {
+                    const qreal alphaValue =
+                        writeOneChannelFromCache(dstPtr, info.alphaCachePos, info,
+                                                 cacheDataPtr[info.alphaCachePos]);
+
+                    const qreal alphaValueInv =
+                        alphaValue > std::numeric_limits<qreal>::epsilon() ? 1.0 / alphaValue : 0.0;
+
+                    for (int k = 0; k < channelCount; ++k) {
+                        if (k != info.alphaCachePos) {
+                            writeOneChannelFromCache(dstPtr, k, info, cacheDataPtr[k] * alphaValueInv);
+                        }
+                    }
+                } else {
+                    for (int k = 0; k < channelCount; ++k) {
+                        writeOneChannelFromCache(dstPtr, k, info, cacheDataPtr[k]);
+                    }
+                }
+
+                cacheDataPtr += m_pixelStride;
+                hitDst->nextPixel();
+            }
+
+            hitDst->nextRow();
+        }
+    }
+
+    QList<KoChannelInfo *> convolvableChannelList(const KisPaintDeviceSP src)
+    {
+        QBitArray painterChannelFlags = m_painter->channelFlags();
+        if (painterChannelFlags.isEmpty()) {
+            painterChannelFlags = QBitArray(src->colorSpace()->channelCount(), true);
+        }
+        Q_ASSERT(static_cast<quint32>(painterChannelFlags.size()) == src->colorSpace()->channelCount());
+        QList<KoChannelInfo *> channelInfo = src->colorSpace()->channels();
+        QList<KoChannelInfo *> convChannelList;
+
+        for (qint32 c = 0; c < channelInfo.count(); ++c) {
+            if (painterChannelFlags.testBit(c)) {
+                convChannelList.append(channelInfo[c]);
+            }
+        }
+
+        return convChannelList;
+    }
+
+    void setProgress(int value)
+    {
+        if (m_progress) {
+            m_progress->setProgress(value);
+        }
+    }
+
+    bool isInterrupted()
+    {
+        if (m_progress && m_progress->interrupted()) {
+            m_cache.clear();
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    KisPainter *m_painter;
+    KoUpdater *m_progress;
+
+    QRect m_cacheRect;
+    int m_pixelStride = 0;
+    int m_rowStride = 0;
+    std::vector<float> m_cache;
+};
+
+#endif // KIS_CONVOLUTION_WORKER_BOX_GAUSSIAN_H
@@ -20,49 +20,292 @@
 #ifndef KIS_CONVOLUTION_WORKER_FFT_H
 #define KIS_CONVOLUTION_WORKER_FFT_H
 
-#include <iostream>
+#include <cmath>
+#include <limits>
 
 #include <KoChannelInfo.h>
+#include <KoColorSpace.h>
 
+#include "kritaimage_export.h"
+#include "KisThreadLimitedMap.h"
 #include "kis_convolution_worker.h"
 #include "kis_math_toolbox.h"
+#include "kis_image_config.h"
+#include "kis_selection.h"
 
+#include <QByteArray>
+#include <QHash>
 #include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSharedPointer>
 #include <QVector>
-#include <QTextStream>
-#include <QFile>
-#include <QDir>
+#include <QtMath>
 
 #include <fftw3.h>
 
-template<class _IteratorFactory_> class KisConvolutionWorkerFFT;
-class KisConvolutionWorkerFFTLock
+/**
+ * The planner of FFTW is not thread-safe, but the execution of the
+ * plans with the new-array interface is. The plans are created once per
+ * tile size and then shared by all the workers and all the threads, so
+ * the planner is locked only when a new tile size is requested.
+ */
+class KisConvolutionWorkerFFTPlans
 {
+public:
+    struct Plans {
+        fftw_plan forward = 0;
+        fftw_plan backward = 0;
+    };
+
+    /**
+     * Returns the plans for the out-of-place transform of a real
+     * \p width x \p height array. The arrays passed to the plans should
+     * be allocated with fftw_malloc().
+     */
+    static Plans plans(int width, int height)
+    {
+        QMutexLocker l(&mutex());
+
+        QHash<QPair<int, int>, Plans> &cache = plansCache();
+        const QPair<int, int> key(width, height);
+
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            return *it;
+        }
+
+        const int complexLength = height * (width / 2 + 1);
+
+        double *realData = (double*)fftw_malloc(sizeof(double) * width * height);
+        fftw_complex *complexData = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * complexLength);
+
+        Plans plans;
+        plans.forward = fftw_plan_dft_r2c_2d(height, width, realData, complexData, FFTW_ESTIMATE);
+        plans.backward = fftw_plan_dft_c2r_2d(height, width, complexData, realData, FFTW_ESTIMATE);
+
+        fftw_free(realData);
+        fftw_free(complexData);
+
+        cache.insert(key, plans);
+        return plans;
+    }
+
 private:
-    static QMutex fftwMutex;
-    template<class _IteratorFactory_> friend class KisConvolutionWorkerFFT;
+    static QMutex& mutex() {
+        static QMutex s_mutex;
+        return s_mutex;
+    }
+
+    static QHash<QPair<int, int>, Plans>& plansCache() {
+        static QHash<QPair<int, int>, Plans> s_cache;
+        return s_cache;
+    }
 };
 
-QMutex KisConvolutionWorkerFFTLock::fftwMutex;
+/**
+ * The key of a tile in KisConvolutionWorkerFFTSpectraCache
+ */
+struct KisConvolutionWorkerFFTSpectraKey {
+    QRect cacheRect;
+    QRect dataRect;
+    QString colorSpaceId;
+    QVector<int> channelPositions;
+
+    bool operator==(const KisConvolutionWorkerFFTSpectraKey &rhs) const {
+        return cacheRect == rhs.cacheRect &&
+            dataRect == rhs.dataRect &&
+            colorSpaceId == rhs.colorSpaceId &&
+            channelPositions == rhs.channelPositions;
+    }
+};
+
+inline uint qHash(const KisConvolutionWorkerFFTSpectraKey &key, uint seed = 0)
+{
+    uint hash = qHash(key.colorSpaceId, seed);
+
+    const int values[] = {
+        key.cacheRect.x(), key.cacheRect.y(), key.cacheRect.width(), key.cacheRect.height(),
+        key.dataRect.x(), key.dataRect.y(), key.dataRect.width(), key.dataRect.height()
+    };
+
+    for (int value : values) {
+        hash = 31 * hash + qHash(value);
+    }
+
+    Q_FOREACH (int value, key.channelPositions) {
+        hash = 31 * hash + qHash(value);
+    }
+
+    return hash;
+}
+
+/**
+ * A global cache of the spectra of the source tiles of the FFT
+ * convolution. When a filter dialog convolves the same preview area
+ * again and again with different kernels, only the multiplication by
+ * the spectrum of the kernel and the inverse transform are redone.
+ *
+ * The paint devices passed to the filters are usually temporary
+ * copies, so the entries are matched by the raw pixel data of the
+ * tile rather than by the identity of the device.
+ */
+class KRITAIMAGE_EXPORT KisConvolutionWorkerFFTSpectraCache
+{
+public:
+    typedef KisConvolutionWorkerFFTSpectraKey Key;
+
+    struct Entry {
+        QByteArray sourceData;
+
+        // the spectrum of every channel as interleaved complex values
+        QVector<QVector<double>> spectra;
+
+        qint64 memorySize() const {
+            qint64 size = sourceData.size();
+            Q_FOREACH (const QVector<double> &spectrum, spectra) {
+                size += qint64(sizeof(double)) * spectrum.size();
+            }
+            return size;
+        }
+    };
+
+    typedef QSharedPointer<const Entry> EntrySP;
+
+    /**
+     * Returns the spectra cached for \p key, if they were calculated
+     * for exactly the same \p sourceData
+     */
+    static EntrySP find(const Key &key, const QByteArray &sourceData)
+    {
+        QMutexLocker l(&instance().mutex);
+
+        auto it = instance().entries.find(key);
+        if (it == instance().entries.end() || it->entry->sourceData != sourceData) {
+            return EntrySP();
+        }
+
+        it->lastAccess = ++instance().accessCounter;
+        instance().hitCount++;
+        return it->entry;
+    }
+
+    /**
+     * The number of lookups that found the spectra cached since the
+     * start of the application. Used by the unittests.
+     */
+    static qint64 hitCount()
+    {
+        QMutexLocker l(&instance().mutex);
+        return instance().hitCount;
+    }
+
+    /**
+     * Drops all the cached spectra
+     */
+    static void clear()
+    {
+        QMutexLocker l(&instance().mutex);
+
+        instance().entries.clear();
+        instance().memorySize = 0;
+    }
+
+    /**
+     * Caches \p entry, dropping the least recently used entries to fit
+     * into \p memoryLimit bytes
+     */
+    static void insert(const Key &key, EntrySP entry, qint64 memoryLimit)
+    {
+        QMutexLocker l(&instance().mutex);
+
+        Cache &cache = instance();
+
+        auto it = cache.entries.find(key);
+        if (it != cache.entries.end()) {
+            cache.memorySize -= it->entry->memorySize();
+            cache.entries.erase(it);
+        }
+
+        const qint64 entrySize = entry->memorySize();
+        if (entrySize > memoryLimit) return;
+
+        while (cache.memorySize + entrySize > memoryLimit && !cache.entries.isEmpty()) {
+            auto oldest = cache.entries.begin();
+            for (auto i = cache.entries.begin(); i != cache.entries.end(); ++i) {
+                if (i->lastAccess < oldest->lastAccess) {
+                    oldest = i;
+                }
+            }
+
+            cache.memorySize -= oldest->entry->memorySize();
+            cache.entries.erase(oldest);
+        }
+
+        CacheItem item;
+        item.entry = entry;
+        item.lastAccess = ++cache.accessCounter;
 
+        cache.entries.insert(key, item);
+        cache.memorySize += entrySize;
+    }
 
+private:
+    struct CacheItem {
+        EntrySP entry;
+        qint64 lastAccess = 0;
+    };
+
+    struct Cache {
+        QMutex mutex;
+        QHash<Key, CacheItem> entries;
+        qint64 memorySize = 0;
+        qint64 accessCounter = 0;
+        qint64 hitCount = 0;
+    };
+
+    /**
+     * Defined in the library rather than inline, so that the unittests
+     * see the same instance as the convolution painter
+     */
+    static Cache& instance();
+};
+
+/**
+ * Convolves the device with the "overlap-save" method: the area is split
+ * into tiles, every tile is convolved with its own FFT of a fixed size
+ * and the parts of the result that are not spoiled by the wrapping of
+ * the FFT are written into the destination.
+ *
+ * The tiles are processed in parallel. The size of the tiles and the
+ * number of the tiles processed at the same time are limited by
+ * KisImageConfig::fftConvolutionMemoryLimit().
+ */
 template<class _IteratorFactory_>
 class KisConvolutionWorkerFFT : public KisConvolutionWorker<_IteratorFactory_>
 {
 public:
-    KisConvolutionWorkerFFT(KisPainter *painter, KoUpdater *progress)
+    /**
+     * When \p cacheSourceSpectra is true, the spectra of the source
+     * tiles are kept in KisConvolutionWorkerFFTSpectraCache. To let the
+     * kernels of similar sizes reuse the same spectra, the tiles are
+     * then laid out for the kernel size rounded up to
+     * cachedKernelSizeStep.
+     */
+    KisConvolutionWorkerFFT(KisPainter *painter, KoUpdater *progress, bool cacheSourceSpectra = false)
         : KisConvolutionWorker<_IteratorFactory_>(painter, progress),
-          m_currentProgress(0),
-          m_kernelFFT(0)
+          m_kernelFFT(0),
+          m_cacheSourceSpectra(cacheSourceSpectra)
     {
     }
 
     ~KisConvolutionWorkerFFT()
     {
+        cleanUp();
     }
 
 
-    virtual void execute(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect)
+    virtual void execute(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP _src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect)
     {
         // Make the area we cover as small as possible
         if (this->m_painter->selection())
@@ -76,94 +319,94 @@ public:
         if (areaSize.width() == 0 || areaSize.height() == 0)
             return;
 
-        addToProgress(0);
+        setProgress(0);
         if (isInterrupted()) return;
 
-        const quint32 halfKernelWidth = (kernel->width() - 1) / 2;
-        const quint32 halfKernelHeight = (kernel->height() - 1) / 2;
-
-        m_fftWidth = areaSize.width() + 4 * halfKernelWidth;
-        m_fftHeight = areaSize.height() + 2 * halfKernelHeight;
-
         /**
-         * FIXME: check whether this "optimization" is needed to
-         * be uncommented. My tests showed about 30% better performance
-         * when the line is commented out (DK).
+         * The tiles are written while the other tiles are still being
+         * read, so when convolving the device in-place we should read
+         * from a (copy-on-write) snapshot of it.
          */
-        //optimumDimensions(m_fftWidth, m_fftHeight);
-
-        m_fftLength = m_fftHeight * (m_fftWidth / 2 + 1);
-        m_extraMem = (m_fftWidth % 2) ? 1 : 2;
-
-        // create and fill kernel
-        m_kernelFFT = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
-        memset(m_kernelFFT, 0, sizeof(fftw_complex) * m_fftLength);
-        fftFillKernelMatrix(kernel, m_kernelFFT);
+        KisPaintDeviceSP src = _src;
+        if (src == this->m_painter->device()) {
+            src = new KisPaintDevice(*_src);
+        }
 
         // find out which channels need convolving
         QList<KoChannelInfo*> convChannelList = this->convolvableChannelList(src);
 
-        m_channelFFT.resize(convChannelList.count());
-        for (auto i = m_channelFFT.begin(); i != m_channelFFT.end(); ++i) {
-            *i = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
+        m_layoutKernelSize = QSize(kernel->width(), kernel->height());
+
+        if (m_cacheSourceSpectra) {
+            m_layoutKernelSize =
+                QSize((m_layoutKernelSize.width() + cachedKernelSizeStep - 1) / cachedKernelSizeStep * cachedKernelSizeStep,
+                      (m_layoutKernelSize.height() + cachedKernelSizeStep - 1) / cachedKernelSizeStep * cachedKernelSizeStep);
+
+            m_spectraCacheMemoryLimit = qint64(KisImageConfig(true).fftConvolutionMemoryLimit()) * 1024 * 1024;
+
+            m_spectraCacheKeyBase.colorSpaceId = src->colorSpace()->id();
+            m_spectraCacheKeyBase.channelPositions.clear();
+            Q_FOREACH (KoChannelInfo *channel, convChannelList) {
+                m_spectraCacheKeyBase.channelPositions.append(channel->pos());
+            }
         }
 
-        const double kernelFactor = kernel->factor() ? kernel->factor() : 1;
-        const double fftScale = 1.0 / (m_fftHeight * m_fftWidth) / kernelFactor;
+        TileGeometry geometry = calculateTileGeometry(m_layoutKernelSize, areaSize, convChannelList.count());
 
-        FFTInfo info (fftScale, convChannelList, kernel, this->m_painter->device()->colorSpace());
-        int cacheRowStride = m_fftWidth + m_extraMem;
+        m_fftWidth = geometry.fftWidth;
+        m_fftHeight = geometry.fftHeight;
+        m_fftLength = m_fftHeight * (m_fftWidth / 2 + 1);
 
-        fillCacheFromDevice(src,
-                            QRect(srcPos.x() - halfKernelWidth,
-                                  srcPos.y() - halfKernelHeight,
-                                  m_fftWidth,
-                                  m_fftHeight),
-                            cacheRowStride,
-                            info, dataRect);
-
-        addToProgress(10);
-        if (isInterrupted()) return;
+        m_plans = KisConvolutionWorkerFFTPlans::plans(m_fftWidth, m_fftHeight);
 
-        // calculate number off fft operations required for progress reporting
-        const float progressPerFFT = (100 - 30) / (double)(convChannelList.count() * 2 + 1);
+        // create and fill kernel
+        {
+            double *kernelData = (double*)fftw_malloc(sizeof(double) * m_fftWidth * m_fftHeight);
+            memset(kernelData, 0, sizeof(double) * m_fftWidth * m_fftHeight);
+            fftFillKernelMatrix(kernel, kernelData);
 
-        // perform FFT
-        fftw_plan fftwPlanForward, fftwPlanBackward;
+            m_kernelFFT = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
+            fftw_execute_dft_r2c(m_plans.forward, kernelData, m_kernelFFT);
 
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftwPlanForward = fftw_plan_dft_r2c_2d(m_fftHeight, m_fftWidth, (double*)m_kernelFFT, m_kernelFFT, FFTW_ESTIMATE);
-        fftwPlanBackward = fftw_plan_dft_c2r_2d(m_fftHeight, m_fftWidth, m_kernelFFT, (double*)m_kernelFFT, FFTW_ESTIMATE);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
+            fftw_free(kernelData);
+        }
 
-        fftw_execute(fftwPlanForward);
-        addToProgress(progressPerFFT);
+        setProgress(10);
         if (isInterrupted()) return;
 
-        for (auto k = m_channelFFT.begin(); k != m_channelFFT.end(); ++k)
-        {
-            fftw_execute_dft_r2c(fftwPlanForward, (double*)(*k), *k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
+        const double kernelFactor = kernel->factor() ? kernel->factor() : 1;
+        const double fftScale = 1.0 / (m_fftHeight * m_fftWidth) / kernelFactor;
 
-            fftMultiply(*k, m_kernelFFT);
+        FFTInfo info (fftScale, convChannelList, kernel, this->m_painter->device()->colorSpace());
+
+        const KisPaintDeviceSP dst = this->m_painter->device();
+        const QVector<QRect> tiles = splitIntoTiles(QRect(dstPos, areaSize), geometry.tileSize, QPoint(dst->x(), dst->y()));
+        const QPoint srcOffset = srcPos - dstPos;
 
-            fftw_execute_dft_c2r(fftwPlanBackward, *k, (double*)*k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
+        /**
+         * Every job processes every numJobs'th tile sequentially, reusing
+         * its buffers, so there are never more than numJobs tiles in memory.
+         */
+        QVector<int> jobs;
+        for (int i = 0; i < qMin(geometry.numParallelTiles, tiles.size()); i++) {
+            jobs.append(i);
         }
 
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftw_destroy_plan(fftwPlanForward);
-        fftw_destroy_plan(fftwPlanBackward);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
+        const int numJobs = jobs.size();
+
+        KisThreadLimitedMap::blockingMap(jobs, [&] (int jobIndex) {
+            TileBuffers buffers(info.numChannels(), m_fftWidth * m_fftHeight, m_fftLength);
 
+            for (int i = jobIndex; i < tiles.size(); i += numJobs) {
+                if (this->m_progress && this->m_progress->interrupted()) break;
 
-        writeResultToDevice(QRect(dstPos.x(), dstPos.y(), areaSize.width(), areaSize.height()),
-                            cacheRowStride, halfKernelWidth, halfKernelHeight,
-                            info, dataRect);
+                processTile(src, tiles[i], srcOffset, kernel, info, dataRect, buffers);
+            }
+        });
 
-        addToProgress(20);
+        if (isInterrupted()) return;
+
+        setProgress(100);
         cleanUp();
     }
 
@@ -218,11 +461,123 @@ public:
         int alphaRealPos;
     };
 
+    /**
+     * The buffers of a single tile: the real data of every channel
+     * and a complex buffer for the spectrum of the current channel
+     */
+    struct TileBuffers {
+        TileBuffers(int numChannels, int realLength, int complexLength)
+            : channels(numChannels)
+        {
+            for (auto i = channels.begin(); i != channels.end(); ++i) {
+                *i = (double*)fftw_malloc(sizeof(double) * realLength);
+            }
+            spectrum = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * complexLength);
+        }
+
+        ~TileBuffers() {
+            Q_FOREACH (double *channel, channels) {
+                fftw_free(channel);
+            }
+            fftw_free(spectrum);
+        }
+
+        QVector<double*> channels;
+        fftw_complex *spectrum;
+
+    private:
+        Q_DISABLE_COPY(TileBuffers)
+    };
+
+    void processTile(KisPaintDeviceSP src,
+                     const QRect &dstTileRect,
+                     const QPoint &srcOffset,
+                     const KisConvolutionKernelSP kernel,
+                     const FFTInfo &info,
+                     const QRect &dataRect,
+                     TileBuffers &buffers)
+    {
+        Q_UNUSED(kernel);
+
+        /**
+         * The pixel (x, y) of the result depends on the source pixels
+         * in the rect [x - leftMargin, x + rightMargin] x [...]. The
+         * margins are calculated for the layout kernel size, which is
+         * never smaller than the size of the kernel itself.
+         */
+        const int halfKernelWidth = (m_layoutKernelSize.width() - 1) / 2;
+        const int halfKernelHeight = (m_layoutKernelSize.height() - 1) / 2;
+        const int leftMargin = m_layoutKernelSize.width() - 1 - halfKernelWidth;
+        const int topMargin = m_layoutKernelSize.height() - 1 - halfKernelHeight;
+
+        const QPoint cacheOrigin = dstTileRect.topLeft() + srcOffset - QPoint(leftMargin, topMargin);
+        const QRect cacheRect(cacheOrigin, QSize(m_fftWidth, m_fftHeight));
+
+        QByteArray sourceData;
+
+        fillCacheFromDevice(src,
+                            cacheRect,
+                            m_fftWidth,
+                            info, dataRect, buffers.channels,
+                            m_cacheSourceSpectra ? &sourceData : 0);
+
+        KisConvolutionWorkerFFTSpectraCache::Key cacheKey;
+        KisConvolutionWorkerFFTSpectraCache::EntrySP cachedEntry;
+        QSharedPointer<KisConvolutionWorkerFFTSpectraCache::Entry> newEntry;
+
+        if (m_cacheSourceSpectra) {
+            cacheKey = m_spectraCacheKeyBase;
+            cacheKey.cacheRect = cacheRect;
+            cacheKey.dataRect = dataRect;
+
+            cachedEntry = KisConvolutionWorkerFFTSpectraCache::find(cacheKey, sourceData);
+
+            if (!cachedEntry) {
+                newEntry.reset(new KisConvolutionWorkerFFTSpectraCache::Entry());
+                newEntry->sourceData = sourceData;
+                newEntry->spectra.resize(buffers.channels.size());
+            }
+        }
+
+        int channelIndex = 0;
+        for (auto k = buffers.channels.begin(); k != buffers.channels.end(); ++k, ++channelIndex)
+        {
+            if (cachedEntry) {
+                const fftw_complex *spectrum =
+                    reinterpret_cast<const fftw_complex*>(cachedEntry->spectra[channelIndex].constData());
+
+                fftMultiply(spectrum, m_kernelFFT, buffers.spectrum);
+            } else {
+                fftw_execute_dft_r2c(m_plans.forward, *k, buffers.spectrum);
+
+                if (newEntry) {
+                    QVector<double> &spectrum = newEntry->spectra[channelIndex];
+                    spectrum.resize(2 * m_fftLength);
+                    memcpy(spectrum.data(), buffers.spectrum, sizeof(fftw_complex) * m_fftLength);
+                }
+
+                fftMultiply(buffers.spectrum, m_kernelFFT, buffers.spectrum);
+            }
+
+            fftw_execute_dft_c2r(m_plans.backward, buffers.spectrum, *k);
+        }
+
+        if (newEntry) {
+            KisConvolutionWorkerFFTSpectraCache::insert(cacheKey, newEntry, m_spectraCacheMemoryLimit);
+        }
+
+        writeResultToDevice(dstTileRect,
+                            m_fftWidth, leftMargin, topMargin,
+                            info, dataRect, buffers.channels);
+    }
+
     void fillCacheFromDevice(KisPaintDeviceSP src,
                              const QRect &rect,
                              const int cacheRowStride,
                              const FFTInfo &info,
-                             const QRect &dataRect) {
+                             const QRect &dataRect,
+                             const QVector<double*> &channels,
+                             QByteArray *sourceData) {
 
         typename _IteratorFactory_::HLineConstIterator hitSrc =
             _IteratorFactory_::createHLineConstIterator(src,
@@ -230,19 +585,22 @@ public:
                                                         dataRect);
 
         const int channelCount = info.numChannels();
-        QVector<double*> channelPtr(channelCount);
+        QVector<double*> channelPtr(channels);
         const auto channelPtrBegin = channelPtr.begin();
         const auto channelPtrEnd = channelPtr.end();
 
-        auto iFFt = m_channelFFT.constBegin();
-        for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iFFt) {
-            *i = (double*)*iFFt;
-        }
-
         // prepare cache, reused in all loops
         QVector<double*> cacheRowStart(channelCount);
         const auto cacheRowStartBegin = cacheRowStart.begin();
 
+        const int pixelSize = src->pixelSize();
+        quint8 *sourceDataPtr = 0;
+
+        if (sourceData) {
+            sourceData->resize(rect.width() * rect.height() * pixelSize);
+            sourceDataPtr = reinterpret_cast<quint8*>(sourceData->data());
+        }
+
         for (int y = 0; y < rect.height(); ++y) {
             // cache current channelPtr in cacheRowStart
             memcpy(cacheRowStart.data(), channelPtr.data(), channelCount * sizeof(double*));
@@ -250,6 +608,11 @@ public:
             for (int x = 0; x < rect.width(); ++x) {
                 const quint8 *data = hitSrc->oldRawData();
 
+                if (sourceDataPtr) {
+                    memcpy(sourceDataPtr, data, pixelSize);
+                    sourceDataPtr += pixelSize;
+                }
+
                 // no alpha is a rare case, so just multiply by 1.0 in that case
                 double alphaValue = info.alphaRealPos >= 0 ?
                     info.toDoubleFuncPtr[info.alphaCachePos](data, info.alphaRealPos) : 1.0;
@@ -313,7 +676,8 @@ public:
                              const int halfKernelWidth,
                              const int halfKernelHeight,
                              const FFTInfo &info,
-                             const QRect &dataRect) {
+                             const QRect &dataRect,
+                             const QVector<double*> &channels) {
 
         typename _IteratorFactory_::HLineIterator hitDst =
             _IteratorFactory_::createHLineIterator(this->m_painter->device(),
@@ -327,9 +691,9 @@ public:
         const auto channelPtrBegin = channelPtr.begin();
         const auto channelPtrEnd = channelPtr.end();
 
-        auto iFFt = m_channelFFT.constBegin();
-        for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iFFt) {
-            *i = (double*)*iFFt + initialOffset;
+        auto iChannel = channels.constBegin();
+        for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iChannel) {
+            *i = *iChannel + initialOffset;
         }
 
         // prepare cache, reused in all loops
@@ -400,7 +764,133 @@ public:
     }
 
 private:
-    void fftFillKernelMatrix(const KisConvolutionKernelSP kernel, fftw_complex *m_kernelFFT)
+    /**
+     * The size of the tiles of the paint device. The tiles are aligned
+     * to them, so that different threads never write into the same tile
+     * of the device
+     */
+    static const int tileAlignment = 64;
+
+    /**
+     * The step the kernel sizes are rounded up to when the source
+     * spectra are cached
+     */
+    static const int cachedKernelSizeStep = 32;
+
+    struct TileGeometry {
+        QSize tileSize;
+        int fftWidth;
+        int fftHeight;
+        int numParallelTiles;
+    };
+
+    static int optimalFFTSize(int size)
+    {
+        // FFTW is most efficient when array size is a factor of 2, 3, 5 or 7
+        for (;; size++) {
+            int n = size;
+            while (n % 2 == 0) n /= 2;
+            while (n % 3 == 0) n /= 3;
+            while (n % 5 == 0) n /= 5;
+            while (n % 7 == 0) n /= 7;
+
+            if (n == 1) return size;
+        }
+    }
+
+    static int alignedTileSize(int size)
+    {
+        return qMax(1, size / tileAlignment) * tileAlignment;
+    }
+
+    /**
+     * Chooses the size of the tiles so that the buffers of all the tiles
+     * processed in parallel fit into the memory limit. The tiles are never
+     * smaller than the kernel (otherwise most of the FFT would be wasted
+     * on the overlapping margins), so for huge kernels the number of
+     * parallel tiles is reduced instead.
+     */
+    static TileGeometry calculateTileGeometry(const QSize &kernelSize, const QSize &areaSize, int numChannels)
+    {
+        KisImageConfig cfg(true);
+        const qint64 memoryLimit = qint64(cfg.fftConvolutionMemoryLimit()) * 1024 * 1024;
+        const int idealThreadCount = qMax(1, cfg.maxNumberOfThreads());
+
+        // the channels, the spectrum and the spectrum of the kernel
+        auto memoryPerTile = [numChannels] (int width, int height) {
+            return qint64(sizeof(double)) * width * height * numChannels +
+                2 * qint64(sizeof(fftw_complex)) * height * (width / 2 + 1);
+        };
+
+        const int kernelWidth = kernelSize.width();
+        const int kernelHeight = kernelSize.height();
+
+        const qint64 bytesPerPixel = qint64(sizeof(double)) * (numChannels + 2);
+        const int maxFFTSize = qMax(1, int(std::sqrt(qreal(memoryLimit) / idealThreadCount / bytesPerPixel)));
+
+        TileGeometry geometry;
+
+        // a single tile covering the whole area needs no alignment
+        const int maxTileWidth = areaSize.width();
+        const int maxTileHeight = areaSize.height();
+
+        const int preferredTileWidth =
+            qMax(alignedTileSize(maxFFTSize - kernelWidth + 1), alignedTileSize(kernelWidth));
+        const int preferredTileHeight =
+            qMax(alignedTileSize(maxFFTSize - kernelHeight + 1), alignedTileSize(kernelHeight));
+
+        geometry.tileSize =
+            QSize(qBound(qMin(int(tileAlignment), maxTileWidth), preferredTileWidth, maxTileWidth),
+                  qBound(qMin(int(tileAlignment), maxTileHeight), preferredTileHeight, maxTileHeight));
+
+        geometry.fftWidth = optimalFFTSize(geometry.tileSize.width() + kernelWidth - 1);
+        geometry.fftHeight = optimalFFTSize(geometry.tileSize.height() + kernelHeight - 1);
+
+        geometry.numParallelTiles =
+            qBound(qint64(1),
+                   memoryLimit / memoryPerTile(geometry.fftWidth, geometry.fftHeight),
+                   qint64(idealThreadCount));
+
+        return geometry;
+    }
+
+    /**
+     * Splits \p rc into tiles aligned to the tiles of a device
+     * with offset \p origin
+     */
+    static QVector<QRect> splitIntoTiles(const QRect &rc, const QSize &tileSize, const QPoint &origin)
+    {
+        QVector<QRect> tiles;
+
+        /**
+         * A tile size smaller than the area is always aligned, so
+         * we can align the grid by the alignment of the first tile
+         */
+        auto misalignment = [] (int pos, int origin) {
+            return pos - origin - qFloor(qreal(pos - origin) / tileAlignment) * tileAlignment;
+        };
+
+        const int firstWidth = tileSize.width() < rc.width() ?
+            tileSize.width() - misalignment(rc.left(), origin.x()) : rc.width();
+        const int firstHeight = tileSize.height() < rc.height() ?
+            tileSize.height() - misalignment(rc.top(), origin.y()) : rc.height();
+
+        for (int y = rc.top(); y <= rc.bottom(); ) {
+            const int height = qMin(y == rc.top() ? firstHeight : tileSize.height(), rc.bottom() + 1 - y);
+
+            for (int x = rc.left(); x <= rc.right(); ) {
+                const int width = qMin(x == rc.left() ? firstWidth : tileSize.width(), rc.right() + 1 - x);
+                tiles.append(QRect(x, y, width, height));
+                x += width;
+            }
+
+            y += height;
+        }
+
+        return tiles;
+    }
+
+    void fftFillKernelMatrix(const KisConvolutionKernelSP kernel, double *kernelData)
     {
         // find central item
         QPoint offset((kernel->width() - 1) / 2, (kernel->height() - 1) / 2);
@@ -422,16 +912,21 @@ private:
                 if (absXpos >= m_fftWidth)
                     absXpos -= m_fftWidth;
 
-                ((double*)m_kernelFFT)[(m_fftWidth + m_extraMem) * absYpos + absXpos] = kernel->data()->coeff(y, x);
+                kernelData[m_fftWidth * absYpos + absXpos] = kernel->data()->coeff(y, x);
             }
         }
     }
 
-    void fftMultiply(fftw_complex* channel, fftw_complex* kernel)
+    /**
+     * Multiplies \p channel by \p kernel and writes the result into
+     * \p dst, which may coincide with \p channel
+     */
+    void fftMultiply(const fftw_complex* channel, const fftw_complex* kernel, fftw_complex *dst)
     {
         // perform complex multiplication
-        fftw_complex *channelPtr = channel;
-        fftw_complex *kernelPtr = kernel;
+        const fftw_complex *channelPtr = channel;
+        const fftw_complex *kernelPtr = kernel;
+        fftw_complex *dstPtr = dst;
 
         fftw_complex tmp;
 
@@ -440,71 +935,19 @@ private:
             tmp[0] = ((*channelPtr)[0] * (*kernelPtr)[0]) - ((*channelPtr)[1] * (*kernelPtr)[1]);
             tmp[1] = ((*channelPtr)[0] * (*kernelPtr)[1]) + ((*channelPtr)[1] * (*kernelPtr)[0]);
 
-            (*channelPtr)[0] = tmp[0];
-            (*channelPtr)[1] = tmp[1];
+            (*dstPtr)[0] = tmp[0];
+            (*dstPtr)[1] = tmp[1];
 
             ++channelPtr;
             ++kernelPtr;
+            ++dstPtr;
         }
     }
 
-    void optimumDimensions(quint32& w, quint32& h)
+    void setProgress(int value)
     {
-        // FFTW is most efficient when array size is a factor of 2, 3, 5 or 7
-        quint32 optW = w, optH = h;
-
-        while ((optW % 2 != 0) || (optW % 3 != 0) || (optW % 5 != 0) || (optW % 7 != 0))
-            ++optW;
-
-        while ((optH % 2 != 0) || (optH % 3 != 0) || (optH % 5 != 0) || (optH % 7 != 0))
-            ++optH;
-
-        quint32 optAreaW = optW * h;
-        quint32 optAreaH = optH * w;
-
-        if (optAreaW < optAreaH) {
-            w = optW;
-        }
-        else {
-            h = optH;
-        }
-    }
-
-    void fftLogMatrix(double* channel, const QString &f)
-    {
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        QString filename(QDir::homePath() + "/log_" + f + ".txt");
-        dbgKrita << "Log File Name: " << filename;
-        QFile file (filename);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
-        {
-            dbgKrita << "Failed";
-            KisConvolutionWorkerFFTLock::fftwMutex.unlock();
-            return;
-        }
-
-        QTextStream in(&file);
-        for (quint32 y = 0; y < m_fftHeight; y++)
-        {
-            for (quint32 x = 0; x < m_fftWidth; x++)
-            {
-                QString num = QString::number(channel[y * m_fftWidth + x]);
-                while (num.length() < 15)
-                    num += " ";
-
-                in << num << " ";
-            }
-            in << "\n";
-        }
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
-    }
-
-    void addToProgress(float amount)
-    {
-        m_currentProgress += amount;
-
         if (this->m_progress) {
-            this->m_progress->setProgress((int)m_currentProgress);
+            this->m_progress->setProgress(value);
         }
     }
 
@@ -523,19 +966,19 @@ private:
         // free kernel fft data
         if (m_kernelFFT) {
             fftw_free(m_kernelFFT);
+            m_kernelFFT = 0;
         }
-
-        Q_FOREACH (fftw_complex *channel, m_channelFFT) {
-            fftw_free(channel);
-        }
-        m_channelFFT.clear();
     }
 private:
-    quint32 m_fftWidth, m_fftHeight, m_fftLength, m_extraMem;
-    float m_currentProgress;
+    quint32 m_fftWidth, m_fftHeight, m_fftLength;
+    KisConvolutionWorkerFFTPlans::Plans m_plans;
 
     fftw_complex* m_kernelFFT;
-    QVector<fftw_complex*> m_channelFFT;
+
+    bool m_cacheSourceSpectra;
+    QSize m_layoutKernelSize;
+    qint64 m_spectraCacheMemoryLimit = 0;
+    KisConvolutionWorkerFFTSpectraCache::Key m_spectraCacheKeyBase;
 };
 
 #endif
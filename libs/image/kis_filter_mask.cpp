@@ -26,6 +26,9 @@
 #include "filter/kis_filter.h"
 #include "filter/kis_filter_configuration.h"
 #include "filter/kis_filter_registry.h"
+#include "filter/kis_color_transformation_filter.h"
+#include "filter/kis_color_transformation_configuration.h"
+#include "kis_pixel_selection.h"
 #include "kis_selection.h"
 #include "kis_processing_information.h"
 #include "kis_node.h"
@@ -34,6 +37,7 @@
 #include "kis_busy_progress_indicator.h"
 #include "kis_transaction.h"
 #include "kis_painter.h"
+#include "KisFilterTileCache.h"
 
 KisFilterMask::KisFilterMask(const QString &name)
     : KisEffectMask(name),
@@ -67,8 +71,6 @@ QRect KisFilterMask::decorateRect(KisPaintDeviceSP &src,
                                   const QRect & rc,
                                   PositionToFilthy maskPos) const
 {
-    Q_UNUSED(maskPos);
-
     KisFilterConfigurationSP filterConfig = filter();
 
     KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(nodeProgressProxy(), rc);
@@ -94,12 +96,55 @@ QRect KisFilterMask::decorateRect(KisPaintDeviceSP &src,
     KIS_ASSERT_RECOVER_NOOP(this->busyProgressIndicator());
     this->busyProgressIndicator()->update();
 
-    filter->process(src, dst, 0, rc, filterConfig.data(), 0);
+    /**
+     * The mask is above the filthy node when the layer itself or one
+     * of the masks below has changed, so its source is different
+     */
+    filterTileCache()->process(filter, filterConfig, src, dst, rc,
+                               maskPos == N_ABOVE_FILTHY);
 
     QRect r = filter->changedRect(rc, filterConfig.data(), dst->defaultBounds()->currentLevelOfDetail());
     return r;
 }
 
+const KoColorTransformation* KisFilterMask::perPixelTransformation(const KoColorSpace *cs, const QRect &rect,
+                                                                   KisFilterConfigurationSP *configuration) const
+{
+    KisFilterConfigurationSP filterConfig = filter();
+    if (!filterConfig) return 0;
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value(filterConfig->name());
+    const KisColorTransformationFilter *colorTransformationFilter =
+        dynamic_cast<const KisColorTransformationFilter*>(filter.data());
+
+    const KisColorTransformationConfiguration *colorTransformationConfig =
+        dynamic_cast<const KisColorTransformationConfiguration*>(filterConfig.data());
+
+    if (!colorTransformationFilter || !colorTransformationConfig) return 0;
+
+    if (KisSelectionSP selection = this->selection()) {
+        // the temporary target may be being merged into the selection atm
+        KisIndirectPaintingSupport::ReadLocker l(this);
+
+        if (hasTemporaryTarget() || selection->hasShapeSelection()) return 0;
+
+        /**
+         * The selection covers the rect completely only when its
+         * default pixel is fully selected and there are no painted
+         * tiles inside the rect
+         */
+        KisPixelSelectionSP pixelSelection = selection->pixelSelection();
+        if (*pixelSelection->defaultPixel().data() != MAX_SELECTED ||
+            pixelSelection->extent().intersects(rect)) {
+
+            return 0;
+        }
+    }
+
+    *configuration = filterConfig;
+    return colorTransformationConfig->colorTransformation(cs, colorTransformationFilter);
+}
+
 bool KisFilterMask::accept(KisNodeVisitor &v)
 {
     return v.visit(this);
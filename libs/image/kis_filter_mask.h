@@ -24,6 +24,8 @@
 #include "kis_node_filter_interface.h"
 
 class KisFilterConfiguration;
+class KoColorSpace;
+class KoColorTransformation;
 
 /**
    An filter mask is a single channel mask that applies a particular
@@ -65,6 +67,24 @@ public:
 
     QRect changeRect(const QRect &rect, PositionToFilthy pos = N_FILTHY) const override;
     QRect needRect(const QRect &rect, PositionToFilthy pos = N_FILTHY) const override;
+
+    /**
+     * Returns a per-pixel color transformation that has the same effect
+     * on \p rect of a device with color space \p cs as applying the
+     * mask itself. It lets the parent layer apply a chain of such masks
+     * in a single pass over the pixels.
+     *
+     * Returns null if the filter of the mask is not a color
+     * transformation filter with a cached configuration or if the
+     * selection of the mask is not fully opaque inside \p rect.
+     *
+     * The transformation is the one cached for the current thread by
+     * the filter configuration, which is returned in \p configuration.
+     * The caller should keep \p configuration alive while using the
+     * transformation and must not delete it.
+     */
+    const KoColorTransformation* perPixelTransformation(const KoColorSpace *cs, const QRect &rect,
+                                                        KisFilterConfigurationSP *configuration) const;
 };
 
 #endif //_KIS_FILTER_MASK_
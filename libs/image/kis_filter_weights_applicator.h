@@ -262,25 +262,23 @@ public:
             memcpy(bufPtr, borderPixel, pixelSize);
         }
 
-        const quint8 **colors = new const quint8* [buffer->maxSpan()];
-
         T dstIt = tmp::createIterator<T>(m_dst, dstStart, line, dstEnd - dstStart);
         for (int i = dstStart; i < dstEnd; i++) {
             BlendSpan span = calculateBlendSpan(i, line, buffer);
 
             int bufIndexStart = span.firstBlendPixel - leftSrcBorder;
-            int bufIndexEnd = bufIndexStart + span.weights->span;
-
-            const quint8 **colorsPtr = colors;
-            for (int j = bufIndexStart; j < bufIndexEnd; j++) {
-                *(colorsPtr++) = srcLineBuf + j * pixelSize;
-            }
 
-            mixOp->mixColors(colors, span.weights->weight, span.weights->span, dstIt->rawData());
+            /**
+             * The source pixels of a span lie in the line buffer one
+             * after another, so they are passed to the mixing op as a
+             * plain array, which lets it walk them with a constant
+             * stride instead of dereferencing a pointer per pixel
+             */
+            mixOp->mixColors(srcLineBuf + bufIndexStart * pixelSize,
+                             span.weights->weight, span.weights->span, dstIt->rawData());
             dstIt->nextPixel();
         }
 
-        delete[] colors;
         delete[] srcLineBuf;
 
         return LinePos(dstStart, qMax(0, dstEnd - dstStart));
@@ -121,8 +121,16 @@ void KisGaussianKernel::applyGaussian(KisPaintDeviceSP device,
 {
     QPoint srcTopLeft = rect.topLeft();
 
+    KisConvolutionPainter boxPainter(device);
 
-    if (KisConvolutionPainter::supportsFFTW()) {
+    if (boxPainter.useBoxGaussian(xRadius, yRadius)) {
+        boxPainter.setChannelFlags(channelFlags);
+        boxPainter.setProgress(progressUpdater);
+
+        // the box blur caches the source data, so no transaction is needed
+        boxPainter.applyGaussian(device, srcTopLeft, srcTopLeft, rect.size(), xRadius, yRadius, borderOp);
+
+    } else if (KisConvolutionPainter::supportsFFTW()) {
         KisConvolutionPainter painter(device, KisConvolutionPainter::FFTW);
         painter.setChannelFlags(channelFlags);
         painter.setProgress(progressUpdater);
@@ -19,16 +19,19 @@
 #ifndef __KIS_GRID_INTERPOLATION_TOOLS_H
 #define __KIS_GRID_INTERPOLATION_TOOLS_H
 
+#include <cmath>
 #include <limits>
 #include <algorithm>
 
 #include <QImage>
+#include <QScopedPointer>
 
 #include "kis_algebra_2d.h"
 #include "kis_four_point_interpolator_forward.h"
 #include "kis_four_point_interpolator_backward.h"
 #include "kis_iterator_ng.h"
 #include "kis_random_sub_accessor.h"
+#include "KisMipmapSampler.h"
 
 //#define DEBUG_PAINTING_POLYGONS
 
@@ -179,12 +182,33 @@ struct PaintDevicePolygonOp
     PaintDevicePolygonOp(KisPaintDeviceSP srcDev, KisPaintDeviceSP dstDev)
         : m_srcDev(srcDev), m_dstDev(dstDev) {}
 
+    /**
+     * When \p sampler is set, every cell is sampled from the level of
+     * detail matching the ratio of the areas of its source and
+     * destination polygons, so that the minified cells are not aliased
+     */
+    PaintDevicePolygonOp(KisPaintDeviceSP srcDev, KisPaintDeviceSP dstDev,
+                         const KisMipmapSampler *sampler)
+        : m_srcDev(srcDev), m_dstDev(dstDev),
+          m_mipmapAccessor(new KisMipmapSampler::Accessor(sampler)) {}
+
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon) {
         this->operator() (srcPolygon, dstPolygon, dstPolygon);
     }
 
+    /**
+     * Limits the written pixels to \p rect, so that several ops could
+     * process the same grid in parallel, each in its own area
+     */
+    void setClipRect(const QRect &rect) {
+        m_clipRect = rect;
+    }
+
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
         QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        if (m_clipRect.isValid()) {
+            boundRect &= m_clipRect;
+        }
         if (boundRect.isEmpty()) return;
 
         KisSequentialIterator dstIt(m_dstDev, boundRect);
@@ -192,6 +216,15 @@ struct PaintDevicePolygonOp
 
         KisFourPointInterpolatorBackward interp(srcPolygon, dstPolygon);
 
+        qreal lod = 0.0;
+
+        if (m_mipmapAccessor) {
+            const qreal dstArea = polygonArea(dstPolygon);
+            lod = dstArea > 0.0 ?
+                KisMipmapSampler::lodForFootprint(std::sqrt(polygonArea(srcPolygon) / dstArea)) :
+                0.0;
+        }
+
         int y = boundRect.top();
         interp.setY(y);
 
@@ -217,16 +250,32 @@ struct PaintDevicePolygonOp
                 // (which is non-transformed) and write it into
                 // "srcPoint" (which is transformed position)
 
-                srcAcc->moveTo(dstPoint);
-                srcAcc->sampledOldRawData(dstIt.rawData());
+                if (lod > 0.0) {
+                    m_mipmapAccessor->sample(dstPoint, lod, dstIt.rawData());
+                } else {
+                    srcAcc->moveTo(dstPoint);
+                    srcAcc->sampledOldRawData(dstIt.rawData());
+                }
             }
 
         }
 
     }
 
+    static qreal polygonArea(const QPolygonF &polygon) {
+        qreal area = 0.0;
+
+        for (int i = 0; i < polygon.size(); i++) {
+            area += KisAlgebra2D::crossProduct(polygon[i], polygon[(i + 1) % polygon.size()]);
+        }
+
+        return 0.5 * qAbs(area);
+    }
+
     KisPaintDeviceSP m_srcDev;
     KisPaintDeviceSP m_dstDev;
+    QScopedPointer<KisMipmapSampler::Accessor> m_mipmapAccessor;
+    QRect m_clipRect;
 };
 
 struct QImagePolygonOp
@@ -246,8 +295,19 @@ struct QImagePolygonOp
         this->operator() (srcPolygon, dstPolygon, dstPolygon);
     }
 
+    /**
+     * Limits the written pixels to \p rect (in the coordinates of the
+     * polygons, not of the destination image)
+     */
+    void setClipRect(const QRect &rect) {
+        m_clipRect = rect;
+    }
+
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
         QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        if (m_clipRect.isValid()) {
+            boundRect &= m_clipRect;
+        }
         KisFourPointInterpolatorBackward interp(srcPolygon, dstPolygon);
 
         for (int y = boundRect.top(); y <= boundRect.bottom(); y++) {
@@ -299,6 +359,7 @@ struct QImagePolygonOp
 
     QRect m_srcImageRect;
     QRect m_dstImageRect;
+    QRect m_clipRect;
 };
 
 /*************************************************************/
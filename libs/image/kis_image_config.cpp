@@ -398,6 +398,17 @@ void KisImageConfig::setLazyFrameCreationEnabled(bool value)
 #include <sys/sysctl.h>
 #endif
 
+int KisImageConfig::fftConvolutionMemoryLimit(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("fftConvolutionMemoryLimit", 256) : 256; // in MiB
+}
+
+void KisImageConfig::setFftConvolutionMemoryLimit(int value)
+{
+    m_config.writeEntry("fftConvolutionMemoryLimit", value);
+}
+
 int KisImageConfig::totalRAM()
 {
     // let's think that default memory size is 1000MiB
@@ -541,6 +552,36 @@ void KisImageConfig::setMaxNumberOfThreads(int value)
     }
 }
 
+bool KisImageConfig::tiledParticleRendering(bool defaultValue) const
+{
+    return defaultValue ? true : m_config.readEntry("tiledParticleRendering", true);
+}
+
+void KisImageConfig::setTiledParticleRendering(bool value)
+{
+    m_config.writeEntry("tiledParticleRendering", value);
+}
+
+bool KisImageConfig::asynchronousFilterDabs(bool defaultValue) const
+{
+    return defaultValue ? true : m_config.readEntry("asynchronousFilterDabs", true);
+}
+
+void KisImageConfig::setAsynchronousFilterDabs(bool value)
+{
+    m_config.writeEntry("asynchronousFilterDabs", value);
+}
+
+bool KisImageConfig::boxGaussianBlur(bool defaultValue) const
+{
+    return defaultValue ? false : m_config.readEntry("boxGaussianBlur", false);
+}
+
+void KisImageConfig::setBoxGaussianBlur(bool value)
+{
+    m_config.writeEntry("boxGaussianBlur", value);
+}
+
 int KisImageConfig::frameRenderingClones(bool defaultValue) const
 {
     const int defaultClonesCount = qMax(1, maxNumberOfThreads(defaultValue) / 2);
@@ -71,6 +71,13 @@ public:
 
     static int totalRAM(); // MiB
 
+    /**
+     * The maximum amount of memory the FFT convolution may use
+     * for its buffers, in MiB
+     */
+    int fftConvolutionMemoryLimit(bool requestDefault = false) const;
+    void setFftConvolutionMemoryLimit(int value);
+
     /**
      * @return a specific directory for the swapfile, if set. If not set, return an
      * empty QString and use the default KDE directory.
@@ -114,6 +121,15 @@ public:
     int maxNumberOfThreads(bool defaultValue = false) const;
     void setMaxNumberOfThreads(int value);
 
+    bool tiledParticleRendering(bool defaultValue = false) const;
+    void setTiledParticleRendering(bool value);
+
+    bool asynchronousFilterDabs(bool defaultValue = false) const;
+    void setAsynchronousFilterDabs(bool value);
+
+    bool boxGaussianBlur(bool defaultValue = false) const;
+    void setBoxGaussianBlur(bool value);
+
     int frameRenderingClones(bool defaultValue = false) const;
     void setFrameRenderingClones(int value);
 
@@ -36,6 +36,7 @@
 #include <KoProperties.h>
 #include <KoCompositeOpRegistry.h>
 #include <KoColorSpace.h>
+#include <KoColorTransformation.h>
 
 #include "kis_debug.h"
 #include "kis_image.h"
@@ -43,6 +44,7 @@
 #include "kis_painter.h"
 #include "kis_mask.h"
 #include "kis_effect_mask.h"
+#include "kis_filter_mask.h"
 #include "kis_selection_mask.h"
 #include "kis_meta_data_store.h"
 #include "kis_selection.h"
@@ -58,6 +60,8 @@
 #include "krita_utils.h"
 #include "kis_layer_properties_icons.h"
 #include "kis_layer_utils.h"
+#include "kis_sequential_iterator.h"
+#include "kis_busy_progress_indicator.h"
 #include "kis_projection_leaf.h"
 #include "KisSafeNodeProjectionStore.h"
 
@@ -640,6 +644,38 @@ KisNode::PositionToFilthy calculatePositionToFilthy(KisNodeSP nodeInQuestion,
     return KisNode::N_BELOW_FILTHY;
 }
 
+/**
+ * Applies the per-pixel transformations collected from a chain of
+ * filter masks to \p rect of \p device in a single pass, so that
+ * every chunk of pixels is processed by the whole chain while it is
+ * still in the cache. The transformations are consumed.
+ */
+static void applyFusedTransformations(KisPaintDeviceSP device,
+                                      const QRect &rect,
+                                      QVector<const KoColorTransformation*> &transformations)
+{
+    if (transformations.isEmpty()) return;
+
+    /**
+     * The transformations are owned by the configurations of the masks,
+     * so they are applied in place one by one, the same way as
+     * KoCompositeColorTransformation does
+     */
+    KisSequentialIterator it(device, rect);
+
+    int conseq = it.nConseqPixels();
+    while (it.nextPixels(conseq)) {
+        conseq = it.nConseqPixels();
+
+        transformations.first()->transform(it.oldRawData(), it.rawData(), conseq);
+        for (int i = 1; i < transformations.size(); i++) {
+            transformations[i]->transform(it.rawData(), it.rawData(), conseq);
+        }
+    }
+
+    transformations.clear();
+}
+
 QRect KisLayer::applyMasks(const KisPaintDeviceSP source,
                            KisPaintDeviceSP destination,
                            const QRect &requestedRect,
@@ -688,14 +724,47 @@ QRect KisLayer::applyMasks(const KisPaintDeviceSP source,
                 copyOriginalToProjection(source, destination, needRect);
             }
 
+            /**
+             * Consecutive filter masks that are pure per-pixel color
+             * transformations are fused and applied in a single pass
+             * instead of copying the projection back and forth for
+             * every mask
+             */
+            QVector<const KoColorTransformation*> fusedTransformations;
+            QVector<KisFilterConfigurationSP> fusedConfigurations;
+            QRect fusedRect;
+
             Q_FOREACH (const KisEffectMaskSP& mask, masks) {
                 const QRect maskApplyRect = applyRects.pop();
                 const QRect maskNeedRect =
                     applyRects.isEmpty() ? needRect : applyRects.top();
 
+                if (!fusedTransformations.isEmpty() && maskApplyRect != fusedRect) {
+                    applyFusedTransformations(destination, fusedRect, fusedTransformations);
+                }
+
+                const KisFilterMask *filterMask = dynamic_cast<const KisFilterMask*>(mask.data());
+                KisFilterConfigurationSP filterConfig;
+                const KoColorTransformation *transformation = filterMask ?
+                    filterMask->perPixelTransformation(destination->colorSpace(), maskApplyRect, &filterConfig) : 0;
+
+                if (transformation) {
+                    if (KisBusyProgressIndicator *indicator = mask->busyProgressIndicator()) {
+                        indicator->update();
+                    }
+
+                    fusedTransformations.append(transformation);
+                    fusedConfigurations.append(filterConfig);
+                    fusedRect = maskApplyRect;
+                    continue;
+                }
+
+                applyFusedTransformations(destination, fusedRect, fusedTransformations);
+
                 PositionToFilthy maskPosition = calculatePositionToFilthy(mask, filthyNode, const_cast<KisLayer*>(this));
                 mask->apply(destination, maskApplyRect, maskNeedRect, maskPosition);
             }
+            applyFusedTransformations(destination, fusedRect, fusedTransformations);
             Q_ASSERT(applyRects.isEmpty());
         } else {
             /**
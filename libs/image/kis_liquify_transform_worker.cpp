@@ -18,10 +18,31 @@
 
 #include "kis_liquify_transform_worker.h"
 
+#include <algorithm>
+
+#include <QMap>
+#include <QPainter>
+#include <QPair>
+#include <QSet>
+
+#include "KisThreadLimitedMap.h"
 #include "kis_grid_interpolation_tools.h"
 #include "kis_dom_utils.h"
 #include "krita_utils.h"
 
+/**
+ * The grid is split into square blocks of LIQUIFY_BLOCK_SIZE x
+ * LIQUIFY_BLOCK_SIZE points. With the default precision of 8 pixels a
+ * block covers a single 64x64 tile of the source.
+ */
+#define LIQUIFY_BLOCK_SIZE 8
+
+/**
+ * The size of the destination patches rendered in parallel, equal to
+ * the size of a tile, so that no two jobs write into the same tile
+ */
+#define LIQUIFY_PATCH_SIZE 64
+
 
 struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
 {
@@ -30,7 +51,8 @@ struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
             int _pixelPrecision)
         : srcBounds(_srcBounds),
           progress(_progress),
-          pixelPrecision(_pixelPrecision)
+          pixelPrecision(_pixelPrecision),
+          allPointsChanged(true)
     {
     }
 
@@ -43,8 +65,40 @@ struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
     int pixelPrecision;
     QSize gridSize;
 
+    /**
+     * The bounds of the transformed points of every block, with a
+     * margin of one pixel. A block includes the last row and column
+     * of its cells, so the bounds cover all the cells of the block.
+     */
+    QSize blocksSize;
+    QVector<QRectF> blockBounds;
+
+    /**
+     * The area covered by the cells whose points were changed since
+     * the last call to takeChangedRect()
+     */
+    QRectF changedRect;
+    bool allPointsChanged;
+
     void preparePoints();
 
+    void prepareBlocks();
+    void updateBlockBounds(int blockIndex);
+    QRect blockCells(int blockIndex) const;
+
+    template <class PointOp>
+    void processPointsInRect(const QRectF &clipRect, PointOp op);
+
+    template <class PolygonOp, class MapOp>
+    void processCellsInRect(PolygonOp &polygonOp,
+                            const QVector<int> &blocks,
+                            const QRect &rect,
+                            MapOp mapOp);
+
+    void renderDevice(KisPaintDeviceSP srcDev,
+                      KisPaintDeviceSP dstDev,
+                      const QRect &dstRect);
+
     struct MapIndexesOp;
 
     template <class ProcessOp>
@@ -80,6 +134,7 @@ KisLiquifyTransformWorker::KisLiquifyTransformWorker(const QRect &srcBounds,
 KisLiquifyTransformWorker::KisLiquifyTransformWorker(const KisLiquifyTransformWorker &rhs)
     : m_d(new Private(*rhs.m_d.data()))
 {
+    m_d->allPointsChanged = true;
 }
 
 KisLiquifyTransformWorker::~KisLiquifyTransformWorker()
@@ -123,9 +178,28 @@ const QVector<QPointF>& KisLiquifyTransformWorker::originalPoints() const
 
 QVector<QPointF>& KisLiquifyTransformWorker::transformedPoints()
 {
+    /**
+     * We cannot track the changes made through the returned
+     * reference, so the blocks are recalculated on the next access
+     */
+    m_d->blockBounds.clear();
+    m_d->allPointsChanged = true;
+
     return m_d->transformedPoints;
 }
 
+bool KisLiquifyTransformWorker::takeChangedRect(QRect *rect)
+{
+    const bool result = !m_d->allPointsChanged;
+
+    *rect = result ? m_d->changedRect.toAlignedRect() : QRect();
+
+    m_d->changedRect = QRectF();
+    m_d->allPointsChanged = false;
+
+    return result;
+}
+
 struct AllPointsFetcherOp
 {
     AllPointsFetcherOp(QRectF srcRect) : m_srcRect(srcRect) {}
@@ -164,6 +238,99 @@ void KisLiquifyTransformWorker::Private::preparePoints()
 
     originalPoints = pointsOp.m_points;
     transformedPoints = pointsOp.m_points;
+
+    prepareBlocks();
+}
+
+void KisLiquifyTransformWorker::Private::prepareBlocks()
+{
+    blocksSize = QSize((gridSize.width() + LIQUIFY_BLOCK_SIZE - 1) / LIQUIFY_BLOCK_SIZE,
+                       (gridSize.height() + LIQUIFY_BLOCK_SIZE - 1) / LIQUIFY_BLOCK_SIZE);
+
+    blockBounds.resize(blocksSize.width() * blocksSize.height());
+
+    for (int i = 0; i < blockBounds.size(); i++) {
+        updateBlockBounds(i);
+    }
+}
+
+QRect KisLiquifyTransformWorker::Private::blockCells(int blockIndex) const
+{
+    const int firstCol = (blockIndex % blocksSize.width()) * LIQUIFY_BLOCK_SIZE;
+    const int firstRow = (blockIndex / blocksSize.width()) * LIQUIFY_BLOCK_SIZE;
+
+    return QRect(firstCol, firstRow,
+                 qMin(LIQUIFY_BLOCK_SIZE, gridSize.width() - 1 - firstCol),
+                 qMin(LIQUIFY_BLOCK_SIZE, gridSize.height() - 1 - firstRow));
+}
+
+void KisLiquifyTransformWorker::Private::updateBlockBounds(int blockIndex)
+{
+    const QRect cells = blockCells(blockIndex);
+
+    QRectF bounds;
+
+    // the cells of the block share the points of the next row and column
+    for (int row = cells.top(); row <= cells.bottom() + 1; row++) {
+        for (int col = cells.left(); col <= cells.right() + 1; col++) {
+            KisAlgebra2D::accumulateBounds(transformedPoints[col + row * gridSize.width()], &bounds);
+        }
+    }
+
+    blockBounds[blockIndex] = bounds.adjusted(-1.0, -1.0, 1.0, 1.0);
+}
+
+template <class PointOp>
+void KisLiquifyTransformWorker::Private::processPointsInRect(const QRectF &clipRect, PointOp op)
+{
+    if (blockBounds.isEmpty()) {
+        prepareBlocks();
+    }
+
+    QSet<int> changedBlocks;
+
+    for (int i = 0; i < blockBounds.size(); i++) {
+        if (!blockBounds[i].intersects(clipRect)) continue;
+
+        const int blockCol = i % blocksSize.width();
+        const int blockRow = i / blocksSize.width();
+
+        const int firstCol = blockCol * LIQUIFY_BLOCK_SIZE;
+        const int firstRow = blockRow * LIQUIFY_BLOCK_SIZE;
+        const int lastCol = qMin(firstCol + LIQUIFY_BLOCK_SIZE, gridSize.width()) - 1;
+        const int lastRow = qMin(firstRow + LIQUIFY_BLOCK_SIZE, gridSize.height()) - 1;
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                const int index = col + row * gridSize.width();
+
+                QPointF &pt = transformedPoints[index];
+                const QPointF oldPt = pt;
+
+                op(pt, originalPoints[index]);
+
+                if (pt == oldPt) continue;
+
+                /**
+                 * The points of the first row and column of the block
+                 * also belong to the cells of the neighbouring blocks
+                 */
+                const bool sharesCol = col == firstCol && blockCol > 0;
+                const bool sharesRow = row == firstRow && blockRow > 0;
+
+                changedBlocks.insert(i);
+                if (sharesCol) changedBlocks.insert(i - 1);
+                if (sharesRow) changedBlocks.insert(i - blocksSize.width());
+                if (sharesCol && sharesRow) changedBlocks.insert(i - blocksSize.width() - 1);
+            }
+        }
+    }
+
+    Q_FOREACH (int block, changedBlocks) {
+        changedRect |= blockBounds[block];
+        updateBlockBounds(block);
+        changedRect |= blockBounds[block];
+    }
 }
 
 void KisLiquifyTransformWorker::translate(const QPointF &offset)
@@ -179,6 +346,12 @@ void KisLiquifyTransformWorker::translate(const QPointF &offset)
         *it += offset;
         *refIt += offset;
     }
+
+    for (auto boundsIt = m_d->blockBounds.begin(); boundsIt != m_d->blockBounds.end(); ++boundsIt) {
+        boundsIt->translate(offset);
+    }
+
+    m_d->allPointsChanged = true;
 }
 
 void KisLiquifyTransformWorker::undoPoints(const QPointF &base,
@@ -190,24 +363,21 @@ void KisLiquifyTransformWorker::undoPoints(const QPointF &base,
     QRectF clipRect(base.x() - maxDist, base.y() - maxDist,
                     2 * maxDist, 2 * maxDist);
 
-    QVector<QPointF>::iterator it = m_d->transformedPoints.begin();
-    QVector<QPointF>::iterator end = m_d->transformedPoints.end();
-
-    QVector<QPointF>::iterator refIt = m_d->originalPoints.begin();
     KIS_ASSERT_RECOVER_RETURN(m_d->originalPoints.size() ==
                               m_d->transformedPoints.size());
 
-    for (; it != end; ++it, ++refIt) {
-        if (!clipRect.contains(*it)) continue;
+    m_d->processPointsInRect(clipRect,
+        [&] (QPointF &pt, const QPointF &refPt) {
+            if (!clipRect.contains(pt)) return;
 
-        QPointF diff = *it - base;
-        qreal dist = KisAlgebra2D::norm(diff);
-        if (dist > maxDist) continue;
+            QPointF diff = pt - base;
+            qreal dist = KisAlgebra2D::norm(diff);
+            if (dist > maxDist) return;
 
-        qreal lambda = exp(-0.5 * pow2(dist / sigma));
-        lambda *= amount;
-        *it = *refIt * lambda + *it * (1.0 - lambda);
-    }
+            qreal lambda = exp(-0.5 * pow2(dist / sigma));
+            lambda *= amount;
+            pt = refPt * lambda + pt * (1.0 - lambda);
+        });
 }
 
 template <class ProcessOp>
@@ -220,19 +390,19 @@ processTransformedPixelsBuildUp(ProcessOp op,
     QRectF clipRect(base.x() - maxDist, base.y() - maxDist,
                     2 * maxDist, 2 * maxDist);
 
-    QVector<QPointF>::iterator it = transformedPoints.begin();
-    QVector<QPointF>::iterator end = transformedPoints.end();
+    processPointsInRect(clipRect,
+        [&] (QPointF &pt, const QPointF &refPt) {
+            Q_UNUSED(refPt);
 
-    for (; it != end; ++it) {
-        if (!clipRect.contains(*it)) continue;
+            if (!clipRect.contains(pt)) return;
 
-        QPointF diff = *it - base;
-        qreal dist = KisAlgebra2D::norm(diff);
-        if (dist > maxDist) continue;
+            QPointF diff = pt - base;
+            qreal dist = KisAlgebra2D::norm(diff);
+            if (dist > maxDist) return;
 
-        const qreal lambda = exp(-0.5 * pow2(dist / sigma));
-        *it = op(*it, base, diff, lambda);
-    }
+            const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+            pt = op(pt, base, diff, lambda);
+        });
 }
 
 template <class ProcessOp>
@@ -246,27 +416,24 @@ processTransformedPixelsWash(ProcessOp op,
     QRectF clipRect(base.x() - maxDist, base.y() - maxDist,
                     2 * maxDist, 2 * maxDist);
 
-    QVector<QPointF>::iterator it = transformedPoints.begin();
-    QVector<QPointF>::iterator end = transformedPoints.end();
-
-    QVector<QPointF>::iterator refIt = originalPoints.begin();
     KIS_ASSERT_RECOVER_RETURN(originalPoints.size() ==
                               transformedPoints.size());
 
-    for (; it != end; ++it, ++refIt) {
-        if (!clipRect.contains(*it)) continue;
+    processPointsInRect(clipRect,
+        [&] (QPointF &pt, const QPointF &refPt) {
+            if (!clipRect.contains(pt)) return;
 
-        QPointF diff = *refIt - base;
-        qreal dist = KisAlgebra2D::norm(diff);
-        if (dist > maxDist) continue;
+            QPointF diff = refPt - base;
+            qreal dist = KisAlgebra2D::norm(diff);
+            if (dist > maxDist) return;
 
-        const qreal lambda = exp(-0.5 * pow2(dist / sigma));
-        QPointF dstPt = op(*refIt, base, diff, lambda);
+            const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+            QPointF dstPt = op(refPt, base, diff, lambda);
 
-        if (kisDistance(dstPt, *refIt) > kisDistance(*it, *refIt)) {
-            *it = (1.0 - flow) * (*it) + flow * dstPt;
-        }
-    }
+            if (kisDistance(dstPt, refPt) > kisDistance(pt, refPt)) {
+                pt = (1.0 - flow) * pt + flow * dstPt;
+            }
+        });
 }
 
 template <class ProcessOp>
@@ -424,40 +591,153 @@ struct KisLiquifyTransformWorker::Private::MapIndexesOp {
 };
 
 
+/**
+ * Processes the cells of \p blocks whose destination polygons touch
+ * \p rect, clipping them to \p rect. The cells are processed in the
+ * same order iterateThroughGrid() processes them, so the overlapping
+ * cells overwrite each other in the same way.
+ */
+template <class PolygonOp, class MapOp>
+void KisLiquifyTransformWorker::Private::processCellsInRect(PolygonOp &polygonOp,
+                                                            const QVector<int> &blocks,
+                                                            const QRect &rect,
+                                                            MapOp mapOp)
+{
+    using namespace GridIterationTools;
+
+    QVector<QPolygonF> srcPolygons;
+    QVector<QPolygonF> dstPolygons;
+    QVector<QPair<int, int>> cells;
+
+    Q_FOREACH (int block, blocks) {
+        const QRect blockRect = blockCells(block);
+
+        for (int row = blockRect.top(); row <= blockRect.bottom(); row++) {
+            for (int col = blockRect.left(); col <= blockRect.right(); col++) {
+                const QVector<int> indexes = calculateCellIndexes(col, row, gridSize);
+
+                QPolygonF srcPolygon;
+                QPolygonF dstPolygon;
+
+                for (int i = 0; i < 4; i++) {
+                    srcPolygon << mapOp(originalPoints[indexes[i]]);
+                    dstPolygon << mapOp(transformedPoints[indexes[i]]);
+                }
+
+                adjustAlignedPolygon(srcPolygon);
+                adjustAlignedPolygon(dstPolygon);
+
+                if (!dstPolygon.boundingRect().toAlignedRect().intersects(rect)) continue;
+
+                cells << qMakePair(pointToIndex(QPoint(col, row), gridSize), srcPolygons.size());
+                srcPolygons << srcPolygon;
+                dstPolygons << dstPolygon;
+            }
+        }
+    }
+
+    std::sort(cells.begin(), cells.end());
+
+    polygonOp.setClipRect(rect);
+
+    for (auto it = cells.constBegin(); it != cells.constEnd(); ++it) {
+        polygonOp(srcPolygons[it->second], dstPolygons[it->second]);
+    }
+}
+
+void KisLiquifyTransformWorker::Private::renderDevice(KisPaintDeviceSP srcDev,
+                                                      KisPaintDeviceSP dstDev,
+                                                      const QRect &dstRect)
+{
+    using KisAlgebra2D::divideFloor;
+
+    if (blockBounds.isEmpty()) {
+        prepareBlocks();
+    }
+
+    /**
+     * Every patch of the destination is rendered by its own job from
+     * the blocks that touch it. The grid cells may overlap, so the
+     * patches are aligned to the tiles of the destination device (they
+     * start at its offset), not to make two jobs race for a tile.
+     */
+    typedef QPair<int, int> PatchKey;
+    QMap<PatchKey, QVector<int>> patchBlocks;
+
+    const QPoint tileGridOrigin(dstDev->x(), dstDev->y());
+
+    for (int i = 0; i < blockBounds.size(); i++) {
+        const QRect rc = (blockBounds[i].toAlignedRect() & dstRect).translated(-tileGridOrigin);
+        if (rc.isEmpty()) continue;
+
+        for (int row = divideFloor(rc.top(), LIQUIFY_PATCH_SIZE);
+             row <= divideFloor(rc.bottom(), LIQUIFY_PATCH_SIZE); row++) {
+
+            for (int col = divideFloor(rc.left(), LIQUIFY_PATCH_SIZE);
+                 col <= divideFloor(rc.right(), LIQUIFY_PATCH_SIZE); col++) {
+
+                patchBlocks[qMakePair(row, col)].append(i);
+            }
+        }
+    }
+
+    struct Job {
+        QRect rect;
+        QVector<int> blocks;
+    };
+
+    QVector<Job> jobs;
+
+    for (auto it = patchBlocks.constBegin(); it != patchBlocks.constEnd(); ++it) {
+        const QRect patchRect(it.key().second * LIQUIFY_PATCH_SIZE + tileGridOrigin.x(),
+                              it.key().first * LIQUIFY_PATCH_SIZE + tileGridOrigin.y(),
+                              LIQUIFY_PATCH_SIZE, LIQUIFY_PATCH_SIZE);
+
+        jobs.append({patchRect & dstRect, it.value()});
+    }
+
+    KisThreadLimitedMap::blockingMap(jobs,
+        [this, srcDev, dstDev] (const Job &job) {
+            GridIterationTools::PaintDevicePolygonOp polygonOp(srcDev, dstDev);
+            processCellsInRect(polygonOp, job.blocks, job.rect,
+                               [] (const QPointF &pt) { return pt; });
+        });
+}
+
 void KisLiquifyTransformWorker::run(KisPaintDeviceSP device)
 {
     KisPaintDeviceSP srcDev = new KisPaintDevice(*device.data());
     device->clear();
 
-    using namespace GridIterationTools;
+    m_d->renderDevice(srcDev, device, approxChangeRect(QRect()));
+}
 
-    PaintDevicePolygonOp polygonOp(srcDev, device);
-    Private::MapIndexesOp indexesOp(m_d.data());
-    iterateThroughGrid<AlwaysCompletePolygonPolicy>(polygonOp, indexesOp,
-                                                    m_d->gridSize,
-                                                    m_d->originalPoints,
-                                                    m_d->transformedPoints);
+void KisLiquifyTransformWorker::runPartialDst(KisPaintDeviceSP srcDev,
+                                              KisPaintDeviceSP dstDev,
+                                              const QRect &dstRect)
+{
+    dstDev->clear(dstRect);
+    m_d->renderDevice(srcDev, dstDev, dstRect);
 }
 
 QRect KisLiquifyTransformWorker::approxChangeRect(const QRect &rc)
 {
     const qreal margin = 0.05;
 
+    if (m_d->blockBounds.isEmpty()) {
+        m_d->prepareBlocks();
+    }
+
     /**
-     * Here we just return the full area occupied by the transformed grid.
-     * We sample grid points for not doing too much work.
+     * Here we just return the full area occupied by the transformed grid,
+     * which is the union of the bounds of its blocks
      */
-    const int maxSamplePoints = 200;
-    const int minStep = 3;
-    const int step = qMax(minStep, m_d->transformedPoints.size() / maxSamplePoints);
-
-    QVector<QPoint> samplePoints;
-    for (auto it = m_d->transformedPoints.constBegin(); it != m_d->transformedPoints.constEnd(); ++it) {
-        samplePoints << it->toPoint();
+    QRectF resultRect;
+    Q_FOREACH (const QRectF &bounds, m_d->blockBounds) {
+        resultRect |= bounds;
     }
 
-    QRect resultRect = KisAlgebra2D::approximateRectFromPoints(samplePoints);
-    return KisAlgebra2D::blowRect(resultRect | rc, margin);
+    return KisAlgebra2D::blowRect(resultRect.toAlignedRect() | rc, margin);
 }
 
 QRect KisLiquifyTransformWorker::approxNeedRect(const QRect &rc, const QRect &fullBounds)
@@ -533,6 +813,54 @@ QImage KisLiquifyTransformWorker::runOnQImage(const QImage &srcImage,
     return dstImage;
 }
 
+bool KisLiquifyTransformWorker::runOnQImagePartial(const QImage &srcImage,
+                                                   const QPointF &srcImageOffset,
+                                                   const QTransform &imageToThumbTransform,
+                                                   const QRect &changedRect,
+                                                   QImage *dstImage,
+                                                   const QPointF &dstImageOffset)
+{
+    KIS_ASSERT_RECOVER(srcImage.format() == QImage::Format_ARGB32 &&
+                       dstImage->format() == QImage::Format_ARGB32) {
+        return false;
+    }
+
+    if (changedRect.isEmpty()) return true;
+
+    if (m_d->blockBounds.isEmpty()) {
+        m_d->prepareBlocks();
+    }
+
+    const QRect thumbRect =
+        imageToThumbTransform.mapRect(QRectF(changedRect)).toAlignedRect();
+
+    // the polygon op rounds the pixel positions in the same way
+    const QRect dstImageRect = thumbRect.translated((-dstImageOffset).toPoint());
+
+    if (!dstImage->rect().contains(dstImageRect)) return false;
+
+    {
+        QPainter gc(dstImage);
+        gc.setCompositionMode(QPainter::CompositionMode_Source);
+        gc.fillRect(dstImageRect, Qt::transparent);
+    }
+
+    QVector<int> blocks;
+    for (int i = 0; i < m_d->blockBounds.size(); i++) {
+        if (imageToThumbTransform.mapRect(m_d->blockBounds[i]).intersects(thumbRect)) {
+            blocks << i;
+        }
+    }
+
+    GridIterationTools::QImagePolygonOp polygonOp(srcImage, *dstImage, srcImageOffset, dstImageOffset);
+    m_d->processCellsInRect(polygonOp, blocks, thumbRect,
+                            [&imageToThumbTransform] (const QPointF &pt) {
+                                return imageToThumbTransform.map(pt);
+                            });
+
+    return true;
+}
+
 void KisLiquifyTransformWorker::toXML(QDomElement *e) const
 {
     QDomDocument doc = e->ownerDocument();
@@ -597,6 +925,8 @@ KisLiquifyTransformWorker* KisLiquifyTransformWorker::fromXML(const QDomElement
         worker->m_d->transformedPoints[i] = transformedPoints[i];
     }
 
+    worker->m_d->prepareBlocks();
+
 
     return worker;
 }
@@ -73,12 +73,44 @@ public:
     const QVector<QPointF>& originalPoints() const;
     QVector<QPointF>& transformedPoints();
 
+    /**
+     * Fetches the area (in image coordinates) covered by the grid cells
+     * changed since the previous call and resets it. Returns false if
+     * the changes cannot be localized, e.g. when the worker has just
+     * been created, copied or translated. In such a case the whole
+     * grid should be considered changed.
+     */
+    bool takeChangedRect(QRect *rect);
+
     void run(KisPaintDeviceSP device);
+
+    /**
+     * Renders \p dstRect of the transformed \p srcDev into \p dstDev.
+     * Only the grid cells touching \p dstRect are processed, so the
+     * rect reported by takeChangedRect() can be re-rendered cheaply.
+     */
+    void runPartialDst(KisPaintDeviceSP srcDev,
+                       KisPaintDeviceSP dstDev,
+                       const QRect &dstRect);
+
     QImage runOnQImage(const QImage &srcImage,
                        const QPointF &srcImageOffset,
                        const QTransform &imageToThumbTransform,
                        QPointF *newOffset);
 
+    /**
+     * Re-renders \p changedRect (in image coordinates) of \p dstImage
+     * generated by runOnQImage() before with the same arguments.
+     * Returns false if \p changedRect does not fit into \p dstImage
+     * and the image should be regenerated with runOnQImage().
+     */
+    bool runOnQImagePartial(const QImage &srcImage,
+                            const QPointF &srcImageOffset,
+                            const QTransform &imageToThumbTransform,
+                            const QRect &changedRect,
+                            QImage *dstImage,
+                            const QPointF &dstImageOffset);
+
     void toXML(QDomElement *e) const;
     static KisLiquifyTransformWorker* fromXML(const QDomElement &e);
 
@@ -24,6 +24,7 @@
 #include "filter/kis_filter_registry.h"
 #include "filter/kis_filter_configuration.h"
 #include "generator/kis_generator_registry.h"
+#include "KisFilterTileCache.h"
 
 #ifdef SANITY_CHECK_FILTER_CONFIGURATION_OWNER
 
@@ -53,15 +54,16 @@
 #endif /* SANITY_CHECK_FILTER_CONFIGURATION_OWNER*/
 
 KisNodeFilterInterface::KisNodeFilterInterface(KisFilterConfigurationSP filterConfig)
-    : m_filter(filterConfig)
+    : m_filter(filterConfig),
+      m_filterTileCache(new KisFilterTileCache())
 {
     SANITY_ACQUIRE_FILTER(m_filter);
     KIS_SAFE_ASSERT_RECOVER_NOOP(!filterConfig || filterConfig->hasLocalResourcesSnapshot());
 }
 
 KisNodeFilterInterface::KisNodeFilterInterface(const KisNodeFilterInterface &rhs)
-    : m_filter(rhs.m_filter->clone())
-
+    : m_filter(rhs.m_filter->clone()),
+      m_filterTileCache(new KisFilterTileCache())
 {
     SANITY_ACQUIRE_FILTER(m_filter);
 }
@@ -83,6 +85,12 @@ void KisNodeFilterInterface::setFilter(KisFilterConfigurationSP filterConfig)
     KIS_SAFE_ASSERT_RECOVER_RETURN(filterConfig);
     KIS_SAFE_ASSERT_RECOVER_NOOP(filterConfig->hasLocalResourcesSnapshot());
     m_filter = filterConfig;
+    m_filterTileCache->clear();
 
     SANITY_ACQUIRE_FILTER(m_filter);
 }
+
+KisFilterTileCache* KisNodeFilterInterface::filterTileCache() const
+{
+    return m_filterTileCache.data();
+}
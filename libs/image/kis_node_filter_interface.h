@@ -19,9 +19,13 @@
 #ifndef _KIS_NODE_FILTER_INTERFACE_H_
 #define _KIS_NODE_FILTER_INTERFACE_H_
 
+#include <QScopedPointer>
+
 #include <kritaimage_export.h>
 #include <kis_types.h>
 
+class KisFilterTileCache;
+
 /**
  * Define an interface for nodes that are associated with a filter.
  */
@@ -48,11 +52,20 @@ public:
      */
     virtual void setFilter(KisFilterConfigurationSP filterConfig);
 
+    /**
+     * @return the cache of the output of the filter of this node. It is
+     *         dropped automatically when a new filter is set, but if the
+     *         filter configuration is changed in place, the cache should
+     *         be cleared manually.
+     */
+    KisFilterTileCache* filterTileCache() const;
+
 // the child classes should access the filter with the filter() method
 private:
     KisNodeFilterInterface& operator=(const KisNodeFilterInterface &other);
 
     KisFilterConfigurationSP m_filter;
+    QScopedPointer<KisFilterTileCache> m_filterTileCache;
 };
 
 #endif
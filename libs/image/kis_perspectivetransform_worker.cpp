@@ -27,6 +27,10 @@
 #include <QTransform>
 #include <QVector3D>
 #include <QPolygonF>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
 
 #include <KoUpdater.h>
 #include <KoColor.h>
@@ -42,6 +46,21 @@
 #include "kis_progress_update_helper.h"
 #include "kis_painter.h"
 #include "kis_image.h"
+#include "kis_algebra_2d.h"
+#include "KisMipmapSampler.h"
+#include "KisThreadLimitedMap.h"
+
+/**
+ * The destination is processed in parallel jobs, each of them owning
+ * whole tiles of the destination device
+ */
+#define PERSPECTIVE_JOB_TILE_SIZE 64
+
+/**
+ * The step of the grid the maximum footprint of the destination pixels
+ * is estimated on
+ */
+#define FOOTPRINT_ESTIMATION_STEP 16
 
 
 KisPerspectiveTransformWorker::KisPerspectiveTransformWorker(KisPaintDeviceSP dev, QPointF center, double aX, double aY, double distance, KoUpdaterPtr progress)
@@ -124,27 +143,7 @@ void KisPerspectiveTransformWorker::run()
 
     KIS_ASSERT_RECOVER_NOOP(!m_isIdentity);
 
-    KisProgressUpdateHelper progressHelper(m_progressUpdater, 100, m_dstRegion.rectCount());
-
-    KisRandomSubAccessorSP srcAcc = cloneDevice->createRandomSubAccessor();
-    KisRandomAccessorSP accessor = m_dev->createRandomAccessorNG();
-
-    Q_FOREACH (const QRect &rect, m_dstRegion.rects()) {
-        for (int y = rect.y(); y < rect.y() + rect.height(); ++y) {
-            for (int x = rect.x(); x < rect.x() + rect.width(); ++x) {
-
-                QPointF dstPoint(x, y);
-                QPointF srcPoint = m_backwardTransform.map(dstPoint);
-
-                if (m_srcRect.contains(srcPoint)) {
-                    accessor->moveTo(dstPoint.x(), dstPoint.y());
-                    srcAcc->moveTo(srcPoint.x(), srcPoint.y());
-                    srcAcc->sampledOldRawData(accessor->rawData());
-                }
-            }
-        }
-        progressHelper.step();
-    }
+    processRegion(cloneDevice, m_dev, m_dstRegion, m_srcRect, false);
 }
 
 void KisPerspectiveTransformWorker::runPartialDst(KisPaintDeviceSP srcDev,
@@ -172,26 +171,127 @@ void KisPerspectiveTransformWorker::runPartialDst(KisPaintDeviceSP srcDev,
         }
     }
 
-    KisProgressUpdateHelper progressHelper(m_progressUpdater, 100, dstRect.height());
+    processRegion(srcDev, dstDev, KisRegion(dstRect), srcClipRect,
+                  srcDev->defaultBounds()->wrapAroundMode());
+}
 
-    KisRandomSubAccessorSP srcAcc = srcDev->createRandomSubAccessor();
-    KisRandomAccessorSP accessor = dstDev->createRandomAccessorNG();
+qreal KisPerspectiveTransformWorker::footprintAt(const QPointF &dstPoint, const QPointF &srcPoint) const
+{
+    const QPointF dx = m_backwardTransform.map(dstPoint + QPointF(1.0, 0.0)) - srcPoint;
+    const QPointF dy = m_backwardTransform.map(dstPoint + QPointF(0.0, 1.0)) - srcPoint;
 
-    for (int y = dstRect.y(); y < dstRect.y() + dstRect.height(); ++y) {
-        for (int x = dstRect.x(); x < dstRect.x() + dstRect.width(); ++x) {
+    return qMax(KisAlgebra2D::norm(dx), KisAlgebra2D::norm(dy));
+}
 
-            QPointF dstPoint(x, y);
-            QPointF srcPoint = m_backwardTransform.map(dstPoint);
+void KisPerspectiveTransformWorker::processRegion(KisPaintDeviceSP srcDev,
+                                                  KisPaintDeviceSP dstDev,
+                                                  const KisRegion &dstRegion,
+                                                  const QRectF &srcClipRect,
+                                                  bool wrapAroundMode)
+{
+    const QRect dstBounds = dstRegion.boundingRect();
+    if (dstBounds.isEmpty()) return;
+
+    /**
+     * When the source is minified strongly enough to alias, sample it
+     * from a mipmap pyramid, mild downscales are sampled bilinearly as
+     * before. The wrap-around mode has no bounds to build the pyramid
+     * for, so it is sampled as is.
+     */
+    int numLevels = 1;
+    QRect pyramidBounds;
+
+    if (!wrapAroundMode) {
+        qreal maxFootprint = 0.0;
+
+        for (int y = dstBounds.top(); y <= dstBounds.bottom() + FOOTPRINT_ESTIMATION_STEP; y += FOOTPRINT_ESTIMATION_STEP) {
+            for (int x = dstBounds.left(); x <= dstBounds.right() + FOOTPRINT_ESTIMATION_STEP; x += FOOTPRINT_ESTIMATION_STEP) {
+                const QPointF dstPoint(qMin(x, dstBounds.right()), qMin(y, dstBounds.bottom()));
+                const QPointF srcPoint = m_backwardTransform.map(dstPoint);
+
+                if (srcClipRect.contains(srcPoint)) {
+                    maxFootprint = qMax(maxFootprint, footprintAt(dstPoint, srcPoint));
+                }
+            }
+        }
+
+        pyramidBounds = srcClipRect.toAlignedRect();
+
+        /**
+         * A projective transform may map some corners of the
+         * destination from behind the viewer, so only affine ones are
+         * trusted to shrink the pyramid
+         */
+        if (m_backwardTransform.type() < QTransform::TxProject) {
+            const int margin = 2 << KisMipmapSampler::levelsForFootprint(maxFootprint, pyramidBounds);
+            pyramidBounds &= m_backwardTransform.mapRect(QRectF(dstBounds)).toAlignedRect()
+                .adjusted(-margin, -margin, margin, margin);
+        }
+
+        numLevels = KisMipmapSampler::levelsForFootprint(maxFootprint, pyramidBounds);
+    }
+
+    KisMipmapSampler sampler(srcDev, pyramidBounds, numLevels);
+    const bool useMipmaps = sampler.numLevels() > 1;
+
+    /**
+     * Group the patches by the tiles of the destination, so that no
+     * two jobs ever write into the same tile. The tiles of a moved
+     * device start at its offset, so the grid is aligned to it.
+     */
+    QMap<QPair<int, int>, QVector<QRect>> tilePatches;
+    const QPoint tileGridOrigin(dstDev->x(), dstDev->y());
+
+    Q_FOREACH (const QRect &rect, dstRegion.rects()) {
+        Q_FOREACH (const QRect &patch,
+                   KritaUtils::splitRectIntoPatches(rect.translated(-tileGridOrigin),
+                                                    QSize(PERSPECTIVE_JOB_TILE_SIZE,
+                                                          PERSPECTIVE_JOB_TILE_SIZE))) {
+            const QPair<int, int> key(KisAlgebra2D::divideFloor(patch.x(), PERSPECTIVE_JOB_TILE_SIZE),
+                                      KisAlgebra2D::divideFloor(patch.y(), PERSPECTIVE_JOB_TILE_SIZE));
+            tilePatches[key].append(patch.translated(tileGridOrigin));
+        }
+    }
+
+    QVector<QVector<QRect>> jobs;
+    Q_FOREACH (const QVector<QRect> &patches, tilePatches) {
+        jobs.append(patches);
+    }
 
-            if (srcClipRect.contains(srcPoint) || srcDev->defaultBounds()->wrapAroundMode()) {
-                accessor->moveTo(dstPoint.x(), dstPoint.y());
-                srcAcc->moveTo(srcPoint.x(), srcPoint.y());
-                srcAcc->sampledOldRawData(accessor->rawData());
+    QMutex progressMutex;
+    KisProgressUpdateHelper progressHelper(m_progressUpdater, 100, jobs.size());
+
+    auto processJob = [&] (const QVector<QRect> &patches) {
+        KisMipmapSampler::Accessor srcAcc(&sampler);
+        KisRandomAccessorSP accessor = dstDev->createRandomAccessorNG();
+
+        Q_FOREACH (const QRect &rect, patches) {
+            for (int y = rect.y(); y < rect.y() + rect.height(); ++y) {
+                for (int x = rect.x(); x < rect.x() + rect.width(); ++x) {
+
+                    QPointF dstPoint(x, y);
+                    QPointF srcPoint = m_backwardTransform.map(dstPoint);
+
+                    if (srcClipRect.contains(srcPoint) || wrapAroundMode) {
+                        const qreal lod = useMipmaps ?
+                            KisMipmapSampler::lodForFootprint(footprintAt(dstPoint, srcPoint)) : 0.0;
+
+                        accessor->moveTo(dstPoint.x(), dstPoint.y());
+                        srcAcc.sample(srcPoint, lod, accessor->rawData());
+                    }
+                }
             }
         }
+
+        QMutexLocker l(&progressMutex);
         progressHelper.step();
-    }
+    };
 
+    if (jobs.size() > 1) {
+        KisThreadLimitedMap::blockingMap(jobs, processJob);
+    } else if (!jobs.isEmpty()) {
+        processJob(jobs.first());
+    }
 }
 
 QTransform KisPerspectiveTransformWorker::forwardTransform() const
@@ -55,6 +55,14 @@ private:
                     KisRegion *dstRegion,
                     QPolygonF *dstClipPolygon);
 
+    qreal footprintAt(const QPointF &dstPoint, const QPointF &srcPoint) const;
+
+    void processRegion(KisPaintDeviceSP srcDev,
+                       KisPaintDeviceSP dstDev,
+                       const KisRegion &dstRegion,
+                       const QRectF &srcClipRect,
+                       bool wrapAroundMode);
+
 private:
     KisPaintDeviceSP m_dev;
     KoUpdaterPtr m_progressUpdater;
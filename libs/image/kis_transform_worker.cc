@@ -25,12 +25,17 @@
 #include <qmath.h>
 #include <klocalizedstring.h>
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
 #include <QTransform>
+#include <QVector>
 
 #include <KoColorSpace.h>
 #include <KoCompositeOpRegistry.h>
 #include <KoColor.h>
 
+#include "KisThreadLimitedMap.h"
 #include "kis_paint_device.h"
 #include "kis_debug.h"
 #include "kis_selection.h"
@@ -65,6 +70,7 @@ KisTransformWorker::KisTransformWorker(KisPaintDeviceSP dev,
     m_ytranslate = ytranslate;
     m_progressUpdater = progress;
     m_filter = filter;
+    m_forceSerialPasses = false;
 }
 
 KisTransformWorker::~KisTransformWorker()
@@ -195,6 +201,31 @@ void updateBounds<KisVLineIteratorSP>(QRect &boundRect, const KisFilterWeightsAp
     boundRect.setHeight(newBounds.size());
 }
 
+/**
+ * The lines of a transformation pass are processed in parallel in
+ * bands aligned to the tiles (64x64 pixels), so that two threads never
+ * write into the same tile
+ */
+#define TRANSFORM_PASS_BAND_ALIGNMENT 64
+
+/**
+ * The tiles of a moved device start at its offset, not at zero
+ */
+template <class iter>
+int tileGridOrigin(const KisPaintDevice *dev);
+
+template <>
+int tileGridOrigin<KisHLineIteratorSP>(const KisPaintDevice *dev)
+{
+    return dev->y();
+}
+
+template <>
+int tileGridOrigin<KisVLineIteratorSP>(const KisPaintDevice *dev)
+{
+    return dev->x();
+}
+
 template <class T>
 void KisTransformWorker::transformPass(KisPaintDevice *src, KisPaintDevice *dst,
                                        double floatscale, double shear, double dx,
@@ -210,16 +241,45 @@ void KisTransformWorker::transformPass(KisPaintDevice *src, KisPaintDevice *dst,
     KisFilterWeightsBuffer buf(filterStrategy, qAbs(floatscale));
     KisFilterWeightsApplicator applicator(src, dst, floatscale, shear, dx, clampToEdge);
 
-    KisFilterWeightsApplicator::LinePos dstBounds;
+    const qreal filterSupport = filterStrategy->support(buf.weightsPositionScale().toFloat());
 
-    for (int i = firstLine; i < firstLine + numLines; i++) {
-        KisFilterWeightsApplicator::LinePos dstPos;
-        KisFilterWeightsApplicator::LinePos srcPos(srcStart, srcLen);
+    const int gridOrigin = tileGridOrigin<T>(dst);
 
-        dstPos = applicator.processLine<T>(srcPos, i, &buf, filterStrategy->support(buf.weightsPositionScale().toFloat()));
-        dstBounds.unite(dstPos);
+    QVector<QPair<int, int>> bands;
+    for (int bandStart = firstLine; bandStart < firstLine + numLines;) {
+        const int alignedEnd = gridOrigin +
+            (qFloor(qreal(bandStart - gridOrigin) / TRANSFORM_PASS_BAND_ALIGNMENT) + 1) * TRANSFORM_PASS_BAND_ALIGNMENT;
+        const int bandEnd = qMin(alignedEnd, firstLine + numLines);
 
-        progressHelper.step();
+        bands.append(qMakePair(bandStart, bandEnd));
+        bandStart = bandEnd;
+    }
+
+    QVector<KisFilterWeightsApplicator::LinePos> linePositions(numLines);
+    QMutex progressMutex;
+
+    auto processBand = [&] (const QPair<int, int> &band) {
+        for (int i = band.first; i < band.second; i++) {
+            KisFilterWeightsApplicator::LinePos srcPos(srcStart, srcLen);
+            linePositions[i - firstLine] = applicator.processLine<T>(srcPos, i, &buf, filterSupport);
+
+            QMutexLocker l(&progressMutex);
+            progressHelper.step();
+        }
+    };
+
+    if (bands.size() > 1 && !m_forceSerialPasses) {
+        KisThreadLimitedMap::blockingMap(bands, processBand);
+    } else {
+        Q_FOREACH (const auto &band, bands) {
+            processBand(band);
+        }
+    }
+
+    KisFilterWeightsApplicator::LinePos dstBounds;
+
+    Q_FOREACH (const KisFilterWeightsApplicator::LinePos &dstPos, linePositions) {
+        dstBounds.unite(dstPos);
     }
 
     updateBounds<T>(m_boundRect, dstBounds);
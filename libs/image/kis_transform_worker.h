@@ -155,6 +155,9 @@ private:
     KoUpdaterPtr m_progressUpdater;
     KisFilterStrategy *m_filter;
     QRect m_boundRect;
+
+    // process the lines of every pass in the calling thread (for tests)
+    bool m_forceSerialPasses;
 };
 
 #endif // KIS_TRANSFORM_VISITOR_H_
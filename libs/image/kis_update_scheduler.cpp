@@ -29,6 +29,7 @@
 
 #include "kis_queues_progress_updater.h"
 #include "KisImageConfigNotifier.h"
+#include "KisThreadLimitedMap.h"
 
 #include <QReadWriteLock>
 #include "kis_lazy_wait_condition.h"
@@ -107,6 +108,8 @@ void KisUpdateScheduler::setThreadsLimit(int value)
     m_d->updaterContext.setThreadsLimit(value);
     m_d->updaterContext.unlock();
     unlock(false);
+
+    KisThreadLimitedMap::setThreadsLimit(value);
 }
 
 int KisUpdateScheduler::threadsLimit() const
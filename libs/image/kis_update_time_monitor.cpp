@@ -18,6 +18,7 @@
 
 #include "kis_update_time_monitor.h"
 
+#include <QAtomicInt>
 #include <QGlobalStatic>
 #include <QHash>
 #include <QSet>
@@ -36,6 +37,7 @@
 #include "kis_debug.h"
 #include "kis_global.h"
 #include "kis_image_config.h"
+#include "KisRollingMeanAccumulatorWrapper.h"
 
 
 #include <brushengine/kis_paintop_preset.h>
@@ -77,6 +79,16 @@ private:
     qint64 m_updateTime;
 };
 
+/**
+ * A job of the latency measure that has already been processed by
+ * its stroke, but whose result hasn't reached the projection yet
+ */
+struct LatencyTicket
+{
+    qint64 startTime;
+    QRegion dirtyRegion;
+};
+
 struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
 {
     Private()
@@ -85,9 +97,11 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
           numTickets(0),
           numUpdates(0),
           mousePath(0.0),
-          loggingEnabled(false)
+          loggingEnabled(false),
+          latencyAccumulator(30)
     {
         loggingEnabled = KisImageConfig(true).enablePerfLog();
+        latencyTimer.start();
     }
 
     QHash<void*, StrokeTicket*> preliminaryTickets;
@@ -105,6 +119,18 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
     KisPaintOpPresetSP preset;
 
     bool loggingEnabled;
+
+    QAtomicInt latencyClients;
+    QElapsedTimer latencyTimer;
+
+    /**
+     * The time each job was added to the image. The job data is deleted
+     * right after it is processed, so the same key may be reused by a
+     * newer job before the older one is reported as finished.
+     */
+    QMultiHash<void*, qint64> latencyStartedJobs;
+    QList<LatencyTicket> latencyTickets;
+    KisRollingMeanAccumulatorWrapper latencyAccumulator;
 };
 
 KisUpdateTimeMonitor::KisUpdateTimeMonitor()
@@ -209,6 +235,11 @@ void KisUpdateTimeMonitor::printValues()
 
 void KisUpdateTimeMonitor::reportJobStarted(void *key)
 {
+    if (m_d->latencyClients.loadAcquire() > 0) {
+        QMutexLocker locker(&m_d->mutex);
+        m_d->latencyStartedJobs.insert(key, m_d->latencyTimer.elapsed());
+    }
+
     if (!m_d->loggingEnabled) return;
 
     QMutexLocker locker(&m_d->mutex);
@@ -221,6 +252,29 @@ void KisUpdateTimeMonitor::reportJobStarted(void *key)
 
 void KisUpdateTimeMonitor::reportJobFinished(void *key, const QVector<QRect> &rects)
 {
+    if (m_d->latencyClients.loadAcquire() > 0) {
+        QMutexLocker locker(&m_d->mutex);
+
+        // the values of the same key are returned from the newest to the oldest one
+        const QList<qint64> startTimes = m_d->latencyStartedJobs.values(key);
+
+        if (!startTimes.isEmpty()) {
+            const qint64 startTime = startTimes.last();
+            m_d->latencyStartedJobs.remove(key, startTime);
+
+            LatencyTicket ticket;
+            ticket.startTime = startTime;
+
+            Q_FOREACH (const QRect &rect, rects) {
+                ticket.dirtyRegion += rect;
+            }
+
+            if (!ticket.dirtyRegion.isEmpty()) {
+                m_d->latencyTickets.append(ticket);
+            }
+        }
+    }
+
     if (!m_d->loggingEnabled) return;
 
     QMutexLocker locker(&m_d->mutex);
@@ -238,6 +292,23 @@ void KisUpdateTimeMonitor::reportJobFinished(void *key, const QVector<QRect> &re
 
 void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
 {
+    if (m_d->latencyClients.loadAcquire() > 0) {
+        QMutexLocker locker(&m_d->mutex);
+
+        const qint64 now = m_d->latencyTimer.elapsed();
+
+        for (auto it = m_d->latencyTickets.begin(); it != m_d->latencyTickets.end();) {
+            it->dirtyRegion -= rect;
+
+            if (it->dirtyRegion.isEmpty()) {
+                m_d->latencyAccumulator(now - it->startTime);
+                it = m_d->latencyTickets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
     if (!m_d->loggingEnabled) return;
 
     QMutexLocker locker(&m_d->mutex);
@@ -256,3 +327,23 @@ void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
     }
     m_d->numUpdates++;
 }
+
+void KisUpdateTimeMonitor::startLatencyMeasure()
+{
+    m_d->latencyClients.ref();
+}
+
+void KisUpdateTimeMonitor::endLatencyMeasure()
+{
+    if (!m_d->latencyClients.deref()) {
+        QMutexLocker locker(&m_d->mutex);
+        m_d->latencyStartedJobs.clear();
+        m_d->latencyTickets.clear();
+    }
+}
+
+qreal KisUpdateTimeMonitor::averageUpdateLatency() const
+{
+    QMutexLocker locker(&m_d->mutex);
+    return m_d->latencyAccumulator.rollingMeanSafe();
+}
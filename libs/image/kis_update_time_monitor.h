@@ -46,6 +46,24 @@ public:
     void reportJobFinished(void *key, const QVector<QRect> &rects);
     void reportUpdateFinished(const QRect &rect);
 
+    /**
+     * Starts measuring the update latency, that is the time between
+     * the moment a stroke job was added to the image and the moment
+     * the projection has been updated in all the rects the job has
+     * reported dirty with reportJobFinished(). Unlike the rest of the
+     * monitor, this measurement doesn't depend on the perf log being
+     * enabled. The measurement is active while there is at least one
+     * client that has started it and hasn't stopped it yet.
+     */
+    void startLatencyMeasure();
+    void endLatencyMeasure();
+
+    /**
+     * The rolling mean of the measured update latency in milliseconds,
+     * or 0 if nothing has been measured yet
+     */
+    qreal averageUpdateLatency() const;
+
 
 private:
     struct Private;
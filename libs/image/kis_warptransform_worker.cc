@@ -257,9 +257,40 @@ void KisWarpTransformWorker::run()
     const int pixelPrecision = 8;
 
     FunctionTransformOp functionOp(m_warpMathFunction, m_origPoint, m_transfPoint, m_alpha);
-    GridIterationTools::PaintDevicePolygonOp polygonOp(srcdev, m_dev);
-    GridIterationTools::processGrid(polygonOp, functionOp,
-                                    srcBounds, pixelPrecision);
+
+    /**
+     * Estimate how strongly the warp minifies the source, to know
+     * whether it should be sampled from a mipmap pyramid
+     */
+    const int footprintStep = 32;
+    qreal maxFootprint = 0.0;
+
+    for (int y = srcBounds.top(); y <= srcBounds.bottom(); y += footprintStep) {
+        for (int x = srcBounds.left(); x <= srcBounds.right(); x += footprintStep) {
+            const QPointF pt(x, y);
+            const QPointF origin = functionOp(pt);
+            const QPointF dx = functionOp(pt + QPointF(footprintStep, 0)) - origin;
+            const QPointF dy = functionOp(pt + QPointF(0, footprintStep)) - origin;
+
+            const qreal area = qAbs(KisAlgebra2D::crossProduct(dx, dy));
+            if (area > 0.0) {
+                maxFootprint = qMax(maxFootprint, footprintStep / std::sqrt(area));
+            }
+        }
+    }
+
+    const int numLevels = KisMipmapSampler::levelsForFootprint(maxFootprint, srcBounds);
+
+    if (numLevels > 1) {
+        KisMipmapSampler sampler(srcdev, srcBounds, numLevels);
+        GridIterationTools::PaintDevicePolygonOp polygonOp(srcdev, m_dev, &sampler);
+        GridIterationTools::processGrid(polygonOp, functionOp,
+                                        srcBounds, pixelPrecision);
+    } else {
+        GridIterationTools::PaintDevicePolygonOp polygonOp(srcdev, m_dev);
+        GridIterationTools::processGrid(polygonOp, functionOp,
+                                        srcBounds, pixelPrecision);
+    }
 }
 
 #include "krita_utils.h"
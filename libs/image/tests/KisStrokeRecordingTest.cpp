@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecordingTest.h"
+
+#include <QBuffer>
+#include <QTest>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+
+#include "brushengine/KisStrokeRecording.h"
+#include "kis_image.h"
+
+#include <KisGlobalResourcesInterface.h>
+
+namespace {
+
+KisPaintInformation createPaintInfo(qreal x, qreal y, qreal pressure, qreal time)
+{
+    return KisPaintInformation(QPointF(x, y), pressure, 10.0, -20.0, 45.0, 0.3, 1.0, time, 0.5);
+}
+
+bool comparePaintInfo(const KisPaintInformation &lhs, const KisPaintInformation &rhs)
+{
+    return qFuzzyCompare(lhs.pos().x(), rhs.pos().x()) &&
+        qFuzzyCompare(lhs.pos().y(), rhs.pos().y()) &&
+        qFuzzyCompare(lhs.pressure(), rhs.pressure()) &&
+        qFuzzyCompare(lhs.xTilt(), rhs.xTilt()) &&
+        qFuzzyCompare(lhs.yTilt(), rhs.yTilt()) &&
+        qFuzzyCompare(lhs.rotation(), rhs.rotation()) &&
+        qFuzzyCompare(lhs.tangentialPressure(), rhs.tangentialPressure()) &&
+        qFuzzyCompare(lhs.currentTime(), rhs.currentTime());
+}
+
+}
+
+void KisStrokeRecordingTest::testSaveLoad()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KisImageSP image = new KisImage(0, 640, 480, cs, "test image");
+    image->setResolution(2.0, 3.0);
+
+    KisStrokeRecording recording;
+    recording.setImageState(image);
+    recording.setPainterState(KoColor(Qt::red, cs), COMPOSITE_MULT, 128, KisPaintOpPresetSP());
+
+    recording.addPoint(createPaintInfo(10.5, 20.25, 0.1, 5.0));
+    recording.addLine(createPaintInfo(10.5, 20.25, 0.1, 5.0),
+                      createPaintInfo(30.125, 40.0, 0.7, 12.0));
+    recording.addBezierCurve(createPaintInfo(30.125, 40.0, 0.7, 12.0),
+                             QPointF(35.5, 45.5), QPointF(50.0, 55.0),
+                             createPaintInfo(60.0, 62.5, 1.0, 20.0));
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(recording.save(&buffer));
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    KisStrokeRecording loaded;
+    QVERIFY(loaded.load(&buffer, KisGlobalResourcesInterface::instance()));
+
+    QCOMPARE(loaded.imageBounds(), QRect(0, 0, 640, 480));
+    QCOMPARE(loaded.colorSpace(), cs);
+    QCOMPARE(loaded.xRes(), 2.0);
+    QCOMPARE(loaded.yRes(), 3.0);
+    QCOMPARE(loaded.compositeOpId(), COMPOSITE_MULT);
+    QCOMPARE(loaded.opacity(), quint8(128));
+    QCOMPARE(loaded.paintColor().toQColor(), QColor(Qt::red));
+    QVERIFY(!loaded.preset());
+
+    const QVector<KisStrokeRecording::Segment> original = recording.segments();
+    const QVector<KisStrokeRecording::Segment> segments = loaded.segments();
+
+    QCOMPARE(segments.size(), 3);
+
+    for (int i = 0; i < segments.size(); i++) {
+        QCOMPARE(segments[i].type, original[i].type);
+        QVERIFY(comparePaintInfo(segments[i].pi1, original[i].pi1));
+
+        if (segments[i].type != KisStrokeRecording::Point) {
+            QVERIFY(comparePaintInfo(segments[i].pi2, original[i].pi2));
+        }
+    }
+
+    QCOMPARE(segments[2].control1, QPointF(35.5, 45.5));
+    QCOMPARE(segments[2].control2, QPointF(50.0, 55.0));
+}
+
+void KisStrokeRecordingTest::testLoadInvalid()
+{
+    QByteArray data("<strokeRecording version=\"1\"><stroke><unknown/></stroke></strokeRecording>");
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    KisStrokeRecording recording;
+    QVERIFY(!recording.load(&buffer, KisGlobalResourcesInterface::instance()));
+}
+
+QTEST_MAIN(KisStrokeRecordingTest)
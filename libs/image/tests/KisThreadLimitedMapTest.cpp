@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisThreadLimitedMapTest.h"
+
+#include <QTest>
+#include <QThread>
+
+#include "KisThreadLimitedMap.h"
+#include "kis_image_config.h"
+
+void KisThreadLimitedMapTest::cleanupTestCase()
+{
+    KisThreadLimitedMap::setThreadsLimit(KisImageConfig(true).maxNumberOfThreads());
+}
+
+void KisThreadLimitedMapTest::testAllJobsDone_data()
+{
+    QTest::addColumn<int>("threadsLimit");
+    QTest::addColumn<int>("numJobs");
+
+    QTest::newRow("1-thread") << 1 << 100;
+    QTest::newRow("2-threads") << 2 << 100;
+    QTest::newRow("8-threads") << 8 << 100;
+    QTest::newRow("8-threads-3-jobs") << 8 << 3;
+    QTest::newRow("8-threads-1-job") << 8 << 1;
+    QTest::newRow("8-threads-0-jobs") << 8 << 0;
+}
+
+void KisThreadLimitedMapTest::testAllJobsDone()
+{
+    QFETCH(int, threadsLimit);
+    QFETCH(int, numJobs);
+
+    KisThreadLimitedMap::setThreadsLimit(threadsLimit);
+
+    QVector<QAtomicInt> counters(numJobs);
+    KisThreadLimitedMap::blockingMap(counters, [] (QAtomicInt &counter) {
+        counter.ref();
+    });
+
+    for (int i = 0; i < numJobs; i++) {
+        QCOMPARE(counters[i].loadAcquire(), 1);
+    }
+}
+
+void KisThreadLimitedMapTest::testSingleThread()
+{
+    KisThreadLimitedMap::setThreadsLimit(1);
+
+    QVector<QThread*> threads(16);
+    KisThreadLimitedMap::run(threads.size(), [&threads] (int index) {
+        threads[index] = QThread::currentThread();
+    });
+
+    Q_FOREACH (QThread *thread, threads) {
+        QCOMPARE(thread, QThread::currentThread());
+    }
+}
+
+void KisThreadLimitedMapTest::testNested()
+{
+    /**
+     * The inner maps run while all the threads of the pool are taken
+     * by the outer one, so they must be done by the calling threads
+     */
+    KisThreadLimitedMap::setThreadsLimit(2);
+
+    const int numOuterJobs = 16;
+    const int numInnerJobs = 64;
+
+    QAtomicInt numDone;
+    KisThreadLimitedMap::run(numOuterJobs, [&numDone] (int) {
+        KisThreadLimitedMap::run(numInnerJobs, [&numDone] (int) {
+            numDone.ref();
+        });
+    });
+
+    QCOMPARE(numDone.loadAcquire(), numOuterJobs * numInnerJobs);
+}
+
+QTEST_MAIN(KisThreadLimitedMapTest)
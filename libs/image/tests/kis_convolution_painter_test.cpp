@@ -34,7 +34,17 @@
 #include "kis_convolution_kernel.h"
 #include <kis_gaussian_kernel.h>
 #include <kis_mask_generator.h>
+#include <kis_image_config.h>
 #include "testutil.h"
+#include "lod_override.h"
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+
+#include "config_convolution.h"
+
+#ifdef HAVE_FFTW3
+#include "kis_convolution_worker_fft.h"
+#endif
 
 KisPaintDeviceSP initAsymTestDevice(QRect &imageRect, int &pixelSize, QByteArray &initialData)
 {
@@ -57,6 +67,25 @@ KisPaintDeviceSP initAsymTestDevice(QRect &imageRect, int &pixelSize, QByteArray
     return dev;
 }
 
+/**
+ * Fills \p imageRect with opaque 10x10 blocks of different colors,
+ * so that the convolution has sharp edges to smear
+ */
+KisPaintDeviceSP initBlocksTestDevice(const QRect &imageRect)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    for (int y = imageRect.top(); y < imageRect.bottom(); y += 10) {
+        for (int x = imageRect.left(); x < imageRect.right(); x += 10) {
+            KoColor c(QColor((x * 7) % 256, (y * 5) % 256, ((x + y) * 3) % 256), cs);
+            dev->fill(QRect(x, y, 10, 10), c);
+        }
+    }
+
+    return dev;
+}
+
 Eigen::Matrix<qreal, 3, 3> initSymmFilter(qreal &offset, qreal &factor)
 {
     Eigen::Matrix<qreal, 3, 3> filter;
@@ -438,6 +467,202 @@ void KisConvolutionPainterTest::testGaussianDetailsFFTW()
     testGaussianDetails(true);
 }
 
+void KisConvolutionPainterTest::testGaussianBoxCascade()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(0, 0, 200, 200);
+
+    KisPaintDeviceSP dev = initBlocksTestDevice(imageRect);
+
+    const qreal radius = 20;
+
+    KisPaintDeviceSP boxDev = new KisPaintDevice(cs);
+    KisConvolutionPainter boxPainter(boxDev, KisConvolutionPainter::BOX_GAUSSIAN);
+    boxPainter.applyGaussian(dev, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(),
+                             radius, radius, BORDER_IGNORE);
+
+    KisConvolutionKernelSP kernelHoriz = KisGaussianKernel::createHorizontalKernel(radius);
+    KisConvolutionKernelSP kernelVertical = KisGaussianKernel::createVerticalKernel(radius);
+    const int verticalCenter = kernelVertical->height() / 2;
+
+    KisPaintDeviceSP interm = new KisPaintDevice(cs);
+    KisConvolutionPainter horizPainter(interm, KisConvolutionPainter::SPATIAL);
+    horizPainter.applyMatrix(kernelHoriz, dev,
+                             imageRect.topLeft() - QPoint(0, verticalCenter),
+                             imageRect.topLeft() - QPoint(0, verticalCenter),
+                             imageRect.size() + QSize(0, 2 * verticalCenter),
+                             BORDER_IGNORE);
+
+    KisPaintDeviceSP kernelDev = new KisPaintDevice(cs);
+    KisConvolutionPainter verticalPainter(kernelDev, KisConvolutionPainter::SPATIAL);
+    verticalPainter.applyMatrix(kernelVertical, interm,
+                                imageRect.topLeft(), imageRect.topLeft(), imageRect.size(),
+                                BORDER_IGNORE);
+
+    /**
+     * The box cascade only approximates the Gaussian, so compare the results
+     * fuzzily and away from the transparent border of the image
+     */
+    const QRect compareRect = imageRect.adjusted(30, 30, -30, -30);
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint,
+                                  boxDev->convertToQImage(0, compareRect),
+                                  kernelDev->convertToQImage(0, compareRect),
+                                  4, 4)) {
+        QFAIL(QString("Box cascade Gaussian differs from the kernel one at %1,%2")
+              .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+void KisConvolutionPainterTest::testBoxGaussianIsOptIn()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 100, 100, cs, "test image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    KisPaintDeviceSP dev = layer->paintDevice();
+
+    const qreal smallRadius = 5;
+    const qreal largeRadius = 50;
+
+    KisImageConfig cfg(false);
+    const bool oldBoxGaussianBlur = cfg.boxGaussianBlur();
+    cfg.setBoxGaussianBlur(false);
+
+    {
+        // the final rendering is exact by default
+        KisConvolutionPainter gc(dev);
+        QVERIFY(!gc.useBoxGaussian(smallRadius, smallRadius));
+        QVERIFY(!gc.useBoxGaussian(largeRadius, largeRadius));
+
+        KisConvolutionPainter boxGc(dev, KisConvolutionPainter::BOX_GAUSSIAN);
+        QVERIFY(boxGc.useBoxGaussian(smallRadius, smallRadius));
+
+        KisConvolutionPainter spatialGc(dev, KisConvolutionPainter::SPATIAL);
+        QVERIFY(!spatialGc.useBoxGaussian(largeRadius, largeRadius));
+    }
+
+    {
+        // the LoD previews use the approximation for large radii
+        TestUtil::LodOverride l(1, image);
+
+        KisConvolutionPainter gc(dev);
+        QVERIFY(!gc.useBoxGaussian(smallRadius, smallRadius));
+        QVERIFY(gc.useBoxGaussian(largeRadius, largeRadius));
+    }
+
+    cfg.setBoxGaussianBlur(true);
+
+    {
+        KisConvolutionPainter gc(dev);
+        QVERIFY(!gc.useBoxGaussian(smallRadius, smallRadius));
+        QVERIFY(gc.useBoxGaussian(largeRadius, largeRadius));
+    }
+
+    cfg.setBoxGaussianBlur(oldBoxGaussianBlur);
+}
+
+void KisConvolutionPainterTest::testFFTWTiled()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(7, 13, 400, 300);
+
+    KisPaintDeviceSP dev = initBlocksTestDevice(imageRect);
+
+    KisConvolutionKernelSP kernel = KisGaussianKernel::createUniform2DKernel(10, 10);
+
+    KisPaintDeviceSP spatialDev = new KisPaintDevice(cs);
+    KisConvolutionPainter spatialPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+    spatialPainter.applyMatrix(kernel, dev, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_IGNORE);
+
+    /**
+     * A tiny memory limit makes the FFT worker split the area into
+     * many small tiles, which should give the same result as a single one
+     */
+    KisImageConfig cfg(false);
+    const int oldMemoryLimit = cfg.fftConvolutionMemoryLimit();
+    cfg.setFftConvolutionMemoryLimit(1);
+
+    KisPaintDeviceSP fftDev = new KisPaintDevice(cs);
+    KisConvolutionPainter fftPainter(fftDev, KisConvolutionPainter::FFTW);
+    fftPainter.applyMatrix(kernel, dev, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_IGNORE);
+
+    cfg.setFftConvolutionMemoryLimit(oldMemoryLimit);
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint,
+                                  spatialDev->convertToQImage(0, imageRect),
+                                  fftDev->convertToQImage(0, imageRect),
+                                  2, 2)) {
+        QFAIL(QString("Tiled FFT convolution differs from the spatial one at %1,%2")
+              .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+void KisConvolutionPainterTest::testFFTWCachedSpectra()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(7, 13, 200, 150);
+
+    KisPaintDeviceSP dev = initBlocksTestDevice(imageRect);
+
+    /**
+     * The second kernel reuses the spectra cached for the first one,
+     * and the copy of the device should hit the cache as well
+     */
+    QList<QPair<KisConvolutionKernelSP, KisPaintDeviceSP>> runs;
+    runs << qMakePair(KisGaussianKernel::createUniform2DKernel(10, 10), dev);
+    runs << qMakePair(KisGaussianKernel::createUniform2DKernel(14, 12), KisPaintDeviceSP(new KisPaintDevice(*dev)));
+
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        KisPaintDeviceSP spatialDev = new KisPaintDevice(cs);
+        KisConvolutionPainter spatialPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+        spatialPainter.applyMatrix(it->first, it->second, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+
+#ifdef HAVE_FFTW3
+        const qint64 oldHitCount = KisConvolutionWorkerFFTSpectraCache::hitCount();
+#endif
+
+        KisPaintDeviceSP fftDev = new KisPaintDevice(cs);
+        KisConvolutionPainter fftPainter(fftDev, KisConvolutionPainter::FFTW);
+        fftPainter.setCacheSourceSpectra(true);
+        fftPainter.applyMatrix(it->first, it->second, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+
+#ifdef HAVE_FFTW3
+        if (it != runs.begin()) {
+            QVERIFY(KisConvolutionWorkerFFTSpectraCache::hitCount() > oldHitCount);
+        }
+#endif
+
+        QPoint errpoint;
+        if (!TestUtil::compareQImages(errpoint,
+                                      spatialDev->convertToQImage(0, imageRect),
+                                      fftDev->convertToQImage(0, imageRect),
+                                      2, 2)) {
+            QFAIL(QString("Cached FFT convolution differs from the spatial one at %1,%2")
+                  .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+        }
+    }
+
+    // the cleared cache has nothing to reuse
+    KisConvolutionPainter::clearSourceSpectraCache();
+
+#ifdef HAVE_FFTW3
+    const qint64 oldHitCount = KisConvolutionWorkerFFTSpectraCache::hitCount();
+#endif
+
+    KisPaintDeviceSP fftDev = new KisPaintDevice(cs);
+    KisConvolutionPainter fftPainter(fftDev, KisConvolutionPainter::FFTW);
+    fftPainter.setCacheSourceSpectra(true);
+    fftPainter.applyMatrix(runs.last().first, runs.last().second, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+
+#ifdef HAVE_FFTW3
+    QCOMPARE(KisConvolutionWorkerFFTSpectraCache::hitCount(), oldHitCount);
+#endif
+}
+
 #include "kis_transaction.h"
 
 void KisConvolutionPainterTest::testDilate()
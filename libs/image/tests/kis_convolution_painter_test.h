@@ -57,6 +57,12 @@ private Q_SLOTS:
     void testGaussianDetailsSpatial();
     void testGaussianDetailsFFTW();
 
+    void testGaussianBoxCascade();
+    void testBoxGaussianIsOptIn();
+
+    void testFFTWTiled();
+    void testFFTWCachedSpectra();
+
     void testDilate();
     void testErode();
 };
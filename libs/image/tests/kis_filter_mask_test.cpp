@@ -19,6 +19,7 @@
 #include "kis_filter_mask_test.h"
 #include <QTest>
 
+#include <KoColor.h>
 #include <KoColorSpaceRegistry.h>
 
 #include "kis_selection.h"
@@ -31,7 +32,11 @@
 #include "kis_paint_layer.h"
 #include "kis_types.h"
 #include "kis_image.h"
+#include "KisFilterTileCache.h"
+#include "lod_override.h"
 #include <KisGlobalResourcesInterface.h>
+#include <KoColorTransformation.h>
+#include <QPainter>
 
 
 #include "testutil.h"
@@ -123,4 +128,152 @@ void KisFilterMaskTest::testProjectionSelected()
 
 }
 
+void KisFilterMaskTest::testFusedMasks()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QImage qimage(QString(FILES_DATA_DIR) + '/' + "hakonepa.png");
+    QImage inverted(QString(FILES_DATA_DIR) + '/' + "inverted_hakonepa.png");
+
+    KisFilterSP f = KisFilterRegistry::instance()->value("invert");
+    Q_ASSERT(f);
+    KisFilterConfigurationSP  kfc = f->defaultConfiguration(KisGlobalResourcesInterface::instance());
+    Q_ASSERT(kfc);
+
+    KisImageSP image = new KisImage(0, qimage.width(), qimage.height(), cs, "tests");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    layer->paintDevice()->convertFromQImage(qimage, 0, 0, 0);
+    image->addNode(layer);
+
+    QVector<KisFilterMaskSP> masks;
+
+    for (int i = 0; i < 3; i++) {
+        KisFilterMaskSP mask = new KisFilterMask();
+        mask->setFilter(kfc->cloneWithResourcesSnapshot());
+        mask->createNodeProgressProxy();
+        image->addNode(mask, layer);
+        mask->initSelection(layer);
+        masks << mask;
+    }
+
+    /**
+     * The first and the last masks are fused, the middle one
+     * doesn't cover the whole layer and is applied separately
+     */
+    const QRect deselectedRect(0, 0, 50, 50);
+    masks[1]->select(deselectedRect, MIN_SELECTED);
+
+    KisFilterConfigurationSP transformationConfig;
+    QVERIFY(masks[0]->perPixelTransformation(cs, image->bounds(), &transformationConfig));
+    QVERIFY(transformationConfig);
+
+    /**
+     * The transformation is cached by the configuration of the mask
+     */
+    QCOMPARE(masks[0]->perPixelTransformation(cs, image->bounds(), &transformationConfig),
+             masks[0]->perPixelTransformation(cs, image->bounds(), &transformationConfig));
+
+    QVERIFY(!masks[1]->perPixelTransformation(cs, image->bounds(), &transformationConfig));
+
+    image->refreshGraph();
+    image->waitForDone();
+
+    QImage expected(inverted);
+    QPainter gc(&expected);
+    gc.setCompositionMode(QPainter::CompositionMode_Source);
+    gc.drawImage(deselectedRect.topLeft(), qimage.copy(deselectedRect));
+    gc.end();
+
+    QPoint errpoint;
+    QImage result = layer->projection()->convertToQImage(0, 0, 0, qimage.width(), qimage.height());
+    if (!TestUtil::compareQImages(errpoint, expected, result)) {
+        result.save("filtermasktest3.png");
+        QFAIL(QString("Failed to fuse the masks, first different pixel: %1,%2 ").arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+void KisFilterMaskTest::testTileCache()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QImage qimage(QString(FILES_DATA_DIR) + '/' + "hakonepa.png");
+    const QRect rect(50, 50, 300, 200);
+
+    KisFilterSP f = KisFilterRegistry::instance()->value("blur");
+    Q_ASSERT(f);
+    KisFilterConfigurationSP  kfc = f->defaultConfiguration(KisGlobalResourcesInterface::instance());
+    Q_ASSERT(kfc);
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->convertFromQImage(qimage, 0, 0, 0);
+
+    // the result is written into a layer, so that its LoD could be overridden
+    KisImageSP image = new KisImage(0, qimage.width(), qimage.height(), cs, "filter cache test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    KisFilterTileCache cache;
+
+    auto checkAgainstDirectProcess = [&] (bool sourceChanged) {
+        KisPaintDeviceSP result = layer->paintDevice();
+        result->clear();
+
+        KisPaintDeviceSP expected = new KisPaintDevice(cs);
+        expected->setDefaultBounds(result->defaultBounds());
+        f->process(src, expected, 0, rect, kfc, 0);
+
+        cache.process(f, kfc, src, result, rect, sourceChanged);
+
+        QPoint errpoint;
+        if (!TestUtil::compareQImages(errpoint,
+                                      expected->convertToQImage(0, rect),
+                                      result->convertToQImage(0, rect))) {
+            result->convertToQImage(0, rect).save("filtermasktest4.png");
+            QFAIL(QString("Cached result differs from the direct one, first different pixel: %1,%2 ").arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+        }
+    };
+
+    // cold cache
+    checkAgainstDirectProcess(false);
+    QVERIFY(cache.numCachedTiles() > 0);
+    QCOMPARE(cache.hitCount(), qint64(0));
+
+    // the source is unchanged, so the tiles are taken from the cache
+    checkAgainstDirectProcess(false);
+    const qint64 numTileHits = cache.hitCount();
+    QVERIFY(numTileHits > 0);
+
+    {
+        // the LoD preview fills its own tiles...
+        TestUtil::LodOverride l(1, image);
+
+        checkAgainstDirectProcess(false);
+        QCOMPARE(cache.hitCount(), numTileHits);
+
+        checkAgainstDirectProcess(false);
+        QVERIFY(cache.hitCount() > numTileHits);
+    }
+
+    // ... and keeps the ones of the final rendering
+    qint64 oldHitCount = cache.hitCount();
+    checkAgainstDirectProcess(false);
+    QCOMPARE(cache.hitCount(), oldHitCount + numTileHits);
+
+    // the tiles around the changed area should be refiltered
+    src->fill(QRect(100, 100, 20, 20), KoColor(Qt::red, cs));
+    oldHitCount = cache.hitCount();
+    checkAgainstDirectProcess(false);
+    QVERIFY(cache.hitCount() > oldHitCount);
+    QVERIFY(cache.hitCount() < oldHitCount + numTileHits);
+
+    // a changed source is not looked up in the cache at all
+    src->fill(QRect(200, 150, 20, 20), KoColor(Qt::blue, cs));
+    oldHitCount = cache.hitCount();
+    checkAgainstDirectProcess(true);
+    QCOMPARE(cache.hitCount(), oldHitCount);
+
+    cache.clear();
+    QCOMPARE(cache.numCachedTiles(), 0);
+}
+
 QTEST_MAIN(KisFilterMaskTest)
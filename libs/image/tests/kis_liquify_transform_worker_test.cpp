@@ -154,4 +154,109 @@ void KisLiquifyTransformWorkerTest::testIdentityTransform()
     TestUtil::checkQImage(result, "liquify_transform_test", "liquify_dev", "identity");
 }
 
+void KisLiquifyTransformWorkerTest::testPartialUpdate()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+
+    KisPaintDeviceSP srcDev = new KisPaintDevice(cs);
+    srcDev->convertFromQImage(image, 0);
+
+    const int pixelPrecision = 8;
+
+    KisLiquifyTransformWorker worker(srcDev->exactBounds(),
+                                     0,
+                                     pixelPrecision);
+
+    QRect changedRect;
+
+    // a new worker cannot tell which part of it has changed
+    QVERIFY(!worker.takeChangedRect(&changedRect));
+
+    worker.translatePoints(QPointF(100,100),
+                           QPointF(50, 0),
+                           50, false, 0.2);
+
+    QVERIFY(worker.takeChangedRect(&changedRect));
+    QVERIFY(!changedRect.isEmpty());
+
+    KisPaintDeviceSP dstDev = new KisPaintDevice(cs);
+    worker.runPartialDst(srcDev, dstDev, worker.approxChangeRect(QRect()));
+
+    worker.scalePoints(QPointF(400,300),
+                       0.5,
+                       50, false, 0.2);
+
+    QVERIFY(worker.takeChangedRect(&changedRect));
+    QVERIFY(!changedRect.isEmpty());
+    QVERIFY(!changedRect.contains(QPoint(100, 100)));
+
+    worker.runPartialDst(srcDev, dstDev, changedRect);
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(*srcDev);
+    worker.run(refDev);
+
+    QVERIFY(TestUtil::comparePaintDevicesClever<quint8>(dstDev, refDev));
+}
+
+void KisLiquifyTransformWorkerTest::testPartialUpdateQImage()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    const int pixelPrecision = 8;
+
+    KisLiquifyTransformWorker worker(image.rect(),
+                                     0,
+                                     pixelPrecision);
+
+    const QTransform imageToThumbTransform = QTransform::fromScale(0.5, 0.5);
+
+    QImage thumbImage(image.size() / 2, QImage::Format_ARGB32);
+    thumbImage.fill(0);
+    {
+        QPainter gc(&thumbImage);
+        gc.setTransform(imageToThumbTransform);
+        gc.drawImage(QPoint(), image);
+    }
+
+    /**
+     * The deformations stay inside the image, so the bounds of the
+     * preview don't change and it can be updated partially
+     */
+    worker.translatePoints(QPointF(100,100),
+                           QPointF(20, 0),
+                           50, false, 0.2);
+
+    QPointF offset;
+    QImage partialResult = worker.runOnQImage(thumbImage, QPointF(), imageToThumbTransform, &offset);
+
+    QRect changedRect;
+    worker.takeChangedRect(&changedRect);
+
+    worker.scalePoints(QPointF(200,150),
+                       0.8,
+                       50, false, 0.2);
+
+    QVERIFY(worker.takeChangedRect(&changedRect));
+    QVERIFY(!changedRect.isEmpty());
+
+    QVERIFY(worker.runOnQImagePartial(thumbImage, QPointF(), imageToThumbTransform,
+                                      changedRect, &partialResult, offset));
+
+    QPointF fullOffset;
+    QImage fullResult = worker.runOnQImage(thumbImage, QPointF(), imageToThumbTransform, &fullOffset);
+
+    QCOMPARE(fullOffset, offset);
+    QCOMPARE(fullResult.size(), partialResult.size());
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint, fullResult, partialResult, 1, 1)) {
+        partialResult.save("liquify_partial_qimage.png");
+        fullResult.save("liquify_full_qimage.png");
+        QFAIL(QString("Partial preview update differs from the full one at %1,%2")
+              .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
 QTEST_MAIN(KisLiquifyTransformWorkerTest)
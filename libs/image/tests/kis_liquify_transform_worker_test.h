@@ -28,6 +28,8 @@ private Q_SLOTS:
     void testPoints();
     void testPointsQImage();
     void testIdentityTransform();
+    void testPartialUpdate();
+    void testPartialUpdateQImage();
 };
 
 #endif /* __KIS_LIQUIFY_TRANSFORM_WORKER_TEST_H */
@@ -27,6 +27,11 @@
 
 #include "kis_perspectivetransform_worker.h"
 #include "kis_transaction.h"
+#include "KisMipmapSampler.h"
+#include "kis_sequential_iterator.h"
+#include "kis_random_sub_accessor.h"
+
+#include <KoColorSpaceRegistry.h>
 
 
 class PerspectiveWorkerTester : public TestUtil::QImageBasedTest
@@ -56,6 +61,24 @@ public:
 };
 
 
+/**
+ * Fills \p rc of \p dev with a checkerboard of one-pixel black and
+ * white cells, the worst case for aliasing
+ */
+void fillCheckerboard(KisPaintDeviceSP dev, const QRect &rc)
+{
+    const KoColorSpace *cs = dev->colorSpace();
+    dev->fill(rc, KoColor(Qt::black, cs));
+
+    const KoColor white(Qt::white, cs);
+    KisSequentialIterator it(dev, rc);
+    while (it.nextPixel()) {
+        if ((it.x() + it.y()) % 2) {
+            memcpy(it.rawData(), white.data(), cs->pixelSize());
+        }
+    }
+}
+
 void KisPerspectiveTransformWorkerTest::testSimpleTransform()
 {
     PerspectiveWorkerTester t;
@@ -72,4 +95,119 @@ void KisPerspectiveTransformWorkerTest::testSimpleTransform()
     t.checkLayer("simple_transform");
 }
 
+void KisPerspectiveTransformWorkerTest::testMipmapSampler()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect rc(0, 0, 64, 64);
+    fillCheckerboard(dev, rc);
+
+    QCOMPARE(KisMipmapSampler::levelsForFootprint(1.0, rc), 1);
+    QCOMPARE(KisMipmapSampler::levelsForFootprint(4.0, rc), 3);
+
+    KisMipmapSampler sampler(dev, rc, 3);
+    QCOMPARE(sampler.numLevels(), 3);
+
+    KisMipmapSampler::Accessor accessor(&sampler);
+    KoColor result(cs);
+
+    // level 0 is sampled exactly
+    accessor.sample(QPointF(11, 20), 0.0, result.data());
+    QCOMPARE(result.toQColor(), QColor(Qt::white));
+
+    accessor.sample(QPointF(10, 20), 0.0, result.data());
+    QCOMPARE(result.toQColor(), QColor(Qt::black));
+
+    // the minified levels average the checkerboard out
+    for (qreal lod = 1.0; lod <= 2.0; lod += 0.5) {
+        accessor.sample(QPointF(32.3, 17.6), lod, result.data());
+        QVERIFY(qAbs(result.toQColor().red() - 128) <= 1);
+        QCOMPARE(result.toQColor().alpha(), 255);
+    }
+}
+
+void KisPerspectiveTransformWorkerTest::testStrongMinificationIsNotAliased()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+
+    const QRect rc(0, 0, 256, 256);
+    fillCheckerboard(src, rc);
+
+    // every destination pixel covers about ten pixels of the source
+    const QTransform transform(0.1, 0.0, 0.0002,
+                               0.0, 0.1, 0.0002,
+                               0.0, 0.0, 1.0);
+
+    KisPerspectiveTransformWorker worker(0, transform, 0);
+    worker.runPartialDst(src, dst, transform.mapRect(QRectF(rc)).toAlignedRect());
+
+    /**
+     * Sampled from level 0 the checkerboard would alias into patches
+     * of black, white and gray, so every opaque pixel must be averaged
+     * into gray (the semi-transparent ones lie on the border)
+     */
+    int numOpaquePixels = 0;
+
+    KisSequentialConstIterator it(dst, dst->exactBounds());
+    while (it.nextPixel()) {
+        const QColor c = KoColor(it.rawDataConst(), cs).toQColor();
+        if (c.alpha() < 255) continue;
+
+        QVERIFY(qAbs(c.red() - 128) <= 2);
+        numOpaquePixels++;
+    }
+
+    QVERIFY(numOpaquePixels > 100);
+}
+
+void KisPerspectiveTransformWorkerTest::testMildMinificationIsSharp()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+    KisPaintDeviceSP ref = new KisPaintDevice(cs);
+
+    const QRect rc(0, 0, 128, 128);
+    fillCheckerboard(src, rc);
+
+    // a destination pixel covers 1.25 pixels of the source at most
+    QTransform transform;
+    transform.rotate(7);
+    transform.scale(0.8, 0.8);
+
+    const QRect dstRect = transform.mapRect(QRectF(rc)).toAlignedRect();
+
+    KisPerspectiveTransformWorker worker(0, transform, 0);
+    worker.runPartialDst(src, dst, dstRect);
+
+    // the reference is sampled bilinearly from the source itself
+    {
+        const QTransform backwardTransform = transform.inverted();
+        const QRectF srcClipRect = src->exactBounds();
+
+        KisRandomSubAccessorSP srcAcc = src->createRandomSubAccessor();
+        KisSequentialIterator it(ref, dstRect);
+
+        while (it.nextPixel()) {
+            const QPointF srcPoint = backwardTransform.map(QPointF(it.x(), it.y()));
+            if (!srcClipRect.contains(srcPoint)) continue;
+
+            srcAcc->moveTo(srcPoint);
+            srcAcc->sampledOldRawData(it.rawData());
+        }
+    }
+
+    const int numBytes = dstRect.width() * dstRect.height() * cs->pixelSize();
+    QVector<quint8> dstBytes(numBytes);
+    QVector<quint8> refBytes(numBytes);
+
+    dst->readBytes(dstBytes.data(), dstRect);
+    ref->readBytes(refBytes.data(), dstRect);
+
+    QVERIFY(dstBytes == refBytes);
+}
+
 QTEST_MAIN(KisPerspectiveTransformWorkerTest)
@@ -26,6 +26,9 @@ class KisPerspectiveTransformWorkerTest : public QObject
     Q_OBJECT
 private Q_SLOTS:
     void testSimpleTransform();
+    void testMipmapSampler();
+    void testStrongMinificationIsNotAliased();
+    void testMildMinificationIsSharp();
 };
 
 #endif /* __KIS_PERSPECTIVE_TRANSFORM_WORKER_TEST_H */
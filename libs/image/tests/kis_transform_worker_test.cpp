@@ -990,4 +990,61 @@ void KisTransformWorkerTest::testPartialProcessing()
     TestUtil::checkQImage(result, "transform_test", "partial", "single");
 }
 
+void KisTransformWorkerTest::testBandedVsSerialPasses()
+{
+    TestUtil::TestProgressBar bar;
+    KoProgressUpdater pu(&bar);
+    KoUpdaterPtr updater = pu.startSubtask();
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // random semi-transparent noise of an odd size at an odd position
+    QImage image(301, 187, QImage::Format_ARGB32);
+    qsrand(1);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgba(qrand() % 256, qrand() % 256, qrand() % 256, 128 + qrand() % 128));
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->convertFromQImage(image, 0, 37, 21);
+
+    /**
+     * Move the device by an offset that is not a multiple of the tile
+     * size, so that the boundaries of the bands are not multiples of 64
+     */
+    dev->moveTo(13, -7);
+
+    KisPaintDeviceSP serialDev = new KisPaintDevice(*dev);
+    KisPaintDeviceSP bandedDev = new KisPaintDevice(*dev);
+
+    KisFilterStrategy * filter = new KisBicubicFilterStrategy();
+
+    KisTransformWorker serialWorker(serialDev, 1.37, 0.83,
+                                    0.2, 0.1,
+                                    50., 40.,
+                                    0.3,
+                                    5, -3, updater, filter);
+    serialWorker.m_forceSerialPasses = true;
+    serialWorker.run();
+
+    KisTransformWorker bandedWorker(bandedDev, 1.37, 0.83,
+                                    0.2, 0.1,
+                                    50., 40.,
+                                    0.3,
+                                    5, -3, updater, filter);
+    bandedWorker.run();
+
+    QCOMPARE(bandedDev->exactBounds(), serialDev->exactBounds());
+
+    QPoint errpoint;
+    if (!TestUtil::comparePaintDevices(errpoint, serialDev, bandedDev)) {
+        QFAIL(QString("Banded transformation differs from the serial one at %1,%2")
+              .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+
+    delete filter;
+}
+
 QTEST_MAIN(KisTransformWorkerTest)
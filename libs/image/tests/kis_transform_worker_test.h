@@ -63,6 +63,7 @@ private Q_SLOTS:
     void benchmarkScaleRotateShear();
 
     void testPartialProcessing();
+    void testBandedVsSerialPasses();
 
 private:
     void generateTestImages();
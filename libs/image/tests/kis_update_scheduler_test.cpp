@@ -411,6 +411,32 @@ void KisUpdateSchedulerTest::testTimeMonitor()
     KisUpdateTimeMonitor::instance()->endStrokeMeasure();
 }
 
+void KisUpdateSchedulerTest::testUpdateLatencyMeasure()
+{
+    KisUpdateTimeMonitor *monitor = KisUpdateTimeMonitor::instance();
+
+    monitor->startLatencyMeasure();
+    QCOMPARE(monitor->averageUpdateLatency(), 0.0);
+
+    monitor->reportJobStarted((void*) 10);
+    monitor->reportJobStarted((void*) 20);
+    monitor->reportJobFinished((void*) 10, {QRect(10,10,10,10)});
+    QTest::qSleep(100);
+
+    // an update of some other area doesn't answer the job
+    monitor->reportUpdateFinished(QRect(30,30,10,10));
+    QCOMPARE(monitor->averageUpdateLatency(), 0.0);
+
+    // the job is answered only when all its rects are updated
+    monitor->reportUpdateFinished(QRect(10,10,5,10));
+    QCOMPARE(monitor->averageUpdateLatency(), 0.0);
+
+    monitor->reportUpdateFinished(QRect(15,10,5,10));
+    QVERIFY(monitor->averageUpdateLatency() >= 100.0);
+
+    monitor->endLatencyMeasure();
+}
+
 void KisUpdateSchedulerTest::testLodSync()
 {
     KisImageSP image = buildTestingImage();
@@ -31,6 +31,36 @@ template<typename _channels_type_,
          typename EnableDummyType = void>
 struct KoAlphaMaskApplicator : public KoAlphaMaskApplicatorBase
 {
+    void applyAlphaU8Mask(quint8 *pixels,
+                          const quint8 *alpha,
+                          qint32 nPixels) const override {
+        KoColorSpaceTrait<
+                _channels_type_,
+                _channels_nb_,
+                _alpha_pos_>::
+                applyAlphaU8Mask(pixels, alpha, nPixels);
+    }
+
+    void applyInverseAlphaU8Mask(quint8 *pixels,
+                                 const quint8 *alpha,
+                                 qint32 nPixels) const override {
+        KoColorSpaceTrait<
+                _channels_type_,
+                _channels_nb_,
+                _alpha_pos_>::
+                applyInverseAlphaU8Mask(pixels, alpha, nPixels);
+    }
+
+    void applyAlphaNormedFloatMask(quint8 *pixels,
+                                   const float *alpha,
+                                   qint32 nPixels) const override {
+        KoColorSpaceTrait<
+                _channels_type_,
+                _channels_nb_,
+                _alpha_pos_>::
+                applyAlphaNormedFloatMask(pixels, alpha, nPixels);
+    }
+
     void applyInverseNormedFloatMask(quint8 *pixels,
                                      const float *alpha,
                                      qint32 nPixels) const override {
@@ -77,6 +107,94 @@ struct KoAlphaMaskApplicator<
     static constexpr int numChannels = 4;
     static constexpr int alphaPos = 3;
 
+    static inline uint_v multiply(uint_v a, uint_v b)
+    {
+        const uint_v c = a * b + 0x80u;
+        return ((c >> 8) + c) >> 8;
+    }
+
+    template <bool inverse>
+    static inline void applyAlphaU8MaskImpl(quint8 *pixels,
+                                            const quint8 *alpha,
+                                            qint32 nPixels)
+    {
+        const int block1 = nPixels / Vc::float_v::size();
+        const int block2 = nPixels % Vc::float_v::size();
+        const int vectorPixelStride = numChannels * Vc::float_v::size();
+
+        const quint32 colorChannelsMask = 0x00FFFFFF;
+
+        for (int i = 0; i < block1; i++) {
+            uint_v maskAlpha_i(alpha, Vc::Unaligned);
+            if (inverse) {
+                maskAlpha_i = uint_v(0xFFu) - maskAlpha_i;
+            }
+
+            uint_v data_i;
+            data_i.load((const quint32*)pixels, Vc::Unaligned);
+
+            const uint_v pixelAlpha_i = multiply(data_i >> 24, maskAlpha_i);
+            data_i = (data_i & colorChannelsMask) | (pixelAlpha_i << 24);
+            data_i.store((quint32*)pixels, Vc::Unaligned);
+
+            pixels += vectorPixelStride;
+            alpha += Vc::float_v::size();
+        }
+
+        if (inverse) {
+            KoColorSpaceTrait<quint8, 4, 3>::
+                applyInverseAlphaU8Mask(pixels, alpha, block2);
+        } else {
+            KoColorSpaceTrait<quint8, 4, 3>::
+                applyAlphaU8Mask(pixels, alpha, block2);
+        }
+    }
+
+    void applyAlphaU8Mask(quint8 *pixels,
+                          const quint8 *alpha,
+                          qint32 nPixels) const override
+    {
+        applyAlphaU8MaskImpl<false>(pixels, alpha, nPixels);
+    }
+
+    void applyInverseAlphaU8Mask(quint8 *pixels,
+                                 const quint8 *alpha,
+                                 qint32 nPixels) const override
+    {
+        applyAlphaU8MaskImpl<true>(pixels, alpha, nPixels);
+    }
+
+    void applyAlphaNormedFloatMask(quint8 *pixels,
+                                   const float *alpha,
+                                   qint32 nPixels) const override
+    {
+        const int block1 = nPixels / Vc::float_v::size();
+        const int block2 = nPixels % Vc::float_v::size();
+        const int vectorPixelStride = numChannels * Vc::float_v::size();
+
+        const quint32 colorChannelsMask = 0x00FFFFFF;
+
+        for (int i = 0; i < block1; i++) {
+            Vc::float_v maskAlpha(alpha, Vc::Unaligned);
+
+            // the scalar version truncates the scaled mask value, so do we
+            const uint_v maskAlpha_i = uint_v(int_v(maskAlpha * Vc::float_v(255.0f)));
+
+            uint_v data_i;
+            data_i.load((const quint32*)pixels, Vc::Unaligned);
+
+            const uint_v pixelAlpha_i = multiply(data_i >> 24, maskAlpha_i);
+            data_i = (data_i & colorChannelsMask) | (pixelAlpha_i << 24);
+            data_i.store((quint32*)pixels, Vc::Unaligned);
+
+            pixels += vectorPixelStride;
+            alpha += Vc::float_v::size();
+        }
+
+        KoColorSpaceTrait<quint8, 4, 3>::
+            applyAlphaNormedFloatMask(pixels, alpha, block2);
+    }
+
     void applyInverseNormedFloatMask(quint8 *pixels,
                                      const float *alpha,
                                      qint32 nPixels) const override
@@ -133,12 +251,6 @@ struct KoAlphaMaskApplicator<
             fillInverseAlphaNormedFloatMaskWithColor(pixels, alpha, brushColor, block2);
     }
 
-    static inline uint_v multiply(uint_v a, uint_v b)
-    {
-        const uint_v c = a * b + 0x80u;
-        return ((c >> 8) + c) >> 8;
-    }
-
     void fillGrayBrushWithColor(quint8 *dst, const QRgb *brush, quint8 *brushColor, qint32 nPixels) const override {
         const int block1 = nPixels / Vc::float_v::size();
         const int block2 = nPixels % Vc::float_v::size();
@@ -30,6 +30,10 @@ public:
     typedef int ParamType;
     typedef KoAlphaMaskApplicatorBase* ReturnType;
 
+    static const char* kernelName() {
+        return "Alpha mask applicators";
+    }
+
     template<Vc::Implementation _impl>
     static KoAlphaMaskApplicatorBase* create(int);
 };
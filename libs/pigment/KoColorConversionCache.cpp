@@ -19,13 +19,23 @@
 
 #include "KoColorConversionCache.h"
 
-#include <QHash>
+#include <QAtomicInt>
 #include <QList>
+#include <QMultiHash>
 #include <QMutex>
+#include <QMutexLocker>
 #include <QThreadStorage>
+#include <QWeakPointer>
 
 #include <KoColorSpace.h>
 
+/**
+ * The key compares the color spaces by their pointers only, so looking
+ * up a transformation never touches a color space that might be being
+ * destroyed in another thread. The entries are removed from all the
+ * pools right when the color space is destroyed, so a pointer reused by
+ * a new color space can never match a stale entry.
+ */
 struct KoColorConversionCacheKey {
 
     KoColorConversionCacheKey(const KoColorSpace* _src,
@@ -40,7 +50,7 @@ struct KoColorConversionCacheKey {
     }
 
     bool operator==(const KoColorConversionCacheKey& rhs) const {
-        return (*src == *(rhs.src)) && (*dst == *(rhs.dst))
+        return src == rhs.src && dst == rhs.dst
                 && (renderingIntent == rhs.renderingIntent)
                 && (conversionFlags == rhs.conversionFlags);
     }
@@ -66,23 +76,73 @@ struct KoColorConversionCache::CachedTransformation {
         delete transfo;
     }
 
-    bool available() {
-        return use == 0;
+    /**
+     * The usage counter is atomic only because a cached transformation
+     * can be returned from a thread different from the one that owns the
+     * pool (e.g. KoFallBackColorTransformation keeps its converters for
+     * its whole lifetime). It is never contended in practice.
+     */
+    bool available() const {
+        return use.loadAcquire() == 0;
     }
 
     KoColorConversionTransformation* transfo;
-    int use;
+    QAtomicInt use;
 };
 
-typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
+/**
+ * A pool of transformations owned by a single thread. Its mutex is
+ * locked by the owner thread on every lookup and by the thread that
+ * destroys a color space, so it is contended only in the latter case.
+ */
+struct KoColorConversionCache::ThreadLocalCache {
+    ~ThreadLocalCache() {
+        qDeleteAll(cache);
+    }
 
-struct KoColorConversionCache::Private {
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
-    QMutex cacheMutex;
+    QMutex mutex;
+    QMultiHash<KoColorConversionCacheKey, CachedTransformation*> cache;
+};
 
-    QThreadStorage<FastPathCacheItem*> fastStorage;
+struct KoColorConversionCache::Private {
+    QThreadStorage<ThreadLocalCacheSP> threadCaches;
+
+    /**
+     * All the pools ever created, so that the entries referring to a
+     * destroyed color space could be removed from them. The pools of
+     * the finished threads expire as soon as their transformations
+     * are returned.
+     */
+    QMutex poolsMutex;
+    QList<QWeakPointer<ThreadLocalCache>> pools;
+
+    ThreadLocalCacheSP localPool();
 };
 
+KoColorConversionCache::ThreadLocalCacheSP KoColorConversionCache::Private::localPool()
+{
+    ThreadLocalCacheSP &threadCache = threadCaches.localData();
+
+    if (!threadCache) {
+        threadCache.reset(new ThreadLocalCache());
+
+        QMutexLocker l(&poolsMutex);
+
+        // drop the pools of the threads that have already finished
+        for (auto it = pools.begin(); it != pools.end();) {
+            if (it->isNull()) {
+                it = pools.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        pools.append(threadCache.toWeakRef());
+    }
+
+    return threadCache;
+}
+
 
 KoColorConversionCache::KoColorConversionCache() : d(new Private)
 {
@@ -90,9 +150,6 @@ KoColorConversionCache::KoColorConversionCache() : d(new Private)
 
 KoColorConversionCache::~KoColorConversionCache()
 {
-    Q_FOREACH (CachedTransformation* transfo, d->cache) {
-        delete transfo;
-    }
     delete d;
 }
 
@@ -101,90 +158,120 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
                                                                               KoColorConversionTransformation::Intent _renderingIntent,
                                                                               KoColorConversionTransformation::ConversionFlags _conversionFlags)
 {
+    ThreadLocalCacheSP threadCache = d->localPool();
+
     KoColorConversionCacheKey key(src, dst, _renderingIntent, _conversionFlags);
 
-    FastPathCacheItem *cacheItem =
-        d->fastStorage.localData();
+    typedef QMultiHash<KoColorConversionCacheKey, CachedTransformation*>::iterator Iterator;
 
-    if (cacheItem) {
-        if (cacheItem->first == key) {
-            return cacheItem->second;
-        }
-    }
+    {
+        QMutexLocker l(&threadCache->mutex);
 
-    cacheItem = 0;
+        Iterator it = threadCache->cache.find(key);
+        while (it != threadCache->cache.end() && it.key() == key) {
+            CachedTransformation *ct = it.value();
 
-    QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
-        Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
             if (ct->available()) {
-                ct->transfo->setSrcColorSpace(src);
-                ct->transfo->setDstColorSpace(dst);
-
-                cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
-                break;
+                return KoCachedColorConversionTransformation(threadCache, ct);
             }
+            ++it;
         }
     }
-    if (!cacheItem) {
-        KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
-        CachedTransformation* ct = new CachedTransformation(transfo);
-        d->cache.insert(key, ct);
-        cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
-    }
 
-    d->fastStorage.setLocalData(cacheItem);
-    return cacheItem->second;
+    /**
+     * Creation of a converter may create (or destroy) color spaces, so
+     * it should happen without holding the lock of the pool
+     */
+    KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
+    CachedTransformation* ct = new CachedTransformation(transfo);
+
+    QMutexLocker l(&threadCache->mutex);
+    threadCache->cache.insert(key, ct);
+
+    return KoCachedColorConversionTransformation(threadCache, ct);
 }
 
 void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
 {
-    d->fastStorage.setLocalData(0);
-
-    QMutexLocker lock(&d->cacheMutex);
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
-    for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
-        if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
-            delete it.value();
-            it = d->cache.erase(it);
-        } else {
-            ++it;
+    typedef QMultiHash<KoColorConversionCacheKey, CachedTransformation*>::iterator Iterator;
+
+    /**
+     * Destruction of a transformation (or of the last reference to a
+     * pool) may destroy other color spaces and get back here, so the
+     * dead entries are only collected under the locks and deleted
+     * after they are released.
+     */
+    QList<CachedTransformation*> deadTransformations;
+    QList<ThreadLocalCacheSP> lockedPools;
+
+    {
+        QMutexLocker poolsLocker(&d->poolsMutex);
+
+        for (auto poolIt = d->pools.begin(); poolIt != d->pools.end();) {
+            ThreadLocalCacheSP pool = poolIt->toStrongRef();
+
+            if (!pool) {
+                poolIt = d->pools.erase(poolIt);
+                continue;
+            }
+
+            QMutexLocker l(&pool->mutex);
+
+            for (Iterator it = pool->cache.begin(); it != pool->cache.end();) {
+                if (it.key().src == cs || it.key().dst == cs) {
+                    Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
+                    deadTransformations.append(it.value());
+                    it = pool->cache.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            lockedPools.append(pool);
+            ++poolIt;
         }
     }
+
+    qDeleteAll(deadTransformations);
+    lockedPools.clear();
 }
 
 //--------- KoCachedColorConversionTransformation ----------//
 
-struct KoCachedColorConversionTransformation::Private {
-    KoColorConversionCache* cache;
-    KoColorConversionCache::CachedTransformation* transfo;
-};
-
+KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoColorConversionCache::ThreadLocalCacheSP cache, KoColorConversionCache::CachedTransformation* transfo)
+    : m_cache(cache),
+      m_transfo(transfo)
+{
+    Q_ASSERT(m_transfo->available());
+    m_transfo->use.ref();
+}
 
-KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoColorConversionCache* cache, KoColorConversionCache::CachedTransformation* transfo) : d(new Private)
+KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs)
+    : m_cache(rhs.m_cache),
+      m_transfo(rhs.m_transfo)
 {
-    Q_ASSERT(transfo->available());
-    d->cache = cache;
-    d->transfo = transfo;
-    d->transfo->use++;
+    m_transfo->use.ref();
 }
 
-KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
+KoCachedColorConversionTransformation& KoCachedColorConversionTransformation::operator=(const KoCachedColorConversionTransformation& rhs)
 {
-    d->transfo->use++;
+    if (this != &rhs) {
+        rhs.m_transfo->use.ref();
+        m_transfo->use.deref();
+
+        m_transfo = rhs.m_transfo;
+        m_cache = rhs.m_cache;
+    }
+    return *this;
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
-    delete d;
+    m_transfo->use.deref();
+    Q_ASSERT(m_transfo->use.loadAcquire() >= 0);
 }
 
 const KoColorConversionTransformation* KoCachedColorConversionTransformation::transformation() const
 {
-    return d->transfo->transfo;
+    return m_transfo->transfo;
 }
-
@@ -23,17 +23,27 @@
 class KoCachedColorConversionTransformation;
 class KoColorSpace;
 
+#include <QSharedPointer>
 #include "KoColorConversionTransformation.h"
 
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
+ * Every thread owns its own pool of cached transformations, so fetching
+ * a converter takes only the uncontended lock of the thread's pool, even
+ * when many threads convert tiles at the same time. The transformations
+ * are keyed by the pointers of the color spaces. When a color space is
+ * destroyed, the transformations referring to it are removed from the
+ * pools of all the threads.
+ *
  * This class is not part of public API, and can be changed without notice.
  */
 class KoColorConversionCache
 {
 public:
     struct CachedTransformation;
+    struct ThreadLocalCache;
+    typedef QSharedPointer<ThreadLocalCache> ThreadLocalCacheSP;
 public:
     KoColorConversionCache();
     ~KoColorConversionCache();
@@ -68,22 +78,26 @@ private:
  * by the cache and when it's deleted it return the transformation to
  * the pool of available color conversion transformation.
  *
+ * The object may outlive the thread that created it: it keeps the
+ * thread-local pool alive until the transformation is returned.
+ *
  * This class is not part of public API, and can be changed without notice.
  */
 class KoCachedColorConversionTransformation
 {
     friend class KoColorConversionCache;
 private:
-    KoCachedColorConversionTransformation(KoColorConversionCache* cache,
+    KoCachedColorConversionTransformation(KoColorConversionCache::ThreadLocalCacheSP cache,
                                           KoColorConversionCache::CachedTransformation* transfo);
 public:
     KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation&);
+    KoCachedColorConversionTransformation& operator=(const KoCachedColorConversionTransformation&);
     ~KoCachedColorConversionTransformation();
 public:
     const KoColorConversionTransformation* transformation() const;
 private:
-    struct Private;
-    Private* const d;
+    KoColorConversionCache::ThreadLocalCacheSP m_cache;
+    KoColorConversionCache::CachedTransformation* m_transfo;
 };
 
 
@@ -336,6 +336,36 @@ KoConvolutionOp* KoColorSpace::convolutionOp() const
     return d->convolutionOp;
 }
 
+void KoColorSpace::differenceSpan(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const
+{
+    const quint32 pixelSize = this->pixelSize();
+
+    for (qint32 i = 0; i < nPixels; i++) {
+        differences[i] = difference(src1, src2);
+        src2 += pixelSize;
+    }
+}
+
+void KoColorSpace::differenceASpan(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const
+{
+    const quint32 pixelSize = this->pixelSize();
+
+    for (qint32 i = 0; i < nPixels; i++) {
+        differences[i] = differenceA(src1, src2);
+        src2 += pixelSize;
+    }
+}
+
+void KoColorSpace::intensity8Span(const quint8 *src, quint8 *intensities, qint32 nPixels) const
+{
+    const quint32 pixelSize = this->pixelSize();
+
+    for (qint32 i = 0; i < nPixels; i++) {
+        intensities[i] = intensity8(src);
+        src += pixelSize;
+    }
+}
+
 const KoCompositeOp * KoColorSpace::compositeOp(const QString & id) const
 {
     const QHash<QString, KoCompositeOp*>::ConstIterator it = d->compositeOps.constFind(id);
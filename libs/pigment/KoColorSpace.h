@@ -566,6 +566,19 @@ public:
      */
     virtual quint8 differenceA(const quint8* src1, const quint8* src2) const = 0;
 
+    /**
+     * Calculates difference() between the reference pixel \p src1 and each
+     * of \p nPixels pixels in \p src2, writing the results into \p differences.
+     * The default implementation calls difference() for every pixel; color
+     * spaces are encouraged to reimplement it with a bulk conversion.
+     */
+    virtual void differenceSpan(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const;
+
+    /**
+     * The same as differenceSpan(), but uses differenceA() semantics
+     */
+    virtual void differenceASpan(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const;
+
     /**
      * @return the mix color operation of this colorspace (do not delete it locally, it's deleted by the colorspace).
      */
@@ -581,6 +594,12 @@ public:
      */
     virtual quint8 intensity8(const quint8 * src) const = 0;
 
+    /**
+     * Calculates intensity8() of \p nPixels pixels in \p src and writes
+     * the results into \p intensities
+     */
+    virtual void intensity8Span(const quint8 *src, quint8 *intensities, qint32 nPixels) const;
+
     /*
      *increase luminosity by step
      */
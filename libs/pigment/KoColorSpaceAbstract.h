@@ -126,15 +126,15 @@ public:
     }
 
     void applyAlphaU8Mask(quint8 * pixels, const quint8 * alpha, qint32 nPixels) const override {
-        _CSTrait::applyAlphaU8Mask(pixels, alpha, nPixels);
+        m_alphaMaskApplicator->applyAlphaU8Mask(pixels, alpha, nPixels);
     }
 
     void applyInverseAlphaU8Mask(quint8 * pixels, const quint8 * alpha, qint32 nPixels) const override {
-        _CSTrait::applyInverseAlphaU8Mask(pixels, alpha, nPixels);
+        m_alphaMaskApplicator->applyInverseAlphaU8Mask(pixels, alpha, nPixels);
     }
 
     void applyAlphaNormedFloatMask(quint8 * pixels, const float * alpha, qint32 nPixels) const override {
-        _CSTrait::applyAlphaNormedFloatMask(pixels, alpha, nPixels);
+        m_alphaMaskApplicator->applyAlphaNormedFloatMask(pixels, alpha, nPixels);
     }
 
     void applyInverseNormedFloatMask(quint8 * pixels, const float * alpha, qint32 nPixels) const override {
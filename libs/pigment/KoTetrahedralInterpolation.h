@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOTETRAHEDRALINTERPOLATION_H
+#define KOTETRAHEDRALINTERPOLATION_H
+
+#include <QtGlobal>
+
+/**
+ * Tetrahedral interpolation in a 3D lookup table with 16-bit nodes,
+ * the same scheme LCMS uses for its optimized 8/16-bit pipelines.
+ *
+ * The table consists of gridPoints^3 nodes of numOutputs channels each,
+ * the first input coordinate being the slowest changing one. Node i of
+ * every axis corresponds to the input value i * 65535 / (gridPoints - 1).
+ */
+namespace KoTetrahedralInterpolation
+{
+
+/**
+ * Splits a 16-bit input value into the index of the grid cell
+ * and the 16.16 fixed-point position inside it. The mapping is
+ * the same as _cmsToFixedDomain() in LCMS.
+ */
+template <int gridPoints>
+inline void toGridCell(quint16 value, int *cell, qint32 *rest)
+{
+    const quint32 scaled = quint32(value) * (gridPoints - 1);
+    const quint32 fixed = scaled + ((scaled + 0x7fff) / 0xffff);
+    *cell = fixed >> 16;
+    *rest = fixed & 0xffff;
+}
+
+/**
+ * Interpolates \p table at the point (\p x, \p y, \p z) and writes
+ * \p numOutputs 16-bit channels into \p result
+ */
+template <int gridPoints, int numOutputs>
+inline void interpolate(const quint16 *table, quint16 x, quint16 y, quint16 z, quint16 *result)
+{
+    const int strideZ = numOutputs;
+    const int strideY = strideZ * gridPoints;
+    const int strideX = strideY * gridPoints;
+    const int lastCell = gridPoints - 1;
+
+    int x0, y0, z0;
+    qint32 rx, ry, rz;
+
+    toGridCell<gridPoints>(x, &x0, &rx);
+    toGridCell<gridPoints>(y, &y0, &ry);
+    toGridCell<gridPoints>(z, &z0, &rz);
+
+    const int dx = x0 == lastCell ? 0 : strideX;
+    const int dy = y0 == lastCell ? 0 : strideY;
+    const int dz = z0 == lastCell ? 0 : strideZ;
+
+    /**
+     * Walk from the base corner of the cell to the opposite one along
+     * the axes in the order of decreasing fractional parts. The three
+     * visited edges define the tetrahedron containing the sample.
+     */
+    int o1, o2;
+    qint32 r1, r2, r3;
+
+    if (rx >= ry) {
+        if (ry >= rz) {
+            o1 = dx; o2 = dx + dy; r1 = rx; r2 = ry; r3 = rz;
+        } else if (rx >= rz) {
+            o1 = dx; o2 = dx + dz; r1 = rx; r2 = rz; r3 = ry;
+        } else {
+            o1 = dz; o2 = dz + dx; r1 = rz; r2 = rx; r3 = ry;
+        }
+    } else {
+        if (rx >= rz) {
+            o1 = dy; o2 = dy + dx; r1 = ry; r2 = rx; r3 = rz;
+        } else if (ry >= rz) {
+            o1 = dy; o2 = dy + dz; r1 = ry; r2 = rz; r3 = rx;
+        } else {
+            o1 = dz; o2 = dz + dy; r1 = rz; r2 = ry; r3 = rx;
+        }
+    }
+
+    const int o3 = dx + dy + dz;
+    const quint16 *c0 = table + x0 * strideX + y0 * strideY + z0 * strideZ;
+
+    for (int ch = 0; ch < numOutputs; ch++) {
+        const qint64 v0 = c0[ch];
+        const qint64 v1 = c0[o1 + ch];
+        const qint64 v2 = c0[o2 + ch];
+        const qint64 v3 = c0[o3 + ch];
+
+        const qint64 rest = (v1 - v0) * r1 + (v2 - v1) * r2 + (v3 - v2) * r3 + 0x8001;
+        const qint64 value = v0 + ((rest + (rest >> 16)) >> 16);
+
+        result[ch] = quint16(qBound(qint64(0), value, qint64(0xffff)));
+    }
+}
+
+}
+
+#endif // KOTETRAHEDRALINTERPOLATION_H
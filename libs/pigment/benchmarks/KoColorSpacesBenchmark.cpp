@@ -19,8 +19,11 @@
 #include "KoColorSpacesBenchmark.h"
 
 #include <QTest>
+#include <QRunnable>
+#include <QThreadPool>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
+#include <KoColorModelStandardIds.h>
 
 #define NB_PIXELS 1000000
 
@@ -146,4 +149,121 @@ void KoColorSpacesBenchmark::benchmarkSetAlpha2IndividualCall()
     END_BENCHMARK
 }
 
+void KoColorSpacesBenchmark::benchmarkConversionSpans_data()
+{
+    QTest::addColumn<QString>("dstModelID");
+    QTest::addColumn<QString>("dstDepthID");
+    QTest::addColumn<int>("spanLength");
+
+    /**
+     * The ICC engine converts these pairs through a precomputed 3D lut,
+     * whose advantage over cmsDoTransform() is the biggest on short spans
+     */
+    QList<int> spanLengths;
+    spanLengths << 1 << 8 << 64 << 1024;
+
+    Q_FOREACH (int spanLength, spanLengths) {
+        QTest::newRow(QString("rgb8-rgb16-%1").arg(spanLength).toLatin1().data())
+            << RGBAColorModelID.id() << Integer16BitsColorDepthID.id() << spanLength;
+        QTest::newRow(QString("rgb8-cmyk8-%1").arg(spanLength).toLatin1().data())
+            << CMYKAColorModelID.id() << Integer8BitsColorDepthID.id() << spanLength;
+    }
+}
+
+void KoColorSpacesBenchmark::benchmarkConversionSpans()
+{
+    QFETCH(QString, dstModelID);
+    QFETCH(QString, dstDepthID);
+    QFETCH(int, spanLength);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->colorSpace(dstModelID, dstDepthID, 0);
+    QVERIFY(dstCs);
+
+    const int numPixels = NB_PIXELS / 10;
+    const int numSpans = numPixels / spanLength;
+
+    quint8 *src = new quint8[numPixels * srcCs->pixelSize()];
+    quint8 *dst = new quint8[numPixels * dstCs->pixelSize()];
+
+    for (int i = 0; i < numPixels * int(srcCs->pixelSize()); i++) {
+        src[i] = quint8(i * 7);
+    }
+
+    QBENCHMARK {
+        for (int i = 0; i < numSpans; i++) {
+            srcCs->convertPixelsTo(src + i * spanLength * srcCs->pixelSize(),
+                                   dst + i * spanLength * dstCs->pixelSize(),
+                                   dstCs, spanLength,
+                                   KoColorConversionTransformation::internalRenderingIntent(),
+                                   KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+
+    delete[] src;
+    delete[] dst;
+}
+
+namespace {
+
+/**
+ * Converts a set of 64x64 tiles row by row, the same way the projection
+ * threads and the OpenGL texture uploader do. Every row fetches the
+ * converter from KoColorConversionCache, so the test measures how well
+ * the cache scales with the number of threads.
+ */
+class TileConversionJob : public QRunnable
+{
+public:
+    TileConversionJob(const KoColorSpace *srcCs, const KoColorSpace *dstCs, int numTiles)
+        : m_srcCs(srcCs),
+          m_dstCs(dstCs),
+          m_numTiles(numTiles)
+    {
+    }
+
+    void run() override {
+        const int tileSize = 64;
+
+        QVector<quint8> src(tileSize * tileSize * m_srcCs->pixelSize(), 0x80);
+        QVector<quint8> dst(tileSize * tileSize * m_dstCs->pixelSize());
+
+        for (int i = 0; i < m_numTiles; i++) {
+            for (int row = 0; row < tileSize; row++) {
+                m_srcCs->convertPixelsTo(src.constData() + row * tileSize * m_srcCs->pixelSize(),
+                                         dst.data() + row * tileSize * m_dstCs->pixelSize(),
+                                         m_dstCs, tileSize,
+                                         KoColorConversionTransformation::internalRenderingIntent(),
+                                         KoColorConversionTransformation::internalConversionFlags());
+            }
+        }
+    }
+
+private:
+    const KoColorSpace *m_srcCs;
+    const KoColorSpace *m_dstCs;
+    int m_numTiles;
+};
+
+}
+
+void KoColorSpacesBenchmark::benchmarkConcurrentTileConversion()
+{
+    const int numThreads = 32;
+    const int numTilesPerThread = 64;
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb16();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK {
+        for (int i = 0; i < numThreads; i++) {
+            pool.start(new TileConversionJob(srcCs, dstCs, numTilesPerThread));
+        }
+        pool.waitForDone();
+    }
+}
+
 QTEST_MAIN(KoColorSpacesBenchmark)
@@ -39,6 +39,9 @@ private Q_SLOTS:
     void benchmarkSetAlphaIndividualCall();
     void benchmarkSetAlpha2IndividualCall_data();
     void benchmarkSetAlpha2IndividualCall();
+    void benchmarkConversionSpans_data();
+    void benchmarkConversionSpans();
+    void benchmarkConcurrentTileConversion();
 };
 
 #endif
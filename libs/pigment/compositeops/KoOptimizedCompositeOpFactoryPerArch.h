@@ -52,6 +52,10 @@ struct KoOptimizedCompositeOpFactoryPerArch
     typedef const KoColorSpace* ParamType;
     typedef KoCompositeOp* ReturnType;
 
+    static const char* kernelName() {
+        return "Optimized composite ops";
+    }
+
     template<Vc::Implementation _impl>
     static ReturnType create(ParamType param);
 };
@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoVcMultiArchBuildSupport.h" // vc.h must come first
+
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <ksharedconfig.h>
+#include <kconfig.h>
+#include <kconfiggroup.h>
+
+namespace {
+
+struct DispatchConfig
+{
+    DispatchConfig() {
+        KConfigGroup cfg = KSharedConfig::openConfig()->group("");
+        useVectorization = !cfg.readEntry("amdDisableVectorWorkaround", false);
+        disableAVXOptimizations = cfg.readEntry("disableAVXOptimizations", false);
+
+        implementation = Vc::ScalarImpl;
+
+        if (!useVectorization) {
+            qWarning() << "WARNING: vector instructions disabled by \'amdDisableVectorWorkaround\' option!";
+            return;
+        }
+
+#ifdef HAVE_VC
+        if (disableAVXOptimizations &&
+            (Vc::isImplementationSupported(Vc::AVXImpl) ||
+             Vc::isImplementationSupported(Vc::AVX2Impl))) {
+
+            qWarning() << "WARNING: AVX and AVX2 optimizations are disabled by \'disableAVXOptimizations\' option!";
+        }
+
+        if (!disableAVXOptimizations && Vc::isImplementationSupported(Vc::AVX2Impl)) {
+            implementation = Vc::AVX2Impl;
+        } else if (!disableAVXOptimizations && Vc::isImplementationSupported(Vc::AVXImpl)) {
+            implementation = Vc::AVXImpl;
+        } else if (Vc::isImplementationSupported(Vc::SSE41Impl)) {
+            implementation = Vc::SSE41Impl;
+        } else if (Vc::isImplementationSupported(Vc::SSSE3Impl)) {
+            implementation = Vc::SSSE3Impl;
+        } else if (Vc::isImplementationSupported(Vc::SSE2Impl)) {
+            implementation = Vc::SSE2Impl;
+        }
+#endif
+    }
+
+    bool useVectorization;
+    bool disableAVXOptimizations;
+    Vc::Implementation implementation;
+};
+
+const DispatchConfig& dispatchConfig()
+{
+    static const DispatchConfig config;
+    return config;
+}
+
+struct KernelRegistry
+{
+    QMutex mutex;
+    QMap<QString, QMap<int, int>> kernels;
+};
+
+Q_GLOBAL_STATIC(KernelRegistry, s_kernelRegistry)
+
+/**
+ * Vc 1.x has no AVX-512 implementation, so the AVX-512 capable CPUs run
+ * the AVX2 flavor of the kernels. We still report the presence of the
+ * instruction set, so that it would be visible in the bug reports.
+ */
+bool cpuSupportsAvx512()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+}
+
+namespace KoVcMultiArch
+{
+
+Vc::Implementation selectedImplementation()
+{
+    return dispatchConfig().implementation;
+}
+
+QString implementationName(Vc::Implementation impl)
+{
+    switch (impl) {
+    case Vc::ScalarImpl:
+        return "Scalar";
+#ifdef HAVE_VC
+    case Vc::SSE2Impl:
+        return "SSE2";
+    case Vc::SSE3Impl:
+        return "SSE3";
+    case Vc::SSSE3Impl:
+        return "SSSE3";
+    case Vc::SSE41Impl:
+        return "SSE4.1";
+    case Vc::SSE42Impl:
+        return "SSE4.2";
+    case Vc::AVXImpl:
+        return "AVX";
+    case Vc::AVX2Impl:
+        return "AVX2";
+#endif
+    default:
+        break;
+    }
+
+    return QString("Unknown (%1)").arg(int(impl));
+}
+
+void registerKernel(const char *kernelName, Vc::Implementation impl)
+{
+    QMutexLocker l(&s_kernelRegistry->mutex);
+    s_kernelRegistry->kernels[QString::fromLatin1(kernelName)][int(impl)]++;
+}
+
+QString dispatchReport()
+{
+    const DispatchConfig &config = dispatchConfig();
+
+    QString report;
+
+    // NOTE: This is intentionally not translated!
+
+    report.append("SIMD Dispatch\n");
+
+#ifdef HAVE_VC
+    QStringList supported;
+
+    const Vc::Implementation allImplementations[] = {
+        Vc::SSE2Impl, Vc::SSE3Impl, Vc::SSSE3Impl, Vc::SSE41Impl,
+        Vc::SSE42Impl, Vc::AVXImpl, Vc::AVX2Impl
+    };
+
+    for (Vc::Implementation impl : allImplementations) {
+        if (Vc::isImplementationSupported(impl)) {
+            supported << implementationName(impl);
+        }
+    }
+
+    report.append("\n  Built with Vc: true");
+    report.append("\n  Supported by CPU: ").append(supported.isEmpty() ? QString("none") : supported.join(", "));
+#else
+    report.append("\n  Built with Vc: false");
+#endif
+
+    report.append("\n  AVX-512F: ").append(cpuSupportsAvx512() ? "present (not used, no Vc implementation)" : "absent");
+    report.append("\n  amdDisableVectorWorkaround: ").append(!config.useVectorization ? "true" : "false");
+    report.append("\n  disableAVXOptimizations: ").append(config.disableAVXOptimizations ? "true" : "false");
+    report.append("\n  Selected: ").append(implementationName(config.implementation));
+
+    QMutexLocker l(&s_kernelRegistry->mutex);
+
+    for (auto it = s_kernelRegistry->kernels.constBegin(); it != s_kernelRegistry->kernels.constEnd(); ++it) {
+        QStringList instances;
+
+        for (auto implIt = it->constBegin(); implIt != it->constEnd(); ++implIt) {
+            instances << QString("%1 (%2 instances)")
+                .arg(implementationName(Vc::Implementation(implIt.key())))
+                .arg(implIt.value());
+        }
+
+        report.append("\n  ").append(it.key()).append(": ").append(instances.join(", "));
+    }
+
+    report.append("\n\n");
+
+    return report;
+}
+
+}
@@ -62,61 +62,80 @@ namespace Vc {
 
 
 #include <QDebug>
-#include <ksharedconfig.h>
-#include <kconfig.h>
-#include <kconfiggroup.h>
+#include <QString>
+#include "kritapigment_export.h"
 
-template<class FactoryType>
-typename FactoryType::ReturnType
-createOptimizedClass(typename FactoryType::ParamType param)
+/**
+ * Run-time selection of the per-arch kernels and its diagnostics.
+ *
+ * The implementation is selected only once per process (it depends on
+ * the CPU and on the user's configuration only) and every factory
+ * that asks createOptimizedClass() for an object registers the choice
+ * under its kernelName(). The collected data can be fetched with
+ * dispatchReport() and is written into the system information log.
+ */
+namespace KoVcMultiArch
 {
-    static bool isConfigInitialized = false;
-    static bool useVectorization = true;
-    static bool disableAVXOptimizations = false;
-
-    if (!isConfigInitialized) {
-        KConfigGroup cfg = KSharedConfig::openConfig()->group("");
-        useVectorization = !cfg.readEntry("amdDisableVectorWorkaround", false);
-        disableAVXOptimizations = cfg.readEntry("disableAVXOptimizations", false);
-        isConfigInitialized = true;
-    }
 
-    if (!useVectorization) {
-        qWarning() << "WARNING: vector instructions disabled by \'amdDisableVectorWorkaround\' option!";
-        return FactoryType::template create<Vc::ScalarImpl>(param);
-    }
+/**
+ * @return the best implementation supported by the CPU and allowed by the
+ *         'amdDisableVectorWorkaround' and 'disableAVXOptimizations' options
+ */
+KRITAPIGMENT_EXPORT Vc::Implementation selectedImplementation();
 
-#ifdef HAVE_VC
-    if (disableAVXOptimizations &&
-        (Vc::isImplementationSupported(Vc::AVXImpl) ||
-         Vc::isImplementationSupported(Vc::AVX2Impl))) {
+KRITAPIGMENT_EXPORT QString implementationName(Vc::Implementation impl);
 
-        qWarning() << "WARNING: AVX and AVX2 optimizations are disabled by \'disableAVXOptimizations\' option!";
-    }
+/**
+ * Records that \p kernelName has been instantiated for \p impl. Called
+ * by createOptimizedClass() automatically.
+ */
+KRITAPIGMENT_EXPORT void registerKernel(const char *kernelName, Vc::Implementation impl);
+
+/**
+ * @return human-readable (and intentionally not translated) description
+ *         of the SIMD capabilities of the CPU and of the implementations
+ *         the registered kernels are running with
+ */
+KRITAPIGMENT_EXPORT QString dispatchReport();
 
+}
+
+template<class FactoryType, Vc::Implementation _impl>
+inline typename FactoryType::ReturnType
+createOptimizedClassForImplementation(typename FactoryType::ParamType param)
+{
+    KoVcMultiArch::registerKernel(FactoryType::kernelName(), _impl);
+    return FactoryType::template create<_impl>(param);
+}
+
+template<class FactoryType>
+typename FactoryType::ReturnType
+createOptimizedClass(typename FactoryType::ParamType param)
+{
+#ifdef HAVE_VC
     /**
      * We use SSE2, SSSE3, SSE4.1, AVX and AVX2.
      * The rest are integer and string instructions mostly.
      *
      * TODO: Add FMA3/4 when it is adopted by Vc
      */
-    if (!disableAVXOptimizations && Vc::isImplementationSupported(Vc::AVX2Impl)) {
-        return FactoryType::template create<Vc::AVX2Impl>(param);
-    } else if (!disableAVXOptimizations && Vc::isImplementationSupported(Vc::AVXImpl)) {
-        return FactoryType::template create<Vc::AVXImpl>(param);
-    } else if (Vc::isImplementationSupported(Vc::SSE41Impl)) {
-        return FactoryType::template create<Vc::SSE41Impl>(param);
-    } else if (Vc::isImplementationSupported(Vc::SSSE3Impl)) {
-        return FactoryType::template create<Vc::SSSE3Impl>(param);
-    } else if (Vc::isImplementationSupported(Vc::SSE2Impl)) {
-        return FactoryType::template create<Vc::SSE2Impl>(param);
-    } else {
-#endif
-        return FactoryType::template create<Vc::ScalarImpl>(param);
-#ifdef HAVE_VC
+    switch (KoVcMultiArch::selectedImplementation()) {
+    case Vc::AVX2Impl:
+        return createOptimizedClassForImplementation<FactoryType, Vc::AVX2Impl>(param);
+    case Vc::AVXImpl:
+        return createOptimizedClassForImplementation<FactoryType, Vc::AVXImpl>(param);
+    case Vc::SSE41Impl:
+        return createOptimizedClassForImplementation<FactoryType, Vc::SSE41Impl>(param);
+    case Vc::SSSE3Impl:
+        return createOptimizedClassForImplementation<FactoryType, Vc::SSSE3Impl>(param);
+    case Vc::SSE2Impl:
+        return createOptimizedClassForImplementation<FactoryType, Vc::SSE2Impl>(param);
+    default:
+        break;
     }
 #endif
 
+    return createOptimizedClassForImplementation<FactoryType, Vc::ScalarImpl>(param);
 }
 
 template<class FactoryType>
@@ -124,7 +143,7 @@ typename FactoryType::ReturnType
 createOptimizedClass(typename FactoryType::ParamType param, bool forceScalarImplemetation)
 {
     if(forceScalarImplemetation){
-        return FactoryType::template create<Vc::ScalarImpl>(param);
+        return createOptimizedClassForImplementation<FactoryType, Vc::ScalarImpl>(param);
     }
     return createOptimizedClass<FactoryType>(param);
 }
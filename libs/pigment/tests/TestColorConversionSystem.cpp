@@ -187,6 +187,90 @@ void TestColorConversionSystem::testAlphaU16Conversions()
     }
 }
 
+#include <QAtomicInt>
+#include <QtConcurrent>
+#include <KoAlphaColorSpace.h>
+
+void TestColorConversionSystem::testConversionCacheStress()
+{
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *lab16 = KoColorSpaceRegistry::instance()->lab16();
+
+    const int numPixels = 64;
+
+    QByteArray rgbPixels(numPixels * rgb8->pixelSize(), '\0');
+    for (int i = 0; i < rgbPixels.size(); i++) {
+        rgbPixels[i] = quint8(i * 13);
+    }
+
+    QByteArray referenceLab(numPixels * lab16->pixelSize(), '\0');
+    rgb8->convertPixelsTo((const quint8*)rgbPixels.constData(), (quint8*)referenceLab.data(),
+                          lab16, numPixels,
+                          KoColorConversionTransformation::IntentPerceptual,
+                          KoColorConversionTransformation::Empty);
+
+    QByteArray referenceAlpha(numPixels * alpha8->pixelSize(), '\0');
+    rgb8->convertPixelsTo((const quint8*)rgbPixels.constData(), (quint8*)referenceAlpha.data(),
+                          alpha8, numPixels,
+                          KoColorConversionTransformation::IntentPerceptual,
+                          KoColorConversionTransformation::Empty);
+
+    QAtomicInt stop(0);
+    QAtomicInt numFailures(0);
+
+    /**
+     * The converters fetch the transformations from the cache all the
+     * time, while the main thread creates and destroys the color spaces,
+     * removing their entries from the pools of all the threads
+     */
+    auto converter = [&] () {
+        QByteArray lab(referenceLab.size(), '\0');
+
+        while (!stop.loadAcquire()) {
+            rgb8->convertPixelsTo((const quint8*)rgbPixels.constData(), (quint8*)lab.data(),
+                                  lab16, numPixels,
+                                  KoColorConversionTransformation::IntentPerceptual,
+                                  KoColorConversionTransformation::Empty);
+            if (lab != referenceLab) {
+                numFailures.ref();
+            }
+        }
+    };
+
+    const int numConverters = 4;
+    QVector<QFuture<void>> converters;
+    for (int i = 0; i < numConverters; i++) {
+        converters << QtConcurrent::run(converter);
+    }
+
+    QVector<int> jobs(16);
+
+    for (int round = 0; round < 200; round++) {
+        QScopedPointer<KoColorSpace> tempAlpha(new KoAlphaColorSpace());
+
+        QtConcurrent::blockingMap(jobs, [&] (int) {
+            QByteArray alpha(referenceAlpha.size(), '\0');
+
+            rgb8->convertPixelsTo((const quint8*)rgbPixels.constData(), (quint8*)alpha.data(),
+                                  tempAlpha.data(), numPixels,
+                                  KoColorConversionTransformation::IntentPerceptual,
+                                  KoColorConversionTransformation::Empty);
+            if (alpha != referenceAlpha) {
+                numFailures.ref();
+            }
+        });
+    }
+
+    stop.storeRelease(1);
+
+    Q_FOREACH (QFuture<void> future, converters) {
+        future.waitForFinished();
+    }
+
+    QCOMPARE(numFailures.loadAcquire(), 0);
+}
+
 void TestColorConversionSystem::benchmarkAlphaToRgbConversion()
 {
     const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
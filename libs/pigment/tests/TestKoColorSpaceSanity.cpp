@@ -63,4 +63,79 @@ void TestKoColorSpaceSanity::testChannelsInfo()
     }
 }
 
+void TestKoColorSpaceSanity::testSpanMethods()
+{
+    // more than one chunk of the bulk implementations
+    const int numPixels = 300;
+
+    QVector<float> floatMask(numPixels);
+    QVector<quint8> u8Mask(numPixels);
+
+    qsrand(1);
+
+    for (int i = 0; i < numPixels; i++) {
+        u8Mask[i] = qrand() % 256;
+        floatMask[i] = u8Mask[i] / 255.0f;
+    }
+
+    Q_FOREACH (const KoColorSpace* colorSpace, KoColorSpaceRegistry::instance()->allColorSpaces(KoColorSpaceRegistry::AllColorSpaces, KoColorSpaceRegistry::OnlyDefaultProfile))
+    {
+        const int pixelSize = colorSpace->pixelSize();
+        QVector<quint8> pixels(numPixels * pixelSize);
+
+        for (int i = 0; i < numPixels; i++) {
+            // every tenth pixel is fully transparent
+            const int alpha = i % 10 ? qrand() % 256 : 0;
+            colorSpace->fromQColor(QColor(qrand() % 256, qrand() % 256, qrand() % 256, alpha),
+                                   pixels.data() + i * pixelSize);
+        }
+
+        const quint8 *refPixel = pixels.constData() + 1 * pixelSize;
+
+        QVector<quint8> spanResult(numPixels);
+
+        colorSpace->differenceSpan(refPixel, pixels.constData(), spanResult.data(), numPixels);
+        for (int i = 0; i < numPixels; i++) {
+            QCOMPARE(spanResult[i], colorSpace->difference(refPixel, pixels.constData() + i * pixelSize));
+        }
+
+        colorSpace->differenceASpan(refPixel, pixels.constData(), spanResult.data(), numPixels);
+        for (int i = 0; i < numPixels; i++) {
+            QCOMPARE(spanResult[i], colorSpace->differenceA(refPixel, pixels.constData() + i * pixelSize));
+        }
+
+        colorSpace->intensity8Span(pixels.constData(), spanResult.data(), numPixels);
+        for (int i = 0; i < numPixels; i++) {
+            QCOMPARE(spanResult[i], colorSpace->intensity8(pixels.constData() + i * pixelSize));
+        }
+
+        QVector<quint8> spanPixels = pixels;
+        QVector<quint8> perPixelPixels = pixels;
+
+        colorSpace->applyAlphaU8Mask(spanPixels.data(), u8Mask.constData(), numPixels);
+        for (int i = 0; i < numPixels; i++) {
+            colorSpace->applyAlphaU8Mask(perPixelPixels.data() + i * pixelSize, u8Mask.constData() + i, 1);
+        }
+        QVERIFY(spanPixels == perPixelPixels);
+
+        spanPixels = pixels;
+        perPixelPixels = pixels;
+
+        colorSpace->applyInverseAlphaU8Mask(spanPixels.data(), u8Mask.constData(), numPixels);
+        for (int i = 0; i < numPixels; i++) {
+            colorSpace->applyInverseAlphaU8Mask(perPixelPixels.data() + i * pixelSize, u8Mask.constData() + i, 1);
+        }
+        QVERIFY(spanPixels == perPixelPixels);
+
+        spanPixels = pixels;
+        perPixelPixels = pixels;
+
+        colorSpace->applyAlphaNormedFloatMask(spanPixels.data(), floatMask.constData(), numPixels);
+        for (int i = 0; i < numPixels; i++) {
+            colorSpace->applyAlphaNormedFloatMask(perPixelPixels.data() + i * pixelSize, floatMask.constData() + i, 1);
+        }
+        QVERIFY(spanPixels == perPixelPixels);
+    }
+}
+
 KISTEST_MAIN(TestKoColorSpaceSanity)
@@ -28,6 +28,7 @@ class TestKoColorSpaceSanity : public QObject
 private Q_SLOTS:
 
     void testChannelsInfo();
+    void testSpanMethods();
 };
 
 #endif
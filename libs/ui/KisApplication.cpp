@@ -20,6 +20,8 @@
 
 #include "KisApplication.h"
 
+#include <KoVcMultiArchBuildSupport.h> // vc.h must come first
+
 #include <stdlib.h>
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -697,6 +699,7 @@ bool KisApplication::start(const KisApplicationArguments &args)
     }
 
     KisUsageLogger::writeSysInfo(KisUsageLogger::screenInformation());
+    KisUsageLogger::writeSysInfo(KoVcMultiArch::dispatchReport());
 
 
     // not calling this before since the program will quit there.
@@ -0,0 +1,189 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisDisplayFilterLut.h"
+
+#include <QtGlobal>
+#include <cmath>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpaceMaths.h>
+#include <KoTetrahedralInterpolation.h>
+
+#include "kis_display_filter.h"
+#include "kis_assert.h"
+
+namespace {
+
+static const int numGridNodes =
+    KisDisplayFilterLut::gridPoints *
+    KisDisplayFilterLut::gridPoints *
+    KisDisplayFilterLut::gridPoints;
+
+inline bool isRgbWithTrailingAlpha(const KoColorSpace *cs)
+{
+    return cs->colorModelId() == RGBAColorModelID &&
+        cs->channelCount() == 4 &&
+        cs->alphaPos() == 3;
+}
+
+}
+
+bool KisDisplayFilterLut::isSupported(const KoColorSpace *srcColorSpace,
+                                      const KoColorSpace *dstColorSpace)
+{
+    return isRgbWithTrailingAlpha(srcColorSpace) &&
+        isRgbWithTrailingAlpha(dstColorSpace) &&
+        (srcColorSpace->colorDepthId() == Integer8BitsColorDepthID ||
+         srcColorSpace->colorDepthId() == Integer16BitsColorDepthID) &&
+        dstColorSpace->colorDepthId() == Integer8BitsColorDepthID;
+}
+
+KisDisplayFilterLut::KisDisplayFilterLut(KisDisplayFilter *filter,
+                                         const KoColorSpace *srcColorSpace,
+                                         const KoColorSpace *floatColorSpace,
+                                         const KoColorSpace *dstColorSpace)
+    : m_srcColorSpace(srcColorSpace),
+      m_floatColorSpace(floatColorSpace),
+      m_dstColorSpace(dstColorSpace)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(isSupported(srcColorSpace, dstColorSpace));
+
+    /**
+     * The grid is sampled in 16-bit versions of the source and destination
+     * spaces, so that the nodes are placed exactly at the cell boundaries
+     * and the interpolated values keep enough precision for rounding.
+     */
+    const KoColorSpace *srcGridColorSpace =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(),
+                                                     Integer16BitsColorDepthID.id(),
+                                                     srcColorSpace->profile());
+
+    const KoColorSpace *dstGridColorSpace =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(),
+                                                     Integer16BitsColorDepthID.id(),
+                                                     dstColorSpace->profile());
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(srcGridColorSpace && dstGridColorSpace);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(isRgbWithTrailingAlpha(srcGridColorSpace) &&
+                                   isRgbWithTrailingAlpha(dstGridColorSpace));
+
+    const int maxSrcValue =
+        srcColorSpace->colorDepthId() == Integer16BitsColorDepthID ? 0xffff : 0xff;
+
+    m_shaper.resize(maxSrcValue + 1);
+    for (int i = 0; i <= maxSrcValue; i++) {
+        m_shaper[i] = quint16(qRound(std::sqrt(qreal(i) / maxSrcValue) * 65535.0));
+    }
+
+    // the nodes are evenly spaced in the shaped domain
+    QVector<quint16> nodeValues(gridPoints);
+    for (int i = 0; i < gridPoints; i++) {
+        const qreal shaped = qreal(i) / (gridPoints - 1);
+        nodeValues[i] = quint16(qRound(shaped * shaped * 65535.0));
+    }
+
+    QVector<quint16> srcGrid(numGridNodes * 4);
+    quint16 *srcNode = srcGrid.data();
+    for (int i0 = 0; i0 < gridPoints; i0++) {
+        for (int i1 = 0; i1 < gridPoints; i1++) {
+            for (int i2 = 0; i2 < gridPoints; i2++) {
+                srcNode[0] = nodeValues[i0];
+                srcNode[1] = nodeValues[i1];
+                srcNode[2] = nodeValues[i2];
+                srcNode[3] = 0xffff;
+                srcNode += 4;
+            }
+        }
+    }
+
+    QVector<quint8> floatGrid(numGridNodes * floatColorSpace->pixelSize());
+    QVector<quint16> dstGrid(numGridNodes * 4);
+
+    srcGridColorSpace->convertPixelsTo(reinterpret_cast<const quint8*>(srcGrid.constData()),
+                                       floatGrid.data(), floatColorSpace, numGridNodes,
+                                       KoColorConversionTransformation::internalRenderingIntent(),
+                                       KoColorConversionTransformation::internalConversionFlags());
+
+    filter->filter(floatGrid.data(), numGridNodes);
+
+    floatColorSpace->convertPixelsTo(floatGrid.constData(),
+                                     reinterpret_cast<quint8*>(dstGrid.data()),
+                                     dstGridColorSpace, numGridNodes,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+
+    m_table.resize(numGridNodes * 3);
+
+    const quint16 *dstNode = dstGrid.constData();
+    quint16 *tableNode = m_table.data();
+    for (int i = 0; i < numGridNodes; i++) {
+        tableNode[0] = dstNode[0];
+        tableNode[1] = dstNode[1];
+        tableNode[2] = dstNode[2];
+        dstNode += 4;
+        tableNode += 3;
+    }
+}
+
+bool KisDisplayFilterLut::isCompatible(const KoColorSpace *srcColorSpace,
+                                       const KoColorSpace *floatColorSpace,
+                                       const KoColorSpace *dstColorSpace) const
+{
+    return !m_table.isEmpty() &&
+        *m_srcColorSpace == *srcColorSpace &&
+        *m_floatColorSpace == *floatColorSpace &&
+        *m_dstColorSpace == *dstColorSpace;
+}
+
+void KisDisplayFilterLut::apply(const quint8 *src, quint8 *dst, int numPixels) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!m_table.isEmpty());
+
+    if (m_srcColorSpace->colorDepthId() == Integer16BitsColorDepthID) {
+        applyImpl<quint16>(src, dst, numPixels);
+    } else {
+        applyImpl<quint8>(src, dst, numPixels);
+    }
+}
+
+template <typename src_channel_t>
+void KisDisplayFilterLut::applyImpl(const quint8 *src, quint8 *dst, int numPixels) const
+{
+    const quint16 *table = m_table.constData();
+    const quint16 *shaper = m_shaper.constData();
+    const src_channel_t *srcPtr = reinterpret_cast<const src_channel_t*>(src);
+
+    quint16 values[3];
+
+    for (int i = 0; i < numPixels; i++) {
+        KoTetrahedralInterpolation::interpolate<gridPoints, 3>(
+            table, shaper[srcPtr[0]], shaper[srcPtr[1]], shaper[srcPtr[2]], values);
+
+        for (int ch = 0; ch < 3; ch++) {
+            dst[ch] = KoColorSpaceMaths<quint16, quint8>::scaleToA(values[ch]);
+        }
+
+        dst[3] = KoColorSpaceMaths<src_channel_t, quint8>::scaleToA(srcPtr[3]);
+
+        srcPtr += 4;
+        dst += 4;
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISDISPLAYFILTERLUT_H
+#define KISDISPLAYFILTERLUT_H
+
+#include <QVector>
+
+#include <kritaui_export.h>
+
+class KoColorSpace;
+class KisDisplayFilter;
+
+/**
+ * A 3D lookup table that bakes the whole CPU display pipeline of the
+ * QPainter canvas into a single pass:
+ *
+ *   projection -> float RGBA -> display filter (OCIO, exposure, gamma)
+ *              -> 8-bit monitor color space
+ *
+ * Without the table, every pixel is converted twice through LCMS and
+ * processed by OCIO in between, with two intermediate buffers.
+ *
+ * The table is sampled once through the real pipeline on a 65x65x65
+ * grid and applied with tetrahedral interpolation. The inputs are passed
+ * through a square root shaper before the lookup, which places more grid
+ * nodes into the darks, where exposure and gamma corrections are the
+ * steepest. The result stays within one 8-bit level of the separate
+ * passes, except for the darks, where it may deviate by up to three
+ * levels (see KisDisplayFilterLutTest).
+ *
+ * Only integer RGB projections are supported, float ones may contain
+ * HDR values that do not fit into the domain of the table.
+ */
+class KRITAUI_EXPORT KisDisplayFilterLut
+{
+public:
+    static const int gridPoints = 65;
+
+    /**
+     * @return true if the conversion from \p srcColorSpace to
+     *         \p dstColorSpace can be baked into the table
+     */
+    static bool isSupported(const KoColorSpace *srcColorSpace,
+                            const KoColorSpace *dstColorSpace);
+
+    /**
+     * Samples the display pipeline. \p floatColorSpace is the space
+     * the display filter expects its input to be in.
+     */
+    KisDisplayFilterLut(KisDisplayFilter *filter,
+                        const KoColorSpace *srcColorSpace,
+                        const KoColorSpace *floatColorSpace,
+                        const KoColorSpace *dstColorSpace);
+
+    /**
+     * @return true if the table has been sampled for the passed spaces
+     */
+    bool isCompatible(const KoColorSpace *srcColorSpace,
+                      const KoColorSpace *floatColorSpace,
+                      const KoColorSpace *dstColorSpace) const;
+
+    /**
+     * Converts \p numPixels pixels from the source space directly
+     * into the monitor space. Alpha is copied as is.
+     */
+    void apply(const quint8 *src, quint8 *dst, int numPixels) const;
+
+private:
+    template <typename src_channel_t>
+    void applyImpl(const quint8 *src, quint8 *dst, int numPixels) const;
+
+private:
+    QVector<quint16> m_shaper;
+    QVector<quint16> m_table;
+    const KoColorSpace *m_srcColorSpace;
+    const KoColorSpace *m_floatColorSpace;
+    const KoColorSpace *m_dstColorSpace;
+};
+
+#endif // KISDISPLAYFILTERLUT_H
@@ -44,6 +44,14 @@ public:
     virtual bool useInternalColorManagement() const = 0;
     virtual KisExposureGammaCorrectionInterface *correctionInterface() const = 0;
     virtual bool lockCurrentColorVisualRepresentation() const = 0;
+
+    /**
+     * @return true if filter() processes color channels of every pixel
+     * independently from its neighbours and its alpha channel. Such
+     * filters can be baked into a lookup table by the canvas.
+     */
+    virtual bool canBeBakedIntoLut() const = 0;
+
     /**
      * @return true if the shader should be recompiled
      */
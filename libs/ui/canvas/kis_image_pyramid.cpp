@@ -25,6 +25,7 @@
 #include <KoColorSpaceMaths.h>
 
 #include "kis_display_filter.h"
+#include "KisDisplayFilterLut.h"
 #include "kis_painter.h"
 #include "kis_iterator_ng.h"
 #include "kis_datamanager.h"
@@ -154,6 +155,31 @@ void KisImagePyramid::setChannelFlags(const QBitArray &channelFlags)
 void KisImagePyramid::setDisplayFilter(QSharedPointer<KisDisplayFilter> displayFilter)
 {
     m_displayFilter = displayFilter;
+
+    /**
+     * The filter is updated in place when the user changes its settings,
+     * so the baked table must be dropped even if the pointer is the same.
+     */
+    QMutexLocker l(&m_displayFilterLutLock);
+    m_displayFilterLut.clear();
+}
+
+QSharedPointer<KisDisplayFilterLut> KisImagePyramid::displayFilterLut(const KoColorSpace *srcColorSpace,
+                                                                      const KoColorSpace *floatColorSpace,
+                                                                      const KoColorSpace *dstColorSpace)
+{
+    QMutexLocker l(&m_displayFilterLutLock);
+
+    if (!m_displayFilterLut ||
+        !m_displayFilterLut->isCompatible(srcColorSpace, floatColorSpace, dstColorSpace)) {
+
+        m_displayFilterLut.reset(new KisDisplayFilterLut(m_displayFilter.data(),
+                                                         srcColorSpace,
+                                                         floatColorSpace,
+                                                         dstColorSpace));
+    }
+
+    return m_displayFilterLut;
 }
 
 void KisImagePyramid::rebuildPyramid()
@@ -259,19 +285,34 @@ void KisImagePyramid::retrieveImageData(const QRect &rect)
                 Integer8BitsColorDepthID.id(),
                 destinationProfile);
 
-        if (projectionCs->colorDepthId() == Float32BitsColorDepthID) {
-            m_displayFilter->filter(originalBytes.data(), numPixels);
-        } else {
-            QScopedArrayPointer<quint8> dst(new quint8[floatCs->pixelSize() * numPixels]);
-            projectionCs->convertPixelsTo(originalBytes.data(), dst.data(), floatCs, numPixels, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
-            m_displayFilter->filter(dst.data(), numPixels);
-            originalBytes.swap(dst);
-        }
+        if (m_displayFilter->canBeBakedIntoLut() &&
+            KisDisplayFilterLut::isSupported(projectionCs, modifiedMonitorCs)) {
+
+            /**
+             * Integer projections go through a single pass of the baked
+             * table instead of two conversions and the filter pass.
+             */
+            QSharedPointer<KisDisplayFilterLut> lut =
+                displayFilterLut(projectionCs, floatCs, modifiedMonitorCs);
 
-        {
             QScopedArrayPointer<quint8> dst(new quint8[modifiedMonitorCs->pixelSize() * numPixels]);
-            floatCs->convertPixelsTo(originalBytes.data(), dst.data(), modifiedMonitorCs, numPixels, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
+            lut->apply(originalBytes.data(), dst.data(), numPixels);
             originalBytes.swap(dst);
+        } else {
+            if (projectionCs->colorDepthId() == Float32BitsColorDepthID) {
+                m_displayFilter->filter(originalBytes.data(), numPixels);
+            } else {
+                QScopedArrayPointer<quint8> dst(new quint8[floatCs->pixelSize() * numPixels]);
+                projectionCs->convertPixelsTo(originalBytes.data(), dst.data(), floatCs, numPixels, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
+                m_displayFilter->filter(dst.data(), numPixels);
+                originalBytes.swap(dst);
+            }
+
+            {
+                QScopedArrayPointer<quint8> dst(new quint8[modifiedMonitorCs->pixelSize() * numPixels]);
+                floatCs->convertPixelsTo(originalBytes.data(), dst.data(), modifiedMonitorCs, numPixels, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
+                originalBytes.swap(dst);
+            }
         }
 #endif
     }
@@ -22,12 +22,14 @@
 #include <QImage>
 #include <QVector>
 #include <QThreadStorage>
+#include <QMutex>
 
 #include <KoColorSpace.h>
 #include <kis_image.h>
 #include <kis_paint_device.h>
 #include "kis_projection_backend.h"
 
+class KisDisplayFilterLut;
 
 class KisImagePyramid : QObject, public KisProjectionBackend
 {
@@ -76,6 +78,15 @@ public:
 private:
 
     void retrieveImageData(const QRect &rect);
+
+    /**
+     * Returns the lookup table baking the display filter for the
+     * passed color spaces, creating it if needed
+     */
+    QSharedPointer<KisDisplayFilterLut> displayFilterLut(const KoColorSpace *srcColorSpace,
+                                                         const KoColorSpace *floatColorSpace,
+                                                         const KoColorSpace *dstColorSpace);
+
     void rebuildPyramid();
     void clearPyramid();
 
@@ -123,6 +134,9 @@ private:
 
     QSharedPointer<KisDisplayFilter> m_displayFilter;
 
+    QSharedPointer<KisDisplayFilterLut> m_displayFilterLut;
+    QMutex m_displayFilterLutLock;
+
     KoColorConversionTransformation::Intent m_renderingIntent;
     KoColorConversionTransformation::ConversionFlags m_conversionFlags;
 
@@ -32,6 +32,7 @@
 #include <kis_paint_layer.h>
 #include <KisViewManager.h>
 #include <kis_config.h>
+#include <kis_convolution_painter.h>
 
 #include "kis_selection.h"
 #include "kis_node_commands_adapter.h"
@@ -111,6 +112,10 @@ KisDlgFilter::KisDlgFilter(KisViewManager *view, KisNodeSP node, KisFilterManage
 KisDlgFilter::~KisDlgFilter()
 {
     KisConfig(false).writeEntry("filterdialog/geometry", saveGeometry());
+
+    // the caches of the preview are useless after the dialog is closed
+    KisConvolutionPainter::clearSourceSpectraCache();
+
     delete d;
 }
 
@@ -137,6 +142,8 @@ void KisDlgFilter::startApplyingFilter(KisFilterConfigurationSP config)
         config->setChannelFlags(qobject_cast<KisPaintLayer*>(d->node.data())->channelLockFlags());
     }
 
+    config->setDialogPreview(true);
+
     d->filterManager->apply(config);
 }
 
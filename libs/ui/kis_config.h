@@ -490,6 +490,9 @@ public:
     bool lineSmoothingStabilizeSensors(bool defaultValue = false) const;
     void setLineSmoothingStabilizeSensors(bool value);
 
+    bool lineSmoothingPredictStroke(bool defaultValue = false) const;
+    void setLineSmoothingPredictStroke(bool value);
+
     int tabletEventsDelay(bool defaultValue = false) const;
     void setTabletEventsDelay(int value);
 
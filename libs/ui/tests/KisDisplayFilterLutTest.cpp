@@ -0,0 +1,192 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisDisplayFilterLutTest.h"
+
+#include <QTest>
+#include <cmath>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+
+#include "canvas/kis_display_filter.h"
+#include "canvas/KisDisplayFilterLut.h"
+
+#include <sdk/tests/kistest.h>
+
+namespace {
+
+/**
+ * A filter that applies exposure and gamma, the same way the OCIO
+ * filter does when the user moves the sliders in the LUT docker
+ */
+class ExposureGammaFilter : public KisDisplayFilter
+{
+public:
+    ExposureGammaFilter(float exposure, float gamma)
+        : m_gain(std::pow(2.0f, exposure)),
+          m_invGamma(1.0f / gamma)
+    {
+    }
+
+    QString program() const override { return QString(); }
+    GLuint lutTexture() const override { return 0; }
+
+    void filter(quint8 *pixels, quint32 numPixels) override {
+        float *p = reinterpret_cast<float*>(pixels);
+        for (quint32 i = 0; i < numPixels; i++) {
+            for (int ch = 0; ch < 3; ch++) {
+                p[ch] = std::pow(qMax(0.0f, p[ch] * m_gain), m_invGamma);
+            }
+            p += 4;
+        }
+    }
+
+    void approximateInverseTransformation(quint8 *, quint32) override {}
+    void approximateForwardTransformation(quint8 *, quint32) override {}
+    bool useInternalColorManagement() const override { return true; }
+    KisExposureGammaCorrectionInterface *correctionInterface() const override { return 0; }
+    bool lockCurrentColorVisualRepresentation() const override { return false; }
+    bool canBeBakedIntoLut() const override { return true; }
+    bool updateShader() override { return false; }
+
+private:
+    float m_gain;
+    float m_invGamma;
+};
+
+struct Pipeline {
+    Pipeline(const QString &srcDepth)
+        : srcCs(KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), srcDepth, 0)),
+          floatCs(KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0)),
+          dstCs(KoColorSpaceRegistry::instance()->rgb8())
+    {
+    }
+
+    void separatePasses(KisDisplayFilter *filter, const quint8 *src, quint8 *dst, int numPixels) {
+        QVector<quint8> floatBuf(numPixels * floatCs->pixelSize());
+        srcCs->convertPixelsTo(src, floatBuf.data(), floatCs, numPixels,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               KoColorConversionTransformation::internalConversionFlags());
+        filter->filter(floatBuf.data(), numPixels);
+        floatCs->convertPixelsTo(floatBuf.constData(), dst, dstCs, numPixels,
+                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                 KoColorConversionTransformation::internalConversionFlags());
+    }
+
+    const KoColorSpace *srcCs;
+    const KoColorSpace *floatCs;
+    const KoColorSpace *dstCs;
+};
+
+QVector<quint8> randomPixels(const KoColorSpace *cs, int numPixels)
+{
+    QVector<quint8> pixels(numPixels * cs->pixelSize());
+    qsrand(1);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = quint8(qrand() % 256);
+    }
+    return pixels;
+}
+
+}
+
+void KisDisplayFilterLutTest::testAccuracy_data()
+{
+    QTest::addColumn<QString>("srcDepth");
+    QTest::addColumn<float>("exposure");
+    QTest::addColumn<float>("gamma");
+
+    QTest::newRow("u8-identity") << Integer8BitsColorDepthID.id() << 0.0f << 1.0f;
+    QTest::newRow("u8-exposure-gamma") << Integer8BitsColorDepthID.id() << 0.5f << 1.4f;
+    QTest::newRow("u16-identity") << Integer16BitsColorDepthID.id() << 0.0f << 1.0f;
+    QTest::newRow("u16-exposure-gamma") << Integer16BitsColorDepthID.id() << -0.5f << 0.8f;
+}
+
+void KisDisplayFilterLutTest::testAccuracy()
+{
+    QFETCH(QString, srcDepth);
+    QFETCH(float, exposure);
+    QFETCH(float, gamma);
+
+    Pipeline pipeline(srcDepth);
+    ExposureGammaFilter filter(exposure, gamma);
+
+    QVERIFY(KisDisplayFilterLut::isSupported(pipeline.srcCs, pipeline.dstCs));
+
+    const int numPixels = 4096;
+    QVector<quint8> src = randomPixels(pipeline.srcCs, numPixels);
+    QVector<quint8> reference(numPixels * pipeline.dstCs->pixelSize());
+    QVector<quint8> fused(numPixels * pipeline.dstCs->pixelSize());
+
+    pipeline.separatePasses(&filter, src.constData(), reference.data(), numPixels);
+
+    KisDisplayFilterLut lut(&filter, pipeline.srcCs, pipeline.floatCs, pipeline.dstCs);
+    QVERIFY(lut.isCompatible(pipeline.srcCs, pipeline.floatCs, pipeline.dstCs));
+    lut.apply(src.constData(), fused.data(), numPixels);
+
+    /**
+     * The table should stay within a single 8-bit level of the separate
+     * passes. The only exception is the darks, where the transfer curves
+     * are steep enough for the interpolation to deviate a bit more.
+     */
+    const int tolerance = 1;
+    const int darksTolerance = 3;
+    const int darksThreshold = 64;
+
+    for (int i = 0; i < reference.size(); i++) {
+        const int maxDifference =
+            reference[i] < darksThreshold ? darksTolerance : tolerance;
+
+        if (qAbs(int(reference[i]) - int(fused[i])) > maxDifference) {
+            qDebug() << "byte" << i << "reference" << reference[i] << "fused" << fused[i];
+            QFAIL("fused display conversion deviates from the separate passes");
+        }
+    }
+}
+
+void KisDisplayFilterLutTest::benchmarkSeparatePasses()
+{
+    Pipeline pipeline(Integer8BitsColorDepthID.id());
+    ExposureGammaFilter filter(0.5f, 1.4f);
+
+    const int numPixels = 512 * 512;
+    QVector<quint8> src = randomPixels(pipeline.srcCs, numPixels);
+    QVector<quint8> dst(numPixels * pipeline.dstCs->pixelSize());
+
+    QBENCHMARK {
+        pipeline.separatePasses(&filter, src.constData(), dst.data(), numPixels);
+    }
+}
+
+void KisDisplayFilterLutTest::benchmarkFusedPass()
+{
+    Pipeline pipeline(Integer8BitsColorDepthID.id());
+    ExposureGammaFilter filter(0.5f, 1.4f);
+
+    const int numPixels = 512 * 512;
+    QVector<quint8> src = randomPixels(pipeline.srcCs, numPixels);
+    QVector<quint8> dst(numPixels * pipeline.dstCs->pixelSize());
+
+    KisDisplayFilterLut lut(&filter, pipeline.srcCs, pipeline.floatCs, pipeline.dstCs);
+
+    QBENCHMARK {
+        lut.apply(src.constData(), dst.data(), numPixels);
+    }
+}
+
+KISTEST_MAIN(KisDisplayFilterLutTest)
@@ -0,0 +1,171 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisMaskingBrushRendererTest.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoChannelInfo.h>
+#include <KoCompositeOpRegistry.h>
+#include <KoCompositeOpFunctions.h>
+#include <KoColorSpaceMaths.h>
+#include <KoGrayColorSpaceTraits.h>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <kis_random_accessor_ng.h>
+#include <kis_iterator_ng.h>
+
+#include "strokes/KisMaskingBrushRenderer.h"
+
+#include <testutil.h>
+
+namespace {
+
+void fillRandomly(KisPaintDeviceSP dev, const QRect &rc, int seed)
+{
+    const int pixelSize = dev->pixelSize();
+    int value = seed;
+
+    KisSequentialIterator it(dev, rc);
+    while (it.nextPixel()) {
+        quint8 *ptr = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            value = (value * 1103515245 + 12345) & 0x7fffffff;
+            ptr[i] = quint8(value >> 16);
+        }
+    }
+}
+
+int alphaOffset(const KoColorSpace *cs)
+{
+    Q_FOREACH (const KoChannelInfo *channel, cs->channels()) {
+        if (channel->channelType() == KoChannelInfo::ALPHA) {
+            return channel->pos();
+        }
+    }
+    return -1;
+}
+
+/**
+ * The way KisMaskingBrushRenderer::updateProjection() worked before the
+ * copy and the masking passes were fused: the stroke is copied into the
+ * destination first, then the alpha channel of every destination pixel
+ * is composited with the mask
+ */
+template <typename channel_type, channel_type compositeFunc(channel_type, channel_type)>
+void referenceProjection(KisPaintDeviceSP stroke, KisPaintDeviceSP mask, KisPaintDeviceSP dst, const QRect &rc)
+{
+    using MaskPixel = KoGrayU8Traits::Pixel;
+
+    KisPainter::copyAreaOptimized(rc.topLeft(), stroke, dst, rc);
+
+    const int dstAlphaOffset = alphaOffset(dst->colorSpace());
+
+    KisRandomConstAccessorSP maskIt = mask->createRandomConstAccessorNG();
+    KisRandomAccessorSP dstIt = dst->createRandomAccessorNG();
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        for (int x = rc.left(); x <= rc.right(); x++) {
+            maskIt->moveTo(x, y);
+            dstIt->moveTo(x, y);
+
+            const MaskPixel *maskPixel = reinterpret_cast<const MaskPixel*>(maskIt->rawDataConst());
+            const quint8 maskValue = KoColorSpaceMaths<quint8>::multiply(maskPixel->gray, maskPixel->alpha);
+            const channel_type maskScaled = KoColorSpaceMaths<quint8, channel_type>::scaleToA(maskValue);
+
+            channel_type *dstAlpha = reinterpret_cast<channel_type*>(dstIt->rawData() + dstAlphaOffset);
+            *dstAlpha = compositeFunc(maskScaled, *dstAlpha);
+        }
+    }
+}
+
+template <typename channel_type>
+void referenceProjection(const QString &compositeOpId,
+                         KisPaintDeviceSP stroke, KisPaintDeviceSP mask, KisPaintDeviceSP dst, const QRect &rc)
+{
+    if (compositeOpId == COMPOSITE_MULT) {
+        referenceProjection<channel_type, cfMultiply>(stroke, mask, dst, rc);
+    } else if (compositeOpId == COMPOSITE_DARKEN) {
+        referenceProjection<channel_type, cfDarkenOnly>(stroke, mask, dst, rc);
+    } else if (compositeOpId == COMPOSITE_OVERLAY) {
+        referenceProjection<channel_type, cfOverlay>(stroke, mask, dst, rc);
+    } else if (compositeOpId == COMPOSITE_SUBTRACT) {
+        referenceProjection<channel_type, cfSubtract>(stroke, mask, dst, rc);
+    } else {
+        QFAIL("unexpected composite op");
+    }
+}
+
+}
+
+void KisMaskingBrushRendererTest::testUpdateProjection_data()
+{
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<QString>("compositeOpId");
+
+    const QStringList depths({Integer8BitsColorDepthID.id(), Integer16BitsColorDepthID.id()});
+    const QStringList ops({COMPOSITE_MULT, COMPOSITE_DARKEN, COMPOSITE_OVERLAY, COMPOSITE_SUBTRACT});
+
+    Q_FOREACH (const QString &depth, depths) {
+        Q_FOREACH (const QString &op, ops) {
+            QTest::newRow(QString("%1-%2").arg(depth).arg(op).toLatin1()) << depth << op;
+        }
+    }
+}
+
+void KisMaskingBrushRendererTest::testUpdateProjection()
+{
+    QFETCH(QString, colorDepthId);
+    QFETCH(QString, compositeOpId);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepthId, 0);
+    QVERIFY(cs);
+
+    const QRect fillRect(-20, -30, 300, 200);
+    const QRect updateRect(10, 17, 150, 90);
+
+    /**
+     * The destination is shifted relative to the stroke and mask devices,
+     * so that the tiles of the three devices are not aligned
+     */
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+    dst->moveTo(13, -7);
+    fillRandomly(dst, fillRect, 1);
+
+    KisMaskingBrushRenderer renderer(dst, compositeOpId);
+    fillRandomly(renderer.strokeDevice(), fillRect, 2);
+    fillRandomly(renderer.maskDevice(), fillRect, 3);
+
+    KisPaintDeviceSP refDst = new KisPaintDevice(*dst);
+
+    renderer.updateProjection(updateRect);
+
+    if (colorDepthId == Integer8BitsColorDepthID.id()) {
+        referenceProjection<quint8>(compositeOpId, renderer.strokeDevice(), renderer.maskDevice(), refDst, updateRect);
+    } else {
+        referenceProjection<quint16>(compositeOpId, renderer.strokeDevice(), renderer.maskDevice(), refDst, updateRect);
+    }
+
+    QPoint errorPoint;
+    QVERIFY2(TestUtil::comparePaintDevices(errorPoint, dst, refDst),
+             QString("projection differs at %1,%2").arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+}
+
+QTEST_MAIN(KisMaskingBrushRendererTest)
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokePredictorTest.h"
+
+#include "KisStrokePredictor.h"
+#include "kis_paint_information.h"
+
+namespace {
+KisPaintInformation sample(qreal x, qreal y, qreal time, qreal pressure = 1.0)
+{
+    return KisPaintInformation(QPointF(x, y), pressure, 0.0, 0.0, 0.0, 0.0, 1.0, time, 0.0);
+}
+}
+
+void KisStrokePredictorTest::testConstantVelocity()
+{
+    KisStrokePredictor predictor;
+    predictor.reset(sample(10, 20, 0));
+
+    for (int i = 1; i <= 5; i++) {
+        predictor.addSample(sample(10 + 2.0 * i, 20 - 0.5 * i, 10.0 * i, 0.5));
+    }
+
+    QCOMPARE(predictor.velocity(), QPointF(0.2, -0.05));
+
+    const KisPaintInformation predicted = predictor.predict(20.0);
+
+    QCOMPARE(predicted.pos(), QPointF(24.0, 16.5));
+
+    // everything but the position is taken from the last sample
+    QCOMPARE(predicted.pressure(), 0.5);
+    QCOMPARE(predicted.currentTime(), 50.0);
+
+    // the zero horizon gives the last sample
+    QCOMPARE(predictor.predict(0.0).pos(), predictor.lastSample().pos());
+}
+
+void KisStrokePredictorTest::testVelocitySmoothing()
+{
+    KisStrokePredictor predictor;
+    predictor.reset(sample(0, 0, 0));
+
+    // the first measurement is taken as is
+    predictor.addSample(sample(10, 0, 10));
+    QCOMPARE(predictor.velocity(), QPointF(1.0, 0.0));
+
+    // the next ones are averaged with the previous velocity
+    predictor.addSample(sample(30, 0, 20));
+    QCOMPARE(predictor.velocity(), QPointF(1.5, 0.0));
+
+    predictor.addSample(sample(30, 10, 30));
+    QCOMPARE(predictor.velocity(), QPointF(0.75, 0.5));
+}
+
+void KisStrokePredictorTest::testZeroTimeDelta()
+{
+    KisStrokePredictor predictor;
+    predictor.reset(sample(0, 0, 0));
+
+    predictor.addSample(sample(10, 0, 10));
+
+    // a coalesced event with the same timestamp must not blow up the velocity
+    predictor.addSample(sample(15, 0, 10));
+
+    QCOMPARE(predictor.velocity(), QPointF(1.0, 0.0));
+    QCOMPARE(predictor.lastSample().pos(), QPointF(15, 0));
+    QCOMPARE(predictor.predict(5.0).pos(), QPointF(20, 0));
+}
+
+void KisStrokePredictorTest::testReset()
+{
+    KisStrokePredictor predictor;
+    predictor.reset(sample(0, 0, 0));
+    predictor.addSample(sample(10, 10, 10));
+
+    predictor.reset(sample(100, 100, 500));
+
+    QCOMPARE(predictor.velocity(), QPointF());
+    QCOMPARE(predictor.predict(50.0).pos(), QPointF(100, 100));
+
+    // the velocity of the new trajectory doesn't depend on the old one
+    predictor.addSample(sample(100, 110, 510));
+    QCOMPARE(predictor.velocity(), QPointF(0.0, 1.0));
+}
+
+QTEST_MAIN(KisStrokePredictorTest)
@@ -28,7 +28,16 @@
 #include "kis_resources_snapshot.h"
 #include "kis_image.h"
 #include "kis_painter.h"
+#include <brushengine/kis_paintop_utils.h>
 #include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_random_source.h>
+#include <brushengine/KisPerStrokeRandomSource.h>
+#include <kis_distance_information.h>
+#include <kis_paint_layer.h>
+#include <KoCanvasResourceProvider.h>
+#include <KoColorSpaceRegistry.h>
+#include <kis_image_config.h>
+#include "testutil.h"
 
 #include "kistest.h"
 
@@ -187,4 +196,204 @@ void FreehandStrokeTest::testPredefinedBrushStrokeLod()
     tester.testSimpleStroke();
 }
 
+namespace {
+
+/**
+ * Paints a horizontal line across a two-color layer directly with
+ * KisPainter. When \p flushEveryDab is true, the line is split into
+ * segments shorter than the dab spacing and the asynchronous updates
+ * are run after each of them, so every dab is fully rendered before
+ * the next one is requested. Otherwise all the dabs are deferred until
+ * the end of the stroke. All the random sources are seeded, so two
+ * calls with the same arguments paint the same stroke.
+ */
+KisPaintDeviceSP paintDirectStroke(const QString &presetFileName, bool flushEveryDab)
+{
+    // the paintops seed their own random sources with qrand()
+    qsrand(0);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 500, 500, cs, "test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    // two colors give the smudging something to carry along the stroke
+    layer->paintDevice()->fill(QRect(0, 0, 250, 500), KoColor(Qt::red, cs));
+    layer->paintDevice()->fill(QRect(250, 0, 250, 500), KoColor(Qt::blue, cs));
+
+    QScopedPointer<KoCanvasResourceProvider> manager(
+        utils::createResourceManager(image, layer, presetFileName));
+
+    KisResourcesSnapshotSP resources =
+        new KisResourcesSnapshot(image, layer, manager.data());
+
+    KisPainter gc(layer->paintDevice());
+    resources->setupPainter(&gc);
+
+    KisRandomSourceSP rnd = new KisRandomSource(0);
+    KisPerStrokeRandomSourceSP strokeRnd = new KisPerStrokeRandomSource();
+    KisDistanceInformation distance;
+
+    const QPointF start(100, 250);
+    const QPointF end(400, 250);
+    const int numSegments = 300;
+
+    KisPaintInformation lastPi(start);
+    lastPi.setRandomSource(rnd);
+    lastPi.setPerStrokeRandomSource(strokeRnd);
+
+    for (int i = 1; i <= numSegments; i++) {
+        KisPaintInformation pi(start + (end - start) * qreal(i) / numSegments);
+        pi.setRandomSource(rnd);
+        pi.setPerStrokeRandomSource(strokeRnd);
+
+        gc.paintLine(lastPi, pi, &distance);
+        lastPi = pi;
+
+        if (flushEveryDab) {
+            KisPaintOpUtils::flushAsynchronousUpdates(&gc);
+        }
+    }
+
+    KisPaintOpUtils::flushAsynchronousUpdates(&gc);
+
+    return layer->paintDevice();
+}
+
+void testDeferredDabs(const QString &presetFileName)
+{
+    KisPaintDeviceSP immediate = paintDirectStroke(presetFileName, true);
+    KisPaintDeviceSP deferred = paintDirectStroke(presetFileName, false);
+
+    QPoint errorPoint;
+    if (!TestUtil::comparePaintDevices(errorPoint, immediate, deferred)) {
+        immediate->convertToQImage(0).save("deferred_dabs_immediate.png");
+        deferred->convertToQImage(0).save("deferred_dabs_deferred.png");
+        QFAIL(QString("Deferred dabs differ from the immediate ones at %1,%2 (%3)")
+              .arg(errorPoint.x()).arg(errorPoint.y()).arg(presetFileName)
+              .toLatin1());
+    }
+}
+
+void compareTiledAndDirectParticles(const QString &presetFileName)
+{
+    KisImageConfig cfg(false);
+    const bool oldTiledRendering = cfg.tiledParticleRendering();
+
+    cfg.setTiledParticleRendering(false);
+    KisPaintDeviceSP direct = paintDirectStroke(presetFileName, false);
+
+    cfg.setTiledParticleRendering(true);
+    KisPaintDeviceSP tiled = paintDirectStroke(presetFileName, false);
+
+    cfg.setTiledParticleRendering(oldTiledRendering);
+
+    QPoint errorPoint;
+    if (!TestUtil::comparePaintDevices(errorPoint, direct, tiled)) {
+        direct->convertToQImage(0).save("tiled_particles_direct.png");
+        tiled->convertToQImage(0).save("tiled_particles_tiled.png");
+        QFAIL(QString("Tiled particles differ from the directly rendered ones at %1,%2 (%3)")
+              .arg(errorPoint.x()).arg(errorPoint.y()).arg(presetFileName)
+              .toLatin1());
+    }
+}
+
+}
+
+void FreehandStrokeTest::testColorSmudgeDeferredDabs()
+{
+    testDeferredDabs("colorsmudge_predefined.kpp");
+    testDeferredDabs("Mix_dull.kpp");
+}
+
+void FreehandStrokeTest::testTiledParticleRendering()
+{
+    compareTiledAndDirectParticles("spray_30px21rasterParticles.kpp");
+    compareTiledAndDirectParticles("hairy-70px.kpp");
+}
+
+/**
+ * Paints a horizontal line across a two-color layer with a
+ * FreehandStrokeStrategy, so that the source device is protected by a
+ * transaction and the asynchronous updates of the paintop are run by
+ * the stroke's workers.
+ */
+KisPaintDeviceSP paintStrategyStroke(const QString &presetFileName)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 500, 500, cs, "test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    // a sharp edge for the filter to change
+    layer->paintDevice()->fill(QRect(0, 0, 250, 500), KoColor(Qt::red, cs));
+    layer->paintDevice()->fill(QRect(250, 0, 250, 500), KoColor(Qt::blue, cs));
+
+    QScopedPointer<KoCanvasResourceProvider> manager(
+        utils::createResourceManager(image, layer, presetFileName));
+
+    KisResourcesSnapshotSP resources =
+        new KisResourcesSnapshot(image, layer, manager.data());
+
+    KisStrokeId strokeId = image->startStroke(
+        new FreehandStrokeStrategy(resources, new KisFreehandStrokeInfo(),
+                                   kundo2_noi18n("Filter Stroke")));
+
+    image->addJob(strokeId,
+                  new FreehandStrokeStrategy::Data(0,
+                                                   KisPaintInformation(QPointF(100, 250)),
+                                                   KisPaintInformation(QPointF(400, 250))));
+    image->addJob(strokeId, new KisAsyncronousStrokeUpdateHelper::UpdateData(true));
+    image->endStroke(strokeId);
+    image->waitForDone();
+
+    return layer->paintDevice();
+}
+
+void compareAsynchronousAndSynchronousFilterDabs(const QString &presetFileName)
+{
+    KisImageConfig cfg(false);
+    const bool oldAsynchronousDabs = cfg.asynchronousFilterDabs();
+
+    cfg.setAsynchronousFilterDabs(false);
+    KisPaintDeviceSP synchronous = paintStrategyStroke(presetFileName);
+
+    cfg.setAsynchronousFilterDabs(true);
+    KisPaintDeviceSP asynchronous = paintStrategyStroke(presetFileName);
+
+    cfg.setAsynchronousFilterDabs(oldAsynchronousDabs);
+
+    const QRect rc = synchronous->exactBounds() | asynchronous->exactBounds();
+    const QImage synchronousImage = synchronous->convertToQImage(0, rc);
+    const QImage asynchronousImage = asynchronous->convertToQImage(0, rc);
+
+    // the filter must really have changed the edge
+    QColor edgeColor;
+    asynchronous->pixel(249, 250, &edgeColor);
+    QVERIFY(edgeColor != QColor(Qt::red));
+
+    /**
+     * The asynchronous dabs premultiply the brush mask into the alpha
+     * before compositing, while the synchronous ones pass it as a
+     * selection, which may round differently by one step
+     */
+    QPoint errorPoint;
+    if (!TestUtil::compareQImages(errorPoint, synchronousImage, asynchronousImage, 1, 1)) {
+        synchronousImage.save("filter_dabs_synchronous.png");
+        asynchronousImage.save("filter_dabs_asynchronous.png");
+        QFAIL(QString("Asynchronous filter dabs differ from the synchronous ones at %1,%2 (%3)")
+              .arg(errorPoint.x()).arg(errorPoint.y()).arg(presetFileName)
+              .toLatin1());
+    }
+}
+
+void FreehandStrokeTest::testFilterOpStroke()
+{
+    // gaussian blur is processed tile by tile
+    compareAsynchronousAndSynchronousFilterDabs("filterOp_gauss.kpp");
+
+    // oilpaint doesn't support threading, so every dab is a single job
+    compareAsynchronousAndSynchronousFilterDabs("filterOp_oilpaint.kpp");
+}
+
 KISTEST_MAIN(FreehandStrokeTest)
@@ -33,6 +33,9 @@ private Q_SLOTS:
     void testAutoTextured17();
     void testAutoTextured38();
     void testMixDullCompositioning();
+    void testColorSmudgeDeferredDabs();
+    void testTiledParticleRendering();
+    void testFilterOpStroke();
 
     void testAutoBrushStrokeLod();
     void testPredefinedBrushStrokeLod();
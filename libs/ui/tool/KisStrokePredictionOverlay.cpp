@@ -0,0 +1,204 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokePredictionOverlay.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <KoCompositeOpRegistry.h>
+
+#include "kis_image.h"
+#include "kis_painter.h"
+#include "kis_paint_device.h"
+#include "kis_default_bounds.h"
+#include "kis_distance_information.h"
+#include "kis_resources_snapshot.h"
+#include "kis_random_source.h"
+#include "KisPerStrokeRandomSource.h"
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_utils.h>
+
+struct KisStrokePredictionOverlay::Private
+{
+    /**
+     * The painting state is accessed by the rendering thread only,
+     * the thread pool has a single thread, so the requests are never
+     * rendered concurrently
+     */
+    KisPaintDeviceSP device;
+    QScopedPointer<KisPainter> painter;
+    KisPerStrokeRandomSourceSP strokeRandomSource;
+    QThreadPool renderingThread;
+
+    /// the state shared with the GUI thread, guarded by the mutex
+    mutable QMutex mutex;
+    bool isRendering = false;
+    bool isCancelled = false;
+    bool hasPendingRequest = false;
+    KisPaintInformation pendingFrom;
+    KisPaintInformation pendingTo;
+    KisPaintDeviceSP result;
+    QRect resultBounds;
+};
+
+KisStrokePredictionOverlay::KisStrokePredictionOverlay(KisResourcesSnapshotSP resources)
+    : m_d(new Private)
+{
+    KisImageSP image = resources->image();
+
+    m_d->device = new KisPaintDevice(image->colorSpace());
+    m_d->device->setDefaultBounds(new KisDefaultBounds(image));
+
+    m_d->strokeRandomSource = new KisPerStrokeRandomSource();
+
+    m_d->painter.reset(new KisPainter(m_d->device));
+    m_d->painter->setPaintColor(resources->currentFgColor());
+    m_d->painter->setBackgroundColor(resources->currentBgColor());
+    m_d->painter->setOpacity(resources->opacity());
+
+    /**
+     * The layer's composite op (e.g. erase) is applied when the real
+     * dabs are painted, the provisional ones are always just shown
+     * over the canvas
+     */
+    m_d->painter->setCompositeOp(COMPOSITE_OVER);
+
+    m_d->painter->setPaintOpPreset(resources->currentPaintOpPreset(),
+                                   resources->currentNode(),
+                                   image);
+
+    m_d->renderingThread.setMaxThreadCount(1);
+}
+
+KisStrokePredictionOverlay::~KisStrokePredictionOverlay()
+{
+    {
+        QMutexLocker l(&m_d->mutex);
+        m_d->isCancelled = true;
+        m_d->hasPendingRequest = false;
+    }
+
+    m_d->renderingThread.waitForDone();
+}
+
+void KisStrokePredictionOverlay::requestUpdate(const KisPaintInformation &from, const KisPaintInformation &to)
+{
+    QMutexLocker l(&m_d->mutex);
+
+    if (m_d->isCancelled) return;
+
+    m_d->pendingFrom = from;
+    m_d->pendingTo = to;
+    m_d->hasPendingRequest = true;
+
+    if (!m_d->isRendering) {
+        m_d->isRendering = true;
+        QtConcurrent::run(&m_d->renderingThread, [this] () { renderPendingRequests(); });
+    }
+}
+
+void KisStrokePredictionOverlay::renderPendingRequests()
+{
+    forever {
+        KisPaintInformation pi1;
+        KisPaintInformation pi2;
+
+        {
+            QMutexLocker l(&m_d->mutex);
+
+            if (!m_d->hasPendingRequest || m_d->isCancelled) {
+                m_d->isRendering = false;
+                return;
+            }
+
+            pi1 = m_d->pendingFrom;
+            pi2 = m_d->pendingTo;
+            m_d->hasPendingRequest = false;
+        }
+
+        m_d->device->clear();
+
+        /**
+         * Use the same random sequence every time, otherwise the
+         * provisional dabs of the random-based brushes would flicker
+         */
+        KisRandomSourceSP rnd = new KisRandomSource(0);
+
+        pi1.setRandomSource(rnd);
+        pi2.setRandomSource(rnd);
+        pi1.setPerStrokeRandomSource(m_d->strokeRandomSource);
+        pi2.setPerStrokeRandomSource(m_d->strokeRandomSource);
+
+        KisDistanceInformation distance(pi1.pos(), 0.0);
+        m_d->painter->paintLine(pi1, pi2, &distance);
+        KisPaintOpUtils::flushAsynchronousUpdates(m_d->painter.data());
+
+        // the GUI thread gets a copy, so that it is never painted on
+        KisPaintDeviceSP snapshot = new KisPaintDevice(*m_d->device);
+        const QRect bounds = m_d->device->extent();
+
+        QRect dirtyRect;
+
+        {
+            QMutexLocker l(&m_d->mutex);
+
+            if (m_d->isCancelled) {
+                m_d->isRendering = false;
+                return;
+            }
+
+            dirtyRect = m_d->resultBounds | bounds;
+            m_d->result = snapshot;
+            m_d->resultBounds = bounds;
+        }
+
+        if (!dirtyRect.isEmpty()) {
+            emit sigUpdated(dirtyRect);
+        }
+    }
+}
+
+QRect KisStrokePredictionOverlay::clear()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    const QRect dirtyRect = m_d->resultBounds;
+
+    m_d->isCancelled = true;
+    m_d->hasPendingRequest = false;
+    m_d->result = 0;
+    m_d->resultBounds = QRect();
+
+    return dirtyRect;
+}
+
+KisPaintDeviceSP KisStrokePredictionOverlay::device() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->result;
+}
+
+QRect KisStrokePredictionOverlay::bounds() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->resultBounds;
+}
@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKEPREDICTIONOVERLAY_H
+#define KISSTROKEPREDICTIONOVERLAY_H
+
+#include <QObject>
+#include <QRect>
+#include <QScopedPointer>
+
+#include "kis_types.h"
+#include "kis_resources_snapshot.h"
+#include "kritaui_export.h"
+
+class KisPaintInformation;
+
+/**
+ * A temporary device with the provisional dabs of the predicted part of
+ * a stroke. The dabs are painted with the preset and colors of the
+ * stroke, but never reach the layer: the device is cleared and repainted
+ * every time the prediction changes, and is shown by the tool on top of
+ * the canvas until the real dabs arrive.
+ *
+ * The dabs are painted in a background thread, so the input events are
+ * never delayed by the overlay. When the prediction changes faster than
+ * the dabs are painted, only the latest request is rendered.
+ */
+class KRITAUI_EXPORT KisStrokePredictionOverlay : public QObject
+{
+    Q_OBJECT
+public:
+    KisStrokePredictionOverlay(KisResourcesSnapshotSP resources);
+    ~KisStrokePredictionOverlay() override;
+
+    /**
+     * Requests replacing the content of the overlay with the line of
+     * dabs from \p from to \p to. The dab at \p from is considered to be
+     * painted by the stroke already. sigUpdated() is emitted when the
+     * new content is ready.
+     */
+    void requestUpdate(const KisPaintInformation &from, const KisPaintInformation &to);
+
+    /**
+     * Removes all the dabs from the overlay and stops rendering, the
+     * overlay cannot be updated anymore after that
+     *
+     * \return the image rect that should be updated on the canvas
+     */
+    QRect clear();
+
+    /**
+     * The snapshot of the latest rendered content of the overlay, it
+     * is never changed after it has been returned
+     */
+    KisPaintDeviceSP device() const;
+    QRect bounds() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted from the rendering thread when the content of the overlay
+     * changes in \p dirtyRect, that is both the old and the new content
+     */
+    void sigUpdated(const QRect &dirtyRect);
+
+private:
+    void renderPendingRequests();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISSTROKEPREDICTIONOVERLAY_H
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokePredictor.h"
+
+// The weight of the newest velocity measurement in the moving average
+const qreal VELOCITY_SMOOTHING_FACTOR = 0.5;
+
+KisStrokePredictor::KisStrokePredictor()
+    : m_hasVelocity(false)
+{
+}
+
+void KisStrokePredictor::reset(const KisPaintInformation &pi)
+{
+    m_lastSample = pi;
+    m_velocity = QPointF();
+    m_hasVelocity = false;
+}
+
+void KisStrokePredictor::addSample(const KisPaintInformation &pi)
+{
+    const qreal dt = pi.currentTime() - m_lastSample.currentTime();
+
+    if (dt > 0) {
+        const QPointF velocity = (pi.pos() - m_lastSample.pos()) / dt;
+
+        m_velocity = m_hasVelocity ?
+            VELOCITY_SMOOTHING_FACTOR * velocity + (1.0 - VELOCITY_SMOOTHING_FACTOR) * m_velocity :
+            velocity;
+
+        m_hasVelocity = true;
+    }
+
+    m_lastSample = pi;
+}
+
+QPointF KisStrokePredictor::velocity() const
+{
+    return m_velocity;
+}
+
+KisPaintInformation KisStrokePredictor::lastSample() const
+{
+    return m_lastSample;
+}
+
+KisPaintInformation KisStrokePredictor::predict(qreal horizon) const
+{
+    KisPaintInformation pi(m_lastSample);
+    pi.setPos(m_lastSample.pos() + horizon * m_velocity);
+    return pi;
+}
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKEPREDICTOR_H
+#define KISSTROKEPREDICTOR_H
+
+#include <QPointF>
+
+#include "kis_paint_information.h"
+#include "kritaui_export.h"
+
+/**
+ * Extrapolates the raw cursor trajectory of a stroke. The velocity is
+ * an exponential moving average of the velocities between the samples,
+ * measured in pixels per millisecond of the stroke time.
+ */
+class KRITAUI_EXPORT KisStrokePredictor
+{
+public:
+    KisStrokePredictor();
+
+    /**
+     * Starts a new trajectory at \p pi and forgets the velocity
+     */
+    void reset(const KisPaintInformation &pi);
+
+    /**
+     * Adds a new sample of the trajectory. Samples with the same or
+     * an older time than the last one don't change the velocity.
+     */
+    void addSample(const KisPaintInformation &pi);
+
+    QPointF velocity() const;
+    KisPaintInformation lastSample() const;
+
+    /**
+     * \return the last sample moved to the position the cursor is
+     * expected to have in \p horizon milliseconds
+     */
+    KisPaintInformation predict(qreal horizon) const;
+
+private:
+    KisPaintInformation m_lastSample;
+    QPointF m_velocity;
+    bool m_hasVelocity;
+};
+
+#endif // KISSTROKEPREDICTOR_H
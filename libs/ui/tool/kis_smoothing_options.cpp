@@ -34,6 +34,7 @@ struct KisSmoothingOptions::Private {
         useDelayDistance = cfg.lineSmoothingUseDelayDistance(!useSavedSmoothing);
         finishStabilizedCurve = cfg.lineSmoothingFinishStabilizedCurve(!useSavedSmoothing);
         stabilizeSensors = cfg.lineSmoothingStabilizeSensors(!useSavedSmoothing);
+        predictStroke = cfg.lineSmoothingPredictStroke(!useSavedSmoothing);
     }
 
     KisSignalCompressor writeCompressor;
@@ -47,6 +48,7 @@ struct KisSmoothingOptions::Private {
     bool useDelayDistance;
     bool finishStabilizedCurve;
     bool stabilizeSensors;
+    bool predictStroke;
 };
 
 KisSmoothingOptions::KisSmoothingOptions(bool useSavedSmoothing)
@@ -164,6 +166,17 @@ bool KisSmoothingOptions::stabilizeSensors() const
     return m_d->stabilizeSensors;
 }
 
+void KisSmoothingOptions::setPredictStroke(bool value)
+{
+    m_d->predictStroke = value;
+    m_d->writeCompressor.start();
+}
+
+bool KisSmoothingOptions::predictStroke() const
+{
+    return m_d->predictStroke;
+}
+
 void KisSmoothingOptions::slotWriteConfig()
 {
     KisConfig cfg(false);
@@ -176,4 +189,5 @@ void KisSmoothingOptions::slotWriteConfig()
     cfg.setLineSmoothingUseDelayDistance(m_d->useDelayDistance);
     cfg.setLineSmoothingFinishStabilizedCurve(m_d->finishStabilizedCurve);
     cfg.setLineSmoothingStabilizeSensors(m_d->stabilizeSensors);
+    cfg.setLineSmoothingPredictStroke(m_d->predictStroke);
 }
@@ -68,6 +68,14 @@ public:
     void setStabilizeSensors(bool value);
     bool stabilizeSensors() const;
 
+    /**
+     * When enabled, the freehand tool shows the part of the stroke
+     * that has not been painted yet due to smoothing and update
+     * latency as a provisional overlay
+     */
+    void setPredictStroke(bool value);
+    bool predictStroke() const;
+
 Q_SIGNALS:
     void sigSmoothingTypeChanged();
 
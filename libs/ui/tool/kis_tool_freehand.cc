@@ -53,6 +53,7 @@
 #include "kis_abstract_perspective_grid.h"
 #include "kis_config.h"
 #include "canvas/kis_canvas2.h"
+#include "kis_display_color_converter.h"
 #include "kis_cursor.h"
 #include <KisViewManager.h>
 #include <kis_painting_assistants_decoration.h>
@@ -79,6 +80,7 @@ KisToolFreehand::KisToolFreehand(KoCanvasBase * canvas, const QCursor & cursor,
     m_helper = new KisToolFreehandHelper(m_infoBuilder, canvas->resourceManager(), transactionText);
 
     connect(m_helper, SIGNAL(requestExplicitUpdateOutline()), SLOT(explicitUpdateOutline()));
+    connect(m_helper, SIGNAL(requestPredictionOverlayUpdate(QRect)), SLOT(updatePredictionOverlay(QRect)));
 }
 
 KisToolFreehand::~KisToolFreehand()
@@ -440,6 +442,42 @@ void KisToolFreehand::explicitUpdateOutline()
     requestUpdateOutline(m_outlineDocPoint, 0);
 }
 
+void KisToolFreehand::updatePredictionOverlay(const QRect &imageRect)
+{
+    if (!image()) return;
+
+    KisCanvas2 *kiscanvas = dynamic_cast<KisCanvas2*>(canvas());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(kiscanvas);
+
+    KisPaintDeviceSP overlay = m_helper->predictionOverlay();
+
+    m_predictionImageRect = overlay ? overlay->exactBounds() : QRect();
+    m_predictionImage = !m_predictionImageRect.isEmpty() ?
+        kiscanvas->displayColorConverter()->toQImage(overlay) : QImage();
+
+    canvas()->updateCanvas(image()->pixelToDocument(QRectF(imageRect)));
+}
+
+void KisToolFreehand::paint(QPainter &gc, const KoViewConverter &converter)
+{
+    KisToolPaint::paint(gc, converter);
+
+    if (m_predictionImage.isNull()) return;
+
+    KisCanvas2 *kiscanvas = dynamic_cast<KisCanvas2*>(canvas());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(kiscanvas);
+
+    /**
+     * The overlay is in image pixels, so it is drawn through the full
+     * image-to-widget transform, which includes the rotation and the
+     * mirroring of the canvas
+     */
+    gc.save();
+    gc.setTransform(kiscanvas->coordinatesConverter()->imageToWidgetTransform());
+    gc.drawImage(m_predictionImageRect.topLeft(), m_predictionImage);
+    gc.restore();
+}
+
 QPainterPath KisToolFreehand::getOutlinePath(const QPointF &documentPos,
                                              const KoPointerEvent *event,
                                              KisPaintOpSettings::OutlineMode outlineMode)
@@ -19,6 +19,8 @@
 #ifndef KIS_TOOL_FREEHAND_H_
 #define KIS_TOOL_FREEHAND_H_
 
+#include <QImage>
+
 #include <brushengine/kis_paint_information.h>
 #include <brushengine/kis_paintop_settings.h>
 #include <kis_distance_information.h>
@@ -47,6 +49,7 @@ public:
     ~KisToolFreehand() override;
     int flags() const override;
     void mouseMoveEvent(KoPointerEvent *event) override;
+    void paint(QPainter &gc, const KoViewConverter &converter) override;
 
 public Q_SLOTS:
     void activate(ToolActivation toolActivation, const QSet<KoShape*> &shapes) override;
@@ -85,6 +88,7 @@ protected:
 protected Q_SLOTS:
 
     void explicitUpdateOutline();
+    void updatePredictionOverlay(const QRect &imageRect);
     void resetCursorStyle() override;
     void setAssistant(bool assistant);
     void setOnlyOneAssistantSnap(bool assistant);
@@ -117,6 +121,13 @@ private:
     KisPaintingInformationBuilder *m_infoBuilder;
     KisToolFreehandHelper *m_helper;
 
+    /**
+     * The prediction overlay converted into the display color space,
+     * it is converted once per overlay update instead of every repaint
+     */
+    QImage m_predictionImage;
+    QRect m_predictionImageRect;
+
     QPointF m_initialGestureDocPoint;
     QPointF m_lastDocumentPoint;
     qreal m_lastPaintOpSize;
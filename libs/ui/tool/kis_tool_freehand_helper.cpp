@@ -21,6 +21,9 @@
 #include <QTimer>
 #include <QElapsedTimer>
 #include <QQueue>
+#include <QDateTime>
+#include <QDir>
+#include <QtConcurrent>
 
 #include <klocalizedstring.h>
 
@@ -34,10 +37,13 @@
 #include "kis_painter.h"
 #include <brushengine/kis_paintop_preset.h>
 #include <brushengine/kis_paintop_utils.h>
+#include <brushengine/KisStrokeRecording.h>
 
 #include "kis_update_time_monitor.h"
 #include "kis_stabilized_events_sampler.h"
 #include "KisStabilizerDelayedPaintHelper.h"
+#include "KisStrokePredictor.h"
+#include "KisStrokePredictionOverlay.h"
 #include "kis_config.h"
 
 #include "kis_random_source.h"
@@ -65,6 +71,10 @@ const qreal SPACING_UPDATE_INTERVAL = 50.0;
 // used when airbrushing.
 const qreal TIMING_UPDATE_INTERVAL = 50.0;
 
+// The maximum time, in milliseconds, the cursor trajectory is extrapolated for when predicting the
+// stroke. The actual horizon is the measured update latency of the image.
+const qreal MAX_PREDICTION_HORIZON = 50.0;
+
 struct KisToolFreehandHelper::Private
 {
     KoCanvasResourceProvider *resourceManager;
@@ -114,6 +124,18 @@ struct KisToolFreehandHelper::Private
     KisStabilizedEventsSampler stabilizedSampler;
     KisStabilizerDelayedPaintHelper stabilizerDelayedPaintHelper;
 
+    // Recording of the painted primitives, active only when
+    // KRITA_STROKE_RECORDING_DIR environment variable is set
+    QScopedPointer<KisStrokeRecording> recording;
+
+    // Stroke prediction data. The part of the stroke between the end of the
+    // last painted primitive and the extrapolated cursor position is painted
+    // as provisional dabs into the overlay until the real input arrives
+    bool predictStroke = false;
+    KisPaintInformation lastPaintedInfo;
+    KisStrokePredictor predictor;
+    QScopedPointer<KisStrokePredictionOverlay> predictionOverlay;
+
     qreal effectiveSmoothnessDistance() const;
 };
 
@@ -283,6 +305,11 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
 
     m_d->previousPaintInformation = pi;
 
+    m_d->predictStroke =
+        m_d->smoothingOptions->predictStroke() &&
+        (m_d->smoothingOptions->smoothingType() == KisSmoothingOptions::WEIGHTED_SMOOTHING ||
+         m_d->smoothingOptions->smoothingType() == KisSmoothingOptions::STABILIZER);
+
     m_d->resources = new KisResourcesSnapshot(image,
                                               currentNode,
                                               resourceManager,
@@ -291,6 +318,15 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
         m_d->resources->setCurrentNode(overrideNode);
     }
 
+    if (m_d->predictStroke) {
+        m_d->lastPaintedInfo = pi;
+        m_d->predictor.reset(pi);
+        m_d->predictionOverlay.reset(new KisStrokePredictionOverlay(m_d->resources));
+        connect(m_d->predictionOverlay.data(), SIGNAL(sigUpdated(QRect)),
+                SIGNAL(requestPredictionOverlayUpdate(QRect)), Qt::QueuedConnection);
+        KisUpdateTimeMonitor::instance()->startLatencyMeasure();
+    }
+
     const bool airbrushing = m_d->resources->needsAirbrushing();
     const bool useSpacingUpdates = m_d->resources->needsSpacingUpdates();
 
@@ -309,6 +345,17 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
 
     m_d->strokeId = m_d->strokesFacade->startStroke(stroke);
 
+    if (!qEnvironmentVariableIsEmpty("KRITA_STROKE_RECORDING_DIR")) {
+        m_d->recording.reset(new KisStrokeRecording());
+        m_d->recording->setImageState(m_d->resources->image());
+
+        // the recording is saved in a background thread, so it needs its own copy of the preset
+        m_d->recording->setPainterState(m_d->resources->currentFgColor(),
+                                        m_d->resources->compositeOpId(),
+                                        m_d->resources->opacity(),
+                                        m_d->resources->currentPaintOpPreset()->clone().dynamicCast<KisPaintOpPreset>());
+    }
+
     m_d->history.clear();
     m_d->distanceHistory.clear();
 
@@ -449,7 +496,53 @@ void KisToolFreehandHelper::paintEvent(KoPointerEvent *event)
                                              elapsedStrokeTime());
     KisUpdateTimeMonitor::instance()->reportMouseMove(info.pos());
 
+    if (m_d->predictStroke) {
+        m_d->predictor.addSample(info);
+    }
+
     paint(info);
+
+    if (m_d->predictStroke) {
+        updatePredictionOverlay();
+    }
+}
+
+void KisToolFreehandHelper::updatePredictionOverlay()
+{
+    const qreal horizon =
+        qMin(KisUpdateTimeMonitor::instance()->averageUpdateLatency(),
+             MAX_PREDICTION_HORIZON);
+
+    /**
+     * The provisional dabs cover the part of the stroke delayed by
+     * smoothing, from the last painted position to the latest cursor
+     * position, and the extrapolation of the cursor trajectory by
+     * the time the image needs to show the real dabs
+     */
+    KisPaintInformation predictedInfo = m_d->predictor.predict(horizon);
+
+    m_d->predictionOverlay->requestUpdate(m_d->lastPaintedInfo, predictedInfo);
+}
+
+void KisToolFreehandHelper::stopPrediction()
+{
+    if (m_d->predictStroke) {
+        m_d->predictStroke = false;
+
+        const QRect dirtyRect = m_d->predictionOverlay->clear();
+        m_d->predictionOverlay.reset();
+
+        if (!dirtyRect.isEmpty()) {
+            emit requestPredictionOverlayUpdate(dirtyRect);
+        }
+
+        KisUpdateTimeMonitor::instance()->endLatencyMeasure();
+    }
+}
+
+KisPaintDeviceSP KisToolFreehandHelper::predictionOverlay() const
+{
+    return m_d->predictionOverlay ? m_d->predictionOverlay->device() : KisPaintDeviceSP();
 }
 
 void KisToolFreehandHelper::paint(KisPaintInformation &info)
@@ -646,12 +739,34 @@ void KisToolFreehandHelper::endPaint()
 
     m_d->strokesFacade->endStroke(m_d->strokeId);
     m_d->strokeId.clear();
+
+    stopPrediction();
+
+    if (m_d->recording) {
+        const QDir dir(qgetenv("KRITA_STROKE_RECORDING_DIR"));
+        const QString fileName =
+            QString("stroke-%1.kstroke")
+                .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"));
+
+        const QString filePath = dir.absoluteFilePath(fileName);
+
+        /**
+         * Serializing a long stroke takes noticeable time, so it is
+         * saved in a background thread to not block the GUI
+         */
+        QSharedPointer<KisStrokeRecording> recording(m_d->recording.take());
+        QtConcurrent::run([recording, filePath] () {
+            recording->save(filePath);
+        });
+    }
 }
 
 void KisToolFreehandHelper::cancelPaint()
 {
     if (!m_d->strokeId) return;
 
+    m_d->recording.reset();
+
     m_d->strokeTimeoutTimer.stop();
 
     if (m_d->airbrushingTimer.isActive()) {
@@ -676,6 +791,8 @@ void KisToolFreehandHelper::cancelPaint()
     m_d->strokesFacade->cancelStroke(m_d->strokeId);
     m_d->strokeId.clear();
 
+    stopPrediction();
+
 }
 
 int KisToolFreehandHelper::elapsedStrokeTime() const
@@ -816,6 +933,10 @@ void KisToolFreehandHelper::stabilizerPollAndPaint()
     } else {
         emit requestExplicitUpdateOutline();
     }
+
+    if (m_d->predictStroke) {
+        updatePredictionOverlay();
+    }
 }
 
 void KisToolFreehandHelper::stabilizerEnd()
@@ -909,6 +1030,14 @@ void KisToolFreehandHelper::paintAt(int strokeInfoId,
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi));
 
+    if (strokeInfoId == 0) {
+        m_d->lastPaintedInfo = pi;
+    }
+
+    if (m_d->recording && strokeInfoId == 0) {
+        m_d->recording->addPoint(pi);
+    }
+
 }
 
 void KisToolFreehandHelper::paintLine(int strokeInfoId,
@@ -919,6 +1048,14 @@ void KisToolFreehandHelper::paintLine(int strokeInfoId,
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi1, pi2));
 
+    if (strokeInfoId == 0) {
+        m_d->lastPaintedInfo = pi2;
+    }
+
+    if (m_d->recording && strokeInfoId == 0) {
+        m_d->recording->addLine(pi1, pi2);
+    }
+
 }
 
 void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
@@ -956,6 +1093,14 @@ void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
                                new FreehandStrokeStrategy::Data(strokeInfoId,
                                                                 pi1, control1, control2, pi2));
 
+    if (strokeInfoId == 0) {
+        m_d->lastPaintedInfo = pi2;
+    }
+
+    if (m_d->recording && strokeInfoId == 0) {
+        m_d->recording->addBezierCurve(pi1, control1, control2, pi2);
+    }
+
 }
 
 void KisToolFreehandHelper::createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
@@ -84,6 +84,12 @@ public:
                                 const KisPaintOpSettingsSP globalSettings,
                                 KisPaintOpSettings::OutlineMode mode) const;
 
+    /**
+     * The device with the provisional dabs of the predicted part of
+     * the stroke, or null if the prediction is not active
+     */
+    KisPaintDeviceSP predictionOverlay() const;
+
 Q_SIGNALS:
     /**
      * The signal is emitted when the outline should be updated
@@ -93,6 +99,12 @@ Q_SIGNALS:
      */
     void requestExplicitUpdateOutline();
 
+    /**
+     * The signal is emitted when the content of the prediction overlay
+     * changes in \p imageRect (in image pixels)
+     */
+    void requestPredictionOverlayUpdate(const QRect &imageRect);
+
 protected:
     void cancelPaint();
     int elapsedStrokeTime() const;
@@ -150,6 +162,9 @@ private:
                                                const KisPaintInformation &lastPaintInfo);
     int computeAirbrushTimerInterval() const;
 
+    void updatePredictionOverlay();
+    void stopPrediction();
+
     qreal currentZoom() const;
 
 private Q_SLOTS:
@@ -19,6 +19,8 @@
 #ifndef KISMASKINGBRUSHCOMPOSITEOP_H
 #define KISMASKINGBRUSHCOMPOSITEOP_H
 
+#include <cstring>
+
 #include <KoColorSpaceTraits.h>
 #include <KoGrayColorSpaceTraits.h>
 #include <KoColorSpaceMaths.h>
@@ -36,32 +38,33 @@ public:
     }
 
     void composite(const quint8 *srcRowStart, int srcRowStride,
+                   const quint8 *maskRowStart, int maskRowStride,
                    quint8 *dstRowStart, int dstRowStride,
                    int columns, int rows) override {
 
         using MaskPixel = KoGrayU8Traits::Pixel;
 
-        dstRowStart += m_dstAlphaOffset;
+        const int rowSize = columns * m_dstPixelSize;
 
         for (int y = 0; y < rows; y++) {
-            const quint8 *srcPtr = srcRowStart;
-            quint8 *dstPtr = dstRowStart;
-
-            for (int x = 0; x < columns; x++) {
+            memcpy(dstRowStart, srcRowStart, rowSize);
 
-                const MaskPixel *srcDataPtr = reinterpret_cast<const MaskPixel*>(srcPtr);
+            const MaskPixel *maskPtr = reinterpret_cast<const MaskPixel*>(maskRowStart);
+            quint8 *dstPtr = dstRowStart + m_dstAlphaOffset;
 
-                const quint8 mask = KoColorSpaceMaths<quint8>::multiply(srcDataPtr->gray, srcDataPtr->alpha);
+            for (int x = 0; x < columns; x++) {
+                const quint8 mask = KoColorSpaceMaths<quint8>::multiply(maskPtr->gray, maskPtr->alpha);
                 const channels_type maskScaled = KoColorSpaceMaths<quint8, channels_type>::scaleToA(mask);
 
                 channels_type *dstDataPtr = reinterpret_cast<channels_type*>(dstPtr);
                 *dstDataPtr = compositeFunc(maskScaled, *dstDataPtr);
 
-                srcPtr += sizeof(MaskPixel);
+                maskPtr++;
                 dstPtr += m_dstPixelSize;
             }
 
             srcRowStart += srcRowStride;
+            maskRowStart += maskRowStride;
             dstRowStart += dstRowStride;
         }
     }
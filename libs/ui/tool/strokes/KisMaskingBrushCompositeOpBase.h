@@ -26,7 +26,16 @@ class KisMaskingBrushCompositeOpBase
 {
 public:
     virtual ~KisMaskingBrushCompositeOpBase() {}
+
+    /**
+     * Copies the pixels of the stroke from \p srcRowStart into
+     * \p dstRowStart and composites the alpha channel of the copied
+     * pixels with the GrayA8 mask from \p maskRowStart. Both steps are
+     * done in a single pass over the rows, so the destination row is
+     * still hot in the cache when its alpha channel is processed.
+     */
     virtual void composite(const quint8 *srcRowStart, int srcRowStride,
+                           const quint8 *maskRowStart, int maskRowStride,
                            quint8 *dstRowStart, int dstRowStride,
                            int columns, int rows) = 0;
 };
@@ -24,7 +24,6 @@
 #include <KoChannelInfo.h>
 #include <KoCompositeOpRegistry.h>
 
-#include "kis_painter.h"
 #include "kis_paint_device.h"
 #include "kis_random_accessor_ng.h"
 
@@ -86,10 +85,15 @@ void KisMaskingBrushRenderer::updateProjection(const QRect &rc)
 {
     if (rc.isEmpty()) return;
 
-    KisPainter::copyAreaOptimized(rc.topLeft(), m_strokeDevice, m_dstDevice, rc);
+    /**
+     * The stroke is copied into the destination device and masked in
+     * the same pass, so we don't have to walk through the destination
+     * tiles twice.
+     */
 
-    KisRandomAccessorSP dstIt = m_dstDevice->createRandomAccessorNG();
+    KisRandomConstAccessorSP srcIt = m_strokeDevice->createRandomConstAccessorNG();
     KisRandomConstAccessorSP maskIt = m_maskDevice->createRandomConstAccessorNG();
+    KisRandomAccessorSP dstIt = m_dstDevice->createRandomAccessorNG();
 
     qint32 dstY = rc.y();
     qint32 rowsRemaining = rc.height();
@@ -97,26 +101,31 @@ void KisMaskingBrushRenderer::updateProjection(const QRect &rc)
     while (rowsRemaining > 0) {
         qint32 dstX = rc.x();
 
+        const qint32 numContiguousSrcRows = srcIt->numContiguousRows(dstY);
         const qint32 numContiguousDstRows = dstIt->numContiguousRows(dstY);
         const qint32 numContiguousMaskRows = maskIt->numContiguousRows(dstY);
 
-        const qint32 rows = std::min({rowsRemaining, numContiguousDstRows, numContiguousMaskRows});
+        const qint32 rows = std::min({rowsRemaining, numContiguousSrcRows, numContiguousDstRows, numContiguousMaskRows});
 
         qint32 columnsRemaining = rc.width();
 
         while (columnsRemaining > 0) {
 
+            const qint32 numContiguousSrcColumns = srcIt->numContiguousColumns(dstX);
             const qint32 numContiguousDstColumns = dstIt->numContiguousColumns(dstX);
             const qint32 numContiguousMaskColumns = maskIt->numContiguousColumns(dstX);
-            const qint32 columns = std::min({columnsRemaining, numContiguousDstColumns, numContiguousMaskColumns});
+            const qint32 columns = std::min({columnsRemaining, numContiguousSrcColumns, numContiguousDstColumns, numContiguousMaskColumns});
 
+            const qint32 srcRowStride = srcIt->rowStride(dstX, dstY);
             const qint32 dstRowStride = dstIt->rowStride(dstX, dstY);
             const qint32 maskRowStride = maskIt->rowStride(dstX, dstY);
 
+            srcIt->moveTo(dstX, dstY);
             dstIt->moveTo(dstX, dstY);
             maskIt->moveTo(dstX, dstY);
 
-            m_compositeOp->composite(maskIt->rawDataConst(), maskRowStride,
+            m_compositeOp->composite(srcIt->rawDataConst(), srcRowStride,
+                                     maskIt->rawDataConst(), maskRowStride,
                                      dstIt->rawData(), dstRowStride,
                                      columns, rows);
 
@@ -128,4 +137,3 @@ void KisMaskingBrushRenderer::updateProjection(const QRect &rc)
         rowsRemaining -= rows;
     }
 }
-
@@ -20,11 +20,12 @@
 #define KISMASKINGBRUSHRENDERER_H
 
 #include "kis_types.h"
+#include "kritaui_export.h"
 
 class KisMaskingBrushCompositeOpBase;
 
 
-class KisMaskingBrushRenderer
+class KRITAUI_EXPORT KisMaskingBrushRenderer
 {
 public:
     KisMaskingBrushRenderer(KisPaintDeviceSP dstDevice, const QString &compositeOpId);
@@ -74,6 +74,14 @@ struct FreehandStrokeStrategy::Private
 
     const bool needsAsynchronousUpdates = false;
     std::mutex updateEntryMutex;
+
+    /**
+     * The jobs painted since the last setDirty() call. Their result
+     * reaches the projection with the next dirty rects, which is what
+     * KisUpdateTimeMonitor measures the latency to.
+     */
+    QVector<void*> paintedJobs;
+    std::mutex paintedJobsMutex;
 };
 
 FreehandStrokeStrategy::FreehandStrokeStrategy(KisResourcesSnapshotSP resources,
@@ -217,6 +225,11 @@ void FreehandStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
             break;
         };
 
+        {
+            std::lock_guard<std::mutex> l(m_d->paintedJobsMutex);
+            m_d->paintedJobs.append(data);
+        }
+
         tryDoUpdate();
     } else {
         KisPainterBasedStrokeStrategy::doStrokeCallback(data);
@@ -292,6 +305,19 @@ void FreehandStrokeStrategy::issueSetDirtySignals()
         dirtyRects.append(maskedPainter->takeDirtyRegion());
     }
 
+    // the jobs should be reported before the update is requested,
+    // otherwise the update might finish before the monitor knows about them
+    QVector<void*> paintedJobs;
+
+    {
+        std::lock_guard<std::mutex> l(m_d->paintedJobsMutex);
+        paintedJobs.swap(m_d->paintedJobs);
+    }
+
+    Q_FOREACH (void *job, paintedJobs) {
+        KisUpdateTimeMonitor::instance()->reportJobFinished(job, dirtyRects);
+    }
+
     if (needsMaskingUpdates()) {
 
         // optimize the rects so that they would never intersect with each other!
@@ -329,8 +355,6 @@ void FreehandStrokeStrategy::issueSetDirtySignals()
     } else {
         targetNode()->setDirty(dirtyRects);
     }
-
-    //KisUpdateTimeMonitor::instance()->reportJobFinished(data, dirtyRects);
 }
 
 KisStrokeStrategy* FreehandStrokeStrategy::createLodClone(int levelOfDetail)
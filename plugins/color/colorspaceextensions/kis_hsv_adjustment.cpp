@@ -24,6 +24,10 @@
 #endif
 
 #include <QByteArray>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <limits>
 
 #include <kis_debug.h>
 #include <klocalizedstring.h>
@@ -35,6 +39,8 @@
 #include <KoColorTransformation.h>
 #include <KoID.h>
 
+#include "kis_hsv_adjustment_kernel_factory_impl.h"
+
 #define SCALE_TO_FLOAT( v ) KoColorSpaceMaths< _channel_type_, float>::scaleToA( v )
 #define SCALE_FROM_FLOAT( v  ) KoColorSpaceMaths< float, _channel_type_>::scaleToA( v )
 
@@ -329,6 +335,30 @@ void HSVTransform(float *r, float *g, float *b, float dh, float ds, float dv, Va
 }
 
 
+template<typename _channel_type_>
+struct HSVKernelChannelType {
+    static const bool isSupported = false;
+    static const KisHSVAdjustmentKernelParams::ChannelType value = KisHSVAdjustmentKernelParams::UInt8;
+};
+
+template<>
+struct HSVKernelChannelType<quint8> {
+    static const bool isSupported = true;
+    static const KisHSVAdjustmentKernelParams::ChannelType value = KisHSVAdjustmentKernelParams::UInt8;
+};
+
+template<>
+struct HSVKernelChannelType<quint16> {
+    static const bool isSupported = true;
+    static const KisHSVAdjustmentKernelParams::ChannelType value = KisHSVAdjustmentKernelParams::UInt16;
+};
+
+template<>
+struct HSVKernelChannelType<float> {
+    static const bool isSupported = true;
+    static const KisHSVAdjustmentKernelParams::ChannelType value = KisHSVAdjustmentKernelParams::Float32;
+};
+
 template<typename _channel_type_,typename traits>
 class KisHSVAdjustment : public KoColorTransformation
 {
@@ -345,7 +375,8 @@ public:
         m_lumaBlue(0.0),
         m_type(0),
         m_colorize(false),
-        m_compatibilityMode(true)
+        m_compatibilityMode(true),
+        m_forceScalarImplementation(false)
     {
     }
 
@@ -353,6 +384,10 @@ public:
 
     void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const override
     {
+        if (m_kernel) {
+            m_kernel->transform(srcU8, dstU8, nPixels);
+            return;
+        }
 
         //if (m_model="RGBA" || m_colorize) {
         /*It'd be nice to have LCH automatically selector for LAB in the future, but I don't know how to select LAB
@@ -565,7 +600,7 @@ public:
     QList<QString> parameters() const override
     {
       QList<QString> list;
-      list << "h" << "s" << "v" << "type" << "colorize" << "lumaRed" << "lumaGreen"<< "lumaBlue" << "compatibilityMode";
+      list << "h" << "s" << "v" << "type" << "colorize" << "lumaRed" << "lumaGreen"<< "lumaBlue" << "compatibilityMode" << "forceScalarImplementation";
       return list;
     }
 
@@ -589,6 +624,8 @@ public:
             return 7;
         } else if (name == "compatibilityMode") {
             return 8;
+        } else if (name == "forceScalarImplementation") {
+            return 9;
         }
         return -1;
     }
@@ -601,6 +638,7 @@ public:
     * type: 0:HSV, 1:HSL, 2:HSI, 3:HSY, 4:YUV
     * m_colorize: Use colorize formula instead
     * luma Red/Green/Blue: Used for luma calculations.
+    * forceScalarImplementation: don't use the vectorized kernel (for tests and benchmarks)
     */
     void setParameter(int id, const QVariant& parameter) override
     {
@@ -633,10 +671,49 @@ public:
         case 8:
             m_compatibilityMode = parameter.toBool();
             break;
+        case 9:
+            m_forceScalarImplementation = parameter.toBool();
+            break;
         default:
             KIS_ASSERT_RECOVER_NOOP(false && "Unknown parameter ID. Ignored!");
-            ;
+            return;
         }
+
+        updateKernel();
+    }
+
+private:
+
+    /**
+     * Only the non-compatibility modes of HSV, HSL, HSI and HSY have
+     * a vectorized implementation, the rest of the modes and the
+     * half-float color spaces use the scalar code in transform()
+     */
+    void updateKernel()
+    {
+        m_kernel.reset();
+
+        if (!HSVKernelChannelType<_channel_type_>::isSupported ||
+            m_colorize || m_compatibilityMode ||
+            m_type < 0 || m_type > 3) {
+
+            return;
+        }
+
+        KisHSVAdjustmentKernelParams params;
+        params.channelType = HSVKernelChannelType<_channel_type_>::value;
+        params.type = m_type;
+        params.dh = m_adj_h;
+        params.ds = m_adj_s;
+        params.dv = m_adj_v;
+
+        if (m_lumaRed > 0 && m_lumaGreen > 0 && m_lumaBlue > 0) {
+            params.lumaRed = m_lumaRed;
+            params.lumaGreen = m_lumaGreen;
+            params.lumaBlue = m_lumaBlue;
+        }
+
+        m_kernel.reset(createOptimizedClass<KisHSVAdjustmentKernelFactoryImpl>(params, m_forceScalarImplementation));
     }
 
 private:
@@ -646,6 +723,9 @@ private:
     int m_type;
     bool m_colorize;
     bool m_compatibilityMode;
+    bool m_forceScalarImplementation;
+
+    QScopedPointer<KisHSVAdjustmentKernelBase> m_kernel;
 };
 
 template<typename _channel_type_,typename traits>
@@ -664,7 +744,7 @@ public:
     QList<QString> parameters() const override
     {
       QList<QString> list;
-      list << "curve" << "channel" << "driverChannel" << "relative" << "lumaRed" << "lumaGreen"<< "lumaBlue";
+      list << "curve" << "channel" << "driverChannel" << "relative" << "lumaRed" << "lumaGreen"<< "lumaBlue" << "forcePerPixelLookup";
       return list;
     }
 
@@ -684,6 +764,8 @@ public:
             return PAR_LUMA_G;
         } else if (name == "lumaBlue") {
             return PAR_LUMA_B;
+        } else if (name == "forcePerPixelLookup") {
+            return PAR_FORCE_PER_PIXEL_LOOKUP;
         }
         return -1;
     }
@@ -696,6 +778,7 @@ public:
     *   false: use curve for direct lookup.
     *   true: add adjustment to original. In this mode, the curve range is mapped to -1.0 to 1.0
     * luma Red/Green/Blue: Used for luma calculations.
+    * forcePerPixelLookup: evaluate the curve for every pixel instead of using the driver table (for tests)
     */
     void setParameter(int id, const QVariant& parameter) override
     {
@@ -720,16 +803,22 @@ public:
             break;
         case PAR_LUMA_R:
             m_lumaRed = parameter.toDouble();
-            break;
+            return;
         case PAR_LUMA_G:
             m_lumaGreen = parameter.toDouble();
-            break;
+            return;
         case PAR_LUMA_B:
             m_lumaBlue = parameter.toDouble();
+            return;
+        case PAR_FORCE_PER_PIXEL_LOOKUP:
+            m_forcePerPixelLookup = parameter.toBool();
             break;
         default:
             KIS_ASSERT_RECOVER_NOOP(false && "Unknown parameter ID. Ignored!");
+            return;
         }
+
+        updateDriverTable();
     }
 
     const float SCALE_FROM_16BIT = 1.0f / 0xFFFF;
@@ -741,6 +830,10 @@ public:
 
         int driverChannel = m_relative ? m_driverChannel : m_channel;
 
+        const bool useDriverTable = !m_driverTable.isEmpty();
+
+        const bool needsHSV = m_channel >= KisHSVCurve::Hue || driverChannel >= KisHSVCurve::Hue;
+
         float component[KisHSVCurve::ChannelCount];
 
         // Aliases for convenience
@@ -758,12 +851,16 @@ public:
             b = SCALE_TO_FLOAT(src->blue);
             a = SCALE_TO_FLOAT(src->alpha);
 
-            RGBToHSV(r, g, b, &h, &s, &v);
+            if (needsHSV) {
+                RGBToHSV(r, g, b, &h, &s, &v);
 
-            // Normalize hue to 0.0 to 1.0 range
-            h /= 360.0f;
+                // Normalize hue to 0.0 to 1.0 range
+                h /= 360.0f;
+            }
 
-            float adjustment = lookupComponent(component[driverChannel], max) * SCALE_FROM_16BIT;
+            float adjustment = useDriverTable ?
+                m_driverTable[rawComponent(src, driverChannel)] :
+                lookupComponent(component[driverChannel], max) * SCALE_FROM_16BIT;
 
             if (m_relative) {
                 // Curve uses range 0.0 to 1.0, but for adjustment we need -1.0 to 1.0
@@ -784,11 +881,11 @@ public:
                 }
             }
 
-            h *= 360.0f;
-            if (h > 360) h -= 360;
-            if (h < 0) h += 360;
-
             if (m_channel >= KisHSVCurve::Hue) {
+                h *= 360.0f;
+                if (h > 360) h -= 360;
+                if (h < 0) h += 360;
+
                 HSVToRGB(h, s, v, &r, &g, &b);
             }
 
@@ -807,6 +904,47 @@ public:
     }
 
 
+    /**
+     * When the adjustment is driven by a real channel of an integer
+     * color space, the curve is evaluated for every possible value
+     * of the channel beforehand
+     */
+    void updateDriverTable()
+    {
+        m_driverTable.clear();
+
+        const int driverChannel = m_relative ? m_driverChannel : m_channel;
+
+        if (!std::numeric_limits<_channel_type_>::is_integer ||
+            driverChannel > KisHSVCurve::Alpha ||
+            m_curve.isEmpty() ||
+            m_forcePerPixelLookup) {
+
+            return;
+        }
+
+        const float max = m_curve.size() - 1;
+
+        m_driverTable.resize(int(std::numeric_limits<_channel_type_>::max()) + 1);
+        for (int i = 0; i < m_driverTable.size(); i++) {
+            m_driverTable[i] = lookupComponent(SCALE_TO_FLOAT(_channel_type_(i)), max) * SCALE_FROM_16BIT;
+        }
+    }
+
+    inline _channel_type_ rawComponent(const RGBPixel *pixel, int channel) const
+    {
+        switch (channel) {
+        case KisHSVCurve::Red:
+            return pixel->red;
+        case KisHSVCurve::Green:
+            return pixel->green;
+        case KisHSVCurve::Blue:
+            return pixel->blue;
+        default:
+            return pixel->alpha;
+        }
+    }
+
     float lookupComponent(float x, float max) const
     {
         // No curve for this component? Pass through unmodified
@@ -838,12 +976,17 @@ private:
         PAR_LUMA_R,
         PAR_LUMA_G,
         PAR_LUMA_B,
+        PAR_FORCE_PER_PIXEL_LOOKUP,
     };
 
     QVector<quint16> m_curve;
     int m_channel = 0;
     int m_driverChannel = 0;
     bool m_relative = false;
+    bool m_forcePerPixelLookup = false;
+
+    /// the adjustment for every value of the driver channel, see updateDriverTable()
+    QVector<float> m_driverTable;
 
     /* Note: the filter currently only supports HSV, so these are
      * unused, but will be needed once HSL, etc.
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+*/
+
+#ifndef _KIS_HSV_ADJUSTMENT_KERNEL_H_
+#define _KIS_HSV_ADJUSTMENT_KERNEL_H_
+
+#include <QtGlobal>
+
+/**
+ * Parameters of the non-compatibility mode of the HSV adjustment, which
+ * is the only mode that has a vectorized implementation
+ */
+struct KisHSVAdjustmentKernelParams
+{
+    enum ChannelType {
+        UInt8,
+        UInt16,
+        Float32
+    };
+
+    ChannelType channelType = UInt8;
+
+    /// 0:HSV, 1:HSL, 2:HSI, 3:HSY
+    int type = 0;
+
+    float dh = 0.0f;
+    float ds = 0.0f;
+    float dv = 0.0f;
+
+    float lumaRed = 0.2126f;
+    float lumaGreen = 0.7152f;
+    float lumaBlue = 0.0722f;
+};
+
+/**
+ * A vectorized version of HSVTransform() of KisHSVAdjustment.
+ *
+ * The implementations are created per-arch with
+ * KisHSVAdjustmentKernelFactoryImpl. The scalar "implementation" is
+ * null, the callers should use the scalar path of KisHSVAdjustment
+ * instead.
+ */
+class KisHSVAdjustmentKernelBase
+{
+public:
+    virtual ~KisHSVAdjustmentKernelBase();
+
+    /**
+     * Transforms \p nPixels RGBA pixels of the channel type
+     * the kernel was created for
+     */
+    virtual void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const = 0;
+};
+
+#endif
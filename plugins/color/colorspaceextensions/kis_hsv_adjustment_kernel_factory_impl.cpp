@@ -0,0 +1,434 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+*/
+
+#include "kis_hsv_adjustment_kernel_factory_impl.h"
+
+#include <limits>
+#include <type_traits>
+
+#include <KoColorSpaceMaths.h>
+#include <KoColorSpaceTraits.h>
+
+/**
+ * NOTE: this file is compiled once per every supported instruction set,
+ *       so everything except the factory method should have internal
+ *       linkage, otherwise the linker may pick the AVX version of an
+ *       inline function for the SSE2 kernel.
+ */
+
+namespace {
+
+template<Vc::Implementation _impl, typename EnableDummyType = void>
+struct KernelCreator
+{
+    static KisHSVAdjustmentKernelBase* create(const KisHSVAdjustmentKernelParams &params)
+    {
+        Q_UNUSED(params);
+
+        // the scalar path lives in KisHSVAdjustment itself
+        return 0;
+    }
+};
+
+#ifdef HAVE_VC
+
+using Vc::float_v;
+using Vc::float_m;
+
+const float EPSILON = 1e-9f;
+
+/**
+ * Writes \p hi, \p mid and \p lo into the channels in the same order
+ * as writeRGBSimple() of the scalar path does for every sextant
+ */
+inline void writeBySextant(const float_v &sextant,
+                           const float_v &hi, const float_v &mid, const float_v &lo,
+                           float_v *r, float_v *g, float_v *b)
+{
+    const float_m s0 = sextant == float_v(0.0f);
+    const float_m s1 = sextant == float_v(1.0f);
+    const float_m s2 = sextant == float_v(2.0f);
+    const float_m s3 = sextant == float_v(3.0f);
+    const float_m s4 = sextant == float_v(4.0f);
+    const float_m s5 = sextant == float_v(5.0f);
+
+    *r = lo;
+    (*r)(s0 || s5) = hi;
+    (*r)(s1 || s4) = mid;
+
+    *g = lo;
+    (*g)(s1 || s2) = hi;
+    (*g)(s0 || s3) = mid;
+
+    *b = lo;
+    (*b)(s3 || s4) = hi;
+    (*b)(s2 || s5) = mid;
+}
+
+struct HSVPolicy
+{
+    inline float_m hasChroma(const float_v &v) const {
+        return v > float_v(EPSILON);
+    }
+
+    inline float_v valueFromRGB(const float_v &r, const float_v &g, const float_v &b,
+                                const float_v &m, const float_v &M) const {
+        Q_UNUSED(r);
+        Q_UNUSED(g);
+        Q_UNUSED(b);
+        Q_UNUSED(m);
+        return M;
+    }
+
+    inline float_v fixupChroma(const float_v &c, const float_v &v) const {
+        return Vc::min(v, c);
+    }
+
+    inline void writeRGB(float_v *r, float_v *g, float_v *b,
+                         const float_v &sextant,
+                         const float_v &x, const float_v &c, const float_v &v) const {
+
+        const float_v m = v - c;
+        writeBySextant(sextant, v, x + m, m, r, g, b);
+    }
+};
+
+struct HSLPolicy
+{
+    inline float_m hasChroma(const float_v &v) const {
+        return v > float_v(EPSILON) && v < float_v(1.0f - EPSILON);
+    }
+
+    inline float_v valueFromRGB(const float_v &r, const float_v &g, const float_v &b,
+                                const float_v &m, const float_v &M) const {
+        Q_UNUSED(r);
+        Q_UNUSED(g);
+        Q_UNUSED(b);
+        return float_v(0.5f) * (M + m);
+    }
+
+    inline float_v fixupChroma(const float_v &c, const float_v &v) const {
+        float_v limit = float_v(2.0f) * v;
+        limit(v >= float_v(0.5f)) = float_v(2.0f) - float_v(2.0f) * v;
+        return Vc::min(c, limit);
+    }
+
+    inline void writeRGB(float_v *r, float_v *g, float_v *b,
+                         const float_v &sextant,
+                         const float_v &x, const float_v &c, const float_v &v) const {
+
+        const float_v M = v + float_v(0.5f) * c;
+        const float_v m = v - float_v(0.5f) * c;
+
+        writeBySextant(sextant, M, x + m, m, r, g, b);
+    }
+};
+
+struct HCIPolicy
+{
+    inline float_m hasChroma(const float_v &v) const {
+        return v > float_v(EPSILON) && v < float_v(1.0f - EPSILON);
+    }
+
+    inline float_v valueFromRGB(const float_v &r, const float_v &g, const float_v &b,
+                                const float_v &m, const float_v &M) const {
+        Q_UNUSED(m);
+        Q_UNUSED(M);
+        return (r + g + b) / float_v(3.0f);
+    }
+
+    inline float_v fixupChroma(const float_v &c, const float_v &v) const {
+        const float oneThird = 1.0f / 3.0f;
+
+        float_v limit = float_v(3.0f) * v;
+        limit(v >= float_v(oneThird)) = float_v(1.5f) * (float_v(1.0f) - v);
+        return Vc::min(c, limit);
+    }
+
+    inline void writeRGB(float_v *r, float_v *g, float_v *b,
+                         const float_v &sextant,
+                         const float_v &x, const float_v &c, const float_v &v) const {
+
+        const float oneThird = 1.0f / 3.0f;
+
+        const float_v m = v - float_v(oneThird) * (c + x);
+        const float_v M = c + m;
+
+        writeBySextant(sextant, M, x + m, m, r, g, b);
+    }
+};
+
+struct HCYPolicy
+{
+    HCYPolicy(float _rCoeff, float _gCoeff, float _bCoeff)
+        : rCoeff(_rCoeff),
+          gCoeff(_gCoeff),
+          bCoeff(_bCoeff)
+    {
+    }
+
+    float rCoeff;
+    float gCoeff;
+    float bCoeff;
+
+    inline float_m hasChroma(const float_v &v) const {
+        return v > float_v(EPSILON) && v < float_v(1.0f - EPSILON);
+    }
+
+    inline float_v valueFromRGB(const float_v &r, const float_v &g, const float_v &b,
+                                const float_v &m, const float_v &M) const {
+        Q_UNUSED(m);
+        Q_UNUSED(M);
+        return float_v(rCoeff) * r + float_v(gCoeff) * g + float_v(bCoeff) * b;
+    }
+
+    inline float_v fixupChroma(const float_v &c, const float_v &v) const {
+        Q_UNUSED(v);
+        return c;
+    }
+
+    inline void writeRGB(float_v *r, float_v *g, float_v *b,
+                         const float_v &sextant,
+                         const float_v &x, const float_v &c, const float_v &v) const {
+
+        writeBySextant(sextant, c, x, float_v(Vc::Zero), r, g, b);
+
+        const float_v m = v - *r * float_v(rCoeff) - *g * float_v(gCoeff) - *b * float_v(bCoeff);
+        *r += m;
+        *g += m;
+        *b += m;
+    }
+};
+
+template<typename _channel_type_, typename traits, class ValuePolicy>
+class KisHSVAdjustmentKernel : public KisHSVAdjustmentKernelBase
+{
+    typedef typename traits::Pixel RGBPixel;
+
+public:
+    KisHSVAdjustmentKernel(const KisHSVAdjustmentKernelParams &params, const ValuePolicy &valuePolicy)
+        : m_dh(params.dh),
+          m_ds(params.ds),
+          m_dv(params.dv),
+          m_valuePolicy(valuePolicy)
+    {
+        /// the same nonlinear saturation slider as in the scalar path
+        m_chromaScale = m_ds > 0 ? 1.0f + m_ds + 2.0f * m_ds * m_ds : m_ds + 1.0f;
+    }
+
+    void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const override
+    {
+        const RGBPixel *src = reinterpret_cast<const RGBPixel*>(srcU8);
+        RGBPixel *dst = reinterpret_cast<RGBPixel*>(dstU8);
+
+        const int vectorSize = float_v::size();
+
+        float rBuf[float_v::size()];
+        float gBuf[float_v::size()];
+        float bBuf[float_v::size()];
+
+        while (nPixels > 0) {
+            const int blockSize = qMin(nPixels, vectorSize);
+
+            /**
+             * The channels are converted into floats with the same
+             * functions as in the scalar path, the tail of the last
+             * block is padded with black pixels
+             */
+            for (int i = 0; i < vectorSize; i++) {
+                if (i < blockSize) {
+                    rBuf[i] = KoColorSpaceMaths<_channel_type_, float>::scaleToA(src[i].red);
+                    gBuf[i] = KoColorSpaceMaths<_channel_type_, float>::scaleToA(src[i].green);
+                    bBuf[i] = KoColorSpaceMaths<_channel_type_, float>::scaleToA(src[i].blue);
+                } else {
+                    rBuf[i] = gBuf[i] = bBuf[i] = 0.0f;
+                }
+            }
+
+            float_v r(rBuf, Vc::Unaligned);
+            float_v g(gBuf, Vc::Unaligned);
+            float_v b(bBuf, Vc::Unaligned);
+
+            transformVector(&r, &g, &b);
+
+            if (std::numeric_limits<_channel_type_>::is_integer) {
+                const float_v zero(Vc::Zero);
+                const float_v one(Vc::One);
+
+                r = Vc::min(Vc::max(r, zero), one);
+                g = Vc::min(Vc::max(g, zero), one);
+                b = Vc::min(Vc::max(b, zero), one);
+            }
+
+            r.store(rBuf, Vc::Unaligned);
+            g.store(gBuf, Vc::Unaligned);
+            b.store(bBuf, Vc::Unaligned);
+
+            for (int i = 0; i < blockSize; i++) {
+                dst[i].red = KoColorSpaceMaths<float, _channel_type_>::scaleToA(rBuf[i]);
+                dst[i].green = KoColorSpaceMaths<float, _channel_type_>::scaleToA(gBuf[i]);
+                dst[i].blue = KoColorSpaceMaths<float, _channel_type_>::scaleToA(bBuf[i]);
+                dst[i].alpha = src[i].alpha;
+            }
+
+            src += blockSize;
+            dst += blockSize;
+            nPixels -= blockSize;
+        }
+    }
+
+private:
+    /**
+     * A branchless version of HSVTransform(): both branches are
+     * calculated for every pixel and blended with the masks
+     */
+    inline void transformVector(float_v *r, float_v *g, float_v *b) const
+    {
+        const float_v zero(Vc::Zero);
+        const float_v one(Vc::One);
+        const float_v v60(60.0f);
+        const float_v v360(360.0f);
+
+        const float_v M = Vc::max(*r, Vc::max(*g, *b));
+        const float_v m = Vc::min(*r, Vc::min(*g, *b));
+
+        float_v chroma = M - m;
+        float_v v = m_valuePolicy.valueFromRGB(*r, *g, *b, m, M);
+
+        const float_m hasChroma = m_valuePolicy.hasChroma(v);
+
+        // the pixels without chroma just change their value
+        const float_v achromaticV =
+            m_dv < 0 ?
+            v * float_v(m_dv + 1.0f) :
+            v + float_v(m_dv) * (one - v);
+
+        const float_m chromaMask = chroma > float_v(EPSILON);
+
+        float_v safeChroma = one;
+        safeChroma(chromaMask) = chroma;
+
+        float_v h = float_v(4.0f) + (*r - *g) / safeChroma;
+        h(*g == M) = float_v(2.0f) + (*b - *r) / safeChroma;
+        h(*r == M) = (*g - *b) / safeChroma;
+
+        h = h * v60 + float_v(m_dh * 180);
+
+        // normalizeAngleDegrees()
+        h -= v360 * Vc::floor(h / v360);
+        h(h >= v360) = h - v360;
+        h.setZero(!chromaMask);
+
+        float_v scaledChroma = chroma * float_v(m_chromaScale);
+        if (m_ds > 0) {
+            scaledChroma = Vc::min(one, scaledChroma);
+        }
+        chroma(chromaMask) = scaledChroma;
+
+        {
+            const float_v dstV = m_dv > 0.0f ? one : zero;
+            const float_v movement(std::abs(m_dv));
+
+            v += movement * (dstV - v);
+            chroma -= movement * chroma;
+        }
+
+        v = Vc::min(Vc::max(v, zero), one);
+        chroma = m_valuePolicy.fixupChroma(chroma, v);
+
+        v(!hasChroma) = achromaticV;
+        chroma.setZero(!hasChroma);
+        h.setZero(!hasChroma);
+
+        h /= v60;
+
+        // float rounding may bring the hue of 359.99 up to the sixth sextant
+        const float_v sextant = Vc::min(Vc::floor(h), float_v(5.0f));
+        const float_v fract = h - sextant;
+
+        const float_m isOddSextant =
+            sextant == float_v(1.0f) ||
+            sextant == float_v(3.0f) ||
+            sextant == float_v(5.0f);
+
+        float_v x = chroma * fract;
+        x(isOddSextant) = chroma - chroma * fract;
+
+        m_valuePolicy.writeRGB(r, g, b, sextant, x, chroma, v);
+
+        const float_m isBlack = v <= float_v(EPSILON);
+        r->setZero(isBlack);
+        g->setZero(isBlack);
+        b->setZero(isBlack);
+    }
+
+private:
+    float m_dh;
+    float m_ds;
+    float m_dv;
+    float m_chromaScale;
+    ValuePolicy m_valuePolicy;
+};
+
+template<typename _channel_type_, typename traits>
+KisHSVAdjustmentKernelBase* createKernel(const KisHSVAdjustmentKernelParams &params)
+{
+    switch (params.type) {
+    case 0:
+        return new KisHSVAdjustmentKernel<_channel_type_, traits, HSVPolicy>(params, HSVPolicy());
+    case 1:
+        return new KisHSVAdjustmentKernel<_channel_type_, traits, HSLPolicy>(params, HSLPolicy());
+    case 2:
+        return new KisHSVAdjustmentKernel<_channel_type_, traits, HCIPolicy>(params, HCIPolicy());
+    case 3:
+        return new KisHSVAdjustmentKernel<_channel_type_, traits, HCYPolicy>(params, HCYPolicy(params.lumaRed, params.lumaGreen, params.lumaBlue));
+    }
+
+    return 0;
+}
+
+template<Vc::Implementation _impl>
+struct KernelCreator<_impl, typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    static KisHSVAdjustmentKernelBase* create(const KisHSVAdjustmentKernelParams &params)
+    {
+        switch (params.channelType) {
+        case KisHSVAdjustmentKernelParams::UInt8:
+            return createKernel<quint8, KoBgrTraits<quint8>>(params);
+        case KisHSVAdjustmentKernelParams::UInt16:
+            return createKernel<quint16, KoBgrTraits<quint16>>(params);
+        case KisHSVAdjustmentKernelParams::Float32:
+            return createKernel<float, KoRgbTraits<float>>(params);
+        }
+
+        return 0;
+    }
+};
+
+#endif /* HAVE_VC */
+
+}
+
+template<Vc::Implementation _impl>
+KisHSVAdjustmentKernelBase* KisHSVAdjustmentKernelFactoryImpl::create(KisHSVAdjustmentKernelParams params)
+{
+    return KernelCreator<_impl>::create(params);
+}
+
+template KisHSVAdjustmentKernelBase* KisHSVAdjustmentKernelFactoryImpl::create<Vc::CurrentImplementation::current()>(KisHSVAdjustmentKernelParams);
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+*/
+
+#ifndef _KIS_HSV_ADJUSTMENT_KERNEL_FACTORY_IMPL_H_
+#define _KIS_HSV_ADJUSTMENT_KERNEL_FACTORY_IMPL_H_
+
+#include <compositeops/KoVcMultiArchBuildSupport.h>
+
+#include "kis_hsv_adjustment_kernel.h"
+
+struct KisHSVAdjustmentKernelFactoryImpl
+{
+    typedef KisHSVAdjustmentKernelParams ParamType;
+    typedef KisHSVAdjustmentKernelBase* ReturnType;
+
+    static const char* kernelName() {
+        return "HSV adjustment";
+    }
+
+    template<Vc::Implementation _impl>
+    static KisHSVAdjustmentKernelBase* create(KisHSVAdjustmentKernelParams params);
+};
+
+#endif
@@ -22,9 +22,12 @@
 
 #include "KoColorModelStandardIds.h"
 
+#include <QScopedPointer>
+
 #include <klocalizedstring.h>
 
 #include "LcmsColorSpace.h"
+#include "LcmsColorConversionLut.h"
 
 // -- KoLcmsColorConversionTransformation --
 
@@ -61,6 +64,20 @@ public:
                                          conversionFlags);
 
         Q_ASSERT(m_transform);
+
+        /**
+         * The lut is built right away, so whether a span is converted
+         * through it depends on the length of the span only, never on
+         * the history of the transformation
+         */
+        if (LcmsColorConversionLut::isSupported(srcCs, dstCs, conversionFlags)) {
+            m_lut.reset(new LcmsColorConversionLut(srcCs, srcColorSpaceType, srcProfile->lcmsProfile(),
+                                                   dstCs, dstColorSpaceType, dstProfile->lcmsProfile(),
+                                                   renderingIntent, conversionFlags));
+            if (!m_lut->isValid()) {
+                m_lut.reset();
+            }
+        }
     }
 
     ~KoLcmsColorConversionTransformation() override
@@ -74,11 +91,18 @@ public:
     {
         Q_ASSERT(m_transform);
 
+        if (m_lut && numPixels <= LcmsColorConversionLut::maxSpanLength) {
+            m_lut->transform(src, dst, numPixels);
+            return;
+        }
+
         cmsDoTransform(m_transform, const_cast<quint8 *>(src), dst, numPixels);
 
     }
+
 private:
     mutable cmsHTRANSFORM m_transform;
+    QScopedPointer<LcmsColorConversionLut> m_lut;
 };
 
 class KoLcmsColorProofingConversionTransformation : public KoColorProofingConversionTransformation
@@ -0,0 +1,181 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "LcmsColorConversionLut.h"
+
+#include <algorithm>
+#include <QtGlobal>
+
+#include "KoColorSpace.h"
+#include "KoColorModelStandardIds.h"
+#include "KoTetrahedralInterpolation.h"
+#include "kis_assert.h"
+
+namespace {
+
+static const int numGridNodes =
+    LcmsColorConversionLut::gridPoints *
+    LcmsColorConversionLut::gridPoints *
+    LcmsColorConversionLut::gridPoints;
+
+inline quint16 to16(quint8 value) {
+    return quint16(value) * 257;
+}
+
+inline quint8 from16(quint16 value) {
+    // the same rounding as LCMS uses in its 16->8 bit formatters
+    return quint8((quint32(value) * 65281U + 8388608U) >> 24);
+}
+
+inline quint32 to16BitType(quint32 colorSpaceType)
+{
+    return (colorSpaceType & ~BYTES_SH(7)) | BYTES_SH(2);
+}
+
+
+}
+
+bool LcmsColorConversionLut::isSupported(const KoColorSpace *srcCs,
+                                         const KoColorSpace *dstCs,
+                                         KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    if (conversionFlags.testFlag(KoColorConversionTransformation::NoOptimization) ||
+        conversionFlags.testFlag(KoColorConversionTransformation::GamutCheck) ||
+        conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing)) {
+
+        return false;
+    }
+
+    if (srcCs->colorModelId() != RGBAColorModelID ||
+        (dstCs->colorModelId() != RGBAColorModelID &&
+         dstCs->colorModelId() != CMYKAColorModelID)) {
+
+        return false;
+    }
+
+    /**
+     * The interpolation error is below the precision of 8-bit channels
+     * only, 16-bit conversions are always done by LCMS
+     */
+    if (srcCs->colorDepthId() != Integer8BitsColorDepthID ||
+        dstCs->colorDepthId() != Integer8BitsColorDepthID) {
+        return false;
+    }
+
+    // the interpolation code expects alpha to be the last channel
+    return srcCs->alphaPos() == srcCs->channelCount() - 1 &&
+        dstCs->alphaPos() == dstCs->channelCount() - 1;
+}
+
+LcmsColorConversionLut::LcmsColorConversionLut(const KoColorSpace *srcCs, quint32 srcColorSpaceType, cmsHPROFILE srcProfile,
+                                               const KoColorSpace *dstCs, quint32 dstColorSpaceType, cmsHPROFILE dstProfile,
+                                               KoColorConversionTransformation::Intent renderingIntent,
+                                               KoColorConversionTransformation::ConversionFlags conversionFlags)
+    : m_numOutputs(dstCs->colorChannelCount())
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(isSupported(srcCs, dstCs, conversionFlags));
+
+    /**
+     * The grid is sampled with 16-bit precision, so that the nodes are
+     * placed exactly at the cell boundaries. The alpha channel is not needed
+     * for sampling, so we don't ask LCMS to copy it.
+     */
+    conversionFlags &= ~KoColorConversionTransformation::CopyAlpha;
+
+    cmsHTRANSFORM sampler = cmsCreateTransform(srcProfile,
+                                               to16BitType(srcColorSpaceType),
+                                               dstProfile,
+                                               to16BitType(dstColorSpaceType),
+                                               renderingIntent,
+                                               quint32(conversionFlags));
+    if (!sampler) return;
+
+    const int srcPixelChannels = 4;
+    const int dstPixelChannels = m_numOutputs + 1;
+
+    QVector<quint16> srcGrid(numGridNodes * srcPixelChannels);
+    QVector<quint16> dstGrid(numGridNodes * dstPixelChannels);
+
+    quint16 *srcNode = srcGrid.data();
+    for (int i0 = 0; i0 < gridPoints; i0++) {
+        for (int i1 = 0; i1 < gridPoints; i1++) {
+            for (int i2 = 0; i2 < gridPoints; i2++) {
+                srcNode[0] = quint16(qRound(i0 * 65535.0 / (gridPoints - 1)));
+                srcNode[1] = quint16(qRound(i1 * 65535.0 / (gridPoints - 1)));
+                srcNode[2] = quint16(qRound(i2 * 65535.0 / (gridPoints - 1)));
+                srcNode[3] = 0xffff;
+                srcNode += srcPixelChannels;
+            }
+        }
+    }
+
+    cmsDoTransform(sampler, srcGrid.constData(), dstGrid.data(), numGridNodes);
+    cmsDeleteTransform(sampler);
+
+    m_table.resize(numGridNodes * m_numOutputs);
+
+    const quint16 *dstNode = dstGrid.constData();
+    quint16 *tableNode = m_table.data();
+    for (int i = 0; i < numGridNodes; i++) {
+        std::copy(dstNode, dstNode + m_numOutputs, tableNode);
+        dstNode += dstPixelChannels;
+        tableNode += m_numOutputs;
+    }
+}
+
+bool LcmsColorConversionLut::isValid() const
+{
+    return !m_table.isEmpty();
+}
+
+void LcmsColorConversionLut::transform(const quint8 *src, quint8 *dst, qint32 numPixels) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(isValid());
+
+    if (m_numOutputs == 3) {
+        transformImpl<3>(src, dst, numPixels);
+    } else {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(m_numOutputs == 4);
+        transformImpl<4>(src, dst, numPixels);
+    }
+}
+
+template <int numOutputs>
+void LcmsColorConversionLut::transformImpl(const quint8 *src, quint8 *dst, qint32 numPixels) const
+{
+    const quint16 *table = m_table.constData();
+    const quint8 *srcPtr = src;
+    quint8 *dstPtr = dst;
+
+    quint16 values[numOutputs];
+
+    for (qint32 i = 0; i < numPixels; i++) {
+        KoTetrahedralInterpolation::interpolate<gridPoints, numOutputs>(
+            table, to16(srcPtr[0]), to16(srcPtr[1]), to16(srcPtr[2]), values);
+
+        for (int ch = 0; ch < numOutputs; ch++) {
+            dstPtr[ch] = from16(values[ch]);
+        }
+
+        dstPtr[numOutputs] = srcPtr[3];
+
+        srcPtr += 4;
+        dstPtr += numOutputs + 1;
+    }
+}
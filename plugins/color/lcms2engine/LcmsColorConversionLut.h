@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LCMSCOLORCONVERSIONLUT_H
+#define LCMSCOLORCONVERSIONLUT_H
+
+#include <QVector>
+#include <lcms2.h>
+
+#include "KoColorConversionTransformation.h"
+
+class KoColorSpace;
+
+/**
+ * A precomputed 3D lookup table for ICC conversions from RGB color spaces.
+ *
+ * cmsDoTransform() has a noticeable per-call overhead, which dominates
+ * when the conversion is requested for very short spans of pixels (color
+ * pickers, iterator rows, single KoColor conversions). The conversion is
+ * done via tetrahedral interpolation in a 33x33x33 grid, sampled once from
+ * LCMS itself with 16-bit precision.
+ *
+ * The lut is used only for the spans of up to maxSpanLength pixels, the
+ * longer ones are converted by cmsDoTransform() exactly. The interpolated
+ * values deviate from the ones of cmsDoTransform() by no more than
+ * maxError (in normalized channel units), which is checked by
+ * TestLcmsColorConversionLut.
+ *
+ * Only 8-bit RGB sources with 8-bit RGB or CMYK destinations are
+ * supported, the interpolation error would be visible in 16-bit
+ * channels. Transformations that asked LCMS to avoid optimizations
+ * (e.g. ones involving linear profiles) always use LCMS directly.
+ */
+class LcmsColorConversionLut
+{
+public:
+    static const int gridPoints = 33;
+
+    /**
+     * The longest span converted through the lut, for the longer spans
+     * the overhead of cmsDoTransform() is negligible
+     */
+    static const int maxSpanLength = 64;
+
+    /**
+     * The maximum deviation of the interpolated channels from the ones
+     * calculated by LCMS, two levels of an 8-bit channel
+     */
+    static constexpr qreal maxError = 2.0 / 255.0;
+
+    /**
+     * @return true if the conversion between \p srcCs and \p dstCs
+     *         can be served by the lut without losing precision
+     */
+    static bool isSupported(const KoColorSpace *srcCs,
+                            const KoColorSpace *dstCs,
+                            KoColorConversionTransformation::ConversionFlags conversionFlags);
+
+    LcmsColorConversionLut(const KoColorSpace *srcCs, quint32 srcColorSpaceType, cmsHPROFILE srcProfile,
+                           const KoColorSpace *dstCs, quint32 dstColorSpaceType, cmsHPROFILE dstProfile,
+                           KoColorConversionTransformation::Intent renderingIntent,
+                           KoColorConversionTransformation::ConversionFlags conversionFlags);
+
+    /**
+     * @return false if LCMS failed to create the sampling transform
+     */
+    bool isValid() const;
+
+    void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const;
+
+private:
+    template <int numOutputs>
+    void transformImpl(const quint8 *src, quint8 *dst, qint32 numPixels) const;
+
+private:
+    QVector<quint16> m_table;
+    int m_numOutputs;
+};
+
+#endif // LCMSCOLORCONVERSIONLUT_H
@@ -428,8 +428,111 @@ public:
         }
     }
 
+    void intensity8Span(const quint8 *src, quint8 *intensities, qint32 nPixels) const override
+    {
+        static const qint32 chunkSize = 256;
+
+        KIS_ASSERT_RECOVER_RETURN(d->defaultTransformations && d->defaultTransformations->toRGB);
+
+        /**
+         * We use the same default sRGB transform as toQColor() does, but
+         * convert the whole span at once and into a local buffer, so there
+         * is no need to lock the qcolordata mutex.
+         */
+        quint8 bgr[3 * chunkSize];
+        const quint32 pixelSize = this->pixelSize();
+
+        while (nPixels > 0) {
+            const qint32 numChunkPixels = qMin(nPixels, chunkSize);
+
+            cmsDoTransform(d->defaultTransformations->toRGB, const_cast<quint8 *>(src), bgr, numChunkPixels);
+
+            for (qint32 i = 0; i < numChunkPixels; i++) {
+                const quint8 *pixel = bgr + 3 * i;
+                intensities[i] = static_cast<quint8>(pixel[2] * 0.30 + pixel[1] * 0.59 + pixel[0] * 0.11);
+            }
+
+            src += numChunkPixels * pixelSize;
+            intensities += numChunkPixels;
+            nPixels -= numChunkPixels;
+        }
+    }
+
+    void differenceSpan(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const override
+    {
+        differenceSpanImpl<false>(src1, src2, differences, nPixels);
+    }
+
+    void differenceASpan(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const override
+    {
+        differenceSpanImpl<true>(src1, src2, differences, nPixels);
+    }
+
 private:
 
+    /**
+     * Converts the whole span into Lab in a single LCMS call and then
+     * calculates the distances in a tight loop. The formulas are exactly
+     * the same as the ones used by cmsLabEncoded2Float() and cmsDeltaE(),
+     * so the results match difference() and differenceA() bit-to-bit.
+     */
+    template <bool useAlpha>
+    void differenceSpanImpl(const quint8 *src1, const quint8 *src2, quint8 *differences, qint32 nPixels) const
+    {
+        static const int LabAAlphaPos = 3;
+        static const qint32 chunkSize = 256;
+        static const cmsFloat64Number alphaScale = 100.0 / KoColorSpaceMathsTraits<quint16>::max;
+
+        const quint32 pixelSize = this->pixelSize();
+        const quint8 opacity1 = _CSTraits::opacityU8(src1);
+
+        KIS_ASSERT_RECOVER_RETURN(this->toLabA16Converter());
+
+        quint16 lab1[4];
+        this->toLabA16Converter()->transform(src1, reinterpret_cast<quint8*>(lab1), 1);
+
+        const cmsFloat64Number L1 = lab1[0] / 655.35;
+        const cmsFloat64Number a1 = (lab1[1] / 257.0) - 128.0;
+        const cmsFloat64Number b1 = (lab1[2] / 257.0) - 128.0;
+        const quint16 alpha1 = lab1[LabAAlphaPos];
+
+        quint16 lab2[4 * chunkSize];
+
+        while (nPixels > 0) {
+            const qint32 numChunkPixels = qMin(nPixels, chunkSize);
+
+            this->toLabA16Converter()->transform(src2, reinterpret_cast<quint8*>(lab2), numChunkPixels);
+
+            for (qint32 i = 0; i < numChunkPixels; i++) {
+                const quint16 *lab = lab2 + 4 * i;
+
+                const cmsFloat64Number dL = fabs(L1 - lab[0] / 655.35);
+                const cmsFloat64Number da = fabs(a1 - ((lab[1] / 257.0) - 128.0));
+                const cmsFloat64Number db = fabs(b1 - ((lab[2] / 257.0) - 128.0));
+
+                const cmsFloat64Number dAlpha =
+                    useAlpha ? fabs((qreal)(alpha1 - lab[LabAAlphaPos])) * alphaScale : 0.0;
+
+                const qreal diff = pow(dL * dL + da * da + db * db + dAlpha * dAlpha, 0.5);
+
+                differences[i] = diff > 255.0 ? 255 : quint8(diff);
+            }
+
+            // transparent pixels are compared by opacity only
+            for (qint32 i = 0; i < numChunkPixels; i++) {
+                const quint8 opacity2 = _CSTraits::opacityU8(src2 + i * pixelSize);
+
+                if (opacity1 == OPACITY_TRANSPARENT_U8 || opacity2 == OPACITY_TRANSPARENT_U8) {
+                    differences[i] = opacity1 == opacity2 ? 0 : 255;
+                }
+            }
+
+            src2 += numChunkPixels * pixelSize;
+            differences += numChunkPixels;
+            nPixels -= numChunkPixels;
+        }
+    }
+
     inline LcmsColorProfileContainer *lcmsProfile() const
     {
         return d->profile;
@@ -83,6 +83,15 @@ quint8 RgbU8ColorSpace::intensity8(const quint8 *src) const
     return (quint8)(p->red * 0.30 + p->green * 0.59 + p->blue * 0.11);
 }
 
+void RgbU8ColorSpace::intensity8Span(const quint8 *src, quint8 *intensities, qint32 nPixels) const
+{
+    const KoBgrU8Traits::Pixel *p = reinterpret_cast<const KoBgrU8Traits::Pixel *>(src);
+
+    for (qint32 i = 0; i < nPixels; i++) {
+        intensities[i] = (quint8)(p[i].red * 0.30 + p[i].green * 0.59 + p[i].blue * 0.11);
+    }
+}
+
 void RgbU8ColorSpace::toHSY(const QVector<double> &channelValues, qreal *hue, qreal *sat, qreal *luma) const
 {
     RGBToHSY(channelValues[0],channelValues[1],channelValues[2], hue, sat, luma, lumaCoefficients()[0], lumaCoefficients()[1], lumaCoefficients()[2]);
@@ -53,6 +53,8 @@ public:
     void colorFromXML(quint8 *pixel, const QDomElement &elt) const override;
 
     quint8 intensity8(const quint8 * src) const override;
+
+    void intensity8Span(const quint8 *src, quint8 *intensities, qint32 nPixels) const override;
     
     void toHSY(const QVector<double> &channelValues, qreal *hue, qreal *sat, qreal *luma) const override;
     QVector <double> fromHSY(qreal *hue, qreal *sat, qreal *luma) const override;
@@ -0,0 +1,232 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestLcmsColorConversionLut.h"
+
+#include <QTest>
+#include "sdk/tests/kistest.h"
+
+#include "KoColorSpaceRegistry.h"
+#include "KoColorSpace.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorProfile.h"
+
+#include <lcms2.h>
+
+#include "kis_assert.h"
+
+#include "LcmsColorConversionLut.h"
+
+namespace {
+
+quint32 lcmsType(const KoColorSpace *cs)
+{
+    const bool is16Bit = cs->colorDepthId() == Integer16BitsColorDepthID;
+
+    if (cs->colorModelId() == CMYKAColorModelID) {
+        return is16Bit ? TYPE_CMYKA_16 : TYPE_CMYKA_8;
+    }
+
+    return is16Bit ? TYPE_BGRA_16 : TYPE_BGRA_8;
+}
+
+QVector<quint8> randomPixels(const KoColorSpace *cs, int numPixels)
+{
+    QVector<quint8> pixels(numPixels * cs->pixelSize());
+
+    qsrand(1);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = quint8(qrand() % 256);
+    }
+
+    return pixels;
+}
+
+/**
+ * A gamma 2.2 RGB profile with wide gamut primaries, so that the
+ * conversion from sRGB is far from an identity
+ */
+const KoColorProfile* wideGamutProfile(const QString &colorDepthId)
+{
+    const cmsCIExyY whitePoint = {0.3127, 0.3290, 1.0};
+    const cmsCIExyYTRIPLE primaries = {
+        {0.6400, 0.3300, 1.0},
+        {0.2100, 0.7100, 1.0},
+        {0.1500, 0.0600, 1.0}
+    };
+
+    cmsToneCurve *gamma = cmsBuildGamma(0, 2.2);
+    cmsToneCurve *curves[3] = {gamma, gamma, gamma};
+
+    cmsHPROFILE profile = cmsCreateRGBProfile(&whitePoint, &primaries, curves);
+    cmsFreeToneCurve(gamma);
+
+    cmsMLU *description = cmsMLUalloc(0, 1);
+    cmsMLUsetASCII(description, "en", "US", "Wide gamut test profile");
+    cmsWriteTag(profile, cmsSigProfileDescriptionTag, description);
+    cmsMLUfree(description);
+
+    cmsUInt32Number size = 0;
+    cmsSaveProfileToMem(profile, 0, &size);
+    QByteArray rawData(int(size), 0);
+    cmsSaveProfileToMem(profile, rawData.data(), &size);
+    cmsCloseProfile(profile);
+
+    return KoColorSpaceRegistry::instance()->createColorProfile(RGBAColorModelID.id(), colorDepthId, rawData);
+}
+
+const KoColorSpace* dstColorSpace(const QString &dstModel, const QString &dstDepth)
+{
+    if (dstModel == CMYKAColorModelID.id()) {
+        return KoColorSpaceRegistry::instance()->colorSpace(dstModel, dstDepth, 0);
+    }
+
+    return KoColorSpaceRegistry::instance()->colorSpace(dstModel, dstDepth, wideGamutProfile(dstDepth));
+}
+
+/**
+ * Converts \p src the same way as the engine does, but with LCMS directly
+ */
+QVector<quint8> convertWithLcms(const KoColorSpace *srcCs, const KoColorSpace *dstCs,
+                                const QVector<quint8> &src, int numPixels)
+{
+    QVector<quint8> result(numPixels * dstCs->pixelSize());
+
+    const QByteArray srcProfileData = srcCs->profile()->rawData();
+    const QByteArray dstProfileData = dstCs->profile()->rawData();
+
+    cmsHPROFILE srcProfile = cmsOpenProfileFromMem(srcProfileData.constData(), srcProfileData.size());
+    cmsHPROFILE dstProfile = cmsOpenProfileFromMem(dstProfileData.constData(), dstProfileData.size());
+    KIS_ASSERT(srcProfile && dstProfile);
+
+    cmsHTRANSFORM transform =
+        cmsCreateTransform(srcProfile, lcmsType(srcCs),
+                           dstProfile, lcmsType(dstCs),
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           quint32(KoColorConversionTransformation::internalConversionFlags() |
+                                   KoColorConversionTransformation::CopyAlpha));
+    KIS_ASSERT(transform);
+
+    cmsDoTransform(transform, src.constData(), result.data(), numPixels);
+
+    cmsDeleteTransform(transform);
+    cmsCloseProfile(srcProfile);
+    cmsCloseProfile(dstProfile);
+
+    return result;
+}
+
+}
+
+void TestLcmsColorConversionLut::initTestCase_data()
+{
+    QTest::addColumn<QString>("srcDepth");
+    QTest::addColumn<QString>("dstModel");
+    QTest::addColumn<QString>("dstDepth");
+    QTest::addColumn<bool>("usesLut");
+
+    QTest::newRow("srgb8-wide8") << Integer8BitsColorDepthID.id() << RGBAColorModelID.id() << Integer8BitsColorDepthID.id() << true;
+    QTest::newRow("srgb8-cmyk8") << Integer8BitsColorDepthID.id() << CMYKAColorModelID.id() << Integer8BitsColorDepthID.id() << true;
+    QTest::newRow("srgb16-wide16") << Integer16BitsColorDepthID.id() << RGBAColorModelID.id() << Integer16BitsColorDepthID.id() << false;
+    QTest::newRow("srgb8-wide16") << Integer8BitsColorDepthID.id() << RGBAColorModelID.id() << Integer16BitsColorDepthID.id() << false;
+    QTest::newRow("srgb16-cmyk16") << Integer16BitsColorDepthID.id() << CMYKAColorModelID.id() << Integer16BitsColorDepthID.id() << false;
+}
+
+void TestLcmsColorConversionLut::testShortSpans()
+{
+    QFETCH_GLOBAL(QString, srcDepth);
+    QFETCH_GLOBAL(QString, dstModel);
+    QFETCH_GLOBAL(QString, dstDepth);
+    QFETCH_GLOBAL(bool, usesLut);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), srcDepth, 0);
+    const KoColorSpace *dstCs = dstColorSpace(dstModel, dstDepth);
+    QVERIFY(srcCs);
+    QVERIFY(dstCs);
+
+    QCOMPARE(LcmsColorConversionLut::isSupported(srcCs, dstCs,
+                                                 KoColorConversionTransformation::internalConversionFlags()),
+             usesLut);
+
+    const int numPixels = 4096;
+    const QVector<quint8> src = randomPixels(srcCs, numPixels);
+    const QVector<quint8> reference = convertWithLcms(srcCs, dstCs, src, numPixels);
+
+    QVector<quint8> spans(numPixels * dstCs->pixelSize());
+
+    for (int i = 0; i < numPixels; i += LcmsColorConversionLut::maxSpanLength) {
+        const int length = qMin(int(LcmsColorConversionLut::maxSpanLength), numPixels - i);
+
+        srcCs->convertPixelsTo(src.constData() + i * srcCs->pixelSize(),
+                               spans.data() + i * dstCs->pixelSize(),
+                               dstCs, length,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               KoColorConversionTransformation::internalConversionFlags());
+    }
+
+    if (!usesLut) {
+        QVERIFY(spans == reference);
+        return;
+    }
+
+    /**
+     * The profiles differ, so the lut really has to interpolate
+     */
+    QVERIFY(spans != src);
+
+    QVector<float> lutChannels(dstCs->channelCount());
+    QVector<float> referenceChannels(dstCs->channelCount());
+
+    for (int i = 0; i < numPixels; i++) {
+        dstCs->normalisedChannelsValue(spans.constData() + i * dstCs->pixelSize(), lutChannels);
+        dstCs->normalisedChannelsValue(reference.constData() + i * dstCs->pixelSize(), referenceChannels);
+
+        for (int ch = 0; ch < lutChannels.size(); ch++) {
+            if (qAbs(lutChannels[ch] - referenceChannels[ch]) > LcmsColorConversionLut::maxError) {
+                qDebug() << "pixel" << i << "channel" << ch << referenceChannels[ch] << lutChannels[ch];
+                QFAIL("lut conversion deviates from LCMS");
+            }
+        }
+    }
+}
+
+void TestLcmsColorConversionLut::testBulkIsExact()
+{
+    QFETCH_GLOBAL(QString, srcDepth);
+    QFETCH_GLOBAL(QString, dstModel);
+    QFETCH_GLOBAL(QString, dstDepth);
+
+    const KoColorSpace *srcCs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), srcDepth, 0);
+    const KoColorSpace *dstCs = dstColorSpace(dstModel, dstDepth);
+    QVERIFY(srcCs);
+    QVERIFY(dstCs);
+
+    const int numPixels = 4096;
+    const QVector<quint8> src = randomPixels(srcCs, numPixels);
+    const QVector<quint8> reference = convertWithLcms(srcCs, dstCs, src, numPixels);
+
+    QVector<quint8> bulk(numPixels * dstCs->pixelSize());
+
+    srcCs->convertPixelsTo(src.constData(), bulk.data(), dstCs, numPixels,
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           KoColorConversionTransformation::internalConversionFlags());
+
+    QVERIFY(bulk == reference);
+}
+
+KISTEST_MAIN(TestLcmsColorConversionLut)
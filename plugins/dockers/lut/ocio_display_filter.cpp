@@ -98,6 +98,12 @@ void OcioDisplayFilter::setLockCurrentColorVisualRepresentation(bool value)
     m_lockCurrentColorVisualRepresentation = value;
 }
 
+bool OcioDisplayFilter::canBeBakedIntoLut() const
+{
+    // the alpha swizzle shows the alpha channel as gray
+    return swizzle != A;
+}
+
 QString OcioDisplayFilter::program() const
 {
     return m_program;
@@ -48,6 +48,7 @@ public:
     bool useInternalColorManagement() const;
     bool lockCurrentColorVisualRepresentation() const;
     void setLockCurrentColorVisualRepresentation(bool value);
+    bool canBeBakedIntoLut() const;
 
     bool updateShader();
     template <class F>
@@ -174,6 +174,9 @@ void KisLensBlurFilter::processImpl(KisPaintDeviceSP device,
     painter.setChannelFlags(channelFlags);
     painter.setProgress(progressUpdater);
 
+    // the dialog preview convolves the same data again on every change
+    painter.setCacheSourceSpectra(config->isDialogPreview());
+
     KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(irisKernel, 0, irisKernel.sum());
     painter.applyMatrix(kernel, device, srcTopLeft, srcTopLeft, rect.size(), BORDER_REPEAT);
 }
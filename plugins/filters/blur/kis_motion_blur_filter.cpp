@@ -146,6 +146,9 @@ void KisMotionBlurFilter::processImpl(KisPaintDeviceSP device,
     painter.setChannelFlags(channelFlags);
     painter.setProgress(progressUpdater);
 
+    // the dialog preview convolves the same data again on every change
+    painter.setCacheSourceSpectra(config->isDialogPreview());
+
     KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(motionBlurKernel, 0, motionBlurKernel.sum());
     painter.applyMatrix(kernel, device, srcTopLeft, srcTopLeft, rect.size(), BORDER_REPEAT);
 }
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_lut_color_transformation.h"
+
+#include <cstring>
+#include <limits>
+
+#include <KoChannelInfo.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceMaths.h>
+
+#include <kis_assert.h>
+
+namespace {
+
+template <typename channel_type>
+class LutColorTransformation : public KisLutColorTransformation
+{
+public:
+    LutColorTransformation(int channelCount)
+        : m_tables(channelCount)
+    {
+    }
+
+    void appendTransfer(int channelPos, const QVector<quint16> &transfer) override
+    {
+        const int channel = channelPos / int(sizeof(channel_type));
+        KIS_SAFE_ASSERT_RECOVER_RETURN(channel >= 0 && channel < m_tables.size());
+
+        if (transfer.size() < 2) return;
+
+        const int maxValue = std::numeric_limits<channel_type>::max();
+        QVector<channel_type> &table = m_tables[channel];
+
+        if (table.isEmpty()) {
+            table.resize(maxValue + 1);
+            for (int i = 0; i <= maxValue; i++) {
+                table[i] = channel_type(i);
+            }
+
+            m_activeChannels.append(channel);
+        }
+
+        /**
+         * The input value is mapped onto the transfer in the same way
+         * as lcms maps it onto a tabulated tone curve
+         */
+        const qreal transferScale = qreal(transfer.size() - 1) / maxValue;
+
+        for (int i = 0; i <= maxValue; i++) {
+            const qreal position = table[i] * transferScale;
+            const int index = qMin(int(position), transfer.size() - 2);
+            const qreal offset = position - index;
+
+            const quint16 value = quint16(qRound((1.0 - offset) * transfer[index] +
+                                                 offset * transfer[index + 1]));
+
+            table[i] = KoColorSpaceMaths<quint16, channel_type>::scaleToA(value);
+        }
+    }
+
+    void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const override
+    {
+        const int channelCount = m_tables.size();
+
+        if (srcU8 != dstU8) {
+            memcpy(dstU8, srcU8, nPixels * channelCount * sizeof(channel_type));
+        }
+
+        channel_type *dst = reinterpret_cast<channel_type*>(dstU8);
+
+        Q_FOREACH (int channel, m_activeChannels) {
+            const channel_type *table = m_tables[channel].constData();
+            channel_type *ptr = dst + channel;
+
+            for (qint32 i = 0; i < nPixels; i++) {
+                *ptr = table[*ptr];
+                ptr += channelCount;
+            }
+        }
+    }
+
+private:
+    QVector<QVector<channel_type>> m_tables;
+    QVector<int> m_activeChannels;
+};
+
+}
+
+KisLutColorTransformation* KisLutColorTransformation::create(const KoColorSpace *cs)
+{
+    const QList<KoChannelInfo*> channels = cs->channels();
+    if (channels.isEmpty()) return 0;
+
+    const KoChannelInfo::enumChannelValueType valueType = channels.first()->channelValueType();
+
+    Q_FOREACH (KoChannelInfo *channel, channels) {
+        if (channel->channelValueType() != valueType) return 0;
+    }
+
+    if (cs->pixelSize() != quint32(channels.size() * channels.first()->size())) return 0;
+
+    if (valueType == KoChannelInfo::UINT8) {
+        return new LutColorTransformation<quint8>(channels.size());
+    } else if (valueType == KoChannelInfo::UINT16) {
+        return new LutColorTransformation<quint16>(channels.size());
+    }
+
+    return 0;
+}
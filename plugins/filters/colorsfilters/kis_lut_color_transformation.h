@@ -0,0 +1,58 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_LUT_COLOR_TRANSFORMATION_H
+#define __KIS_LUT_COLOR_TRANSFORMATION_H
+
+#include <QVector>
+
+#include <KoColorTransformation.h>
+
+class KoColorSpace;
+
+/**
+ * A per-channel color transformation for the color spaces with
+ * integer channels (8 and 16 bits per channel). Every channel has its
+ * own table with an entry for every possible value of the channel, so
+ * applying the transformation is a single lookup per channel, without
+ * any conversions to floating point.
+ *
+ * The tables are filled in with appendTransfer(), which accepts the
+ * transfer functions in the same format as
+ * KoColorSpace::createPerChannelAdjustment() does. Several transfers
+ * appended to the same channel are applied one after another.
+ */
+class KisLutColorTransformation : public KoColorTransformation
+{
+public:
+    /**
+     * Creates a transformation for \p cs, or returns null if the
+     * channels of \p cs are not 8- or 16-bit integers
+     */
+    static KisLutColorTransformation* create(const KoColorSpace *cs);
+
+    /**
+     * Appends \p transfer to the channel at byte offset \p channelPos
+     * in the pixel. The transfer is a table of 16-bit values evenly
+     * spaced over the range of the channel, the values in between are
+     * interpolated linearly.
+     */
+    virtual void appendTransfer(int channelPos, const QVector<quint16> &transfer) = 0;
+};
+
+#endif /* __KIS_LUT_COLOR_TRANSFORMATION_H */
@@ -49,6 +49,7 @@
 
 #include "kis_histogram.h"
 #include "kis_painter.h"
+#include "kis_lut_color_transformation.h"
 #include "widgets/kis_curve_widget.h"
 #include <KisGlobalResourcesInterface.h>
 
@@ -199,6 +200,8 @@ KoColorTransformation* KisPerChannelFilter::createTransformation(const KoColorSp
         return 0;
     }
 
+    QVector<int> realChannelPositions;
+    QVector<bool> realChannelIsIdentity;
     bool colorsNull = true;
     bool hueNull = true;
     bool saturationNull = true;
@@ -215,6 +218,8 @@ KoColorTransformation* KisPerChannelFilter::createTransformation(const KoColorSp
     for (int i = 0; i < virtualChannels.size(); i++) {
         if (virtualChannels[i].type() == VirtualChannelInfo::REAL) {
             realTransfers << originalTransfers[i];
+            realChannelPositions << virtualChannels[i].channelInfo()->pos();
+            realChannelIsIdentity << originalCurves[i].isIdentity();
 
             if (virtualChannels[i].isAlpha()) {
                 alphaIndexInReal = realTransfers.size() - 1;
@@ -260,7 +265,27 @@ KoColorTransformation* KisPerChannelFilter::createTransformation(const KoColorSp
     KoColorTransformation *allColorsTransform = 0;
     KoColorTransformation *colorTransform = 0;
 
-    if (!colorsNull) {
+    /**
+     * For integer color spaces both per-channel adjustments are baked
+     * into a single table per channel
+     */
+    KisLutColorTransformation *lutTransform =
+        !colorsNull || !allColorsNull ? KisLutColorTransformation::create(cs) : 0;
+
+    if (lutTransform) {
+        for (int i = 0; i < realTransfers.size(); i++) {
+            if (!realChannelIsIdentity[i]) {
+                lutTransform->appendTransfer(realChannelPositions[i], realTransfers[i]);
+            }
+            if (!allColorsNull && i != alphaIndexInReal) {
+                lutTransform->appendTransfer(realChannelPositions[i], allColorsTransfer);
+            }
+        }
+
+        colorTransform = lutTransform;
+    }
+
+    if (!colorsNull && !lutTransform) {
         const quint16** transfers = new const quint16*[realTransfers.size()];
         for(int i = 0; i < realTransfers.size(); ++i) {
             transfers[i] = realTransfers[i].constData();
@@ -305,7 +330,7 @@ KoColorTransformation* KisPerChannelFilter::createTransformation(const KoColorSp
         lightnessTransform = cs->createBrightnessContrastAdjustment(lightnessTransfer.constData());
     }
 
-    if (!allColorsNull) {
+    if (!allColorsNull && !lutTransform) {
         const quint16** allColorsTransfers = new const quint16*[realTransfers.size()];
         for(int i = 0; i < realTransfers.size(); ++i) {
             allColorsTransfers[i] = (i != alphaIndexInReal) ?
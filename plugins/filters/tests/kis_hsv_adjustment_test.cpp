@@ -0,0 +1,302 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_hsv_adjustment_test.h"
+
+#include <QTest>
+
+#include <cmath>
+
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorTransformation.h>
+
+#include "../../color/colorspaceextensions/kis_hsv_adjustment.h"
+
+namespace {
+
+const KoColorSpace* colorSpaceForDepth(const QString &depthId)
+{
+    return KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depthId, 0);
+}
+
+KoColorTransformation* createAdjustment(const KoColorSpace *cs, int type,
+                                        qreal h, qreal s, qreal v,
+                                        bool forceScalar)
+{
+    QHash<QString, QVariant> params;
+    params["h"] = h;
+    params["s"] = s;
+    params["v"] = v;
+    params["type"] = type;
+    params["colorize"] = false;
+    params["compatibilityMode"] = false;
+    params["forceScalarImplementation"] = forceScalar;
+
+    return cs->createColorTransformation("hsv_adjustment", params);
+}
+
+KoColorTransformation* createCurveAdjustment(const KoColorSpace *cs,
+                                             const QVector<quint16> &curve,
+                                             int channel, int driverChannel, bool relative,
+                                             bool forcePerPixelLookup)
+{
+    QHash<QString, QVariant> params;
+    params["curve"] = QVariant::fromValue(curve);
+    params["channel"] = channel;
+    params["driverChannel"] = driverChannel;
+    params["relative"] = relative;
+    params["forcePerPixelLookup"] = forcePerPixelLookup;
+
+    return cs->createColorTransformation("hsv_curve_adjustment", params);
+}
+
+/**
+ * Random colors with a few grays, blacks and whites, which
+ * go through a separate branch of the transformation
+ */
+QVector<quint8> generatePixels(const KoColorSpace *cs, int numPixels)
+{
+    const int pixelSize = cs->pixelSize();
+    QVector<quint8> pixels(numPixels * pixelSize);
+
+    qsrand(1);
+
+    QVector<float> channels(4);
+
+    for (int i = 0; i < numPixels; i++) {
+        const float r = float(qrand()) / RAND_MAX;
+
+        switch (i % 16) {
+        case 0:
+            channels[0] = channels[1] = channels[2] = r;
+            break;
+        case 1:
+            channels[0] = channels[1] = channels[2] = 0.0f;
+            break;
+        case 2:
+            channels[0] = channels[1] = channels[2] = 1.0f;
+            break;
+        default:
+            channels[0] = r;
+            channels[1] = float(qrand()) / RAND_MAX;
+            channels[2] = float(qrand()) / RAND_MAX;
+        }
+
+        channels[3] = float(qrand()) / RAND_MAX;
+
+        cs->fromNormalisedChannelsValue(pixels.data() + i * pixelSize, channels);
+    }
+
+    return pixels;
+}
+
+}
+
+void KisHSVAdjustmentTest::testVectorVsScalar_data()
+{
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<int>("type");
+
+    const QStringList depths = {
+        Integer8BitsColorDepthID.id(),
+        Integer16BitsColorDepthID.id(),
+        Float32BitsColorDepthID.id()
+    };
+
+    const QStringList typeNames = {"hsv", "hsl", "hsi", "hsy"};
+
+    Q_FOREACH (const QString &depth, depths) {
+        for (int type = 0; type < typeNames.size(); type++) {
+            QTest::newRow(QString("%1-%2").arg(depth).arg(typeNames[type]).toLatin1()) << depth << type;
+        }
+    }
+}
+
+void KisHSVAdjustmentTest::testVectorVsScalar()
+{
+    QFETCH(QString, depthId);
+    QFETCH(int, type);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    QVERIFY(cs);
+
+    // odd size to check the tail of the vectorized loop
+    const int numPixels = 1021;
+    const QVector<quint8> src = generatePixels(cs, numPixels);
+
+    /**
+     * The integer color spaces may differ in one unit because of
+     * rounding, the float one only in the precision of the float math
+     */
+    const qreal tolerance =
+        depthId == Integer8BitsColorDepthID.id() ? 1.0 / 255.0 :
+        depthId == Integer16BitsColorDepthID.id() ? 1.0 / 65535.0 :
+        1e-4;
+
+    const QVector<QVector<qreal>> adjustments = {
+        {0.0, 0.0, 0.0},
+        {0.3, 0.0, 0.0},
+        {-0.7, 0.4, -0.2},
+        {1.0, -1.0, 0.5},
+        {-0.15, 0.9, 0.8},
+        {0.55, -0.35, -0.9}
+    };
+
+    Q_FOREACH (const QVector<qreal> &adj, adjustments) {
+        QScopedPointer<KoColorTransformation> scalar(createAdjustment(cs, type, adj[0], adj[1], adj[2], true));
+        QScopedPointer<KoColorTransformation> vector(createAdjustment(cs, type, adj[0], adj[1], adj[2], false));
+        QVERIFY(scalar);
+        QVERIFY(vector);
+
+        QVector<quint8> scalarDst(src.size());
+        QVector<quint8> vectorDst(src.size());
+
+        scalar->transform(src.constData(), scalarDst.data(), numPixels);
+        vector->transform(src.constData(), vectorDst.data(), numPixels);
+
+        QVector<float> scalarChannels(4);
+        QVector<float> vectorChannels(4);
+
+        for (int i = 0; i < numPixels; i++) {
+            cs->normalisedChannelsValue(scalarDst.constData() + i * cs->pixelSize(), scalarChannels);
+            cs->normalisedChannelsValue(vectorDst.constData() + i * cs->pixelSize(), vectorChannels);
+
+            for (int ch = 0; ch < 4; ch++) {
+                if (qAbs(scalarChannels[ch] - vectorChannels[ch]) > tolerance + 1e-6) {
+                    qDebug() << "adjustment" << adj << "pixel" << i << "channel" << ch;
+                    qDebug() << "scalar:" << scalarChannels;
+                    qDebug() << "vector:" << vectorChannels;
+                    QFAIL("The vectorized HSV adjustment differs from the scalar one");
+                }
+            }
+        }
+    }
+}
+
+void KisHSVAdjustmentTest::testCurveTableVsPerPixel_data()
+{
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<int>("channel");
+    QTest::addColumn<int>("driverChannel");
+    QTest::addColumn<bool>("relative");
+
+    const QStringList depths = {
+        Integer8BitsColorDepthID.id(),
+        Integer16BitsColorDepthID.id()
+    };
+
+    Q_FOREACH (const QString &depth, depths) {
+        QTest::newRow(QString("%1-red").arg(depth).toLatin1())
+            << depth << int(KisHSVCurve::Red) << int(KisHSVCurve::Red) << false;
+        QTest::newRow(QString("%1-all-colors-by-green").arg(depth).toLatin1())
+            << depth << int(KisHSVCurve::AllColors) << int(KisHSVCurve::Green) << true;
+        QTest::newRow(QString("%1-hue-by-blue").arg(depth).toLatin1())
+            << depth << int(KisHSVCurve::Hue) << int(KisHSVCurve::Blue) << true;
+        QTest::newRow(QString("%1-alpha").arg(depth).toLatin1())
+            << depth << int(KisHSVCurve::Alpha) << int(KisHSVCurve::Alpha) << false;
+    }
+}
+
+void KisHSVAdjustmentTest::testCurveTableVsPerPixel()
+{
+    QFETCH(QString, depthId);
+    QFETCH(int, channel);
+    QFETCH(int, driverChannel);
+    QFETCH(bool, relative);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    QVERIFY(cs);
+
+    const int numPixels = 1021;
+    const QVector<quint8> src = generatePixels(cs, numPixels);
+
+    // a non-monotonic curve with a few hundred nodes
+    QVector<quint16> curve(257);
+    for (int i = 0; i < curve.size(); i++) {
+        const qreal x = qreal(i) / (curve.size() - 1);
+        curve[i] = quint16(qBound(0.0, 0.5 + 0.45 * std::sin(x * 7.0), 1.0) * 0xFFFF);
+    }
+
+    QScopedPointer<KoColorTransformation> table(
+        createCurveAdjustment(cs, curve, channel, driverChannel, relative, false));
+    QScopedPointer<KoColorTransformation> perPixel(
+        createCurveAdjustment(cs, curve, channel, driverChannel, relative, true));
+    QVERIFY(table);
+    QVERIFY(perPixel);
+
+    QVector<quint8> tableDst(src.size());
+    QVector<quint8> perPixelDst(src.size());
+
+    table->transform(src.constData(), tableDst.data(), numPixels);
+    perPixel->transform(src.constData(), perPixelDst.data(), numPixels);
+
+    /**
+     * The table stores exactly the values the per-pixel path
+     * computes, so the results should be bit-exact
+     */
+    for (int i = 0; i < numPixels; i++) {
+        const int offset = i * cs->pixelSize();
+
+        if (memcmp(tableDst.constData() + offset, perPixelDst.constData() + offset, cs->pixelSize()) != 0) {
+            qDebug() << "pixel" << i;
+            QFAIL("The tabulated HSV curve adjustment differs from the per-pixel one");
+        }
+    }
+}
+
+void KisHSVAdjustmentTest::benchmarkAdjustment_data()
+{
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<bool>("forceScalar");
+
+    const QStringList depths = {
+        Integer8BitsColorDepthID.id(),
+        Integer16BitsColorDepthID.id(),
+        Float32BitsColorDepthID.id()
+    };
+
+    Q_FOREACH (const QString &depth, depths) {
+        QTest::newRow(QString("%1-scalar").arg(depth).toLatin1()) << depth << true;
+        QTest::newRow(QString("%1-vector").arg(depth).toLatin1()) << depth << false;
+    }
+}
+
+void KisHSVAdjustmentTest::benchmarkAdjustment()
+{
+    QFETCH(QString, depthId);
+    QFETCH(bool, forceScalar);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    QVERIFY(cs);
+
+    const int numPixels = 512 * 512;
+    const QVector<quint8> src = generatePixels(cs, numPixels);
+    QVector<quint8> dst(src.size());
+
+    QScopedPointer<KoColorTransformation> adjustment(createAdjustment(cs, 1, 0.3, 0.2, -0.1, forceScalar));
+    QVERIFY(adjustment);
+
+    QBENCHMARK {
+        adjustment->transform(src.constData(), dst.data(), numPixels);
+    }
+}
+
+#include <sdk/tests/kistest.h>
+KISTEST_MAIN(KisHSVAdjustmentTest)
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_lut_color_transformation_test.h"
+
+#include <QTest>
+
+#include <KoChannelInfo.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorTransformation.h>
+#include <KoCompositeColorTransformation.h>
+
+#include <kis_cubic_curve.h>
+
+#include "../colorsfilters/kis_lut_color_transformation.h"
+
+namespace {
+
+QVector<quint16> curveTransfer(const QList<QPointF> &points)
+{
+    return KisCubicCurve(points).uint16Transfer();
+}
+
+/**
+ * All the values of every channel in the 8-bit case, the
+ * ramps are shifted so that the channels differ
+ */
+QVector<quint8> generatePixels(const KoColorSpace *cs, int numPixels)
+{
+    const int pixelSize = cs->pixelSize();
+    QVector<quint8> pixels(numPixels * pixelSize);
+
+    QVector<float> channels(4);
+
+    for (int i = 0; i < numPixels; i++) {
+        for (int ch = 0; ch < 4; ch++) {
+            channels[ch] = float((i + ch * 67) % numPixels) / (numPixels - 1);
+        }
+
+        cs->fromNormalisedChannelsValue(pixels.data() + i * pixelSize, channels);
+    }
+
+    return pixels;
+}
+
+}
+
+void KisLutColorTransformationTest::testLutVsPerChannelAdjustment_data()
+{
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<bool>("useColorCurves");
+    QTest::addColumn<bool>("useAllColorsCurve");
+    QTest::addColumn<qreal>("tolerance");
+
+    QTest::newRow("u8-colors") << Integer8BitsColorDepthID.id() << true << false << 1.01 / 255.0;
+    QTest::newRow("u8-all-colors") << Integer8BitsColorDepthID.id() << false << true << 1.01 / 255.0;
+    QTest::newRow("u8-both") << Integer8BitsColorDepthID.id() << true << true << 1.01 / 255.0;
+    QTest::newRow("u16-colors") << Integer16BitsColorDepthID.id() << true << false << 1.0 / 1024.0;
+    QTest::newRow("u16-all-colors") << Integer16BitsColorDepthID.id() << false << true << 1.0 / 1024.0;
+    QTest::newRow("u16-both") << Integer16BitsColorDepthID.id() << true << true << 1.0 / 1024.0;
+}
+
+void KisLutColorTransformationTest::testLutVsPerChannelAdjustment()
+{
+    QFETCH(QString, depthId);
+    QFETCH(bool, useColorCurves);
+    QFETCH(bool, useAllColorsCurve);
+    QFETCH(qreal, tolerance);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depthId, 0);
+    QVERIFY(cs);
+
+    /**
+     * Different curves for red, green and alpha catch a wrong order
+     * of the channels, blue is left identity, like the curves filter
+     * skips the identity curves
+     */
+    const QVector<quint16> identity = curveTransfer({QPointF(0.0, 0.0), QPointF(1.0, 1.0)});
+
+    QVector<QVector<quint16>> channelTransfers;
+    channelTransfers << curveTransfer({QPointF(0.0, 0.1), QPointF(0.4, 0.7), QPointF(1.0, 0.9)});
+    channelTransfers << curveTransfer({QPointF(0.0, 0.0), QPointF(0.6, 0.2), QPointF(1.0, 1.0)});
+    channelTransfers << identity;
+    channelTransfers << curveTransfer({QPointF(0.0, 0.3), QPointF(1.0, 0.8)});
+
+    const QVector<quint16> allColorsTransfer =
+        curveTransfer({QPointF(0.0, 0.05), QPointF(0.3, 0.5), QPointF(1.0, 0.95)});
+
+    // the channels in display order, the alpha channel is the last one
+    const QList<KoChannelInfo*> channels = KoChannelInfo::displayOrderSorted(cs->channels());
+    QCOMPARE(channels.size(), 4);
+    QCOMPARE(channels.last()->channelType(), KoChannelInfo::ALPHA);
+
+    QScopedPointer<KisLutColorTransformation> lut(KisLutColorTransformation::create(cs));
+    QVERIFY(lut);
+
+    QVector<KoColorTransformation*> referenceTransforms;
+
+    if (useColorCurves) {
+        const quint16* transfers[4];
+
+        for (int i = 0; i < channels.size(); i++) {
+            transfers[i] = channelTransfers[i].constData();
+
+            if (channelTransfers[i] != identity) {
+                lut->appendTransfer(channels[i]->pos(), channelTransfers[i]);
+            }
+        }
+
+        referenceTransforms << cs->createPerChannelAdjustment(transfers);
+    }
+
+    if (useAllColorsCurve) {
+        const quint16* transfers[4];
+
+        for (int i = 0; i < channels.size(); i++) {
+            const bool isAlpha = channels[i]->channelType() == KoChannelInfo::ALPHA;
+            transfers[i] = !isAlpha ? allColorsTransfer.constData() : 0;
+
+            if (!isAlpha) {
+                lut->appendTransfer(channels[i]->pos(), allColorsTransfer);
+            }
+        }
+
+        referenceTransforms << cs->createPerChannelAdjustment(transfers);
+    }
+
+    QScopedPointer<KoColorTransformation> reference(
+        KoCompositeColorTransformation::createOptimizedCompositeTransform(referenceTransforms));
+    QVERIFY(reference);
+
+    const int numPixels = 256;
+    const QVector<quint8> src = generatePixels(cs, numPixels);
+
+    QVector<quint8> lutDst(src.size());
+    QVector<quint8> referenceDst(src.size());
+
+    lut->transform(src.constData(), lutDst.data(), numPixels);
+    reference->transform(src.constData(), referenceDst.data(), numPixels);
+
+    QVector<float> lutChannels(4);
+    QVector<float> referenceChannels(4);
+
+    for (int i = 0; i < numPixels; i++) {
+        const int offset = i * cs->pixelSize();
+
+        cs->normalisedChannelsValue(lutDst.constData() + offset, lutChannels);
+        cs->normalisedChannelsValue(referenceDst.constData() + offset, referenceChannels);
+
+        for (int ch = 0; ch < 4; ch++) {
+            if (qAbs(lutChannels[ch] - referenceChannels[ch]) > tolerance) {
+                qDebug() << "pixel" << i << "channel" << ch
+                         << "lut" << lutChannels[ch] << "reference" << referenceChannels[ch];
+                QFAIL("The baked table differs from the per-channel adjustment");
+            }
+        }
+    }
+}
+
+QTEST_MAIN(KisLutColorTransformationTest)
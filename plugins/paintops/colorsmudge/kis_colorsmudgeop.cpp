@@ -21,6 +21,7 @@
 #include <cmath>
 #include <memory>
 #include <QRect>
+#include <QElapsedTimer>
 
 #include <KoColorSpaceRegistry.h>
 #include <KoColor.h>
@@ -39,9 +40,25 @@
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
 #include <KoColorModelStandardIds.h>
+#include <kis_dab_cache_base.h>
+#include <kis_texture_option.h>
+#include <KisRunnableStrokeJobData.h>
+#include "kis_image_config.h"
 #include "kis_paintop_plugin_utils.h"
 
 
+/**
+ * Calculates the destination rects of the dabs and tells whether the
+ * mask of the previous dab can be reused. The masks themselves are
+ * generated by the asynchronous update.
+ */
+class KisColorSmudgeOp::MaskGenerationCache : public KisDabCacheBase
+{
+public:
+    using KisDabCacheBase::fetchDabGenerationInfo;
+};
+
+
 KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
     , m_firstRun(true)
@@ -55,6 +72,11 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
     , m_smudgeRadiusOption()
+    , m_maskGenerationCache(new MaskGenerationCache())
+    , m_avgUpdateTimePerDab(50)
+    , m_idealNumThreads(KisImageConfig(true).maxNumberOfThreads())
+    , m_minUpdatePeriod(10)
+    , m_maxUpdatePeriod(100)
 {
     Q_UNUSED(node);
 
@@ -117,31 +139,56 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     if (m_overlayModeOption.isChecked() && m_image && m_image->projection()){
         m_preciseImageDeviceWrapper.reset(new KisPrecisePaintDeviceWrapper(m_image->projection()));
     }
+
+    /**
+     * We generate the masks in our own threads, so we need to forbid
+     * the brushes to do threading internally
+     */
+    m_brush->setThreadingAllowed(false);
+
+    m_maskGenerationCache->setPrecisionOption(&m_precisionOption);
+    m_maskGenerationCache->setMirrorPostprocessing(&m_mirrorOption);
+
+    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
+        /**
+        * Disable handling of the subpixel precision. In the smudge op we
+        * should read from the aligned areas of the image, so having
+        * additional internal offsets, created by the subpixel precision,
+        * will worsen the quality (at least because
+        * QRectF(dstDabRect).center() will not point to the real center
+        * of the brush anymore).
+        * Of course, this only really matters with smearing_mode (bug:327235),
+        * and you only notice the lack of subpixel precision in the dulling methods.
+        */
+        m_maskGenerationCache->disableSubpixelPrecision();
+    }
+
+    KisBrushSP baseBrush = m_brush;
+    const int levelOfDetail = painter->device()->defaultBounds()->currentLevelOfDetail();
+    m_resourcesFactory =
+        [baseBrush, settings, levelOfDetail] () {
+            KisDabCacheUtils::DabRenderingResources *resources =
+                new KisDabCacheUtils::DabRenderingResources();
+            resources->brush = baseBrush->clone().dynamicCast<KisBrush>();
+
+            resources->textureOption.reset(new KisTextureProperties(levelOfDetail));
+            resources->textureOption->fillProperties(settings, settings->resourcesInterface());
+
+            return resources;
+        };
+
+    // the dab rects are calculated in paintAt() using the brush of the paintop itself
+    m_requestResources.reset(m_resourcesFactory());
+    m_requestResources->brush = m_brush;
 }
 
 KisColorSmudgeOp::~KisColorSmudgeOp()
 {
     qDeleteAll(m_hsvOptions);
+    qDeleteAll(m_maskGenerationResources);
     delete m_hsvTransform;
 }
 
-void KisColorSmudgeOp::updateMask(const KisPaintInformation& info, const KisDabShape &shape, const QPointF &cursorPoint)
-{
-    static const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
-    static KoColor color(Qt::black, cs);
-
-    m_maskDab = m_dabCache->fetchDab(cs,
-                                     color,
-                                     cursorPoint,
-                                     shape,
-                                     info,
-                                     1.0,
-                                     &m_dstDabRect);
-
-    // sanity check
-    KIS_ASSERT_RECOVER_NOOP(m_dstDabRect.size() == m_maskDab->bounds().size());
-}
-
 inline void KisColorSmudgeOp::getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y)
 {
     QPointF topLeft = pos - hotSpot;
@@ -154,37 +201,12 @@ inline void KisColorSmudgeOp::getTopLeftAligned(const QPointF &pos, const QPoint
 KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 {
     KisBrushSP brush = m_brush;
-    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
-
-    /* This is a fix for dulling + overlay + paint,
-     * this should allow the image to composite paint addition effects correctly
-     * while also respecting overlay mode. */
-    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
-                                        useDullingMode &&
-                                        m_preciseImageDeviceWrapper!= nullptr);
-
-    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
-                                                                                 m_precisePainterWrapper;
 
     // Simple error catching
     if (!painter()->device() || !brush || !brush->canPaintFor(info)) {
         return KisSpacingInformation(1.0);
     }
 
-    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
-        /**
-        * Disable handling of the subpixel precision. In the smudge op we
-        * should read from the aligned areas of the image, so having
-        * additional internal offsets, created by the subpixel precision,
-        * will worsen the quality (at least because
-        * QRectF(m_dstDabRect).center() will not point to the real center
-        * of the brush anymore).
-        * Of course, this only really matters with smearing_mode (bug:327235),
-        * and you only notice the lack of subpixel precision in the dulling methods.
-        */
-        m_dabCache->disableSubpixelPrecision();
-    }
-
 #if 0
     //if precision
     KoColor colorSpaceChanger = painter()->paintColor();
@@ -211,20 +233,218 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
                               brush->maskWidth(shape, 0, 0, info),
                               brush->maskHeight(shape, 0, 0, info));
 
-    QPointF hotSpot = brush->hotSpot(shape, info);
+    static const KoColorSpace *maskColorSpace = KoColorSpaceRegistry::instance()->alpha8();
+    static KoColor maskColor(Qt::black, maskColorSpace);
+
+    DabRequest request;
+    request.seqNo = m_nextSeqNo++;
+    request.hotSpot = brush->hotSpot(shape, info);
+    request.opacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
+
+    /**
+     * Calculate the destination rect of the dab right now, the mask itself
+     * will be generated later by the asynchronous update.
+     */
+    m_requestResources->syncResourcesToSeqNo(request.seqNo, info);
+
+    bool shouldUseCache = false;
+    m_maskGenerationCache->fetchDabGenerationInfo(m_hasGeneratedMasks,
+                                                  m_requestResources.data(),
+                                                  KisDabCacheUtils::DabRequestInfo(
+                                                      maskColor,
+                                                      scatteredPos,
+                                                      shape,
+                                                      info,
+                                                      1.0),
+                                                  &request.generationInfo,
+                                                  &shouldUseCache);
+    m_hasGeneratedMasks = true;
+
+    // postprocessed masks depend on the dab position, so they cannot be shared
+    request.reuseMask = shouldUseCache && !request.generationInfo.needsPostprocessing;
+
+    if (m_colorRateOption.isChecked()) {
+        // the current color (foreground color) or a gradient color (if enabled)
+        KoColor color = m_paintColor;
+        m_gradientOption.apply(color, m_gradient, info);
+        if (m_hsvTransform) {
+            Q_FOREACH (KisPressureHSVOption * option, m_hsvOptions) {
+                option->apply(m_hsvTransform, info);
+            }
+            m_hsvTransform->transform(color.data(), color.data(), 1);
+        }
+        request.paintColor = color;
+    }
+
+    m_pendingDabs.append(request);
+
+    return effectiveSpacing(scale, rotation,
+                            &m_airbrushOption, &m_spacingOption, info);
+}
+
+struct KisColorSmudgeOp::UpdateSharedState
+{
+    QVector<DabRequest> dabs;
+    QElapsedTimer updateTimer;
+};
+
+std::pair<int, bool> KisColorSmudgeOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    if (m_updateSharedState || m_pendingDabs.isEmpty()) {
+        return std::make_pair(m_currentUpdatePeriod, false);
+    }
+
+    m_updateSharedState = toQShared(new UpdateSharedState());
+    UpdateSharedStateSP state = m_updateSharedState;
+
+    {
+        // the smudging cannot be parallelized, so we limit the number of
+        // dabs in one update to fit the maximum update period
+        const qreal updateTimePerDab = m_avgUpdateTimePerDab.rollingMeanSafe();
+        const int dabsLimit =
+            updateTimePerDab > 0 ?
+                qMax(10, int(m_maxUpdatePeriod / updateTimePerDab)) :
+                m_pendingDabs.size();
+
+        if (m_pendingDabs.size() <= dabsLimit) {
+            state->dabs.swap(m_pendingDabs);
+        } else {
+            state->dabs = m_pendingDabs.mid(0, dabsLimit);
+            m_pendingDabs.remove(0, dabsLimit);
+        }
+    }
+
+    const bool someDabsAreStillInQueue = !m_pendingDabs.isEmpty();
+
+    /**
+     * The mask devices are taken from the pool of the devices released
+     * by the previous updates, so that the masks are not reallocated for
+     * every dab
+     */
+    static const KoColorSpace *maskColorSpace = KoColorSpaceRegistry::instance()->alpha8();
+
+    for (auto it = state->dabs.begin(); it != state->dabs.end(); ++it) {
+        if (it->reuseMask) continue;
+
+        it->maskDab = !m_maskDabPool.isEmpty() ?
+            m_maskDabPool.takeLast() : new KisFixedPaintDevice(maskColorSpace);
+    }
 
     /**
-     * Update the brush mask.
-     *
-     * Upon leaving the function:
-     *   o m_maskDab stores the new mask
-     *   o m_maskBounds stores the extents of the mask paint device
-     *   o m_dstDabRect stores the destination rect where the mask is going
-     *     to be written to
+     * Stage 1: the masks do not depend on the content of the canvas, so
+     * the dabs are split into contiguous chunks and the masks of each
+     * chunk are generated in a separate thread with its own copy of the
+     * brush.
      */
-    updateMask(info, shape, scatteredPos);
+    const int numMaskJobs = qMin(m_idealNumThreads, state->dabs.size());
+
+    while (m_maskGenerationResources.size() < numMaskJobs) {
+        m_maskGenerationResources.append(m_resourcesFactory());
+    }
+
+    for (int i = 0; i < numMaskJobs; i++) {
+        const int begin = state->dabs.size() * i / numMaskJobs;
+        const int end = state->dabs.size() * (i + 1) / numMaskJobs;
+        KisDabCacheUtils::DabRenderingResources *resources = m_maskGenerationResources[i];
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [this, state, begin, end, resources] () {
+                    generateMasks(state, begin, end, resources);
+                },
+                KisStrokeJobData::CONCURRENT));
+    }
 
-    QPointF newCenterPos = QRectF(m_dstDabRect).center();
+    /**
+     * Stage 2: every dab reads the pixels written by the previous one,
+     * so the smudging itself is done sequentially in the order the dabs
+     * have been requested.
+     */
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [this, state, someDabsAreStillInQueue] () {
+                state->updateTimer.start();
+
+                /**
+                 * The dabs are smudged strictly in the order they were
+                 * requested, so every dab samples the canvas after all
+                 * the previous dabs of the stroke have been painted, the
+                 * same way as if they were painted right in paintAt()
+                 */
+                Q_FOREACH (const DabRequest &request, state->dabs) {
+                    if (!request.reuseMask) {
+                        if (m_lastMaskDab) {
+                            m_maskDabPool.append(m_lastMaskDab);
+                        }
+                        m_lastMaskDab = request.maskDab;
+                    }
+
+                    KIS_SAFE_ASSERT_RECOVER(m_lastMaskDab) { continue; }
+                    paintDab(request, m_lastMaskDab);
+                }
+
+                const int updateTime = state->updateTimer.elapsed();
+                m_avgUpdateTimePerDab(qreal(updateTime) / state->dabs.size());
+
+                m_currentUpdatePeriod =
+                    someDabsAreStillInQueue ? m_minUpdatePeriod :
+                    qBound(m_minUpdatePeriod, int(1.5 * updateTime), m_maxUpdatePeriod);
+
+                // release all the mask devices
+                state->dabs.clear();
+
+                m_updateSharedState.clear();
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    return std::make_pair(m_currentUpdatePeriod, someDabsAreStillInQueue);
+}
+
+void KisColorSmudgeOp::generateMasks(UpdateSharedStateSP state, int begin, int end,
+                                     KisDabCacheUtils::DabRenderingResources *resources)
+{
+    DabRequest *requests = state->dabs.data();
+
+    for (int i = begin; i < end; i++) {
+        DabRequest &request = requests[i];
+        if (request.reuseMask) continue;
+
+        const KisDabCacheUtils::DabGenerationInfo &di = request.generationInfo;
+
+        resources->syncResourcesToSeqNo(request.seqNo, di.info);
+
+        KisDabCacheUtils::generateDab(di, resources, &request.maskDab);
+
+        if (di.needsPostprocessing) {
+            KisDabCacheUtils::postProcessDab(request.maskDab, di.dstDabRect.topLeft(), di.info, resources);
+        }
+    }
+}
+
+void KisColorSmudgeOp::paintDab(const DabRequest &request, KisFixedPaintDeviceSP maskDab)
+{
+    const KisPaintInformation &info = request.generationInfo.info;
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+
+    /* This is a fix for dulling + overlay + paint,
+     * this should allow the image to composite paint addition effects correctly
+     * while also respecting overlay mode. */
+    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
+                                        useDullingMode &&
+                                        m_preciseImageDeviceWrapper!= nullptr);
+
+    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
+                                                                                 m_precisePainterWrapper;
+
+    QRect dstDabRect = request.generationInfo.dstDabRect;
+    if (request.reuseMask) {
+        dstDabRect = KisDabCacheUtils::correctDabRectWhenFetchedFromCache(dstDabRect, maskDab->bounds().size());
+    }
+
+    // sanity check
+    KIS_ASSERT_RECOVER_NOOP(dstDabRect.size() == maskDab->bounds().size());
+
+    QPointF newCenterPos = QRectF(dstDabRect).center();
     /**
      * Save the center of the current dab to know where to read the
      * data during the next pass. We do not save scatteredPos here,
@@ -232,20 +452,16 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
      * brush (due to rounding effects), which will result in a
      * really weird quality.
      */
-    QRect srcDabRect = m_dstDabRect.translated((m_lastPaintPos - newCenterPos).toPoint());
+    QRect srcDabRect = dstDabRect.translated((m_lastPaintPos - newCenterPos).toPoint());
 
     m_lastPaintPos = newCenterPos;
 
-    KisSpacingInformation spacingInfo =
-        effectiveSpacing(scale, rotation,
-                         &m_airbrushOption, &m_spacingOption, info);
-
     if (m_firstRun) {
         m_firstRun = false;
-        return spacingInfo;
+        return;
     }
 
-    const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
+    const qreal fpOpacity = request.opacity;
 
     if (m_image && m_overlayModeOption.isChecked()) {
         m_image->blockUpdates();
@@ -255,20 +471,20 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
     else {
         // IMPORTANT: Clear the temporary painting device to transparent black.
         //            It will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
+        m_tempDev->clear(QRect(QPoint(), dstDabRect.size()));
     }
 
     // stored in the color space of the paintColor
     KoColor dullingFillColor = m_paintColor;
 
-    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
+    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + request.hotSpot).toPoint();
 
     if (!useDullingMode) {
         activeWrapper.readRect(srcDabRect);
         m_smudgePainter->bitBlt(QPoint(), activeWrapper.preciseDevice(), srcDabRect);
     } else {
         if (m_smudgeRadiusOption.isChecked()) {
-            const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
+            const qreal effectiveSize = 0.5 * (dstDabRect.width() + dstDabRect.height());
 
             const QRect sampleRect = m_smudgeRadiusOption.sampleRect(info, effectiveSize, canvasLocalSamplePoint);
             activeWrapper.readRect(sampleRect);
@@ -293,25 +509,17 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
         m_colorRateOption.apply(*m_colorRatePainter, info, 0.0, maxColorRate, fpOpacity);
 
-        // paint a rectangle with the current color (foreground color)
-        // or a gradient color (if enabled)
+        // paint a rectangle with the color calculated in paintAt()
         // into the temporary painting device and use the user selected
         // composite mode
-        KoColor color = m_paintColor;
-        m_gradientOption.apply(color, m_gradient, info);
-        if (m_hsvTransform) {
-            Q_FOREACH (KisPressureHSVOption * option, m_hsvOptions) {
-                option->apply(m_hsvTransform, info);
-            }
-            m_hsvTransform->transform(color.data(), color.data(), 1);
-        }
+        KoColor color = request.paintColor;
 
         if (!useDullingMode) {
             KIS_SAFE_ASSERT_RECOVER(*m_colorRatePainter->device()->colorSpace() == *color.colorSpace()) {
                 color.convertTo(m_colorRatePainter->device()->colorSpace());
             }
 
-            m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+            m_colorRatePainter->fill(0, 0, dstDabRect.width(), dstDabRect.height(), color);
         } else {
             KIS_SAFE_ASSERT_RECOVER(*dullingFillColor.colorSpace() == *color.colorSpace()) {
                 color.convertTo(dullingFillColor.colorSpace());
@@ -327,10 +535,10 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     if (useDullingMode) {
         KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        m_tempDev->fill(QRect(0, 0, m_dstDabRect.width(), m_dstDabRect.height()), dullingFillColor);
+        m_tempDev->fill(QRect(0, 0, dstDabRect.width(), dstDabRect.height()), dullingFillColor);
     }
 
-    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(m_dstDabRect));
+    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(dstDabRect));
 
     // if color is disabled (only smudge) and "overlay mode" is enabled
     // then first blit the region under the brush from the image projection
@@ -342,7 +550,7 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         // TODO: check if this code is correct in mirrored mode! Technically, the
         //       painter renders the mirrored dab only, so we should also prepare
         //       the overlay for it in all the places.
-        m_finalPainter->bitBlt(m_dstDabRect.topLeft(), m_image->projection(), m_dstDabRect);
+        m_finalPainter->bitBlt(dstDabRect.topLeft(), m_image->projection(), dstDabRect);
         m_image->unblockUpdates();
     }
 
@@ -351,14 +559,12 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     // then blit the temporary painting device on the canvas at the current brush position
     // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
-    m_finalPainter->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    m_finalPainter->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    m_finalPainter->bitBltWithFixedSelection(dstDabRect.x(), dstDabRect.y(), m_tempDev, maskDab, dstDabRect.width(), dstDabRect.height());
+    m_finalPainter->renderMirrorMaskSafe(dstDabRect, m_tempDev, 0, 0, maskDab, !m_dabCache->needSeparateOriginal());
 
     const QVector<QRect> dirtyRects = m_finalPainter->takeDirtyRegion();
     m_precisePainterWrapper.writeRects(dirtyRects);
     painter()->addDirtyRects(dirtyRects);
-
-    return spacingInfo;
 }
 
 KisSpacingInformation KisColorSmudgeOp::updateSpacingImpl(const KisPaintInformation &info) const
@@ -36,6 +36,8 @@
 #include <kis_pressure_gradient_option.h>
 #include <kis_pressure_hsv_option.h>
 #include <kis_airbrush_option_widget.h>
+#include <KisDabCacheUtils.h>
+#include <KisRollingMeanAccumulatorWrapper.h>
 
 #include "kis_overlay_mode_option.h"
 #include "kis_rate_option.h"
@@ -48,13 +50,23 @@ class QPointF;
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
 class KoColorSpace;
+class KisRunnableStrokeJobData;
 
+/**
+ * The color smudge op paints in two stages. paintAt() only calculates the
+ * parameters of the dab and queues it. The asynchronous update generates
+ * the masks of all the queued dabs in parallel and then smudges them into
+ * the canvas one by one, because every dab reads the pixels written by
+ * the previous one.
+ */
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
 public:
     KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image);
     ~KisColorSmudgeOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
@@ -62,8 +74,32 @@ protected:
     KisTimingInformation updateTimingImpl(const KisPaintInformation &info) const;
 
 private:
-    // Sets the m_maskDab _and m_maskDabRect
-    void updateMask(const KisPaintInformation& info, const KisDabShape &shape, const QPointF &cursorPoint);
+    /**
+     * All the information about a dab that is collected in paintAt(). It
+     * depends on the state of the options only, not on the content of the
+     * canvas, so it can be calculated ahead of the actual smudging.
+     */
+    struct DabRequest {
+        KisDabCacheUtils::DabGenerationInfo generationInfo;
+        QPointF hotSpot;
+        qreal opacity = 1.0;
+        KoColor paintColor;
+        int seqNo = 0;
+
+        // the dab has the same shape as the previous one, so the
+        // mask should be taken from it instead of being generated
+        bool reuseMask = false;
+
+        // taken from the pool of masks and filled by the mask generation jobs
+        KisFixedPaintDeviceSP maskDab;
+    };
+
+    class MaskGenerationCache;
+    struct UpdateSharedState;
+    typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
+    void generateMasks(UpdateSharedStateSP state, int begin, int end, KisDabCacheUtils::DabRenderingResources *resources);
+    void paintDab(const DabRequest &request, KisFixedPaintDeviceSP maskDab);
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
@@ -93,12 +129,29 @@ private:
     KisPressureGradientOption m_gradientOption;
     QList<KisPressureHSVOption*> m_hsvOptions;
     KisAirbrushOptionProperties m_airbrushOption;
-    QRect                     m_dstDabRect;
-    KisFixedPaintDeviceSP     m_maskDab;
     QPointF                   m_lastPaintPos;
 
     KoColorTransformation *m_hsvTransform {0};
     const KoCompositeOp *m_preciseColorRateCompositeOp {0};
+
+    // dab pipeline
+    QScopedPointer<MaskGenerationCache> m_maskGenerationCache;
+    KisDabCacheUtils::ResourcesFactory m_resourcesFactory;
+    QScopedPointer<KisDabCacheUtils::DabRenderingResources> m_requestResources;
+    QVector<KisDabCacheUtils::DabRenderingResources*> m_maskGenerationResources;
+    QVector<DabRequest> m_pendingDabs;
+    KisFixedPaintDeviceSP m_lastMaskDab;
+    QVector<KisFixedPaintDeviceSP> m_maskDabPool;
+    bool m_hasGeneratedMasks {false};
+    int m_nextSeqNo {0};
+
+    UpdateSharedStateSP m_updateSharedState;
+    int m_currentUpdatePeriod {20};
+    KisRollingMeanAccumulatorWrapper m_avgUpdateTimePerDab;
+
+    const int m_idealNumThreads;
+    const int m_minUpdatePeriod;
+    const int m_maxUpdatePeriod;
 };
 
 #endif // _KIS_COLORSMUDGEOP_H_
@@ -31,6 +31,8 @@ public:
 
     QList<KisUniformPaintOpPropertySP> uniformProperties(KisPaintOpSettingsSP settings) override;
 
+    bool needsAsynchronousUpdates() const override;
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
@@ -35,7 +35,6 @@
 
 KisCurvePaintOp::KisCurvePaintOp(const KisPaintOpSettingsSP settings, KisPainter * painter, KisNodeSP node, KisImageSP image)
     : KisPaintOp(painter)
-    , m_painter(0)
 {
     Q_ASSERT(settings);
     Q_UNUSED(image);
@@ -49,7 +48,6 @@ KisCurvePaintOp::KisCurvePaintOp(const KisPaintOpSettingsSP settings, KisPainter
 
 KisCurvePaintOp::~KisCurvePaintOp()
 {
-    delete m_painter;
 }
 
 KisSpacingInformation KisCurvePaintOp::paintAt(const KisPaintInformation& info)
@@ -75,7 +73,8 @@ void KisCurvePaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
         m_dab->clear();
     }
 
-    paintLine(m_dab, pi1, pi2);
+    addCurveLines(pi1, pi2);
+    m_rasterizer.render(m_dab, painter()->paintColor());
 
     QRect rc = m_dab->extent();
 
@@ -85,13 +84,8 @@ void KisCurvePaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     painter()->setOpacity(origOpacity);
 }
 
-void KisCurvePaintOp::paintLine(KisPaintDeviceSP dab, const KisPaintInformation &pi1, const KisPaintInformation &pi2)
+void KisCurvePaintOp::addCurveLines(const KisPaintInformation &pi1, const KisPaintInformation &pi2)
 {
-    if (!m_painter) {
-        m_painter = new KisPainter(dab);
-        m_painter->setPaintColor(painter()->paintColor());
-    }
-
     int maxPoints = m_curveProperties.curve_stroke_history_size;
 
     m_points.append(pi2.pos());
@@ -103,17 +97,13 @@ void KisCurvePaintOp::paintLine(KisPaintDeviceSP dab, const KisPaintInformation
     const qreal additionalScale = KisLodTransform::lodToScale(painter()->device());
     const qreal lineWidth = additionalScale * m_lineWidthOption.apply(pi2, m_curveProperties.curve_line_width);
 
-    QPen pen(QBrush(Qt::white), lineWidth);
-    QPainterPath path;
-
     if (m_curveProperties.curve_paint_connection_line) {
-        path.moveTo(pi1.pos());
-        path.lineTo(pi2.pos());
-        m_painter->drawPainterPath(path, pen);
-        path = QPainterPath();
+        m_rasterizer.addLine(pi1.pos(), pi2.pos(), lineWidth);
     }
 
     if (m_points.length() >= maxPoints) {
+        QPainterPath path;
+
         // alpha * 0.2;
         path.moveTo(m_points.first());
 
@@ -126,9 +116,10 @@ void KisCurvePaintOp::paintLine(KisPaintDeviceSP dab, const KisPaintInformation
             path.cubicTo(m_points.at(step), m_points.at(step + step), m_points.last());
         }
 
-        qreal curveOpacity = m_curvesOpacityOption.apply(pi2, m_curveProperties.curve_curves_opacity);
-        m_painter->setOpacity(qRound(255.0 * curveOpacity));
-        m_painter->drawPainterPath(path, pen);
-        m_painter->setOpacity(255); // full
+        const qreal curveOpacity = m_curvesOpacityOption.apply(pi2, m_curveProperties.curve_curves_opacity);
+
+        Q_FOREACH (const QPolygonF &polyline, path.toSubpathPolygons()) {
+            m_rasterizer.addPolyline(polyline, lineWidth, curveOpacity);
+        }
     }
 }
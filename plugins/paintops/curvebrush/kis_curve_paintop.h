@@ -27,6 +27,7 @@
 #include <kis_pressure_opacity_option.h>
 #include "kis_linewidth_option.h"
 #include "kis_curves_opacity_option.h"
+#include <KisLineCoverageRasterizer.h>
 
 class KisPainter;
 
@@ -45,7 +46,7 @@ protected:
     KisSpacingInformation updateSpacingImpl(const KisPaintInformation &info) const override;
 
 private:
-    void paintLine(KisPaintDeviceSP dab, const KisPaintInformation &pi1, const KisPaintInformation &pi2);
+    void addCurveLines(const KisPaintInformation &pi1, const KisPaintInformation &pi2);
 
 private:
     KisPaintDeviceSP m_dab;
@@ -57,7 +58,7 @@ private:
     KisCurvesOpacityOption m_curvesOpacityOption;
 
     QList<QPointF> m_points;
-    KisPainter * m_painter;
+    KisLineCoverageRasterizer m_rasterizer;
 
 };
 
@@ -108,10 +108,15 @@ int KisDabRenderingJobRunner::executeOneJob(KisDabRenderingJob *job,
     resources->syncResourcesToSeqNo(job->seqNo, job->generationInfo.info);
 
     if (job->type == KisDabRenderingJob::Dab) {
-        // TODO: thing about better interface for the reverse queue link
-        job->originalDevice = parentQueue->fetchCachedPaintDevce();
+        if (job->generationInfo.cachedDab) {
+            job->originalDevice = job->generationInfo.cachedDab;
+        } else {
+            // TODO: thing about better interface for the reverse queue link
+            job->originalDevice = parentQueue->fetchCachedPaintDevce();
 
-        generateDab(job->generationInfo, resources, &job->originalDevice);
+            generateDab(job->generationInfo, resources, &job->originalDevice);
+            parentQueue->putDabToCache(job->generationInfo, job->originalDevice);
+        }
     }
 
     // by now the original device should be already prepared
@@ -136,6 +141,11 @@ int KisDabRenderingJobRunner::executeOneJob(KisDabRenderingJob *job,
                            job->generationInfo.dstDabRect.topLeft(),
                            job->generationInfo.info,
                            resources);
+        } else if (job->generationInfo.cachedDab) {
+            // the cached dab is shared with the cache, so it must
+            // not be passed to the painter, which may modify it
+            job->postprocessedDevice = parentQueue->fetchCachedPaintDevce();
+            *job->postprocessedDevice = *job->originalDevice;
         } else {
             job->postprocessedDevice = job->originalDevice;
         }
@@ -397,6 +397,12 @@ KisFixedPaintDeviceSP KisDabRenderingQueue::fetchCachedPaintDevce()
     return new KisFixedPaintDevice(m_d->colorSpace, m_d->paintDeviceAllocator);
 }
 
+void KisDabRenderingQueue::putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di, KisFixedPaintDeviceSP dab)
+{
+    // the cache interface has its own lock
+    m_d->cacheInterface->putDabToCache(di, dab);
+}
+
 qreal KisDabRenderingQueue::averageExecutionTime() const
 {
     QMutexLocker l(&m_d->mutex);
@@ -42,6 +42,15 @@ public:
                                 bool *shouldUseCache) = 0;
 
         virtual bool hasSeparateOriginal(KisDabCacheUtils::DabRenderingResources *resources) const = 0;
+
+        /**
+         * Called from the worker threads when a dab has been generated
+         * from scratch (di.cachedDab is null)
+         */
+        virtual void putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di, KisFixedPaintDeviceSP dab) {
+            Q_UNUSED(di);
+            Q_UNUSED(dab);
+        }
     };
 
 
@@ -62,6 +71,8 @@ public:
 
     KisFixedPaintDeviceSP fetchCachedPaintDevce();
 
+    void putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di, KisFixedPaintDeviceSP dab);
+
     void putResourcesToCache(KisDabCacheUtils::DabRenderingResources *resources);
     KisDabCacheUtils::DabRenderingResources* fetchResourcesFromCache();
 
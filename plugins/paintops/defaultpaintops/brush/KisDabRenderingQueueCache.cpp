@@ -43,3 +43,8 @@ bool KisDabRenderingQueueCache::hasSeparateOriginal(KisDabCacheUtils::DabRenderi
 {
     return needSeparateOriginal(resources->textureOption.data(), resources->sharpnessOption.data());
 }
+
+void KisDabRenderingQueueCache::putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di, KisFixedPaintDeviceSP dab)
+{
+    KisDabCacheBase::putDabToCache(di, dab);
+}
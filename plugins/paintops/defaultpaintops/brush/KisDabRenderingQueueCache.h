@@ -45,6 +45,8 @@ public:
 
     bool hasSeparateOriginal(KisDabCacheUtils::DabRenderingResources *resources) const override;
 
+    void putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di, KisFixedPaintDeviceSP dab) override;
+
 private:
     struct Private;
     QScopedPointer<Private> m_d;
@@ -498,6 +498,67 @@ void KisDabRenderingQueueTest::testRunningJobs()
     QCOMPARE(renderedDabs[1].offset, QPoint(15,15));
 }
 
+void KisDabRenderingQueueTest::testLruCachedDabs()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisDabRenderingQueueCache *cacheInterface = new KisDabRenderingQueueCache();
+
+    KisDabRenderingQueue queue(cs, testResourcesFactory);
+    queue.setCacheInterface(cacheInterface);
+
+    KoColor color(Qt::red, cs);
+    QPointF pos1(10,10);
+    QPointF pos2(20,20);
+    QPointF pos3(30,30);
+    KisDabShape shape1(1.0, 1.0, 0.0);
+    KisDabShape shape2(2.0, 1.0, 0.0);
+    KisPaintInformation pi1(pos1);
+    KisPaintInformation pi2(pos2);
+    KisPaintInformation pi3(pos3);
+
+    KisDabCacheUtils::DabRequestInfo request1(color, pos1, shape1, pi1, 1.0);
+    KisDabCacheUtils::DabRequestInfo request2(color, pos2, shape2, pi2, 1.0);
+    KisDabCacheUtils::DabRequestInfo request3(color, pos3, shape1, pi3, 1.0);
+
+    KisDabRenderingJobSP job0 = queue.addDab(request1, OPACITY_OPAQUE_F, OPACITY_OPAQUE_F);
+    QVERIFY(job0);
+    QVERIFY(!job0->generationInfo.cachedDab);
+    KisDabRenderingJobRunner(job0, &queue, 0).run();
+
+    KisDabRenderingJobSP job1 = queue.addDab(request2, OPACITY_OPAQUE_F, OPACITY_OPAQUE_F);
+    QVERIFY(job1);
+    QVERIFY(!job1->generationInfo.cachedDab);
+    KisDabRenderingJobRunner(job1, &queue, 0).run();
+
+    // the shape of the first dab reappears, so it is served from the LRU cache
+    KisDabRenderingJobSP job2 = queue.addDab(request3, OPACITY_OPAQUE_F, OPACITY_OPAQUE_F);
+    QVERIFY(job2);
+    QCOMPARE(job2->type, KisDabRenderingJob::Dab);
+    QVERIFY(job2->generationInfo.cachedDab);
+    KisDabRenderingJobRunner(job2, &queue, 0).run();
+
+    QCOMPARE(job2->originalDevice, job2->generationInfo.cachedDab);
+
+    // the cached device must never be returned to the painter
+    QVERIFY(job2->postprocessedDevice != job2->originalDevice);
+
+    QCOMPARE(job2->postprocessedDevice->bounds(), job0->postprocessedDevice->bounds());
+    QVERIFY(!memcmp(job2->postprocessedDevice->data(),
+                    job0->postprocessedDevice->data(),
+                    job0->postprocessedDevice->bounds().width() *
+                    job0->postprocessedDevice->bounds().height() * cs->pixelSize()));
+
+    QList<KisRenderedDab> renderedDabs = queue.takeReadyDabs();
+    QCOMPARE(renderedDabs.size(), 3);
+    QCOMPARE(renderedDabs[2].offset, QPoint(25,25));
+
+    const KisDabCacheBase::CacheStatistics stats = cacheInterface->cacheStatistics();
+    QCOMPARE(stats.lastDabHits, 0);
+    QCOMPARE(stats.lruHits, 1);
+    QCOMPARE(stats.misses, 2);
+}
+
 #include "../KisDabRenderingExecutor.h"
 #include "KisFakeRunnableStrokeJobsExecutor.h"
 
@@ -28,6 +28,7 @@ private Q_SLOTS:
     void testCachedDabs();
     void testPostprocessedDabs();
     void testRunningJobs();
+    void testLruCachedDabs();
 
     void testExecutor();
 };
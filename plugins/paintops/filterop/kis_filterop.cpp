@@ -24,6 +24,7 @@
 
 #include <kis_debug.h>
 
+#include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorTransformation.h>
 #include <KoColor.h>
@@ -47,18 +48,67 @@
 #include <kis_transaction.h>
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
+#include <kis_image_config.h>
+
+namespace {
+
+/**
+ * The maximum area of the source region kept cached between the dabs,
+ * when the stroke leaves it, the cache is started from scratch
+ */
+const qint64 maxSourceCacheArea = 2048 * 2048;
+
+qint64 regionArea(const QRegion &region)
+{
+    qint64 area = 0;
+    Q_FOREACH (const QRect &rc, region.rects()) {
+        area += qint64(rc.width()) * rc.height();
+    }
+    return area;
+}
+
+/**
+ * Multiplies the alpha of the \p rect of the filtered device by the
+ * brush mask, \p maskOrigin is the position of the mask in the image
+ */
+void applyDabMask(KisPaintDeviceSP dev, const QRect &rect,
+                  KisFixedPaintDeviceSP mask, const QPoint &maskOrigin)
+{
+    const KoColorSpace *cs = dev->colorSpace();
+    const int pixelSize = cs->pixelSize();
+    const int rowStride = rect.width() * pixelSize;
+    const int maskStride = mask->bounds().width();
+
+    QVector<quint8> pixels(rowStride * rect.height());
+    dev->readBytes(pixels.data(), rect);
+
+    quint8 *pixelPtr = pixels.data();
+    const quint8 *maskPtr = mask->data() +
+        (rect.y() - maskOrigin.y()) * maskStride +
+        (rect.x() - maskOrigin.x());
+
+    for (int y = 0; y < rect.height(); y++) {
+        cs->applyAlphaU8Mask(pixelPtr, maskPtr, rect.width());
+        pixelPtr += rowStride;
+        maskPtr += maskStride;
+    }
+
+    dev->writeBytes(pixels.data(), rect);
+}
+
+}
 
 
 KisFilterOp::KisFilterOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
     , m_filterConfiguration(0)
+    , m_renderer(painter)
 {
     Q_UNUSED(node);
     Q_UNUSED(image);
     Q_ASSERT(settings);
     Q_ASSERT(painter);
 
-    m_tmpDevice = source()->createCompositionSourceDevice();
     m_sizeOption.readOptionSetting(settings);
     m_rotationOption.readOptionSetting(settings);
     m_sizeOption.resetAllSensors();
@@ -66,6 +116,7 @@ KisFilterOp::KisFilterOp(const KisPaintOpSettingsSP settings, KisPainter *painte
     m_filter = KisFilterRegistry::instance()->get(settings->getString(FILTER_ID));
     m_filterConfiguration = static_cast<const KisFilterOpSettings *>(settings.data())->filterConfig();
     m_smudgeMode = settings->getBool(FILTER_SMUDGE_MODE);
+    m_asynchronousDabs = !m_smudgeMode && KisImageConfig(true).asynchronousFilterDabs();
 
     m_rotationOption.applyFanCornersInfo(this);
 }
@@ -120,6 +171,43 @@ KisSpacingInformation KisFilterOp::paintAt(const KisPaintInformation& info)
     // Filter the paint device
     QRect neededRect = m_filter->neededRect(dstRect, m_filterConfiguration, painter()->device()->defaultBounds()->currentLevelOfDetail());
 
+    if (m_asynchronousDabs) {
+        /**
+         * The dab doesn't depend on the result of the previous dabs, so
+         * it is filtered right from the source cache by the stroke's
+         * worker threads. The filters that cannot process a rect in parts
+         * get the whole dab in one job. The dab is copied, because the
+         * dab cache may reuse the device for the next dab.
+         */
+        updateSourceCache(neededRect);
+
+        KisFilterSP filter = m_filter;
+        KisFilterConfigurationSP config = m_filterConfiguration;
+        KisPaintDeviceSP sourceCache = m_sourceCache;
+        KisFixedPaintDeviceSP mask = new KisFixedPaintDevice(*dab);
+        const QPoint maskOrigin = dstRect.topLeft() - dabRect.topLeft();
+
+        m_renderer.addDab(dstRect, painter()->opacity(),
+            [filter, config, sourceCache, mask, maskOrigin] (KisPaintDeviceSP dst, const QRect &tileRect, int threadId) {
+                Q_UNUSED(threadId);
+                filter->process(sourceCache, dst, 0, tileRect, config, 0);
+                applyDabMask(dst, tileRect, mask, maskOrigin);
+            },
+            filter->supportsThreading());
+
+        return effectiveSpacing(scale, rotation, info);
+    }
+
+    /**
+     * In smudge mode every dab accumulates the source pixels over the
+     * filtered pixels of the previous dabs, so it is painted right here.
+     * The same path is used when the asynchronous dabs are disabled in
+     * the config.
+     */
+    if (!m_tmpDevice) {
+        m_tmpDevice = source()->createCompositionSourceDevice();
+    }
+
     KisPainter p(m_tmpDevice);
     if (!m_smudgeMode) {
         p.setCompositeOp(COMPOSITE_COPY);
@@ -142,6 +230,37 @@ KisSpacingInformation KisFilterOp::paintAt(const KisPaintInformation& info)
     return effectiveSpacing(scale, rotation, info);
 }
 
+void KisFilterOp::updateSourceCache(const QRect &neededRect)
+{
+    if (!m_sourceCache ||
+        regionArea(m_sourceCacheRegion) + qint64(neededRect.width()) * neededRect.height() > maxSourceCacheArea) {
+
+        /**
+         * The queued dabs still keep the pointer to the old cache, so
+         * we should create a new device instead of clearing the old one
+         */
+        m_sourceCache = source()->createCompositionSourceDevice();
+        m_sourceCacheRegion = QRegion();
+    }
+
+    const QRegion missingRegion = QRegion(neededRect) - m_sourceCacheRegion;
+    if (missingRegion.isEmpty()) return;
+
+    KisPainter p(m_sourceCache);
+    p.setCompositeOp(COMPOSITE_COPY);
+
+    Q_FOREACH (const QRect &rc, missingRegion.rects()) {
+        p.bitBltOldData(rc.topLeft(), source(), rc);
+    }
+
+    m_sourceCacheRegion += neededRect;
+}
+
+std::pair<int, bool> KisFilterOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_renderer.doAsyncronousUpdate(jobs);
+}
+
 KisSpacingInformation KisFilterOp::updateSpacingImpl(const KisPaintInformation &info) const
 {
     const qreal scale = m_sizeOption.apply(info) * KisLodTransform::lodToScale(painter()->device());
@@ -23,9 +23,12 @@
 #ifndef KIS_FILTEROP_H_
 #define KIS_FILTEROP_H_
 
+#include <QRegion>
+
 #include "kis_brush_based_paintop.h"
 #include <kis_pressure_size_option.h>
 #include <kis_pressure_rotation_option.h>
+#include <KisTiledParticleRenderer.h>
 
 class KisFilterConfiguration;
 class KisFilterOpSettings;
@@ -43,12 +46,17 @@ public:
     static QList<KoResourceSP> prepareLinkedResources(const KisPaintOpSettingsSP settings, KisResourcesInterfaceSP resourcesInterface);
     static QList<KoResourceSP> prepareEmbeddedResources(const KisPaintOpSettingsSP settings, KisResourcesInterfaceSP resourcesInterface);
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 protected:
 
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
     KisSpacingInformation updateSpacingImpl(const KisPaintInformation &info) const override;
 
+private:
+    void updateSourceCache(const QRect &neededRect);
+
 private:
 
     KisPaintDeviceSP m_tmpDevice;
@@ -57,6 +65,20 @@ private:
     KisFilterSP m_filter;
     KisFilterConfigurationSP m_filterConfiguration;
     bool m_smudgeMode;
+
+    /// the dabs are filtered by the renderer, instead of paintAt()
+    bool m_asynchronousDabs;
+
+    /**
+     * In non-smudge mode the filter is always applied to the old data
+     * of the source device, which doesn't change during the stroke. So
+     * the source pixels are copied from the old data only once and are
+     * shared by all the overlapping dabs of the stroke.
+     */
+    KisPaintDeviceSP m_sourceCache;
+    QRegion m_sourceCacheRegion;
+
+    KisTiledParticleRenderer m_renderer;
 };
 
 #endif // KIS_FILTEROP_H_
@@ -49,6 +49,11 @@ bool KisFilterOpSettings::paintIncremental()
     return true; // We always paint on the existing data
 }
 
+bool KisFilterOpSettings::needsAsynchronousUpdates() const
+{
+    return true;
+}
+
 KisFilterConfigurationSP KisFilterOpSettings::filterConfig() const
 {
     if (hasProperty(FILTER_ID)) {
@@ -40,6 +40,8 @@ public:
     ~KisFilterOpSettings() override;
     bool paintIncremental() override;
 
+    bool needsAsynchronousUpdates() const override;
+
     KisFilterConfigurationSP filterConfig() const;
 
     using KisPaintOpSettings::toXML;
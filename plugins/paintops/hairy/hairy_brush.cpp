@@ -22,10 +22,12 @@
 #include <KoColorSpace.h>
 #include <KoColorTransformation.h>
 #include <KoCompositeOpRegistry.h>
+#include <KoColorSpaceTraits.h>
 
 #include <QVariant>
 #include <QHash>
 #include <QVector>
+#include <QtMath>
 
 #include <kis_types.h>
 #include <kis_random_accessor_ng.h>
@@ -45,6 +47,10 @@ HairyBrush::HairyBrush()
 
     m_saturationId = -1;
     m_transfo = 0;
+
+    m_colorSpace = 0;
+    m_compositeOp = 0;
+    m_pixelSize = 0;
 }
 
 HairyBrush::~HairyBrush()
@@ -55,13 +61,14 @@ HairyBrush::~HairyBrush()
 }
 
 
-void HairyBrush::initAndCache()
+void HairyBrush::initAndCache(const KoColorSpace *dabColorSpace)
 {
-    m_compositeOp = m_dab->colorSpace()->compositeOp(COMPOSITE_OVER);
-    m_pixelSize = m_dab->colorSpace()->pixelSize();
+    m_colorSpace = dabColorSpace;
+    m_compositeOp = m_colorSpace->compositeOp(COMPOSITE_OVER);
+    m_pixelSize = m_colorSpace->pixelSize();
 
     if (m_properties->useSaturation) {
-        m_transfo = m_dab->colorSpace()->createColorTransformation("hsv_adjustment", m_params);
+        m_transfo = m_colorSpace->createColorTransformation("hsv_adjustment", m_params);
         if (m_transfo) {
             m_saturationId = m_transfo->parameterId("s");
         }
@@ -106,7 +113,7 @@ void HairyBrush::fromDabWithDensity(KisFixedPaintDeviceSP dab, qreal density)
 }
 
 
-void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation)
+HairyBrush::InkSP HairyBrush::paintLine(const KoColorSpace *dabColorSpace, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation)
 {
     m_counter++;
 
@@ -134,15 +141,13 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     qreal pressure = mousePressure * (pi2.pressure() * 2);
 
     Bristle *bristle = 0;
-    KoColor bristleColor(dab->colorSpace());
-
-    m_dabAccessor = dab->createRandomAccessorNG();
+    KoColor bristleColor(dabColorSpace);
 
-    m_dab = dab;
+    QSharedPointer<Ink> ink(new Ink());
 
     // initialization block
     if (firstStroke()) {
-        initAndCache();
+        initAndCache(dabColorSpace);
     }
 
     /*If this is first time the brush touches the canvas and
@@ -238,14 +243,39 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
                 }
             }
 
-            addBristleInk(bristle, bristlePath.at(i), bristleColor);
+            const QPointF &pos = bristlePath.at(i);
+
+            const int colorOffset = ink->colors.size();
+            ink->colors.resize(colorOffset + m_pixelSize);
+            memcpy(ink->colors.data() + colorOffset, bristleColor.data(), m_pixelSize);
+
+            ink->points.append(pos);
+            ink->bounds |= QRect(qFloor(pos.x()) - 1, qFloor(pos.y()) - 1, 4, 4);
+
             bristle->setInkAmount(1.0 - inkDeplation);
             bristle->upIncrement();
         }
 
     }
-    m_dab = 0;
-    m_dabAccessor = 0;
+
+    return ink;
+}
+
+void HairyBrush::renderInk(InkSP ink, KisPaintDeviceSP dab, const QRect &tileRect) const
+{
+    KisRandomAccessorSP accessor = dab->createRandomAccessorNG();
+
+    // a particle may touch the pixels on the right and on the bottom of it
+    const QRectF pointsRect = QRectF(tileRect).adjusted(-2, -2, 1, 1);
+
+    const quint8 *color = ink->colors.constData();
+
+    Q_FOREACH (const QPointF &pos, ink->points) {
+        if (pointsRect.contains(pos)) {
+            addBristleInk(accessor, pos, color, tileRect);
+        }
+        color += m_pixelSize;
+    }
 }
 
 
@@ -306,32 +336,33 @@ void HairyBrush::opacityDepletion(Bristle* bristle, KoColor& bristleColor, qreal
     bristleColor.setOpacity(opacity);
 }
 
-inline void HairyBrush::addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color)
+inline void HairyBrush::addBristleInk(KisRandomAccessorSP &accessor, const QPointF &pos, const quint8 *color, const QRect &tileRect) const
 {
-    Q_UNUSED(bristle);
     if (m_properties->antialias) {
         if (m_properties->useCompositing) {
-            paintParticle(pos, color);
+            paintParticle(accessor, pos, color, tileRect);
         } else {
-            paintParticle(pos, color, 1.0);
+            paintParticle(accessor, pos, color, 1.0, tileRect);
         }
     }
     else {
         int ix = qRound(pos.x());
         int iy = qRound(pos.y());
         if (m_properties->useCompositing) {
-            plotPixel(ix, iy, color);
+            plotPixel(accessor, ix, iy, color, tileRect);
         }
         else {
-            darkenPixel(ix, iy, color);
+            darkenPixel(accessor, ix, iy, color, tileRect);
         }
     }
 }
 
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
+void HairyBrush::paintParticle(KisRandomAccessorSP &accessor, QPointF pos, const quint8 *color, qreal weight, const QRect &tileRect) const
 {
     // opacity top left, right, bottom left, right
-    quint8 opacity = color.opacityU8();
+    const KoColorSpace * cs = m_colorSpace;
+
+    quint8 opacity = cs->opacityU8(color);
     opacity *= weight;
 
     int ipx = int (pos.x());
@@ -339,39 +370,31 @@ void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
     qreal fx = qAbs(pos.x() - ipx);
     qreal fy = qAbs(pos.y() - ipy);
 
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
-
-    const KoColorSpace * cs = m_dab->colorSpace();
-
-    m_dabAccessor->moveTo(ipx  , ipy);
-    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy);
-    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btr, 1);
-
-    m_dabAccessor->moveTo(ipx, ipy + 1);
-    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy + 1);
-    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbr, 1);
+    const int x[4] = {ipx, ipx + 1, ipx, ipx + 1};
+    const int y[4] = {ipy, ipy, ipy + 1, ipy + 1};
+    const quint8 weights[4] = {
+        quint8(qRound((1.0 - fx) * (1.0 - fy) * opacity)),
+        quint8(qRound((fx)  * (1.0 - fy) * opacity)),
+        quint8(qRound((1.0 - fx) * (fy)  * opacity)),
+        quint8(qRound((fx)  * (fy)  * opacity))
+    };
+
+    for (int i = 0; i < 4; i++) {
+        if (!tileRect.contains(x[i], y[i])) continue;
+
+        accessor->moveTo(x[i], y[i]);
+        quint8 pixelOpacity = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, weights[i] + cs->opacityU8(accessor->rawData()), OPACITY_OPAQUE_U8));
+        memcpy(accessor->rawData(), color, m_pixelSize);
+        cs->setOpacity(accessor->rawData(), pixelOpacity, 1);
+    }
 }
 
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
+void HairyBrush::paintParticle(KisRandomAccessorSP &accessor, QPointF pos, const quint8 *color, const QRect &tileRect) const
 {
     // opacity top left, right, bottom left, right
-    memcpy(m_color.data(), color.data(), m_pixelSize);
-    quint8 opacity = color.opacityU8();
+    quint8 particleColor[MAX_PIXEL_SIZE];
+    memcpy(particleColor, color, m_pixelSize);
+    quint8 opacity = m_colorSpace->opacityU8(color);
 
     int ipx = int (pos.x());
     int ipy = int (pos.y());
@@ -383,31 +406,35 @@ void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
     quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
     quint8 bbr = qRound((fx)  * (fy)  * opacity);
 
-    m_color.setOpacity(btl);
-    plotPixel(ipx  , ipy, m_color);
+    m_colorSpace->setOpacity(particleColor, btl, 1);
+    plotPixel(accessor, ipx  , ipy, particleColor, tileRect);
 
-    m_color.setOpacity(btr);
-    plotPixel(ipx + 1  , ipy, m_color);
+    m_colorSpace->setOpacity(particleColor, btr, 1);
+    plotPixel(accessor, ipx + 1  , ipy, particleColor, tileRect);
 
-    m_color.setOpacity(bbl);
-    plotPixel(ipx  , ipy + 1, m_color);
+    m_colorSpace->setOpacity(particleColor, bbl, 1);
+    plotPixel(accessor, ipx  , ipy + 1, particleColor, tileRect);
 
-    m_color.setOpacity(bbr);
-    plotPixel(ipx + 1 , ipy + 1, m_color);
+    m_colorSpace->setOpacity(particleColor, bbr, 1);
+    plotPixel(accessor, ipx + 1 , ipy + 1, particleColor, tileRect);
 }
 
 
-inline void HairyBrush::plotPixel(int wx, int wy, const KoColor &color)
+inline void HairyBrush::plotPixel(KisRandomAccessorSP &accessor, int wx, int wy, const quint8 *color, const QRect &tileRect) const
 {
-    m_dabAccessor->moveTo(wx, wy);
-    m_compositeOp->composite(m_dabAccessor->rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+    if (!tileRect.contains(wx, wy)) return;
+
+    accessor->moveTo(wx, wy);
+    m_compositeOp->composite(accessor->rawData(), m_pixelSize, color, m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
 }
 
-inline void HairyBrush::darkenPixel(int wx, int wy, const KoColor &color)
+inline void HairyBrush::darkenPixel(KisRandomAccessorSP &accessor, int wx, int wy, const quint8 *color, const QRect &tileRect) const
 {
-    m_dabAccessor->moveTo(wx, wy);
-    if (m_dab->colorSpace()->opacityU8(m_dabAccessor->rawData()) < color.opacityU8()) {
-        memcpy(m_dabAccessor->rawData(), color.data(), m_pixelSize);
+    if (!tileRect.contains(wx, wy)) return;
+
+    accessor->moveTo(wx, wy);
+    if (m_colorSpace->opacityU8(accessor->rawData()) < m_colorSpace->opacityU8(color)) {
+        memcpy(accessor->rawData(), color, m_pixelSize);
     }
 }
 
@@ -430,7 +457,7 @@ double HairyBrush::computeMousePressure(double distance)
 
 void HairyBrush::colorifyBristles(KisPaintDeviceSP source, QPointF point)
 {
-    KoColor bristleColor(m_dab->colorSpace());
+    KoColor bristleColor(m_colorSpace);
     KisCrossDeviceColorPickerInt colorPicker(source, bristleColor);
 
     Bristle *b = 0;
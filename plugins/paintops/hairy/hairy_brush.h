@@ -21,6 +21,8 @@
 
 #include <QVector>
 #include <QList>
+#include <QRect>
+#include <QSharedPointer>
 #include <QTransform>
 
 #include <KoColor.h>
@@ -33,6 +35,7 @@
 #include <kis_random_accessor_ng.h>
 
 class KoCompositeOp;
+class KoColorSpace;
 
 
 class KisHairyProperties
@@ -69,11 +72,34 @@ public:
 class HairyBrush
 {
 
+public:
+    /**
+     * The ink left by the bristles during one paintLine() call. The color
+     * of every bristle depends on the whole history of the stroke, so the
+     * points are computed in the stroke thread, and only plotted into the
+     * dab by the worker threads.
+     */
+    struct Ink {
+        QVector<QPointF> points;
+        /// one pixel per point
+        QVector<quint8> colors;
+        QRect bounds;
+    };
+
+    typedef QSharedPointer<const Ink> InkSP;
+
 public:
     HairyBrush();
     ~HairyBrush();
 
-    void paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation);
+    InkSP paintLine(const KoColorSpace *dabColorSpace, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation);
+
+    /**
+     * Plots the part of \p ink that lies inside \p tileRect into \p dab.
+     * Can be called concurrently for different tiles.
+     */
+    void renderInk(InkSP ink, KisPaintDeviceSP dab, const QRect &tileRect) const;
+
     /// set ink color for the whole bristle shape
     void setInkColor(const KoColor &color) {
         m_color = color;
@@ -87,15 +113,15 @@ public:
 
 private:
     /// paints single bristle
-    void addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color);
+    void addBristleInk(KisRandomAccessorSP &accessor, const QPointF &pos, const quint8 *color, const QRect &tileRect) const;
     /// composite single pixel to dab
-    void plotPixel(int wx, int wy, const KoColor &color);
+    void plotPixel(KisRandomAccessorSP &accessor, int wx, int wy, const quint8 *color, const QRect &tileRect) const;
     /// check the opacity of dab pixel and if the opacity is less then color, it will copy color to dab
-    void darkenPixel(int wx, int wy, const KoColor &color);
+    void darkenPixel(KisRandomAccessorSP &accessor, int wx, int wy, const quint8 *color, const QRect &tileRect) const;
     /// paint wu particle by copying the color and setup just the opacity, weight is complementary to opacity of the color
-    void paintParticle(QPointF pos, const KoColor& color, qreal weight);
+    void paintParticle(KisRandomAccessorSP &accessor, QPointF pos, const quint8 *color, qreal weight, const QRect &tileRect) const;
     /// paint wu particle using composite operation
-    void paintParticle(QPointF pos, const KoColor& color);
+    void paintParticle(KisRandomAccessorSP &accessor, QPointF pos, const quint8 *color, const QRect &tileRect) const;
     /// similar to sample input color in spray
     void colorifyBristles(KisPaintDeviceSP source, QPointF point);
 
@@ -110,7 +136,7 @@ private:
     /// fetch actual ink status according depletion curve
     qreal fetchInkDepletion(Bristle * bristle, int inkDepletionSize);
 
-    void initAndCache();
+    void initAndCache(const KoColorSpace *dabColorSpace);
 
 private:
     const KisHairyProperties * m_properties;
@@ -121,9 +147,7 @@ private:
     // used for interpolation the path of bristles
     Trajectory m_trajectory;
     QHash<QString, QVariant> m_params;
-    // temporary device
-    KisPaintDeviceSP m_dab;
-    KisRandomAccessorSP m_dabAccessor;
+    const KoColorSpace * m_colorSpace;
     const KoCompositeOp * m_compositeOp;
     quint32 m_pixelSize;
 
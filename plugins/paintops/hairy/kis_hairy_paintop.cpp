@@ -42,6 +42,7 @@
 
 KisHairyPaintOp::KisHairyPaintOp(const KisPaintOpSettingsSP settings, KisPainter * painter, KisNodeSP node, KisImageSP image)
     : KisPaintOp(painter)
+    , m_renderer(painter)
 {
     Q_UNUSED(image);
     Q_ASSERT(settings);
@@ -113,6 +114,11 @@ void KisHairyPaintOp::loadSettings(const KisBrushBasedPaintOpSettings *settings)
 }
 
 
+std::pair<int, bool> KisHairyPaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_renderer.doAsyncronousUpdate(jobs);
+}
+
 KisSpacingInformation KisHairyPaintOp::paintAt(const KisPaintInformation& info)
 {
     return updateSpacingImpl(info);
@@ -130,13 +136,6 @@ void KisHairyPaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     Q_UNUSED(currentDistance);
     if (!painter()) return;
 
-    if (!m_dab) {
-        m_dab = source()->createCompositionSourceDevice();
-    }
-    else {
-        m_dab->clear();
-    }
-
     /**
      * Even though we don't use spacing in hairy brush, we should still
      * initialize its distance information to ensure drawing angle and
@@ -152,6 +151,8 @@ void KisHairyPaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     scale *= KisLodTransform::lodToScale(painter()->device());
     qreal rotation = m_rotationOption.apply(pi);
     quint8 origOpacity = m_opacityOption.apply(painter(), pi);
+    const quint8 dabOpacity = painter()->opacity();
+    painter()->setOpacity(origOpacity);
 
     const bool mirrorFlip = pi1.canvasMirroredH() != pi1.canvasMirroredV();
 
@@ -159,13 +160,21 @@ void KisHairyPaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     // during initialization), so we should just skip the distance info
     // update
 
-    m_brush.paintLine(m_dab, m_dev, pi1, pi, scale * m_properties.scaleFactor, mirrorFlip ? -rotation : rotation);
+    /**
+     * The paths of the bristles are computed right here, in the stroke
+     * thread, and plotted later by the asynchronous updates of the paintop.
+     */
+    HairyBrush::InkSP ink =
+        m_brush.paintLine(source()->compositionSourceColorSpace(), m_dev,
+                          pi1, pi, scale * m_properties.scaleFactor, mirrorFlip ? -rotation : rotation);
 
-    //QRect rc = m_dab->exactBounds();
-    QRect rc = m_dab->extent();
-    painter()->bitBlt(rc.topLeft(), m_dab, rc);
-    painter()->renderMirrorMask(rc, m_dab);
-    painter()->setOpacity(origOpacity);
+    const HairyBrush *brush = &m_brush;
+
+    m_renderer.addDab(ink->bounds, dabOpacity,
+        [brush, ink] (KisPaintDeviceSP dst, const QRect &tileRect, int threadId) {
+            Q_UNUSED(threadId);
+            brush->renderInk(ink, dst, tileRect);
+        });
 
     // we don't use spacing in hairy brush, but history is
     // still important for us
@@ -30,6 +30,7 @@
 #include <kis_pressure_size_option.h>
 #include <kis_pressure_rotation_option.h>
 #include <kis_pressure_opacity_option.h>
+#include <KisTiledParticleRenderer.h>
 
 class KisPainter;
 class KisBrushBasedPaintOpSettings;
@@ -44,6 +45,9 @@ public:
     void paintLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2, KisDistanceInformation *currentDistance) override;
 
     static QList<KoResourceSP> prepareLinkedResources(const KisPaintOpSettingsSP settings, KisResourcesInterfaceSP resourcesInterface);
+
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
@@ -52,9 +56,9 @@ protected:
 private:
     KisHairyProperties m_properties;
 
-    KisPaintDeviceSP m_dab;
     KisPaintDeviceSP m_dev;
     HairyBrush m_brush;
+    KisTiledParticleRenderer m_renderer;
     KisPressureRotationOption m_rotationOption;
     KisPressureSizeOption m_sizeOption;
     KisPressureOpacityOption m_opacityOption;
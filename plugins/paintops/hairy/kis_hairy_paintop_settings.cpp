@@ -35,3 +35,8 @@ QPainterPath KisHairyPaintOpSettings::brushOutline(const KisPaintInformation &in
 {
     return brushOutlineImpl(info, mode, alignForZoom, getDouble(HAIRY_BRISTLE_SCALE));
 }
+
+bool KisHairyPaintOpSettings::needsAsynchronousUpdates() const
+{
+    return true;
+}
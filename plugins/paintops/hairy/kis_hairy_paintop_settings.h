@@ -36,6 +36,8 @@ public:
     using KisBrushBasedPaintOpSettings::brushOutline;
     QPainterPath brushOutline(const KisPaintInformation &info, const OutlineMode &mode, qreal alignForZoom) override;
 
+    bool needsAsynchronousUpdates() const override;
+
 };
 
 #endif
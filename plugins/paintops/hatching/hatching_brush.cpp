@@ -24,6 +24,7 @@
 
 #include <QVariant>
 #include <QHash>
+#include <QtMath>
 
 #include "kis_random_accessor_ng.h"
 #include <cmath>
@@ -52,12 +53,9 @@ void HatchingBrush::init()
 {
 }
 
-void HatchingBrush::hatch(KisPaintDeviceSP dev, qreal x, qreal y, double width, double height, double givenangle, const KoColor &color, qreal additionalScale)
+void HatchingBrush::hatch(qreal x, qreal y, double width, double height, double givenangle, qreal additionalScale)
 {
-    m_painter.begin(dev);
-    m_painter.setFillStyle(KisPainter::FillStyleForegroundColor);
-    m_painter.setPaintColor(color);
-    m_painter.setBackgroundColor(color);
+    m_rasterizer.setAntialiasing(m_settings->antialias);
 
     angle = givenangle;
     double tempthickness = m_settings->thickness * m_settings->thicknesssensorvalue;
@@ -70,8 +68,6 @@ void HatchingBrush::hatch(KisPaintDeviceSP dev, qreal x, qreal y, double width,
     height_ = height;
     width_ = width;
 
-    m_painter.setMaskImageSize(width_, height_);
-
     /*  dx and dy are the separation between lines in the x and y axis
     dx = separation / sin(angle*M_PI/180);     csc = 1/sin(angle)  */
     dy = fabs(separation / cos(angle * M_PI / 180)); // sec = 1/cos(angle)
@@ -184,10 +180,7 @@ void HatchingBrush::iterateLines(bool forward, int lineindex, bool oneline)
             B.setX(xdraw[1]);
             B.setY(ydraw[1]);
 
-            if (m_settings->antialias)
-                m_painter.drawThickLine(A, B, thickness, thickness);
-            else
-                m_painter.drawLine(A, B, thickness, false);    //testing no subpixel;
+            m_rasterizer.addLine(A, B, thickness);
 
             if (oneline)
                 break;
@@ -244,10 +237,7 @@ void HatchingBrush::iterateVerticalLines(bool forward, int lineindex, bool oneli
         B.setX(xdraw);
         B.setY(ydraw[1]);
 
-        if (m_settings->antialias)
-            m_painter.drawThickLine(A, B, thickness, thickness);
-        else
-            m_painter.drawLine(A, B, thickness, false);    //testing no subpixel;
+        m_rasterizer.addLine(A, B, thickness);
 
         if (oneline)
             break;
@@ -256,6 +246,11 @@ void HatchingBrush::iterateVerticalLines(bool forward, int lineindex, bool oneli
     }
 }
 
+void HatchingBrush::renderDab(KisPaintDeviceSP dev, const KoColor &color)
+{
+    m_rasterizer.render(dev, color, QRect(0, 0, qCeil(width_), qCeil(height_)));
+}
+
 double HatchingBrush::separationAsFunctionOfParameter(double parameter, double separation, int numintervals)
 {
     if ((numintervals < 2) || (numintervals > 7)) {
@@ -24,9 +24,9 @@
 
 #include "kis_hatching_paintop_settings.h"
 
-#include <kis_painter.h>
 #include <kis_paint_device.h>
 #include <brushengine/kis_paint_information.h>
+#include <KisLineCoverageRasterizer.h>
 
 #include "kis_hatching_options.h"
 
@@ -39,9 +39,17 @@ public:
     HatchingBrush(KoColor inkColor);
 
     /**
-     *  Performs a single hatching pass according to specifications
+     *  Performs a single hatching pass according to specifications.
+     *  The lines are only queued, all the passes of the dab are drawn
+     *  at once by renderDab()
      */
-    void hatch(KisPaintDeviceSP dev, qreal x, qreal y, double width, double height, double givenangle, const KoColor &color, qreal additionalScale);
+    void hatch(qreal x, qreal y, double width, double height, double givenangle, qreal additionalScale);
+
+    /**
+     *  Draws the lines of all the hatching passes queued since the last
+     *  call onto the hatching area of \p dev
+     */
+    void renderDab(KisPaintDeviceSP dev, const KoColor &color);
 
 
 private:
@@ -50,7 +58,7 @@ private:
     int m_counter;
     int m_radius;
     KisHatchingPaintOpSettingsSP m_settings;
-    KisPainter m_painter;
+    KisLineCoverageRasterizer m_rasterizer;
 
     /** Thickness in pixels of each hatch line */
     int thickness;
@@ -110,14 +118,14 @@ private:
 
     /** Function that begins exploring the field from hotIntercept and
      *  moves in the direction of dy (forward==true) or -dy (forward==false)
-     *  to draw all the lines it finds to KisPaintDeviceSP 'dev'
+     *  to queue all the lines it finds into the rasterizer
      */
     void iterateLines(bool forward, int lineindex, bool oneline);
 
     /** Function that begins exploring the field from verticalHotX and
     *   moves in the direction of separation (forward==true) or
-    *   -separation (forward==false) to draw all the lines it finds
-    *   to KisPaintDeviceSP 'dev'. This function should only be called
+    *   -separation (forward==false) to queue all the lines it finds
+    *   into the rasterizer. This function should only be called
     *   when (angle == 90) or (angle == -90)
     */
     void iterateVerticalLines(bool forward, int lineindex, bool oneline);
@@ -137,47 +137,48 @@ KisSpacingInformation KisHatchingPaintOp::paintAt(const KisPaintInformation& inf
     if (m_settings->enabledcurvecrosshatching) {
         if (m_settings->perpendicular) {
             if (m_settings->crosshatchingsensorvalue > 0.5)
-                m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(90), painter()->paintColor(), additionalScale);
+                m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(90), additionalScale);
         }
         else if (m_settings->minusthenplus) {
             if (m_settings->crosshatchingsensorvalue > 0.33)
-                m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(-45), painter()->paintColor(), additionalScale);
+                m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(-45), additionalScale);
             if (m_settings->crosshatchingsensorvalue > 0.67)
-                m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(45), painter()->paintColor(), additionalScale);
+                m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(45), additionalScale);
         }
         else if (m_settings->plusthenminus) {
             if (m_settings->crosshatchingsensorvalue > 0.33)
-                m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(45), painter()->paintColor(), additionalScale);
+                m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(45), additionalScale);
             if (m_settings->crosshatchingsensorvalue > 0.67)
-                m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(-45), painter()->paintColor(), additionalScale);
+                m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(-45), additionalScale);
         }
         else if (m_settings->moirepattern) {
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle((m_settings->crosshatchingsensorvalue) * 360), painter()->paintColor(), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle((m_settings->crosshatchingsensorvalue) * 360), additionalScale);
         }
     } else {
         if (m_settings->perpendicular) {
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(90), painter()->paintColor(), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(90), additionalScale);
         }
         else if (m_settings->minusthenplus) {
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(-45), painter()->paintColor(), additionalScale);
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(45), painter()->paintColor(), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(-45), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(45), additionalScale);
         }
         else if (m_settings->plusthenminus) {
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(45), painter()->paintColor(), additionalScale);
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(-45), painter()->paintColor(), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(45), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(-45), additionalScale);
         }
         else if (m_settings->moirepattern) {
-            m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle(-10), painter()->paintColor(), additionalScale);
+            m_hatchingBrush->hatch(x, y, sw, sh, spinAngle(-10), additionalScale);
         }
     }
 
     if (m_settings->enabledcurveangle)
-      m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, spinAngle((m_settings->anglesensorvalue)*360+m_settings->angle), painter()->paintColor(), additionalScale);
+      m_hatchingBrush->hatch(x, y, sw, sh, spinAngle((m_settings->anglesensorvalue)*360+m_settings->angle), additionalScale);
 
     // The base hatch... unless moiré or angle
     if (!m_settings->moirepattern && !m_settings->enabledcurveangle)
-        m_hatchingBrush->hatch(m_hatchedDab, x, y, sw, sh, m_settings->angle, painter()->paintColor(), additionalScale);
+        m_hatchingBrush->hatch(x, y, sw, sh, m_settings->angle, additionalScale);
 
+    m_hatchingBrush->renderDab(m_hatchedDab, painter()->paintColor());
 
     // The most important line, the one that paints to the screen.
     painter()->bitBltWithFixedSelection(x, y, m_hatchedDab, maskDab, sw, sh);
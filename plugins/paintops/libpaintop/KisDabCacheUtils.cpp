@@ -23,6 +23,9 @@
 #include "kis_fixed_paint_device.h"
 #include "kis_color_source.h"
 
+#include <QHash>
+#include <KoColorSpace.h>
+
 #include <kis_pressure_sharpness_option.h>
 #include <kis_texture_option.h>
 
@@ -44,6 +47,53 @@ void DabRenderingResources::syncResourcesToSeqNo(int seqNo, const KisPaintInform
     brush->prepareForSeqNo(info, seqNo);
 }
 
+bool DabCacheKey::operator==(const DabCacheKey &rhs) const
+{
+    return precisionLevel == rhs.precisionLevel &&
+           angle == rhs.angle &&
+           width == rhs.width &&
+           height == rhs.height &&
+           subPixelX == rhs.subPixelX &&
+           subPixelY == rhs.subPixelY &&
+           softnessFactor == rhs.softnessFactor &&
+           ratio == rhs.ratio &&
+           index == rhs.index &&
+           horizontalMirror == rhs.horizontalMirror &&
+           verticalMirror == rhs.verticalMirror &&
+           color == rhs.color;
+}
+
+namespace {
+inline void hashCombine(uint &hash, uint value)
+{
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+}
+}
+
+uint qHash(const DabCacheKey &key, uint seed)
+{
+    uint hash = ::qHash(key.precisionLevel, seed);
+
+    hashCombine(hash, ::qHash(key.angle, seed));
+    hashCombine(hash, ::qHash(key.width, seed));
+    hashCombine(hash, ::qHash(key.height, seed));
+    hashCombine(hash, ::qHash(key.subPixelX, seed));
+    hashCombine(hash, ::qHash(key.subPixelY, seed));
+    hashCombine(hash, ::qHash(key.softnessFactor, seed));
+    hashCombine(hash, ::qHash(key.ratio, seed));
+    hashCombine(hash, ::qHash(key.index, seed));
+    hashCombine(hash, ::qHash(int(key.horizontalMirror) | (int(key.verticalMirror) << 1), seed));
+
+    if (key.color.colorSpace()) {
+        const QByteArray colorData =
+            QByteArray::fromRawData(reinterpret_cast<const char*>(key.color.data()),
+                                    key.color.colorSpace()->pixelSize());
+        hashCombine(hash, ::qHash(colorData, seed));
+    }
+
+    return hash;
+}
+
 QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
                                          const QSize &realDabSize)
 {
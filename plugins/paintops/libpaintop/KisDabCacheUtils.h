@@ -23,6 +23,7 @@
 #include <QSize>
 
 #include "kis_types.h"
+#include "kis_fixed_paint_device.h"
 
 #include <kis_pressure_mirror_option.h>
 #include "kis_dab_shape.h"
@@ -87,6 +88,35 @@ private:
     DabRequestInfo(const DabRequestInfo &rhs);
 };
 
+/**
+ * The parameters of a dab quantized according to the precision level
+ * of the paintop. The dabs with equal keys are considered to be equal,
+ * so they can be served from the LRU cache of KisDabCacheBase.
+ */
+struct PAINTOP_EXPORT DabCacheKey
+{
+    bool isValid() const {
+        return precisionLevel >= 0;
+    }
+
+    bool operator==(const DabCacheKey &rhs) const;
+
+    KoColor color;
+    int precisionLevel = -1;
+    qint64 angle = 0;
+    int width = 0;
+    int height = 0;
+    qint64 subPixelX = 0;
+    qint64 subPixelY = 0;
+    qint64 softnessFactor = 0;
+    qint64 ratio = 0;
+    quint32 index = 0;
+    bool horizontalMirror = false;
+    bool verticalMirror = false;
+};
+
+PAINTOP_EXPORT uint qHash(const DabCacheKey &key, uint seed = 0);
+
 struct PAINTOP_EXPORT DabGenerationInfo
 {
     MirrorProperties mirrorProperties;
@@ -99,6 +129,19 @@ struct PAINTOP_EXPORT DabGenerationInfo
     qreal softnessFactor = 1.0;
 
     bool needsPostprocessing = false;
+
+    /**
+     * The key the generated dab should be saved into the cache with,
+     * invalid if the dab cannot be cached
+     */
+    DabCacheKey cacheKey;
+
+    /**
+     * If not null, the original (not postprocessed) dab has been found
+     * in the LRU cache and needn't be generated. The device is shared
+     * with the cache, so it must never be modified.
+     */
+    KisFixedPaintDeviceSP cachedDab;
 };
 
 PAINTOP_EXPORT QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
@@ -0,0 +1,306 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisLineCoverageRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include <kis_painter.h>
+#include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
+
+namespace {
+
+inline qreal dot(const QPointF &a, const QPointF &b)
+{
+    return a.x() * b.x() + a.y() * b.y();
+}
+
+inline qreal cross(const QPointF &a, const QPointF &b)
+{
+    return a.x() * b.y() - a.y() * b.x();
+}
+
+inline void uniteSpan(qreal x, qreal *xMin, qreal *xMax)
+{
+    *xMin = qMin(*xMin, x);
+    *xMax = qMax(*xMax, x);
+}
+
+}
+
+KisLineCoverageRasterizer::KisLineCoverageRasterizer()
+    : m_antialiasing(true)
+{
+}
+
+KisLineCoverageRasterizer::~KisLineCoverageRasterizer()
+{
+}
+
+void KisLineCoverageRasterizer::setAntialiasing(bool value)
+{
+    m_antialiasing = value;
+}
+
+bool KisLineCoverageRasterizer::antialiasing() const
+{
+    return m_antialiasing;
+}
+
+void KisLineCoverageRasterizer::addLine(const QPointF &p1, const QPointF &p2, qreal width, qreal opacity)
+{
+    QPolygonF points;
+    points << p1 << p2;
+    addPolyline(points, width, opacity);
+}
+
+void KisLineCoverageRasterizer::addPolyline(const QPolygonF &points, qreal width, qreal opacity)
+{
+    if (points.isEmpty() || width <= 0.0 || opacity <= 0.0) return;
+
+    Shape shape;
+    shape.points = points;
+    shape.halfWidth = 0.5 * width;
+    shape.opacity = qMin(opacity, 1.0);
+
+    const qreal margin = shape.halfWidth + 1.0;
+    shape.bounds = points.boundingRect().adjusted(-margin, -margin, margin, margin).toAlignedRect();
+
+    m_shapes.append(shape);
+    m_bounds |= shape.bounds;
+}
+
+bool KisLineCoverageRasterizer::isEmpty() const
+{
+    return m_shapes.isEmpty();
+}
+
+QRect KisLineCoverageRasterizer::bounds() const
+{
+    return m_bounds;
+}
+
+void KisLineCoverageRasterizer::clear()
+{
+    m_shapes.clear();
+    m_bounds = QRect();
+}
+
+void KisLineCoverageRasterizer::render(KisPaintDeviceSP dev, const KoColor &color, const QRect &clipRect)
+{
+    QRect rc = m_bounds;
+    if (clipRect.isValid()) {
+        rc &= clipRect;
+    }
+
+    if (rc.isEmpty()) {
+        clear();
+        return;
+    }
+
+    rasterize(rc);
+
+    const KoColorSpace *cs = dev->colorSpace();
+    KoColor paintColor(color);
+    paintColor.convertTo(cs);
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(rc);
+    dab->lazyGrowBufferWithoutInitialization();
+    dab->fill(rc.x(), rc.y(), rc.width(), rc.height(), paintColor.data());
+
+    const int rowStride = rc.width() * cs->pixelSize();
+    QVector<quint8> maskRow(rc.width());
+
+    quint8 *rowPtr = dab->data();
+    const float *coveragePtr = m_coverage.constData();
+
+    for (int y = 0; y < rc.height(); y++) {
+        for (int x = 0; x < rc.width(); x++) {
+            maskRow[x] = quint8(*coveragePtr++ * 255.0f + 0.5f);
+        }
+
+        cs->applyAlphaU8Mask(rowPtr, maskRow.constData(), rc.width());
+        rowPtr += rowStride;
+    }
+
+    KisPainter gc(dev);
+    gc.bltFixed(rc.topLeft(), dab, rc);
+
+    clear();
+}
+
+QVector<quint8> KisLineCoverageRasterizer::coverage(const QRect &rect)
+{
+    QVector<quint8> result(rect.width() * rect.height(), 0);
+    if (rect.isEmpty()) return result;
+
+    rasterize(rect);
+
+    for (int i = 0; i < result.size(); i++) {
+        result[i] = quint8(m_coverage[i] * 255.0f + 0.5f);
+    }
+
+    return result;
+}
+
+void KisLineCoverageRasterizer::rasterize(const QRect &rect)
+{
+    const int numPixels = rect.width() * rect.height();
+
+    m_coverage.fill(0.0f, numPixels);
+    m_shapeCoverage.resize(numPixels);
+
+    Q_FOREACH (const Shape &shape, m_shapes) {
+        const QRect shapeRect = shape.bounds & rect;
+        if (shapeRect.isEmpty()) continue;
+
+        for (int y = shapeRect.top(); y <= shapeRect.bottom(); y++) {
+            float *ptr = m_shapeCoverage.data() + (y - rect.y()) * rect.width() + (shapeRect.x() - rect.x());
+            std::fill(ptr, ptr + shapeRect.width(), 0.0f);
+        }
+
+        if (shape.points.size() == 1) {
+            rasterizeSegment(shape.points.first(), shape.points.first(), shape.halfWidth, rect);
+        } else {
+            for (int i = 1; i < shape.points.size(); i++) {
+                rasterizeSegment(shape.points[i - 1], shape.points[i], shape.halfWidth, rect);
+            }
+        }
+
+        const float opacity = shape.opacity;
+
+        for (int y = shapeRect.top(); y <= shapeRect.bottom(); y++) {
+            const int offset = (y - rect.y()) * rect.width() + (shapeRect.x() - rect.x());
+            const float *srcPtr = m_shapeCoverage.constData() + offset;
+            float *dstPtr = m_coverage.data() + offset;
+
+            for (int x = 0; x < shapeRect.width(); x++) {
+                const float value = srcPtr[x] * opacity;
+                dstPtr[x] = dstPtr[x] + value - dstPtr[x] * value;
+            }
+        }
+    }
+}
+
+void KisLineCoverageRasterizer::rasterizeSegment(const QPointF &p1, const QPointF &p2, qreal halfWidth, const QRect &rect)
+{
+    /**
+     * The lines thinner than a pixel are drawn one pixel wide
+     * with proportionally reduced opacity
+     */
+    const qreal thinLineScale = m_antialiasing && halfWidth < 0.5 ? 2.0 * halfWidth : 1.0;
+    const qreal radius = m_antialiasing ? qMax(halfWidth, 0.5) : halfWidth;
+
+    // the distance from the segment at which the coverage becomes zero
+    const qreal outerRadius = m_antialiasing ? radius + 0.5 : radius;
+
+    const QPointF dir = p2 - p1;
+    const qreal length2 = dot(dir, dir);
+    const qreal length = std::sqrt(length2);
+    const QPointF normal = length > 0.0 ? QPointF(-dir.y(), dir.x()) / length : QPointF();
+
+    // the body of the capsule, without the caps
+    const QPointF corners[4] = {
+        p1 + outerRadius * normal,
+        p2 + outerRadius * normal,
+        p2 - outerRadius * normal,
+        p1 - outerRadius * normal
+    };
+
+    const int firstRow = qMax(rect.top(), qFloor(qMin(p1.y(), p2.y()) - outerRadius));
+    const int lastRow = qMin(rect.bottom(), qCeil(qMax(p1.y(), p2.y()) + outerRadius));
+
+    for (int y = firstRow; y <= lastRow; y++) {
+        const qreal yc = y + 0.5;
+
+        qreal xMin = std::numeric_limits<qreal>::max();
+        qreal xMax = std::numeric_limits<qreal>::lowest();
+
+        // the span of the row covered by the caps...
+        for (const QPointF &pt : {p1, p2}) {
+            const qreal dy = yc - pt.y();
+            if (qAbs(dy) <= outerRadius) {
+                const qreal halfSpan = std::sqrt(outerRadius * outerRadius - dy * dy);
+                uniteSpan(pt.x() - halfSpan, &xMin, &xMax);
+                uniteSpan(pt.x() + halfSpan, &xMin, &xMax);
+            }
+        }
+
+        // ... and by the body
+        if (length > 0.0) {
+            for (int i = 0; i < 4; i++) {
+                const QPointF &q0 = corners[i];
+                const QPointF &q1 = corners[(i + 1) % 4];
+
+                if (q0.y() == q1.y()) {
+                    if (q0.y() == yc) {
+                        uniteSpan(q0.x(), &xMin, &xMax);
+                        uniteSpan(q1.x(), &xMin, &xMax);
+                    }
+                } else if ((q0.y() - yc) * (q1.y() - yc) <= 0.0) {
+                    uniteSpan(q0.x() + (yc - q0.y()) * (q1.x() - q0.x()) / (q1.y() - q0.y()),
+                              &xMin, &xMax);
+                }
+            }
+        }
+
+        if (xMin > xMax) continue;
+
+        const int firstCol = qMax(rect.left(), qCeil(xMin - 0.5));
+        const int lastCol = qMin(rect.right(), qFloor(xMax - 0.5));
+
+        float *ptr = m_shapeCoverage.data() + (y - rect.y()) * rect.width() - rect.x();
+
+        for (int x = firstCol; x <= lastCol; x++) {
+            const QPointF pt(x + 0.5, yc);
+            const QPointF rel = pt - p1;
+            const qreal t = length2 > 0.0 ? qBound(0.0, dot(rel, dir) / length2, 1.0) : 0.0;
+            const QPointF diff = rel - t * dir;
+            const qreal distance = std::sqrt(dot(diff, diff));
+
+            float value = 0.0f;
+
+            if (m_antialiasing) {
+                value = qBound(0.0, radius + 0.5 - distance, 1.0) * thinLineScale;
+            } else if (t > 0.0 && t < 1.0) {
+                /**
+                 * The body of an aliased line covers the pixel centers
+                 * lying in a half-open band, so that a line passing
+                 * exactly between two rows of pixels covers only one of
+                 * them
+                 */
+                const qreal signedDistance = cross(dir, rel) / length;
+                value = signedDistance >= -radius && signedDistance < radius ? 1.0f : 0.0f;
+            } else {
+                value = distance < radius ? 1.0f : 0.0f;
+            }
+
+            ptr[x] = qMax(ptr[x], value);
+        }
+    }
+}
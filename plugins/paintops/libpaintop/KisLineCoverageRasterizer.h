@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISLINECOVERAGERASTERIZER_H
+#define KISLINECOVERAGERASTERIZER_H
+
+#include <QPolygonF>
+#include <QRect>
+#include <QVector>
+
+#include "kis_types.h"
+#include "kritapaintop_export.h"
+
+class KoColor;
+
+/**
+ * A scanline rasterizer for the line-based paintops (hatching, curve,
+ * etc.) that need to draw a lot of thick lines into a single dab.
+ *
+ * The lines are queued with addLine() and addPolyline() and are
+ * rasterized all at once in render(). Every line is drawn as a capsule
+ * (a segment with round caps) of the given width. For every row of the
+ * dab the rasterizer calculates the span of pixels the capsule may cover
+ * and evaluates the coverage only inside this span, so the cost of a
+ * line is proportional to its area, not to the area of the dab.
+ *
+ * The coverage of all the lines is accumulated in a single buffer (the
+ * lines are composited with each other using "over" operation), and
+ * the buffer is written into the paint device in a single pass of
+ * whole rows. The segments of a single polyline are merged with "max"
+ * operation, so the joints of a translucent polyline are not darker
+ * than its segments.
+ */
+class PAINTOP_EXPORT KisLineCoverageRasterizer
+{
+public:
+    KisLineCoverageRasterizer();
+    ~KisLineCoverageRasterizer();
+
+    /**
+     * When antialiasing is disabled, a pixel is either fully covered by
+     * the line or not covered at all. Enabled by default.
+     */
+    void setAntialiasing(bool value);
+    bool antialiasing() const;
+
+    void addLine(const QPointF &p1, const QPointF &p2, qreal width, qreal opacity = 1.0);
+    void addPolyline(const QPolygonF &points, qreal width, qreal opacity = 1.0);
+
+    bool isEmpty() const;
+
+    /**
+     * The rect of the pixels that might be covered by the queued lines
+     */
+    QRect bounds() const;
+
+    /**
+     * Rasterizes all the queued lines and composites them onto \p dev
+     * with "over" operation using \p color. If \p clipRect is valid, the
+     * lines are clipped by it. The queue is cleared afterwards.
+     */
+    void render(KisPaintDeviceSP dev, const KoColor &color, const QRect &clipRect = QRect());
+
+    /**
+     * Rasterizes all the queued lines into a coverage map of \p rect,
+     * one value in range [0, 255] per pixel. The queue is not cleared.
+     */
+    QVector<quint8> coverage(const QRect &rect);
+
+    void clear();
+
+private:
+    struct Shape {
+        QPolygonF points;
+        qreal halfWidth;
+        qreal opacity;
+        QRect bounds;
+    };
+
+    void rasterize(const QRect &rect);
+    void rasterizeSegment(const QPointF &p1, const QPointF &p2, qreal halfWidth, const QRect &rect);
+
+private:
+    QVector<Shape> m_shapes;
+    QRect m_bounds;
+    bool m_antialiasing;
+
+    QVector<float> m_coverage;
+    QVector<float> m_shapeCoverage;
+};
+
+#endif // KISLINECOVERAGERASTERIZER_H
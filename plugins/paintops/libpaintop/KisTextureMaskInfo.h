@@ -23,6 +23,7 @@
 #include <kis_paint_device.h>
 #include <QSharedPointer>
 #include <QMutex>
+#include <QVector>
 
 
 #include <boost/operators.hpp>
@@ -48,7 +49,12 @@ public:
 
     bool hasMask() const;
 
-    KisPaintDeviceSP mask();
+    /**
+     * The mask is stored as a plain alpha8 buffer of maskBounds().size()
+     * pixels with the row stride equal to the mask width, so that it could
+     * be tiled over the dab without any iterators.
+     */
+    const quint8* maskData() const;
 
     QRect maskBounds() const;
 
@@ -70,7 +76,7 @@ private:
     int m_cutoffRight = 255;
     int m_cutoffPolicy = 0;
 
-    KisPaintDeviceSP m_mask;
+    QVector<quint8> m_mask;
     QRect m_maskBounds;
 
 };
@@ -0,0 +1,262 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTiledParticleRenderer.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QtMath>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <kis_image_config.h>
+#include <kis_pointer_utils.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRollingMeanAccumulatorWrapper.h>
+
+namespace {
+
+struct QueuedDab {
+    QRect bounds;
+    quint8 opacity = OPACITY_OPAQUE_U8;
+    KisTiledParticleRenderer::RenderFunc renderFunc;
+    KisPaintDeviceSP device;
+    bool allowTiles = true;
+};
+
+struct TileRequest {
+    int dabIndex;
+    QRect rect;
+};
+
+struct UpdateSharedState {
+    QVector<QueuedDab> dabs;
+    QVector<TileRequest> tiles;
+    QAtomicInt renderingTime;
+};
+
+typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
+/**
+ * The dab devices are created with zero offset, and tileSize is a
+ * multiple of the 64px tiles of the data manager, so every rendering
+ * tile covers a whole block of the device tiles and two threads never
+ * write into the same tile of the data manager.
+ */
+QVector<QRect> splitIntoTiles(const QRect &bounds, int tileSize)
+{
+    QVector<QRect> result;
+
+    const int firstCol = qFloor(qreal(bounds.left()) / tileSize);
+    const int lastCol = qFloor(qreal(bounds.right()) / tileSize);
+    const int firstRow = qFloor(qreal(bounds.top()) / tileSize);
+    const int lastRow = qFloor(qreal(bounds.bottom()) / tileSize);
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            result << (QRect(col * tileSize, row * tileSize, tileSize, tileSize) & bounds);
+        }
+    }
+
+    return result;
+}
+
+}
+
+struct KisTiledParticleRenderer::Private
+{
+    Private(KisPainter *_painter)
+        : painter(_painter),
+          avgUpdateTimePerDab(50),
+          idealNumThreads(KisImageConfig(true).maxNumberOfThreads()),
+          useTiles(KisImageConfig(true).tiledParticleRendering())
+    {
+    }
+
+    KisPaintDeviceSP takeDabDevice() {
+        return !dabDevicesPool.isEmpty() ?
+            dabDevicesPool.takeLast() : painter->device()->createCompositionSourceDevice();
+    }
+
+    KisPainter *painter;
+
+    QVector<QueuedDab> pendingDabs;
+    UpdateSharedStateSP updateSharedState;
+
+    /**
+     * The dab devices of the finished updates. They are cleared right
+     * after compositing and handed to the dabs of the next update, so
+     * the devices are not reallocated for every dab.
+     */
+    QVector<KisPaintDeviceSP> dabDevicesPool;
+
+    int currentUpdatePeriod = 20;
+    KisRollingMeanAccumulatorWrapper avgUpdateTimePerDab;
+
+    const int idealNumThreads;
+    const bool useTiles;
+    const int minUpdatePeriod = 10;
+    const int maxUpdatePeriod = 100;
+};
+
+KisTiledParticleRenderer::KisTiledParticleRenderer(KisPainter *painter)
+    : m_d(new Private(painter))
+{
+}
+
+KisTiledParticleRenderer::~KisTiledParticleRenderer()
+{
+}
+
+int KisTiledParticleRenderer::maxThreads() const
+{
+    return m_d->idealNumThreads;
+}
+
+void KisTiledParticleRenderer::addDab(const QRect &bounds, quint8 opacity, RenderFunc renderFunc, bool allowTiles)
+{
+    if (bounds.isEmpty()) return;
+
+    QueuedDab dab;
+    dab.bounds = bounds;
+    dab.opacity = opacity;
+    dab.renderFunc = renderFunc;
+    dab.allowTiles = allowTiles;
+
+    m_d->pendingDabs.append(dab);
+}
+
+bool KisTiledParticleRenderer::hasPendingDabs() const
+{
+    return !m_d->pendingDabs.isEmpty();
+}
+
+std::pair<int, bool> KisTiledParticleRenderer::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    if (m_d->updateSharedState || m_d->pendingDabs.isEmpty()) {
+        return std::make_pair(m_d->currentUpdatePeriod, false);
+    }
+
+    m_d->updateSharedState = toQShared(new UpdateSharedState());
+    UpdateSharedStateSP state = m_d->updateSharedState;
+
+    {
+        const qreal updateTimePerDab = m_d->avgUpdateTimePerDab.rollingMeanSafe();
+        const int dabsLimit =
+            updateTimePerDab > 0 ?
+                qMax(10, int(m_d->maxUpdatePeriod / updateTimePerDab)) :
+                m_d->pendingDabs.size();
+
+        if (m_d->pendingDabs.size() <= dabsLimit) {
+            state->dabs.swap(m_d->pendingDabs);
+        } else {
+            state->dabs = m_d->pendingDabs.mid(0, dabsLimit);
+            m_d->pendingDabs.remove(0, dabsLimit);
+        }
+    }
+
+    const bool someDabsAreStillInQueue = !m_d->pendingDabs.isEmpty();
+
+    for (int i = 0; i < state->dabs.size(); i++) {
+        QueuedDab &dab = state->dabs[i];
+        dab.device = m_d->takeDabDevice();
+
+        if (m_d->useTiles && dab.allowTiles) {
+            Q_FOREACH (const QRect &rc, splitIntoTiles(dab.bounds, tileSize)) {
+                state->tiles.append({i, rc});
+            }
+        } else {
+            state->tiles.append({i, dab.bounds});
+        }
+    }
+
+    /**
+     * Stage 1: render the tiles. Every job gets a contiguous range of
+     * tiles and a thread id that is unique among the jobs of this update.
+     */
+    const int numRenderingJobs = qMin(m_d->idealNumThreads, state->tiles.size());
+
+    for (int i = 0; i < numRenderingJobs; i++) {
+        const int begin = state->tiles.size() * i / numRenderingJobs;
+        const int end = state->tiles.size() * (i + 1) / numRenderingJobs;
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, begin, end, i] () {
+                    QElapsedTimer timer;
+                    timer.start();
+
+                    for (int tile = begin; tile < end; tile++) {
+                        const TileRequest &request = state->tiles[tile];
+                        const QueuedDab &dab = state->dabs[request.dabIndex];
+                        dab.renderFunc(dab.device, request.rect, i);
+                    }
+
+                    state->renderingTime.fetchAndAddOrdered(timer.elapsed());
+                },
+                KisStrokeJobData::CONCURRENT));
+    }
+
+    /**
+     * Stage 2: composite the dabs in the order they have been queued
+     */
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [this, state, someDabsAreStillInQueue, numRenderingJobs] () {
+                QElapsedTimer timer;
+                timer.start();
+
+                KisPainter *painter = m_d->painter;
+                const quint8 origOpacity = painter->opacity();
+
+                Q_FOREACH (const QueuedDab &dab, state->dabs) {
+                    const QRect rc = dab.device->extent();
+
+                    if (!rc.isEmpty()) {
+                        painter->setOpacity(dab.opacity);
+                        painter->bitBlt(rc.topLeft(), dab.device, rc);
+                        painter->renderMirrorMask(rc, dab.device);
+                    }
+
+                    dab.device->clear();
+                    m_d->dabDevicesPool.append(dab.device);
+                }
+
+                painter->setOpacity(origOpacity);
+
+                const int updateTime =
+                    timer.elapsed() +
+                    state->renderingTime.loadAcquire() / qMax(1, numRenderingJobs);
+
+                m_d->avgUpdateTimePerDab(qreal(updateTime) / state->dabs.size());
+
+                m_d->currentUpdatePeriod =
+                    someDabsAreStillInQueue ? m_d->minUpdatePeriod :
+                    qBound(m_d->minUpdatePeriod, int(1.5 * updateTime), m_d->maxUpdatePeriod);
+
+                // release the captured particles
+                state->dabs.clear();
+                state->tiles.clear();
+
+                m_d->updateSharedState.clear();
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    return std::make_pair(m_d->currentUpdatePeriod, someDabsAreStillInQueue);
+}
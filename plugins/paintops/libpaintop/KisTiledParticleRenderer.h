@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTILEDPARTICLERENDERER_H
+#define KISTILEDPARTICLERENDERER_H
+
+#include <QRect>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <functional>
+#include <utility>
+
+#include "kis_types.h"
+#include "kritapaintop_export.h"
+
+class KisPainter;
+class KisRunnableStrokeJobData;
+
+/**
+ * A helper for the particle-based paintops (spray, hairy, etc.) that
+ * renders the queued dabs in the stroke's worker threads.
+ *
+ * The paintop does all the "random" part of the work (generation of the
+ * particles, color picking, etc.) in paintAt() and queues the dab as a
+ * rendering function. On every asynchronous update the area covered by
+ * the queued dabs is split into 128px tiles, each covering 2x2 tiles of
+ * the dab devices, and the tiles are rendered concurrently. Every dab is rendered
+ * into its own device, so the tiles never depend on each other. When all
+ * the tiles are ready, the dabs are composited onto the painter's device
+ * in a single sequential job, in exactly the same order as they have
+ * been queued, so the result doesn't depend on the number of threads.
+ *
+ * When tiled rendering is disabled in KisImageConfig, every dab is
+ * rendered in one piece. The result is the same, only the parallelism
+ * is lower.
+ */
+class PAINTOP_EXPORT KisTiledParticleRenderer
+{
+public:
+    /**
+     * Renders the part of the dab that lies inside \p tileRect into
+     * \p dab. The function is called concurrently for different tiles
+     * of the same dab, so it must never write outside \p tileRect.
+     * \p threadId is in range [0, maxThreads()) and is unique among the
+     * concurrently running calls, so it can be used for selecting
+     * per-thread rendering resources.
+     */
+    typedef std::function<void(KisPaintDeviceSP dab, const QRect &tileRect, int threadId)> RenderFunc;
+
+    /// must be a multiple of the 64px tiles of the paint device
+    static const int tileSize = 128;
+
+public:
+    KisTiledParticleRenderer(KisPainter *painter);
+    ~KisTiledParticleRenderer();
+
+    /**
+     * The maximum number of the rendering functions running concurrently,
+     * the paintop should prepare this number of copies of its rendering
+     * resources.
+     */
+    int maxThreads() const;
+
+    /**
+     * Queues a dab for rendering. \p bounds is a conservative estimate
+     * of the area the dab covers, \p opacity is the opacity the dab is
+     * composited with. If \p allowTiles is false, the dab is always
+     * rendered in one piece, e.g. when the result of the rendering
+     * function depends on the size of the rendered rect.
+     */
+    void addDab(const QRect &bounds, quint8 opacity, RenderFunc renderFunc, bool allowTiles = true);
+
+    bool hasPendingDabs() const;
+
+    /**
+     * Fills \p jobs with the jobs rendering and compositing the queued
+     * dabs. The return value has the same meaning as in
+     * KisPaintOp::doAsyncronousUpdate().
+     */
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISTILEDPARTICLERENDERER_H
@@ -194,9 +194,18 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
         return fetchFromCache(&resources, info, dstDabRect);
     }
 
-    // 3. Generate new dab
-
-    generateDab(di, &resources, &m_d->dab);
+    // 3. Try to fetch the dab from the LRU cache or generate a new one
+
+    if (di.cachedDab && *di.cachedDab->colorSpace() == *cs) {
+        // the cached device is shared with the cache, so copy it
+        *m_d->dab = *di.cachedDab;
+        *dstDabRect = correctDabRectWhenFetchedFromCache(*dstDabRect, m_d->dab->bounds().size());
+        resources.brush->notifyCachedDabPainted(info);
+    } else {
+        di.cachedDab.clear();
+        generateDab(di, &resources, &m_d->dab);
+        putDabToCache(di, m_d->dab);
+    }
 
     // 4. Do postprocessing
     if (di.needsPostprocessing) {
@@ -206,7 +215,7 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
 
         *m_d->dabOriginal = *m_d->dab;
 
-        postProcessDab(m_d->dab, di.dstDabRect.topLeft(), info, &resources);
+        postProcessDab(m_d->dab, dstDabRect->topLeft(), info, &resources);
     }
 
     return m_d->dab;
@@ -28,6 +28,11 @@
 #include <kis_precision_option.h>
 #include <kis_fixed_paint_device.h>
 #include <brushengine/kis_paintop.h>
+#include <kis_auto_brush.h>
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <kundo2command.h>
 
@@ -75,14 +80,71 @@ struct KisDabCacheBase::SavedDabParameters {
                mirrorProperties.horizontalMirror == rhs.mirrorProperties.horizontalMirror &&
                mirrorProperties.verticalMirror == rhs.mirrorProperties.verticalMirror;
     }
+
+    /**
+     * Quantizes the parameters with the same tolerances compare() uses,
+     * so that the dabs with equal keys could be reused for each other
+     */
+    KisDabCacheUtils::DabCacheKey toCacheKey(int precisionLevel) const {
+        const PrecisionValues &prec = precisionLevels[precisionLevel];
+
+        auto quantize = [] (qreal value, qreal step) {
+            return qRound64(value / step);
+        };
+
+        auto quantizeSize = [&prec] (int size) {
+            const int step = qMax(1, int(prec.sizeFrac * size));
+            return size / step * step;
+        };
+
+        KisDabCacheUtils::DabCacheKey key;
+        key.color = color;
+        key.precisionLevel = precisionLevel;
+        key.angle = quantize(angle, prec.angle);
+        key.width = quantizeSize(width);
+        key.height = quantizeSize(height);
+        key.subPixelX = quantize(subPixelX, prec.subPixel);
+        key.subPixelY = quantize(subPixelY, prec.subPixel);
+        key.softnessFactor = quantize(softnessFactor, prec.softnessFactor);
+        key.ratio = quantize(ratio, prec.ratio);
+        key.index = index;
+        key.horizontalMirror = mirrorProperties.horizontalMirror;
+        key.verticalMirror = mirrorProperties.verticalMirror;
+
+        return key;
+    }
 };
 
+namespace {
+
+struct CachedDab {
+    CachedDab(KisFixedPaintDeviceSP _dab) : dab(_dab) {}
+    KisFixedPaintDeviceSP dab;
+};
+
+/**
+ * The auto brushes with randomness or density generate a new noise
+ * for every dab, so repeating the same dab all over the stroke would
+ * produce a visible pattern.
+ */
+bool brushSupportsLruCache(KisBrushSP brush)
+{
+    const KisAutoBrush *autoBrush = dynamic_cast<const KisAutoBrush*>(brush.data());
+
+    return !autoBrush ||
+        (qFuzzyIsNull(autoBrush->randomness()) &&
+         qFuzzyCompare(autoBrush->density(), 1.0));
+}
+
+}
+
 struct KisDabCacheBase::Private {
 
     Private()
         : mirrorOption(0),
           precisionOption(0),
-          subPixelPrecisionDisabled(false)
+          subPixelPrecisionDisabled(false),
+          dabCache(defaultMaxCacheSize)
     {}
 
     KisPressureMirrorOption *mirrorOption;
@@ -91,6 +153,15 @@ struct KisDabCacheBase::Private {
 
     SavedDabParameters lastSavedDabParameters;
 
+    /**
+     * The cost of the entries is measured in kibibytes
+     */
+    static const int defaultMaxCacheSize = 32 * 1024;
+
+    mutable QMutex cacheMutex;
+    QCache<KisDabCacheUtils::DabCacheKey, CachedDab> dabCache;
+    CacheStatistics statistics;
+
     static qreal positiveFraction(qreal x);
 };
 
@@ -121,6 +192,34 @@ void KisDabCacheBase::disableSubpixelPrecision()
     m_d->subPixelPrecisionDisabled = true;
 }
 
+void KisDabCacheBase::setMaxCacheSize(int kibibytes)
+{
+    QMutexLocker l(&m_d->cacheMutex);
+    m_d->dabCache.setMaxCost(kibibytes);
+}
+
+KisDabCacheBase::CacheStatistics KisDabCacheBase::cacheStatistics() const
+{
+    QMutexLocker l(&m_d->cacheMutex);
+    return m_d->statistics;
+}
+
+void KisDabCacheBase::putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di,
+                                    KisFixedPaintDeviceSP dab)
+{
+    if (!di.cacheKey.isValid() || di.cachedDab || !dab) return;
+
+    const QRect bounds = dab->bounds();
+    const int cost = qMax(1, int((qint64(bounds.width()) * bounds.height() * dab->pixelSize() + 1023) / 1024));
+
+    QMutexLocker l(&m_d->cacheMutex);
+
+    if (cost > m_d->dabCache.maxCost() || m_d->dabCache.contains(di.cacheKey)) return;
+
+    // the caller may still modify its dab, so we keep a copy
+    m_d->dabCache.insert(di.cacheKey, new CachedDab(new KisFixedPaintDevice(*dab)), cost);
+}
+
 inline KisDabCacheBase::SavedDabParameters
 KisDabCacheBase::getDabParameters(KisBrushSP brush,
                               const KoColor& color,
@@ -283,6 +382,23 @@ void KisDabCacheBase::fetchDabGenerationInfo(bool hasDabInCache,
         m_d->lastSavedDabParameters = newParams;
     }
 
+    if (di->solidColorFill && brushSupportsLruCache(resources->brush)) {
+        di->cacheKey = newParams.toCacheKey(precisionLevel);
+    }
+
+    {
+        QMutexLocker l(&m_d->cacheMutex);
+
+        if (*shouldUseCache) {
+            m_d->statistics.lastDabHits++;
+        } else if (di->cacheKey.isValid() && m_d->dabCache.contains(di->cacheKey)) {
+            di->cachedDab = m_d->dabCache.object(di->cacheKey)->dab;
+            m_d->statistics.lruHits++;
+        } else {
+            m_d->statistics.misses++;
+        }
+    }
+
     di->needsPostprocessing = needSeparateOriginal(resources->textureOption.data(), resources->sharpnessOption.data());
 }
 
@@ -50,9 +50,28 @@ struct MirrorProperties;
  *  level.
  *
  *  The texturing and mirroring problems are solved.
+ *
+ *  Apart from the previously generated dab, the class keeps a bounded LRU
+ *  cache of the recently generated dabs, keyed by their parameters
+ *  quantized according to the precision level. It serves the dab shapes
+ *  that reappear in the stroke not in a row, e.g. when the size or
+ *  rotation jitters with pressure or a random sensor.
  */
 class PAINTOP_EXPORT KisDabCacheBase
 {
+public:
+    struct CacheStatistics
+    {
+        int lastDabHits = 0;
+        int lruHits = 0;
+        int misses = 0;
+
+        qreal hitRate() const {
+            const int total = lastDabHits + lruHits + misses;
+            return total > 0 ? qreal(lastDabHits + lruHits) / total : 0.0;
+        }
+    };
+
 public:
     KisDabCacheBase();
     ~KisDabCacheBase();
@@ -75,6 +94,19 @@ public:
     bool needSeparateOriginal(KisTextureProperties *textureOption,
                               KisPressureSharpnessOption *sharpnessOption) const;
 
+    /**
+     * Sets the maximum size of the LRU cache of the dabs in kibibytes,
+     * zero disables the cache
+     */
+    void setMaxCacheSize(int kibibytes);
+
+    /**
+     * @return the number of the dabs, reused from the previously
+     *         generated dab, served from the LRU cache and generated
+     *         from scratch
+     */
+    CacheStatistics cacheStatistics() const;
+
 protected:
     /**
      * Fetches all the necessary information for dab generation and
@@ -98,6 +130,16 @@ protected:
                                 KisDabCacheUtils::DabGenerationInfo *di,
                                 bool *shouldUseCache);
 
+    /**
+     * Saves a copy of the freshly generated (and not postprocessed)
+     * \p dab into the LRU cache under di.cacheKey. The dabs, fetched from
+     * the cache (di.cachedDab is set), should not be put back.
+     *
+     * Unlike fetchDabGenerationInfo(), can be called from any thread.
+     */
+    void putDabToCache(const KisDabCacheUtils::DabGenerationInfo &di,
+                       KisFixedPaintDeviceSP dab);
+
 private:
     struct SavedDabParameters;
     struct DabPosition;
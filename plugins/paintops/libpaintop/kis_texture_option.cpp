@@ -38,9 +38,7 @@
 #include <kis_multipliers_double_slider_spinbox.h>
 #include <resources/KoPattern.h>
 #include <kis_paint_device.h>
-#include <kis_fill_painter.h>
 #include <kis_painter.h>
-#include <kis_iterator_ng.h>
 #include <kis_fixed_paint_device.h>
 #include <KisGradientSlider.h>
 #include "kis_embedded_pattern_manager.h"
@@ -49,6 +47,84 @@
 #include <time.h>
 #include "kis_signals_blocker.h"
 #include <KisGlobalResourcesInterface.h>
+#include <KoColorSpace.h>
+#include <KoChannelInfo.h>
+#include <KoColorSpaceMaths.h>
+
+#include <KoConfig.h>
+#ifdef HAVE_OPENEXR
+#include <half.h>
+#endif /* HAVE_OPENEXR */
+
+
+namespace {
+
+inline int wrapToMask(int value, int size)
+{
+    return value >= 0 ? value % size : size - (-value - 1) % size - 1;
+}
+
+/**
+ * Subtracts the 8-bit mask from the alpha channel of the pixels. The
+ * alpha channel is downscaled to 8 bits before subtraction, exactly
+ * like opacityU8() does, so the result does not depend on the depth
+ * of the dab.
+ */
+template <typename channel_type>
+void subtractAlphaU8MaskImpl(quint8 *pixels, const quint8 *mask, int pixelSize, int alphaOffset, int nPixels)
+{
+    for (int i = 0; i < nPixels; i++) {
+        channel_type *alpha = reinterpret_cast<channel_type*>(pixels + alphaOffset);
+        const int dabA = KoColorSpaceMaths<channel_type, quint8>::scaleToA(*alpha);
+        *alpha = KoColorSpaceMaths<quint8, channel_type>::scaleToA(quint8(qMax(0, dabA - int(mask[i]))));
+        pixels += pixelSize;
+    }
+}
+
+void subtractAlphaU8Mask(const KoColorSpace *cs, quint8 *pixels, const quint8 *mask, int nPixels)
+{
+    const int pixelSize = cs->pixelSize();
+
+    KoChannelInfo::enumChannelValueType alphaChannelType = KoChannelInfo::OTHER;
+    int alphaOffset = -1;
+
+    Q_FOREACH (const KoChannelInfo *channel, cs->channels()) {
+        if (channel->channelType() == KoChannelInfo::ALPHA) {
+            alphaOffset = channel->pos();
+            alphaChannelType = channel->channelValueType();
+            break;
+        }
+    }
+
+    if (alphaOffset >= 0) {
+        switch (alphaChannelType) {
+        case KoChannelInfo::UINT8:
+            subtractAlphaU8MaskImpl<quint8>(pixels, mask, pixelSize, alphaOffset, nPixels);
+            return;
+        case KoChannelInfo::UINT16:
+            subtractAlphaU8MaskImpl<quint16>(pixels, mask, pixelSize, alphaOffset, nPixels);
+            return;
+#ifdef HAVE_OPENEXR
+        case KoChannelInfo::FLOAT16:
+            subtractAlphaU8MaskImpl<half>(pixels, mask, pixelSize, alphaOffset, nPixels);
+            return;
+#endif /* HAVE_OPENEXR */
+        case KoChannelInfo::FLOAT32:
+            subtractAlphaU8MaskImpl<float>(pixels, mask, pixelSize, alphaOffset, nPixels);
+            return;
+        default:
+            break;
+        }
+    }
+
+    for (int i = 0; i < nPixels; i++) {
+        const int dabA = cs->opacityU8(pixels);
+        cs->setOpacity(pixels, quint8(qMax(0, dabA - int(mask[i]))), 1);
+        pixels += pixelSize;
+    }
+}
+
+}
 
 KisTextureOption::KisTextureOption()
     : KisPaintOpOption(KisPaintOpOption::TEXTURE, true)
@@ -246,44 +322,66 @@ void KisTextureProperties::apply(KisFixedPaintDeviceSP dab, const QPoint &offset
 {
     if (!m_enabled) return;
 
-    KisPaintDeviceSP fillDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
-    QRect rect = dab->bounds();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_maskInfo->hasMask());
 
-    KisPaintDeviceSP mask = m_maskInfo->mask();
+    const QRect rect = dab->bounds();
     const QRect maskBounds = m_maskInfo->maskBounds();
+    const quint8 *maskData = m_maskInfo->maskData();
 
-    KIS_SAFE_ASSERT_RECOVER_RETURN(mask);
+    const int maskWidth = maskBounds.width();
+    const int maskHeight = maskBounds.height();
 
-    int x = offset.x() % maskBounds.width() - m_offsetX;
-    int y = offset.y() % maskBounds.height() - m_offsetY;
+    const int x = offset.x() % maskWidth - m_offsetX;
+    const int y = offset.y() % maskHeight - m_offsetY;
 
+    const qreal pressure = m_strengthOption.apply(info);
 
-    KisFillPainter fillPainter(fillDevice);
-    fillPainter.fillRect(x - 1, y - 1, rect.width() + 2, rect.height() + 2, mask, maskBounds);
-    fillPainter.end();
+    /**
+     * The pressure is applied to the 8-bit mask values, so we can
+     * bake it into a lookup table and apply it while tiling the mask
+     */
+    quint8 lut[256];
 
-    qreal pressure = m_strengthOption.apply(info);
-    quint8 *dabData = dab->data();
+    if (m_texturingMode == MULTIPLY) {
+        for (int i = 0; i < 256; i++) {
+            lut[i] = quint8(i * pressure);
+        }
+    } else {
+        const int pressureOffset = (1.0 - pressure) * 255;
+
+        for (int i = 0; i < 256; i++) {
+            lut[i] = qBound(0, i + pressureOffset, 255);
+        }
+    }
+
+    const int numPixels = rect.width() * rect.height();
+    QVector<quint8> tiledMask(numPixels);
+    quint8 *dstPtr = tiledMask.data();
 
-    KisHLineIteratorSP iter = fillDevice->createHLineIteratorNG(x, y, rect.width());
     for (int row = 0; row < rect.height(); ++row) {
-        for (int col = 0; col < rect.width(); ++col) {
-            if (m_texturingMode == MULTIPLY) {
-                dab->colorSpace()->multiplyAlpha(dabData, quint8(*iter->oldRawData() * pressure), 1);
-            }
-            else {
-                int pressureOffset = (1.0 - pressure) * 255;
+        const quint8 *maskRow = maskData + wrapToMask(y + row, maskHeight) * maskWidth;
+        int srcCol = wrapToMask(x, maskWidth);
+        int col = 0;
 
-                qint16 maskA = *iter->oldRawData() + pressureOffset;
-                quint8 dabA = dab->colorSpace()->opacityU8(dabData);
+        while (col < rect.width()) {
+            const int chunk = qMin(maskWidth - srcCol, rect.width() - col);
+            const quint8 *srcPtr = maskRow + srcCol;
 
-                dabA = qMax(0, (qint16)dabA - maskA);
-                dab->colorSpace()->setOpacity(dabData, dabA, 1);
+            for (int i = 0; i < chunk; i++) {
+                dstPtr[i] = lut[srcPtr[i]];
             }
 
-            iter->nextPixel();
-            dabData += dab->pixelSize();
+            dstPtr += chunk;
+            col += chunk;
+            srcCol = 0;
         }
-        iter->nextRow();
+    }
+
+    const KoColorSpace *cs = dab->colorSpace();
+
+    if (m_texturingMode == MULTIPLY) {
+        cs->applyAlphaU8Mask(dab->data(), tiledMask.constData(), numPixels);
+    } else {
+        subtractAlphaU8Mask(cs, dab->data(), tiledMask.constData(), numPixels);
     }
 }
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisLineCoverageRasterizerTest.h"
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <KisLineCoverageRasterizer.h>
+
+namespace {
+
+quint8 coverageAt(const QVector<quint8> &coverage, const QRect &rect, int x, int y)
+{
+    return coverage[(y - rect.y()) * rect.width() + (x - rect.x())];
+}
+
+}
+
+void KisLineCoverageRasterizerTest::testHorizontalLine()
+{
+    KisLineCoverageRasterizer rasterizer;
+    rasterizer.addLine(QPointF(2, 5), QPointF(8, 5), 2.0);
+
+    QVERIFY(rasterizer.bounds().contains(QRect(1, 4, 8, 2)));
+
+    const QRect rect(0, 0, 12, 12);
+    const QVector<quint8> coverage = rasterizer.coverage(rect);
+
+    for (int x = 2; x < 8; x++) {
+        QCOMPARE(coverageAt(coverage, rect, x, 3), quint8(0));
+        QCOMPARE(coverageAt(coverage, rect, x, 4), quint8(255));
+        QCOMPARE(coverageAt(coverage, rect, x, 5), quint8(255));
+        QCOMPARE(coverageAt(coverage, rect, x, 6), quint8(0));
+    }
+
+    // the round caps are antialiased
+    QVERIFY(coverageAt(coverage, rect, 1, 4) > 0);
+    QVERIFY(coverageAt(coverage, rect, 1, 4) < 255);
+    QCOMPARE(coverageAt(coverage, rect, 11, 5), quint8(0));
+}
+
+void KisLineCoverageRasterizerTest::testAliasedLineBetweenPixels()
+{
+    KisLineCoverageRasterizer rasterizer;
+    rasterizer.setAntialiasing(false);
+    rasterizer.addLine(QPointF(10, 0), QPointF(10, 20), 1.0);
+
+    const QRect rect(0, 0, 20, 20);
+    const QVector<quint8> coverage = rasterizer.coverage(rect);
+
+    for (int y = 1; y < 19; y++) {
+        QCOMPARE(coverageAt(coverage, rect, 8, y), quint8(0));
+        QCOMPARE(int(coverageAt(coverage, rect, 9, y)) + coverageAt(coverage, rect, 10, y), 255);
+        QCOMPARE(coverageAt(coverage, rect, 11, y), quint8(0));
+    }
+}
+
+void KisLineCoverageRasterizerTest::testAccumulation()
+{
+    KisLineCoverageRasterizer rasterizer;
+    rasterizer.addLine(QPointF(0, 5.5), QPointF(10, 5.5), 1.0, 0.5);
+    rasterizer.addLine(QPointF(5.5, 0), QPointF(5.5, 10), 1.0, 0.5);
+
+    const QRect rect(0, 0, 10, 10);
+    const QVector<quint8> coverage = rasterizer.coverage(rect);
+
+    QCOMPARE(coverageAt(coverage, rect, 2, 5), quint8(128));
+    QCOMPARE(coverageAt(coverage, rect, 5, 2), quint8(128));
+
+    // the crossing is composited with "over"
+    QCOMPARE(coverageAt(coverage, rect, 5, 5), quint8(191));
+}
+
+void KisLineCoverageRasterizerTest::testPolylineJoints()
+{
+    QPolygonF polyline;
+    polyline << QPointF(0, 5.5) << QPointF(5.5, 5.5) << QPointF(5.5, 0);
+
+    KisLineCoverageRasterizer rasterizer;
+    rasterizer.addPolyline(polyline, 1.0, 0.5);
+
+    const QRect rect(0, 0, 10, 10);
+    const QVector<quint8> coverage = rasterizer.coverage(rect);
+
+    // the joint is not darker than the segments
+    QCOMPARE(coverageAt(coverage, rect, 5, 5), quint8(128));
+    QCOMPARE(coverageAt(coverage, rect, 2, 5), quint8(128));
+}
+
+void KisLineCoverageRasterizerTest::testRender()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    KisLineCoverageRasterizer rasterizer;
+    rasterizer.addLine(QPointF(0, 5), QPointF(100, 5), 2.0);
+    rasterizer.addLine(QPointF(50, 0), QPointF(50, 100), 2.0);
+
+    rasterizer.render(dev, KoColor(Qt::red, cs), QRect(0, 0, 64, 64));
+
+    QVERIFY(rasterizer.isEmpty());
+    QVERIFY(QRect(0, 0, 64, 64).contains(dev->exactBounds()));
+
+    KoColor pixel(cs);
+
+    dev->pixel(20, 4, &pixel);
+    QCOMPARE(pixel.opacityU8(), OPACITY_OPAQUE_U8);
+    QCOMPARE(pixel.toQColor(), QColor(Qt::red));
+
+    dev->pixel(20, 10, &pixel);
+    QCOMPARE(pixel.opacityU8(), OPACITY_TRANSPARENT_U8);
+
+    dev->pixel(49, 40, &pixel);
+    QCOMPARE(pixel.opacityU8(), OPACITY_OPAQUE_U8);
+}
+
+QTEST_MAIN(KisLineCoverageRasterizerTest)
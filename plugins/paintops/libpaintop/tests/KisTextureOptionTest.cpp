@@ -0,0 +1,238 @@
+/*
+ *  Copyright (c) 2020 The Krita team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTextureOptionTest.h"
+
+#include <QPainter>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <resources/KoPattern.h>
+#include <KisLocalStrokeResources.h>
+#include <kis_pointer_utils.h>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_paint_device.h>
+#include <kis_fill_painter.h>
+#include <kis_iterator_ng.h>
+#include <kis_properties_configuration.h>
+#include <brushengine/kis_paint_information.h>
+
+#include "kis_texture_option.h"
+#include "KisTextureMaskInfo.h"
+#include "kis_embedded_pattern_manager.h"
+#include "kis_pressure_texture_strength_option.h"
+
+#include "sdk/tests/kistest.h"
+
+namespace {
+
+KoPatternSP createPattern()
+{
+    QImage image(37, 29, QImage::Format_ARGB32);
+
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgba((x * 7) % 256, (y * 9) % 256, (x * y) % 256, 128 + (x + y) % 128));
+        }
+    }
+
+    return KoPatternSP(new KoPattern(image, "__texture_test_pattern", ""));
+}
+
+KisPropertiesConfigurationSP createSettings(KoPatternSP pattern, int texturingMode, qreal strength)
+{
+    KisPropertiesConfigurationSP setting(new KisPropertiesConfiguration);
+
+    KisEmbeddedPatternManager::saveEmbeddedPattern(setting, pattern);
+
+    setting->setProperty("Texture/Pattern/Enabled", true);
+    setting->setProperty("Texture/Pattern/Scale", 1.0);
+    setting->setProperty("Texture/Pattern/Brightness", 0.1);
+    setting->setProperty("Texture/Pattern/Contrast", 1.3);
+    setting->setProperty("Texture/Pattern/OffsetX", 5);
+    setting->setProperty("Texture/Pattern/OffsetY", 3);
+    setting->setProperty("Texture/Pattern/TexturingMode", texturingMode);
+
+    setting->setProperty("PressureTexture/Strength/", true);
+    setting->setProperty("Texture/Strength/Value", strength);
+    setting->setProperty("Texture/Strength/UseCurve", false);
+
+    return setting;
+}
+
+KisFixedPaintDeviceSP createDab(const KoColorSpace *cs, const QSize &size)
+{
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(QRect(QPoint(), size));
+    dab->initialize();
+
+    QVector<float> channels(cs->channelCount());
+
+    quint8 *ptr = dab->data();
+    for (int i = 0; i < size.width() * size.height(); i++) {
+        for (int ch = 0; ch < channels.size(); ch++) {
+            channels[ch] = ((i * 13 + ch * 71) % 256) / 255.0f;
+        }
+        cs->fromNormalisedChannelsValue(ptr, channels);
+        ptr += cs->pixelSize();
+    }
+
+    return dab;
+}
+
+/**
+ * The per-pixel implementation of KisTextureProperties::apply() that was
+ * used before the mask got stored as a flat buffer
+ */
+void applyTextureReference(KisFixedPaintDeviceSP dab, const QPoint &offset, const KisPaintInformation &info,
+                           KisPropertiesConfigurationSP setting, KisResourcesInterfaceSP resourcesInterface)
+{
+    KisTextureMaskInfoSP maskInfo = toQShared(new KisTextureMaskInfo(0));
+    QVERIFY(maskInfo->fillProperties(setting, resourcesInterface));
+    maskInfo->recalculateMask();
+
+    const QRect maskBounds = maskInfo->maskBounds();
+    KisPaintDeviceSP mask = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    mask->writeBytes(maskInfo->maskData(), maskBounds);
+
+    KisPressureTextureStrengthOption strengthOption;
+    strengthOption.readOptionSetting(setting);
+    strengthOption.resetAllSensors();
+
+    const int offsetX = setting->getInt("Texture/Pattern/OffsetX");
+    const int offsetY = setting->getInt("Texture/Pattern/OffsetY");
+    const int texturingMode = setting->getInt("Texture/Pattern/TexturingMode");
+
+    KisPaintDeviceSP fillDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    QRect rect = dab->bounds();
+
+    int x = offset.x() % maskBounds.width() - offsetX;
+    int y = offset.y() % maskBounds.height() - offsetY;
+
+    KisFillPainter fillPainter(fillDevice);
+    fillPainter.fillRect(x - 1, y - 1, rect.width() + 2, rect.height() + 2, mask, maskBounds);
+    fillPainter.end();
+
+    qreal pressure = strengthOption.apply(info);
+    quint8 *dabData = dab->data();
+
+    KisHLineIteratorSP iter = fillDevice->createHLineIteratorNG(x, y, rect.width());
+    for (int row = 0; row < rect.height(); ++row) {
+        for (int col = 0; col < rect.width(); ++col) {
+            if (texturingMode == KisTextureProperties::MULTIPLY) {
+                dab->colorSpace()->multiplyAlpha(dabData, quint8(*iter->oldRawData() * pressure), 1);
+            }
+            else {
+                int pressureOffset = (1.0 - pressure) * 255;
+
+                qint16 maskA = *iter->oldRawData() + pressureOffset;
+                quint8 dabA = dab->colorSpace()->opacityU8(dabData);
+
+                dabA = qMax(0, (qint16)dabA - maskA);
+                dab->colorSpace()->setOpacity(dabData, dabA, 1);
+            }
+
+            iter->nextPixel();
+            dabData += dab->pixelSize();
+        }
+        iter->nextRow();
+    }
+}
+
+}
+
+void KisTextureOptionTest::testApply_data()
+{
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<int>("texturingMode");
+    QTest::addColumn<qreal>("strength");
+
+    const QStringList depths({Integer8BitsColorDepthID.id(),
+                              Integer16BitsColorDepthID.id(),
+                              Float32BitsColorDepthID.id()});
+
+    Q_FOREACH (const QString &depth, depths) {
+        QTest::newRow(QString("%1-multiply").arg(depth).toLatin1()) << depth << int(KisTextureProperties::MULTIPLY) << 1.0;
+        QTest::newRow(QString("%1-multiply-weak").arg(depth).toLatin1()) << depth << int(KisTextureProperties::MULTIPLY) << 0.6;
+        QTest::newRow(QString("%1-subtract").arg(depth).toLatin1()) << depth << int(KisTextureProperties::SUBTRACT) << 1.0;
+        QTest::newRow(QString("%1-subtract-weak").arg(depth).toLatin1()) << depth << int(KisTextureProperties::SUBTRACT) << 0.6;
+    }
+}
+
+void KisTextureOptionTest::testApply()
+{
+    QFETCH(QString, colorDepthId);
+    QFETCH(int, texturingMode);
+    QFETCH(qreal, strength);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepthId, 0);
+    QVERIFY(cs);
+
+    KoPatternSP pattern = createPattern();
+    KisResourcesInterfaceSP resourcesInterface = toQShared(new KisLocalStrokeResources({pattern}));
+    KisPropertiesConfigurationSP setting = createSettings(pattern, texturingMode, strength);
+
+    KisTextureProperties properties(0);
+    properties.fillProperties(setting, resourcesInterface);
+    QVERIFY(properties.m_enabled);
+
+    const KisPaintInformation info(QPointF(), 0.5);
+
+    /**
+     * The new implementation applies the 8-bit mask through the span
+     * alpha ops, which may round one step differently from the old
+     * per-pixel multiplyAlpha()
+     */
+    const float tolerance = 1.01f / 255.0f;
+
+    const QVector<QPoint> offsets({QPoint(0, 0), QPoint(17, 5), QPoint(100, 250), QPoint(-13, -40)});
+
+    Q_FOREACH (const QPoint &offset, offsets) {
+        KisFixedPaintDeviceSP dab = createDab(cs, QSize(83, 61));
+        KisFixedPaintDeviceSP refDab = createDab(cs, QSize(83, 61));
+
+        properties.apply(dab, offset, info);
+        applyTextureReference(refDab, offset, info, setting, resourcesInterface);
+
+        QVector<float> channels(cs->channelCount());
+        QVector<float> refChannels(cs->channelCount());
+
+        const quint8 *ptr = dab->data();
+        const quint8 *refPtr = refDab->data();
+
+        for (int i = 0; i < dab->bounds().width() * dab->bounds().height(); i++) {
+            cs->normalisedChannelsValue(ptr, channels);
+            cs->normalisedChannelsValue(refPtr, refChannels);
+
+            for (int ch = 0; ch < channels.size(); ch++) {
+                if (qAbs(channels[ch] - refChannels[ch]) > tolerance) {
+                    qDebug() << "offset" << offset << "pixel" << i << "channel" << ch
+                             << "expected" << refChannels[ch] << "actual" << channels[ch];
+                    QFAIL("texture differs from the per-pixel implementation");
+                }
+            }
+
+            ptr += cs->pixelSize();
+            refPtr += cs->pixelSize();
+        }
+    }
+}
+
+KISTEST_MAIN(KisTextureOptionTest)
@@ -43,6 +43,7 @@
 
 KisSprayPaintOp::KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
     : KisPaintOp(painter)
+    , m_renderer(painter)
     , m_isPresetValid(true)
     , m_node(node)
 {
@@ -82,6 +83,8 @@ KisSprayPaintOp::KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter
                                &m_shapeProperties, &m_shapeDynamicsProperties, m_brushOption.brush());
 
     m_sprayBrush.setFixedDab(cachedDab());
+    m_sprayBrush.initRenderingResources(source()->compositionSourceColorSpace(),
+                                        m_renderer.maxThreads());
 
     // spacing
     if ((m_properties.diameter * 0.5) > 1) {
@@ -109,37 +112,43 @@ KisSpacingInformation KisSprayPaintOp::paintAt(const KisPaintInformation& info)
         return KisSpacingInformation(m_spacing);
     }
 
-    if (!m_dab) {
-        m_dab = source()->createCompositionSourceDevice();
-    }
-    else {
-        m_dab->clear();
-    }
-
     qreal rotation = m_rotationOption.apply(info);
     quint8 origOpacity = m_opacityOption.apply(painter(), info);
+    const quint8 dabOpacity = painter()->opacity();
+    painter()->setOpacity(origOpacity);
+
     // Spray Brush is capable of working with zero scale,
     // so no additional checks for 'zero'ness are needed
     const qreal scale = m_sizeOption.apply(info);
     const qreal lodScale = KisLodTransform::lodToScale(painter()->device());
 
-
-    m_sprayBrush.paint(m_dab,
-                       m_node->paintDevice(),
-                       info,
-                       rotation,
-                       scale, lodScale,
-                       painter()->paintColor(),
-                       painter()->backgroundColor());
-
-    QRect rc = m_dab->extent();
-    painter()->bitBlt(rc.topLeft(), m_dab, rc);
-    painter()->renderMirrorMask(rc, m_dab);
-    painter()->setOpacity(origOpacity);
+    /**
+     * The particles are generated right here, in the stroke thread, and
+     * rendered later by the asynchronous updates of the paintop.
+     */
+    SprayBrush::DabSP dab =
+        m_sprayBrush.generateDab(m_node->paintDevice(),
+                                 info,
+                                 rotation,
+                                 scale, lodScale,
+                                 painter()->paintColor(),
+                                 painter()->backgroundColor());
+
+    SprayBrush *sprayBrush = &m_sprayBrush;
+
+    m_renderer.addDab(dab->bounds, dabOpacity,
+        [sprayBrush, dab] (KisPaintDeviceSP dst, const QRect &tileRect, int threadId) {
+            sprayBrush->renderDab(dab, dst, tileRect, threadId);
+        });
 
     return computeSpacing(info, lodScale);
 }
 
+std::pair<int, bool> KisSprayPaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_renderer.doAsyncronousUpdate(jobs);
+}
+
 KisSpacingInformation KisSprayPaintOp::updateSpacingImpl(const KisPaintInformation &info) const
 {
     return computeSpacing(info, KisLodTransform::lodToScale(painter()->device()));
@@ -30,6 +30,7 @@
 #include <kis_pressure_opacity_option.h>
 #include <kis_pressure_size_option.h>
 #include <kis_pressure_rate_option.h>
+#include <KisTiledParticleRenderer.h>
 
 class KisPainter;
 
@@ -44,6 +45,8 @@ public:
 
     static QList<KoResourceSP> prepareLinkedResources(const KisPaintOpSettingsSP settings, KisResourcesInterfaceSP resourcesInterface);
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 protected:
 
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
@@ -62,8 +65,8 @@ private:
     KisColorProperties m_colorProperties;
     KisBrushOptionProperties m_brushOption;
 
-    KisPaintDeviceSP m_dab;
     SprayBrush m_sprayBrush;
+    KisTiledParticleRenderer m_renderer;
     qreal m_xSpacing, m_ySpacing, m_spacing;
     bool m_isPresetValid;
     KisAirbrushOptionProperties m_airbrushOption;
@@ -66,6 +66,11 @@ bool KisSprayPaintOpSettings::paintIncremental()
     return (enumPaintActionType)getInt("PaintOpAction", WASH) == BUILDUP;
 }
 
+bool KisSprayPaintOpSettings::needsAsynchronousUpdates() const
+{
+    return true;
+}
+
 
 QPainterPath KisSprayPaintOpSettings::brushOutline(const KisPaintInformation &info, const OutlineMode &mode, qreal alignForZoom)
 {
@@ -45,6 +45,8 @@ public:
 
     bool paintIncremental() override;
 
+    bool needsAsynchronousUpdates() const override;
+
 protected:
 
     QList<KisUniformPaintOpPropertySP> uniformProperties(KisPaintOpSettingsSP settings) override;
@@ -30,6 +30,7 @@
 #include <QHash>
 #include <QTransform>
 #include <QImage>
+#include <QScopedPointer>
 
 #include <kis_random_accessor_ng.h>
 #include <kis_random_sub_accessor.h>
@@ -40,6 +41,7 @@
 #include <brushengine/kis_paint_information.h>
 #include <kis_fixed_paint_device.h>
 #include <kis_cross_device_color_picker.h>
+#include <kis_assert.h>
 
 #include "kis_spray_paintop_settings.h"
 
@@ -48,15 +50,44 @@
 
 #include <QtGlobal>
 
+namespace {
+
+inline QRect particleBounds(const QPointF &center, qreal width, qreal height)
+{
+    // a conservative estimation: the shape may be rotated and the
+    // painter adds one pixel for anti-aliasing
+    const qreal radius = 0.5 * std::sqrt(pow2(width) + pow2(height)) + 2.0;
+    return QRectF(center.x() - radius, center.y() - radius, 2.0 * radius, 2.0 * radius).toAlignedRect();
+}
+
+inline void writePixel(KisRandomAccessorSP &writeAccessor, int x, int y, const quint8 *data, quint8 pixelSize, const QRect &tileRect)
+{
+    if (!tileRect.contains(x, y)) return;
+
+    writeAccessor->moveTo(x, y);
+    memcpy(writeAccessor->rawData(), data, pixelSize);
+}
+
+}
+
+struct SprayBrush::RenderingResources
+{
+    KisBrushSP brush;
+    KisFixedPaintDeviceSP fixedDab;
+    QImage brushQImage;
+    QScopedPointer<KoColorTransformation> transfo;
+};
+
 SprayBrush::SprayBrush()
 {
-    m_painter = 0;
     m_transfo = 0;
+    m_dabPixelSize = 0;
+    m_paintOpacity = OPACITY_OPAQUE_U8;
 }
 
 SprayBrush::~SprayBrush()
 {
-    delete m_painter;
+    qDeleteAll(m_renderingResources);
     delete m_transfo;
 }
 
@@ -103,39 +134,53 @@ qreal SprayBrush::rotationAngle(KisRandomSourceSP randomSource)
     return rotation;
 }
 
+void SprayBrush::initRenderingResources(const KoColorSpace *dabColorSpace, int numThreads)
+{
+    m_dabPixelSize = dabColorSpace->pixelSize();
 
+    if (m_colorProperties->useRandomHSV) {
+        m_transfo = dabColorSpace->createColorTransformation("hsv_adjustment", QHash<QString, QVariant>());
+    }
 
-void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
-                       const KisPaintInformation& info,
-                       qreal rotation, qreal scale,
-                       qreal additionalScale,
-                       const KoColor &color, const KoColor &bgColor)
-{
-    KisRandomSourceSP randomSource = info.randomSource();
+    m_brushQImage = m_shapeProperties->image;
+    if (!m_brushQImage.isNull()) {
+        m_brushQImage = m_brushQImage.scaled(m_shapeProperties->width, m_shapeProperties->height);
+    }
 
-    // initializing painter
-    if (!m_painter) {
-        m_painter = new KisPainter(dab);
-        m_painter->setFillStyle(KisPainter::FillStyleForegroundColor);
-        m_painter->setMaskImageSize(m_shapeProperties->width, m_shapeProperties->height);
-        m_dabPixelSize = dab->colorSpace()->pixelSize();
-        if (m_colorProperties->useRandomHSV) {
-            m_transfo = dab->colorSpace()->createColorTransformation("hsv_adjustment", QHash<QString, QVariant>());
+    for (int i = 0; i < numThreads; i++) {
+        RenderingResources *resources = new RenderingResources();
+
+        if (m_brush) {
+            resources->brush = m_brush->clone().dynamicCast<KisBrush>();
+            resources->brush->setThreadingAllowed(false);
         }
 
-        m_brushQImage = m_shapeProperties->image;
-        if (!m_brushQImage.isNull()) {
-            m_brushQImage = m_brushQImage.scaled(m_shapeProperties->width, m_shapeProperties->height);
+        resources->fixedDab = new KisFixedPaintDevice(dabColorSpace);
+        resources->brushQImage = m_brushQImage;
+
+        if (m_colorProperties->useRandomHSV) {
+            resources->transfo.reset(dabColorSpace->createColorTransformation("hsv_adjustment", QHash<QString, QVariant>()));
         }
-        m_imageDevice = new KisPaintDevice(dab->colorSpace());
+
+        m_renderingResources.append(resources);
     }
+}
 
+SprayBrush::DabSP SprayBrush::generateDab(KisPaintDeviceSP source,
+                                          const KisPaintInformation& info,
+                                          qreal rotation, qreal scale,
+                                          qreal additionalScale,
+                                          const KoColor &color, const KoColor &bgColor)
+{
+    KisRandomSourceSP randomSource = info.randomSource();
+
+    QSharedPointer<Dab> dab(new Dab(info));
+    dab->additionalScale = additionalScale;
 
     qreal x = info.pos().x();
     qreal y = info.pos().y();
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG();
 
-    Q_ASSERT(color.colorSpace()->pixelSize() == dab->pixelSize());
+    Q_ASSERT(color.colorSpace()->pixelSize() == m_dabPixelSize);
     m_inkColor = color;
     KisCrossDeviceColorPicker colorPicker(source, m_inkColor);
 
@@ -158,19 +203,29 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
         m_particlesCount = m_properties->particleCount;
     }
 
+    dab->particles.reserve(m_particlesCount);
+
     QHash<QString, QVariant> params;
     qreal nx, ny;
-    int ix, iy;
 
     qreal angle;
     qreal length;
     qreal rotationZ = 0.0;
     qreal particleScale = 1.0;
 
+    qreal hue = 0.0;
+    qreal saturation = 0.0;
+    qreal value = 0.0;
+
     bool shouldColor = true;
     if (m_colorProperties->fillBackground) {
-        m_painter->setPaintColor(bgColor);
-        paintCircle(m_painter, x, y, m_radius);
+        dab->fillBackground = true;
+        dab->center = QPointF(x, y);
+        dab->radius = m_radius;
+        dab->bgColor = bgColor;
+        dab->bgOpacity = m_paintOpacity;
+        dab->bgBounds = particleBounds(dab->center, 2.0 * m_radius, 2.0 * m_radius);
+        dab->bounds = dab->bgBounds;
     }
 
     QTransform m;
@@ -178,6 +233,11 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
     m.rotateRadians(-rotation + deg2rad(m_properties->brushRotation));
     m.scale(m_properties->scale, m_properties->scale);
 
+    const bool isPipeBrush =
+        !m_shapeProperties->enabled &&
+        (m_brush->brushType() == PIPE_IMAGE ||
+         m_brush->brushType() == PIPE_MASK);
+
     for (quint32 i = 0; i < m_particlesCount; i++) {
         // generate random angle
         angle = randomSource->generateNormalized() * M_PI * 2;
@@ -229,7 +289,7 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
 
             // mix the color with background color
             if (m_colorProperties->mixBgColor) {
-                KoMixColorsOp * mixOp = dab->colorSpace()->mixColorsOp();
+                KoMixColorsOp * mixOp = m_inkColor.colorSpace()->mixColorsOp();
 
                 const quint8 *colors[2];
                 colors[0] = m_inkColor.data();
@@ -245,9 +305,12 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             }
 
             if (m_colorProperties->useRandomHSV && m_transfo) {
-                params["h"] = (m_colorProperties->hue / 180.0) * randomSource->generateNormalized();
-                params["s"] = (m_colorProperties->saturation / 100.0) * randomSource->generateNormalized();
-                params["v"] = (m_colorProperties->value / 100.0) * randomSource->generateNormalized();
+                hue = (m_colorProperties->hue / 180.0) * randomSource->generateNormalized();
+                saturation = (m_colorProperties->saturation / 100.0) * randomSource->generateNormalized();
+                value = (m_colorProperties->value / 100.0) * randomSource->generateNormalized();
+                params["h"] = hue;
+                params["s"] = saturation;
+                params["v"] = value;
                 m_transfo->setParameters(params);
                 m_transfo->setParameter(3, 1);//sets the type to HSV. For some reason 0 is not an option.
                 m_transfo->setParameter(4, false);//sets the colorize to false.
@@ -257,82 +320,60 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             if (m_colorProperties->useRandomOpacity) {
                 quint8 alpha = qRound(randomSource->generateNormalized() * OPACITY_OPAQUE_U8);
                 m_inkColor.setOpacity(alpha);
-                m_painter->setOpacity(alpha);
+                m_paintOpacity = alpha;
             }
 
             if (!m_colorProperties->colorPerParticle) {
                 shouldColor = false;
             }
-
-            m_painter->setPaintColor(m_inkColor);
         }
 
-        qreal jitteredWidth = qMax(1.0 * additionalScale, m_shapeProperties->width * particleScale * additionalScale);
-        qreal jitteredHeight = qMax(1.0 * additionalScale, m_shapeProperties->height * particleScale * additionalScale);
+        Particle particle;
+        particle.pos = QPointF(nx + x, ny + y);
+        particle.width = qMax(1.0 * additionalScale, m_shapeProperties->width * particleScale * additionalScale);
+        particle.height = qMax(1.0 * additionalScale, m_shapeProperties->height * particleScale * additionalScale);
+        particle.rotationZ = rotationZ;
+        particle.particleScale = particleScale;
+        particle.color = m_inkColor;
+        particle.opacity = m_paintOpacity;
+        particle.hue = hue;
+        particle.saturation = saturation;
+        particle.value = value;
 
         if (m_shapeProperties->enabled){
         switch (m_shapeProperties->shape){
             // ellipse
             case 0:
-            {
-                if (m_shapeProperties->width == m_shapeProperties->height){
-                    paintCircle(m_painter, nx + x, ny + y, jitteredWidth * 0.5);
-                }
-                else {
-                    paintEllipse(m_painter, nx + x, ny + y, jitteredWidth * 0.5 , jitteredHeight * 0.5, rotationZ);
-                }
-                break;
-            }
             // rectangle
             case 1:
             {
-                paintRectangle(m_painter, nx + x, ny + y, qRound(jitteredWidth) , qRound(jitteredHeight), rotationZ);
+                particle.bounds = particleBounds(particle.pos, particle.width, particle.height);
                 break;
             }
             // wu-particle
             case 2: {
-                paintParticle(accessor, m_inkColor, nx + x, ny + y);
+                particle.bounds = QRect(int(particle.pos.x()), int(particle.pos.y()), 2, 2);
                 break;
             }
             // pixel
             case 3: {
-                ix = qRound(nx + x);
-                iy = qRound(ny + y);
-                accessor->moveTo(ix, iy);
-                memcpy(accessor->rawData(), m_inkColor.data(), m_dabPixelSize);
+                particle.bounds = QRect(qRound(particle.pos.x()), qRound(particle.pos.y()), 1, 1);
                 break;
             }
             case 4: {
                 if (!m_brushQImage.isNull()) {
-
-                    QTransform m;
-                    m.rotate(rad2deg(rotationZ));
-                    m.scale(additionalScale, additionalScale);
+                    qreal imageScale = additionalScale;
 
                     if (m_shapeDynamicsProperties->randomSize) {
-                        m.scale(particleScale, particleScale);
+                        imageScale *= particleScale;
                     }
-                    m_transformed = m_brushQImage.transformed(m, Qt::SmoothTransformation);
-                    m_imageDevice->convertFromQImage(m_transformed, 0);
-                    KisRandomAccessorSP ac = m_imageDevice->createRandomAccessorNG();
-                    QRect rc = m_transformed.rect();
-
-                    if (m_colorProperties->useRandomHSV && m_transfo) {
 
-                        for (int y = rc.y(); y < rc.y() + rc.height(); y++) {
-                            for (int x = rc.x(); x < rc.x() + rc.width(); x++) {
-                                ac->moveTo(x, y);
-                                m_transfo->transform(ac->rawData(), ac->rawData() , 1);
-                            }
-                        }
-                    }
-
-                    ix = qRound(nx + x - rc.width() * 0.5);
-                    iy = qRound(ny + y - rc.height() * 0.5);
-                    m_painter->bitBlt(QPoint(ix, iy), m_imageDevice, rc);
-                    m_imageDevice->clear();
-                    break;
+                    particle.bounds = particleBounds(particle.pos,
+                                                     m_brushQImage.width() * imageScale,
+                                                     m_brushQImage.height() * imageScale);
+                    particle.renderedTip.reset(new RenderedTip());
                 }
+                break;
             }
             }
             // Auto-brush
@@ -340,47 +381,239 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
         else {
             KisDabShape shape(particleScale * additionalScale, 1.0, -rotationZ);
             QPointF hotSpot = m_brush->hotSpot(shape, info);
-            QPointF pos(nx + x, ny + y);
-            QPointF pt = pos - hotSpot;
+            QPointF pt = particle.pos - hotSpot;
 
             qint32 ix;
-            qreal xFraction;
             qint32 iy;
-            qreal yFraction;
 
-            KisPaintOp::splitCoordinate(pt.x(), &ix, &xFraction);
-            KisPaintOp::splitCoordinate(pt.y(), &iy, &yFraction);
+            KisPaintOp::splitCoordinate(pt.x(), &ix, &particle.tipXFraction);
+            KisPaintOp::splitCoordinate(pt.y(), &iy, &particle.tipYFraction);
+
+            particle.tipPos = QPoint(ix, iy);
 
-            //KisFixedPaintDeviceSP dab;
-            if (m_brush->brushType() == IMAGE ||
-                    m_brush->brushType() == PIPE_IMAGE) {
-                m_fixedDab = m_brush->paintDevice(m_fixedDab->colorSpace(),
-                          shape, info, xFraction, yFraction);
+            /**
+             * Pipe brushes change their state on every painted dab, so
+             * their tips are rendered right here, in the order of the
+             * particles. All the other brushes are rendered in the
+             * worker threads.
+             */
+            if (isPipeBrush) {
+                if (m_brush->brushType() == PIPE_IMAGE) {
+                    particle.tip = m_brush->paintDevice(m_fixedDab->colorSpace(),
+                              shape, info, particle.tipXFraction, particle.tipYFraction);
 
-                if (m_colorProperties->useRandomHSV && m_transfo) {
-                    quint8 * dabPointer = m_fixedDab->data();
-                    int pixelCount = m_fixedDab->bounds().width() * m_fixedDab->bounds().height();
-                    m_transfo->transform(dabPointer, dabPointer, pixelCount);
+                    if (m_colorProperties->useRandomHSV && m_transfo) {
+                        quint8 * dabPointer = particle.tip->data();
+                        int pixelCount = particle.tip->bounds().width() * particle.tip->bounds().height();
+                        m_transfo->transform(dabPointer, dabPointer, pixelCount);
+                    }
+                }
+                else {
+                    particle.tip = new KisFixedPaintDevice(m_fixedDab->colorSpace());
+                    m_brush->mask(particle.tip, m_inkColor, shape,
+                                  info, particle.tipXFraction, particle.tipYFraction);
                 }
 
+                particle.bounds = QRect(particle.tipPos, particle.tip->bounds().size());
             }
             else {
-                m_brush->mask(m_fixedDab, m_inkColor, shape,
-                              info, xFraction, yFraction);
+                particle.renderedTip.reset(new RenderedTip());
+                particle.bounds =
+                    QRect(particle.tipPos,
+                          QSize(m_brush->maskWidth(shape, particle.tipXFraction, particle.tipYFraction, info),
+                                m_brush->maskHeight(shape, particle.tipXFraction, particle.tipYFraction, info)));
             }
-            m_painter->bltFixed(QPoint(ix, iy), m_fixedDab, m_fixedDab->bounds());
         }
+
+        if (!particle.bounds.isEmpty()) {
+            dab->bounds |= particle.bounds;
+            dab->particles.append(particle);
+        }
+
         if (m_colorProperties->colorPerParticle){
             m_inkColor=color;//reset color//
         }
     }
     // recover from jittering of color,
     // m_inkColor.opacity is recovered with every paint
+
+    return dab;
+}
+
+void SprayBrush::renderDab(DabSP dab, KisPaintDeviceSP dst, const QRect &tileRect, int threadId)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(threadId >= 0 && threadId < m_renderingResources.size());
+    RenderingResources *resources = m_renderingResources[threadId];
+
+    KisPainter painter(dst);
+    painter.setFillStyle(KisPainter::FillStyleForegroundColor);
+    painter.setMaskImageSize(m_shapeProperties->width, m_shapeProperties->height);
+
+    KisRandomAccessorSP accessor = dst->createRandomAccessorNG();
+
+    if (dab->fillBackground && dab->bgBounds.intersects(tileRect)) {
+        painter.setPaintColor(dab->bgColor);
+        painter.setOpacity(dab->bgOpacity);
+        paintCircle(&painter, dab->center.x(), dab->center.y(), dab->radius, tileRect);
+    }
+
+    Q_FOREACH (const Particle &particle, dab->particles) {
+        if (!particle.bounds.intersects(tileRect)) continue;
+
+        painter.setPaintColor(particle.color);
+        painter.setOpacity(particle.opacity);
+
+        const qreal x = particle.pos.x();
+        const qreal y = particle.pos.y();
+
+        if (m_shapeProperties->enabled){
+        switch (m_shapeProperties->shape){
+            // ellipse
+            case 0:
+            {
+                if (m_shapeProperties->width == m_shapeProperties->height){
+                    paintCircle(&painter, x, y, particle.width * 0.5, tileRect);
+                }
+                else {
+                    paintEllipse(&painter, x, y, particle.width * 0.5 , particle.height * 0.5, particle.rotationZ, tileRect);
+                }
+                break;
+            }
+            // rectangle
+            case 1:
+            {
+                paintRectangle(&painter, x, y, qRound(particle.width) , qRound(particle.height), particle.rotationZ, tileRect);
+                break;
+            }
+            // wu-particle
+            case 2: {
+                paintParticle(accessor, particle.color, x, y, tileRect);
+                break;
+            }
+            // pixel
+            case 3: {
+                writePixel(accessor, qRound(x), qRound(y), particle.color.data(), m_dabPixelSize, tileRect);
+                break;
+            }
+            case 4: {
+                paintImage(&painter, particle, dab->additionalScale, resources, tileRect);
+                break;
+            }
+            }
+            // Auto-brush
+        }
+        else {
+            paintBrushTip(&painter, particle, *dab, resources, tileRect);
+        }
+    }
 }
 
+void SprayBrush::paintImage(KisPainter *painter, const Particle &particle, qreal additionalScale,
+                            RenderingResources *resources, const QRect &tileRect)
+{
+    if (resources->brushQImage.isNull()) return;
+    KIS_SAFE_ASSERT_RECOVER_RETURN(particle.renderedTip);
+
+    KisFixedPaintDeviceSP image;
+
+    {
+        QMutexLocker l(&particle.renderedTip->mutex);
+
+        if (!particle.renderedTip->device) {
+            QTransform m;
+            m.rotate(rad2deg(particle.rotationZ));
+            m.scale(additionalScale, additionalScale);
+
+            if (m_shapeDynamicsProperties->randomSize) {
+                m.scale(particle.particleScale, particle.particleScale);
+            }
+
+            const QImage transformed = resources->brushQImage.transformed(m, Qt::SmoothTransformation);
 
+            KisFixedPaintDeviceSP device = new KisFixedPaintDevice(resources->fixedDab->colorSpace());
+            device->convertFromQImage(transformed, 0);
+
+            if (m_colorProperties->useRandomHSV && resources->transfo) {
+                setRandomHSVParameters(resources->transfo.data(), particle);
+                resources->transfo->transform(device->data(), device->data(),
+                                              device->bounds().width() * device->bounds().height());
+            }
+
+            particle.renderedTip->device = device;
+        }
+
+        image = particle.renderedTip->device;
+    }
+
+    const QRect rc = image->bounds();
+
+    const int ix = qRound(particle.pos.x() - rc.width() * 0.5);
+    const int iy = qRound(particle.pos.y() - rc.height() * 0.5);
+
+    const QRect dstRect = QRect(QPoint(ix, iy), rc.size()) & tileRect;
+    if (dstRect.isEmpty()) return;
+
+    painter->bltFixed(dstRect.topLeft(), image, dstRect.translated(-ix, -iy));
+}
+
+void SprayBrush::paintBrushTip(KisPainter *painter, const Particle &particle, const Dab &dab,
+                               RenderingResources *resources, const QRect &tileRect)
+{
+    KisFixedPaintDeviceSP tip = particle.tip;
+
+    if (!tip) {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(particle.renderedTip);
+        QMutexLocker l(&particle.renderedTip->mutex);
+
+        if (!particle.renderedTip->device) {
+            KisBrushSP brush = resources->brush;
+            KIS_SAFE_ASSERT_RECOVER_RETURN(brush);
+
+            KisDabShape shape(particle.particleScale * dab.additionalScale, 1.0, -particle.rotationZ);
+            KisFixedPaintDeviceSP device;
+
+            if (brush->brushType() == IMAGE) {
+                device = brush->paintDevice(resources->fixedDab->colorSpace(),
+                                            shape, dab.info, particle.tipXFraction, particle.tipYFraction);
+
+                if (m_colorProperties->useRandomHSV && resources->transfo) {
+                    setRandomHSVParameters(resources->transfo.data(), particle);
+
+                    quint8 * dabPointer = device->data();
+                    int pixelCount = device->bounds().width() * device->bounds().height();
+                    resources->transfo->transform(dabPointer, dabPointer, pixelCount);
+                }
+            }
+            else {
+                device = new KisFixedPaintDevice(resources->fixedDab->colorSpace());
+                brush->mask(device, particle.color, shape,
+                            dab.info, particle.tipXFraction, particle.tipYFraction);
+            }
+
+            particle.renderedTip->device = device;
+        }
+
+        tip = particle.renderedTip->device;
+    }
+
+    const QRect dstRect = QRect(particle.tipPos, tip->bounds().size()) & tileRect;
+    if (dstRect.isEmpty()) return;
+
+    painter->bltFixed(dstRect.topLeft(), tip, dstRect.translated(-particle.tipPos));
+}
+
+void SprayBrush::setRandomHSVParameters(KoColorTransformation *transfo, const Particle &particle)
+{
+    QHash<QString, QVariant> params;
+    params["h"] = particle.hue;
+    params["s"] = particle.saturation;
+    params["v"] = particle.value;
+    transfo->setParameters(params);
+    transfo->setParameter(3, 1);//sets the type to HSV. For some reason 0 is not an option.
+    transfo->setParameter(4, false);//sets the colorize to false.
+}
 
-void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry)
+void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry, const QRect &tileRect)
 {
     // opacity top left, right, bottom left, right
     KoColor pcolor(color);
@@ -401,31 +634,27 @@ void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor
     // Maybe some kind of compositing using here would be cool
 
     pcolor.setOpacity(btl);
-    writeAccessor->moveTo(ipx  , ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    writePixel(writeAccessor, ipx, ipy, pcolor.data(), m_dabPixelSize, tileRect);
 
     pcolor.setOpacity(btr);
-    writeAccessor->moveTo(ipx + 1, ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    writePixel(writeAccessor, ipx + 1, ipy, pcolor.data(), m_dabPixelSize, tileRect);
 
     pcolor.setOpacity(bbl);
-    writeAccessor->moveTo(ipx, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    writePixel(writeAccessor, ipx, ipy + 1, pcolor.data(), m_dabPixelSize, tileRect);
 
     pcolor.setOpacity(bbr);
-    writeAccessor->moveTo(ipx + 1, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    writePixel(writeAccessor, ipx + 1, ipy + 1, pcolor.data(), m_dabPixelSize, tileRect);
 }
 
-void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius)
+void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius, const QRect &tileRect)
 {
     QPainterPath path;
     path.addEllipse(QPointF(x,y),radius,radius);
-    painter->fillPainterPath(path);
+    painter->fillPainterPath(path, tileRect);
 }
 
 
-void SprayBrush::paintEllipse(KisPainter* painter, qreal x, qreal y, qreal a, qreal b, qreal angle)
+void SprayBrush::paintEllipse(KisPainter* painter, qreal x, qreal y, qreal a, qreal b, qreal angle, const QRect &tileRect)
 {
     QPainterPath path;
     path.addEllipse(QPointF(), a, b);
@@ -433,10 +662,10 @@ void SprayBrush::paintEllipse(KisPainter* painter, qreal x, qreal y, qreal a, qr
     t.translate(x, y);
     t.rotateRadians(angle);
     path = t.map(path);
-    painter->fillPainterPath(path);
+    painter->fillPainterPath(path, tileRect);
 }
 
-void SprayBrush::paintRectangle(KisPainter* painter, qreal x, qreal y, qreal width, qreal height, qreal angle)
+void SprayBrush::paintRectangle(KisPainter* painter, qreal x, qreal y, qreal width, qreal height, qreal angle, const QRect &tileRect)
 {
     QPainterPath path;
     path.addRect(QRectF(-0.5 * width, -0.5 * height, width, height));
@@ -444,7 +673,7 @@ void SprayBrush::paintRectangle(KisPainter* painter, qreal x, qreal y, qreal wid
     t.translate(x, y);
     t.rotateRadians(angle);
     path = t.map(path);
-    painter->fillPainterPath(path);
+    painter->fillPainterPath(path, tileRect);
 }
 
 
@@ -32,18 +32,97 @@
 
 
 #include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
 #include <kis_brush.h>
+#include <brushengine/kis_paint_information.h>
 
-class KisPaintInformation;
+class KoColorSpace;
 
 class SprayBrush
 {
 
+public:
+    /**
+     * The parameters of a single particle of the dab. All of them are
+     * generated in the stroke thread, so the sequence of the random
+     * numbers doesn't depend on how the dab is split into tiles.
+     */
+    /**
+     * The tip of a particle, rendered by the first tile job that needs
+     * it and reused by the jobs of all the other tiles it overlaps
+     */
+    struct RenderedTip {
+        QMutex mutex;
+        KisFixedPaintDeviceSP device;
+    };
+
+    struct Particle {
+        QPointF pos;
+        QRect bounds;
+
+        qreal width = 0.0;
+        qreal height = 0.0;
+        qreal rotationZ = 0.0;
+        qreal particleScale = 1.0;
+
+        KoColor color;
+        quint8 opacity = OPACITY_OPAQUE_U8;
+
+        /// parameters of the random HSV transformation
+        qreal hue = 0.0;
+        qreal saturation = 0.0;
+        qreal value = 0.0;
+
+        /// position of the brush tip, if the brush is used as a shape
+        QPoint tipPos;
+        qreal tipXFraction = 0.0;
+        qreal tipYFraction = 0.0;
+
+        /// the brush tip pre-rendered in the stroke thread (pipe brushes only)
+        KisFixedPaintDeviceSP tip;
+
+        /// the tip or the image rendered lazily in the worker threads
+        QSharedPointer<RenderedTip> renderedTip;
+    };
+
+    struct Dab {
+        Dab(const KisPaintInformation &_info) : info(_info) {}
+
+        KisPaintInformation info;
+        qreal additionalScale = 1.0;
+
+        bool fillBackground = false;
+        QPointF center;
+        qreal radius = 0.0;
+        KoColor bgColor;
+        quint8 bgOpacity = OPACITY_OPAQUE_U8;
+        QRect bgBounds;
+
+        QVector<Particle> particles;
+        QRect bounds;
+    };
+
+    typedef QSharedPointer<const Dab> DabSP;
+
 public:
     SprayBrush();
     ~SprayBrush();
 
-    void paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,  const KisPaintInformation& info, qreal rotation, qreal scale, qreal additionalScale, const KoColor &color, const KoColor &bgColor);
+    /**
+     * Generates all the particles of the dab. Must be called in the
+     * stroke thread, because it consumes the random source of \p info and
+     * advances the pipe brushes.
+     */
+    DabSP generateDab(KisPaintDeviceSP source, const KisPaintInformation& info, qreal rotation, qreal scale, qreal additionalScale, const KoColor &color, const KoColor &bgColor);
+
+    /**
+     * Renders the part of the dab that lies inside \p tileRect. Can be
+     * called concurrently for different values of \p threadId.
+     */
+    void renderDab(DabSP dab, KisPaintDeviceSP dst, const QRect &tileRect, int threadId);
+
     void setProperties(KisSprayOptionProperties * properties,
                        KisColorProperties * colorProperties,
                        KisShapeProperties * shapeProperties,
@@ -52,16 +131,21 @@ public:
 
     void setFixedDab(KisFixedPaintDeviceSP dab);
 
+    /**
+     * Prepares \p numThreads copies of the resources used by renderDab()
+     */
+    void initRenderingResources(const KoColorSpace *dabColorSpace, int numThreads);
+
 private:
+    struct RenderingResources;
+
     KoColor m_inkColor;
     qreal m_radius;
     quint32 m_particlesCount;
     quint8 m_dabPixelSize;
+    quint8 m_paintOpacity;
 
-    KisPainter * m_painter;
-    KisPaintDeviceSP m_imageDevice;
     QImage m_brushQImage;
-    QImage m_transformed;
 
     KoColorTransformation* m_transfo;
 
@@ -73,14 +157,21 @@ private:
     KisBrushSP m_brush;
     KisFixedPaintDeviceSP m_fixedDab;
 
+    QVector<RenderingResources*> m_renderingResources;
+
 private:
     /// rotation in radians according the settings (gauss distribution, uniform distribution or fixed angle)
     qreal rotationAngle(KisRandomSourceSP randomSource);
     /// Paints Wu Particle
-    void paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry);
-    void paintCircle(KisPainter * painter, qreal x, qreal y, qreal radius);
-    void paintEllipse(KisPainter * painter, qreal x, qreal y, qreal a, qreal b, qreal angle);
-    void paintRectangle(KisPainter * painter, qreal x, qreal y, qreal width, qreal height, qreal angle);
+    void paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry, const QRect &tileRect);
+    void paintCircle(KisPainter * painter, qreal x, qreal y, qreal radius, const QRect &tileRect);
+    void paintEllipse(KisPainter * painter, qreal x, qreal y, qreal a, qreal b, qreal angle, const QRect &tileRect);
+    void paintRectangle(KisPainter * painter, qreal x, qreal y, qreal width, qreal height, qreal angle, const QRect &tileRect);
+    void paintImage(KisPainter * painter, const Particle &particle, qreal additionalScale, RenderingResources *resources, const QRect &tileRect);
+    void paintBrushTip(KisPainter * painter, const Particle &particle, const Dab &dab, RenderingResources *resources, const QRect &tileRect);
+
+    /// loads the random HSV parameters of \p particle into \p transfo
+    void setRandomHSVParameters(KoColorTransformation *transfo, const Particle &particle);
 
     void paintOutline(KisPaintDeviceSP dev, const KoColor& painterColor, qreal posX, qreal posY, qreal radius);
 
@@ -138,6 +138,7 @@ void KisToolBrush::slotSetSmoothingType(int index)
         showControl(m_sliderDelayDistance, false);
         showControl(m_chkFinishStabilizedCurve, false);
         showControl(m_chkStabilizeSensors, false);
+        showControl(m_chkPredictStroke, false);
         break;
     case 1:
         smoothingOptions()->setSmoothingType(KisSmoothingOptions::SIMPLE_SMOOTHING);
@@ -148,6 +149,7 @@ void KisToolBrush::slotSetSmoothingType(int index)
         showControl(m_sliderDelayDistance, false);
         showControl(m_chkFinishStabilizedCurve, false);
         showControl(m_chkStabilizeSensors, false);
+        showControl(m_chkPredictStroke, false);
         break;
     case 2:
         smoothingOptions()->setSmoothingType(KisSmoothingOptions::WEIGHTED_SMOOTHING);
@@ -158,6 +160,7 @@ void KisToolBrush::slotSetSmoothingType(int index)
         showControl(m_sliderDelayDistance, false);
         showControl(m_chkFinishStabilizedCurve, false);
         showControl(m_chkStabilizeSensors, false);
+        showControl(m_chkPredictStroke, true);
         break;
     case 3:
     default:
@@ -168,6 +171,7 @@ void KisToolBrush::slotSetSmoothingType(int index)
         showControl(m_sliderDelayDistance, true);
         showControl(m_chkFinishStabilizedCurve, true);
         showControl(m_chkStabilizeSensors, true);
+        showControl(m_chkPredictStroke, true);
 
         // scalable distance option is disabled due to bug 421314
         showControl(m_chkUseScalableDistance, false);
@@ -308,6 +312,17 @@ bool KisToolBrush::stabilizeSensors() const
     return smoothingOptions()->stabilizeSensors();
 }
 
+void KisToolBrush::setPredictStroke(bool value)
+{
+    smoothingOptions()->setPredictStroke(value);
+    emit predictStrokeChanged();
+}
+
+bool KisToolBrush::predictStroke() const
+{
+    return smoothingOptions()->predictStroke();
+}
+
 void KisToolBrush::updateSettingsViews()
 {
     m_cmbSmoothingType->setCurrentIndex(smoothingOptions()->smoothingType());
@@ -320,6 +335,7 @@ void KisToolBrush::updateSettingsViews()
     m_chkUseScalableDistance->setChecked(smoothingOptions()->useScalableDistance());
     m_cmbSmoothingType->setCurrentIndex((int)smoothingOptions()->smoothingType());
     m_chkStabilizeSensors->setChecked(smoothingOptions()->stabilizeSensors());
+    m_chkPredictStroke->setChecked(smoothingOptions()->predictStroke());
 
     emit smoothnessQualityChanged();
     emit smoothnessFactorChanged();
@@ -330,6 +346,7 @@ void KisToolBrush::updateSettingsViews()
     emit delayDistanceChanged();
     emit finishStabilizedCurveChanged();
     emit stabilizeSensorsChanged();
+    emit predictStrokeChanged();
 
     KisTool::updateSettingsViews();
 }
@@ -407,6 +424,18 @@ QWidget * KisToolBrush::createOptionWidget()
     m_chkStabilizeSensors->setChecked(smoothingOptions()->stabilizeSensors());
     addOptionWidgetOption(m_chkStabilizeSensors, new QLabel(i18n("Stabilize Sensors:")));
 
+    // Predict the part of the stroke delayed by smoothing
+    m_chkPredictStroke = new QCheckBox(optionsWidget);
+    m_chkPredictStroke->setMinimumHeight(qMax(m_sliderSmoothnessDistance->sizeHint().height()-3,
+                                              m_chkPredictStroke->sizeHint().height()));
+    m_chkPredictStroke->setToolTip(i18nc("@info:tooltip",
+                                         "Show provisional dabs for the part of the "
+                                         "stroke that is not painted yet, extrapolated "
+                                         "ahead of the cursor"));
+    connect(m_chkPredictStroke, SIGNAL(toggled(bool)), this, SLOT(setPredictStroke(bool)));
+    m_chkPredictStroke->setChecked(smoothingOptions()->predictStroke());
+    addOptionWidgetOption(m_chkPredictStroke, new QLabel(i18n("Predict Stroke:")));
+
 
     m_sliderTailAggressiveness = new KisDoubleSliderSpinBox(optionsWidget);
     m_sliderTailAggressiveness->setRange(0.0, 1.0, 2);
@@ -57,6 +57,7 @@ class KisToolBrush : public KisToolFreehand
 
     Q_PROPERTY(bool finishStabilizedCurve READ finishStabilizedCurve WRITE setFinishStabilizedCurve NOTIFY finishStabilizedCurveChanged)
     Q_PROPERTY(bool stabilizeSensors READ stabilizeSensors WRITE setStabilizeSensors NOTIFY stabilizeSensorsChanged)
+    Q_PROPERTY(bool predictStroke READ predictStroke WRITE setPredictStroke NOTIFY predictStrokeChanged)
 
 
 public:
@@ -76,6 +77,7 @@ public:
 
     bool finishStabilizedCurve() const;
     bool stabilizeSensors() const;
+    bool predictStroke() const;
 
 protected:
     KConfigGroup m_configGroup; // only used in the multihand tool for now
@@ -97,6 +99,7 @@ public Q_SLOTS:
     void setDelayDistance(qreal value);
 
     void setStabilizeSensors(bool value);
+    void setPredictStroke(bool value);
 
     void setFinishStabilizedCurve(bool value);
 
@@ -113,6 +116,7 @@ Q_SIGNALS:
     void delayDistanceChanged();
     void finishStabilizedCurveChanged();
     void stabilizeSensorsChanged();
+    void predictStrokeChanged();
 
 private:
     void addSmoothingAction(int enumId, const QString &id);
@@ -130,6 +134,7 @@ private:
     QCheckBox *m_chkUseScalableDistance {0};
 
     QCheckBox *m_chkStabilizeSensors {0};
+    QCheckBox *m_chkPredictStroke {0};
     QCheckBox *m_chkDelayDistance {0};
     KisDoubleSliderSpinBox *m_sliderDelayDistance {0};
 
@@ -37,7 +37,7 @@
 #include <kis_pixel_selection.h>
 #include "kis_selection_tool_helper.h"
 #include "kis_slider_spin_box.h"
-#include "kis_iterator_ng.h"
+#include "kis_sequential_iterator.h"
 #include "kis_image.h"
 
 void selectByColor(KisPaintDeviceSP dev, KisPixelSelectionSP selection, const quint8 *c, int fuzziness, const QRect & rc)
@@ -46,38 +46,40 @@ void selectByColor(KisPaintDeviceSP dev, KisPixelSelectionSP selection, const qu
         return;
     }
     // XXX: Multithread this!
-    qint32 x, y, w, h;
-    x = rc.x();
-    y = rc.y();
-    w = rc.width();
-    h = rc.height();
 
     const KoColorSpace * cs = dev->colorSpace();
+    const int pixelSize = cs->pixelSize();
 
-    KisHLineConstIteratorSP hiter = dev->createHLineConstIteratorNG(x, y, w);
-    KisHLineIteratorSP selIter = selection->createHLineIteratorNG(x, y, w);
+    KisSequentialConstIterator srcIt(dev, rc);
+    KisSequentialIterator selIt(selection, rc);
 
-    for (int row = y; row < y + h; ++row) {
-        do {
-            //if (dev->colorSpace()->hasAlpha())
-            //    opacity = dev->colorSpace()->alpha(hiter->rawData());
-            if (fuzziness == 1) {
-                if (memcmp(c, hiter->oldRawData(), cs->pixelSize()) == 0) {
-                    *(selIter->rawData()) = MAX_SELECTED;
+    QVector<quint8> differences;
+
+    int numConseqPixels = qMin(srcIt.nConseqPixels(), selIt.nConseqPixels());
+    while (srcIt.nextPixels(numConseqPixels) && selIt.nextPixels(numConseqPixels)) {
+        numConseqPixels = qMin(srcIt.nConseqPixels(), selIt.nConseqPixels());
+
+        const quint8 *srcPtr = srcIt.oldRawData();
+        quint8 *selPtr = selIt.rawData();
+
+        if (fuzziness == 1) {
+            for (int i = 0; i < numConseqPixels; i++) {
+                if (memcmp(c, srcPtr + i * pixelSize, pixelSize) == 0) {
+                    selPtr[i] = MAX_SELECTED;
                 }
             }
-            else {
-                quint8 match = cs->difference(c, hiter->oldRawData());
-                if (match <= fuzziness) {
-                    *(selIter->rawData()) = MAX_SELECTED;
+        }
+        else {
+            differences.resize(numConseqPixels);
+            cs->differenceSpan(c, srcPtr, differences.data(), numConseqPixels);
+
+            for (int i = 0; i < numConseqPixels; i++) {
+                if (differences[i] <= fuzziness) {
+                    selPtr[i] = MAX_SELECTED;
                 }
             }
         }
-        while (hiter->nextPixel() && selIter->nextPixel());
-        hiter->nextRow();
-        selIter->nextRow();
     }
-
 }
 
 
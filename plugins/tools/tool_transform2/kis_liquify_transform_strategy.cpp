@@ -51,7 +51,9 @@ struct KisLiquifyTransformStrategy::Private
           currentArgs(_currentArgs),
           transaction(_transaction),
           helper(_converter),
-          recalculateOnNextRedraw(false)
+          recalculateOnNextRedraw(false),
+          previewWorker(0),
+          previewCacheKey(0)
     {
     }
 
@@ -86,6 +88,13 @@ struct KisLiquifyTransformStrategy::Private
 
     bool recalculateOnNextRedraw;
 
+    // the state transformedImage was generated for
+    QImage previewSourceImage;
+    const KisLiquifyTransformWorker *previewWorker;
+    qint64 previewCacheKey;
+    QTransform previewThumbTransform;
+    QTransform previewImageToThumbTransform;
+
     void recalculateTransformations();
     inline QPointF imageToThumb(const QPointF &pt, bool useFlakeOptimization);
 };
@@ -269,6 +278,15 @@ void KisLiquifyTransformStrategy::Private::recalculateTransformations()
 {
     KIS_ASSERT_RECOVER_RETURN(currentArgs.liquifyWorker());
 
+    KisLiquifyTransformWorker *worker = currentArgs.liquifyWorker();
+
+    /**
+     * While painting only a small part of the grid is changed, so we
+     * regenerate only the corresponding part of the preview
+     */
+    QRect changedRect;
+    const bool changesAreLocal = worker->takeChangedRect(&changedRect);
+
     QTransform scaleTransform = KisTransformUtils::imageToFlakeTransform(converter);
 
     QTransform resultThumbTransform = q->thumbToImageTransform() * scaleTransform;
@@ -276,15 +294,8 @@ void KisLiquifyTransformStrategy::Private::recalculateTransformations()
     bool useFlakeOptimization = scale < 1.0 &&
         !KisTransformUtils::thumbnailTooSmall(resultThumbTransform, q->originalImage().rect());
 
-    paintingOffset = transaction.originalTopLeft();
     if (!q->originalImage().isNull()) {
-        if (useFlakeOptimization) {
-            transformedImage = q->originalImage().transformed(resultThumbTransform);
-            paintingTransform = QTransform();
-        } else {
-            transformedImage = q->originalImage();
-            paintingTransform = resultThumbTransform;
-        }
+        paintingTransform = useFlakeOptimization ? QTransform() : resultThumbTransform;
 
         QTransform imageToRealThumbTransform =
             useFlakeOptimization ?
@@ -294,15 +305,46 @@ void KisLiquifyTransformStrategy::Private::recalculateTransformations()
         QPointF origTLInFlake =
             imageToRealThumbTransform.map(transaction.originalTopLeft());
 
-        transformedImage =
-            currentArgs.liquifyWorker()->runOnQImage(transformedImage,
-                                                     origTLInFlake,
-                                                     imageToRealThumbTransform,
-                                                     &paintingOffset);
+        const bool canUpdatePreview =
+            changesAreLocal &&
+            previewWorker == worker &&
+            !previewSourceImage.isNull() &&
+            previewCacheKey == q->originalImage().cacheKey() &&
+            previewThumbTransform == resultThumbTransform &&
+            previewImageToThumbTransform == imageToRealThumbTransform;
+
+        if (!canUpdatePreview ||
+            !worker->runOnQImagePartial(previewSourceImage,
+                                        origTLInFlake,
+                                        imageToRealThumbTransform,
+                                        changedRect,
+                                        &transformedImage,
+                                        paintingOffset)) {
+
+            previewSourceImage =
+                useFlakeOptimization ?
+                q->originalImage().transformed(resultThumbTransform) :
+                q->originalImage();
+
+            paintingOffset = transaction.originalTopLeft();
+            transformedImage =
+                worker->runOnQImage(previewSourceImage,
+                                    origTLInFlake,
+                                    imageToRealThumbTransform,
+                                    &paintingOffset);
+
+            previewWorker = worker;
+            previewCacheKey = q->originalImage().cacheKey();
+            previewThumbTransform = resultThumbTransform;
+            previewImageToThumbTransform = imageToRealThumbTransform;
+        }
     } else {
         transformedImage = q->originalImage();
         paintingOffset = imageToThumb(transaction.originalTopLeft(), false);
         paintingTransform = resultThumbTransform;
+
+        previewSourceImage = QImage();
+        previewWorker = 0;
     }
 
     handlesTransform = scaleTransform;